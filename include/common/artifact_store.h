@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+// Environment variables that point every tool at a shared store, e.g. on a network mount, and bound its size.
+#define ARTIFACT_STORE_ENV "AST_ARTIFACT_STORE"
+#define ARTIFACT_STORE_SIZE_ENV "AST_ARTIFACT_STORE_SIZE_MB"
+#define ARTIFACT_STORE_DEFAULT_SIZE (16ull << 30)
+
+namespace ast
+{
+// Content addressed store of converted files shared by processes and machines. Every artifact is a single output
+// file stored under a key that hashes its inputs and export options, at [root]/[first 2 hex digits]/[16 hex digits].
+// Artifacts are published by writing a temporary file next to their final path and renaming it, so concurrent
+// writers never need a lock and readers never see a partial file. Once the store grows past its size limit, the
+// least recently used artifacts are removed. Fetching an artifact refreshes its modification time, which serves as
+// its last use. All functions are thread safe.
+class ArtifactStore
+{
+public:
+    /**
+     * Opens a store, creating its directory if needed.
+     * @param root Directory of the store.
+     * @param max_size Size limit in bytes.
+     * @return bool Returns false if the directory could not be created.
+     */
+    bool open(const std::string& root, uint64_t max_size = ARTIFACT_STORE_DEFAULT_SIZE);
+    /**
+     * Opens the store named by ARTIFACT_STORE_ENV with the size limit from ARTIFACT_STORE_SIZE_ENV.
+     * @return bool Returns false if the variable is not set or the store could not be opened.
+     */
+    bool open_from_environment();
+    /**
+     * Copies an artifact to an output path. The output is replaced with a rename, like every exported file.
+     * @param key Key of the artifact.
+     * @param output Path to copy the artifact to.
+     * @return bool Returns false if the store has no artifact for the key.
+     */
+    bool fetch(uint64_t key, const std::string& output);
+    /**
+     * Adds a copy of a file to the store, then evicts old artifacts if enough data was added since the last eviction.
+     * @param key Key of the artifact.
+     * @param file Path of the file to store.
+     * @return bool Returns false if the file could not be stored.
+     */
+    bool publish(uint64_t key, const std::string& file);
+    /**
+     * Removes the least recently used artifacts until the store is below 90% of its size limit, and temporary files
+     * left behind by interrupted writers.
+     */
+    void evict();
+
+private:
+    std::string artifact_path(uint64_t key) const;
+
+    std::mutex  m_mutex;
+    std::string m_root;
+    uint64_t    m_max_size  = 0;
+    uint64_t    m_published = 0; // Bytes published since the last eviction.
+};
+} // namespace ast
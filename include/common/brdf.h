@@ -0,0 +1,24 @@
+#pragma once
+
+#include <common/image.h>
+
+namespace ast
+{
+struct BRDFLUTOptions
+{
+    int  size         = 512;   // Width and height of the LUT.
+    int  sample_count = 1024;  // Importance samples per texel.
+    bool multi_lut    = false; // Add the multi-scatter compensation and Charlie sheen DFG channels.
+};
+
+/**
+     * Integrates the split-sum environment BRDF into a LUT indexed by NdotV (x) and perceptual roughness (y, bottom to
+     * top). R and G hold the GGX scale and bias applied to F0. With multi_lut, B holds the multi-scatter energy
+     * compensation 1 / (scale + bias) - 1, so specular is scaled by 1 + F0 * B, and A holds the Charlie sheen DFG used
+     * by MATERIAL_CLOTH. All channels come from one pass over the samples, vectorized across texels of a row.
+     * @param lut Receives an uncompressed FLOAT32 image with 2 components, or 4 with multi_lut.
+     * @param options Size, sample count and channel settings.
+     * @return bool Returns false if the size or sample count is not valid.
+     */
+extern bool generate_brdf_lut(Image& lut, const BRDFLUTOptions& options);
+} // namespace ast
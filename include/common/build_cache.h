@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bump whenever a converter changes its output for the same source and options, so every cached output is rebuilt.
+#define BUILD_CACHE_VERSION 1
+#define BUILD_CACHE_FILE_NAME ".ast_build_cache"
+
+namespace ast
+{
+/**
+     * Hashes a block of memory with 64-bit MurmurHash2.
+     * @param data Bytes to hash.
+     * @param size Number of bytes.
+     * @param seed Seed, pass a previous hash to hash data in several pieces.
+     * @return uint64_t Hash.
+     */
+extern uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0);
+/**
+     * Mixes a value into a hash.
+     * @param seed Current hash.
+     * @param value Value to add.
+     * @return uint64_t Combined hash.
+     */
+extern uint64_t hash_combine(uint64_t seed, uint64_t value);
+/**
+     * Hashes a string, including its length.
+     * @param seed Current hash.
+     * @param str String to add.
+     * @return uint64_t Combined hash.
+     */
+extern uint64_t hash_string(uint64_t seed, const std::string& str);
+/**
+     * Hashes the contents of a file.
+     * @param path Path of the file.
+     * @param hash Receives the hash.
+     * @return bool Returns false if the file could not be read.
+     */
+extern bool hash_file(const std::string& path, uint64_t& hash);
+
+// Remembers the key every output file was last built with, where the key hashes the source bytes and the export
+// options. Outputs whose key is unchanged and that still exist are skipped. The manifest records BUILD_CACHE_VERSION
+// and AST_VERSION, and a manifest written by another version is ignored. All functions are thread safe.
+class BuildCache
+{
+public:
+    /**
+     * Reads a manifest. A missing or outdated manifest leaves the cache empty.
+     * @param path Path of the manifest, which save writes back to.
+     * @return bool Returns true if entries were read.
+     */
+    bool load(const std::string& path);
+    /**
+     * Writes the manifest if it changed. The manifest is written to a temporary file and renamed over the old one,
+     * so an interrupted build never leaves a truncated manifest.
+     * @return bool Returns false if the manifest could not be written.
+     */
+    bool save();
+    /**
+     * Checks whether an output was built with a key and still exists.
+     * @param output Path of the output file.
+     * @param key Build key of the output.
+     * @return bool Returns true if the output does not need to be rebuilt.
+     */
+    bool up_to_date(const std::string& output, uint64_t key);
+    /**
+     * Returns the extra source files recorded for an output, such as the textures of a mesh.
+     * @param output Path of the output file.
+     * @return vector Recorded dependencies, empty if there are none.
+     */
+    std::vector<std::string> dependencies(const std::string& output);
+    /**
+     * Records the key an output was just built with.
+     * @param output Path of the output file.
+     * @param key Build key of the output.
+     * @param dependencies Extra source files that went into the key.
+     */
+    void update(const std::string& output, uint64_t key, const std::vector<std::string>& dependencies = std::vector<std::string>());
+
+private:
+    struct Entry
+    {
+        uint64_t                 key;
+        std::vector<std::string> dependencies;
+    };
+
+    std::mutex                             m_mutex;
+    std::string                            m_path;
+    std::unordered_map<std::string, Entry> m_entries;
+    bool                                   m_dirty = false;
+};
+} // namespace ast
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <common/image.h>
+
+namespace ast
+{
+enum CubemapFilter
+{
+    CUBEMAP_FILTER_BILINEAR = 0,
+    CUBEMAP_FILTER_BICUBIC  = 1
+};
+
+enum RoughnessMapping
+{
+    ROUGHNESS_MAPPING_LINEAR    = 0, // roughness = mip / (mip_levels - 1)
+    ROUGHNESS_MAPPING_QUADRATIC = 1  // roughness = (mip / (mip_levels - 1))^2, spends more mips on glossy surfaces
+};
+
+struct CubemapConversionOptions
+{
+    int           face_size     = 0; // Width and height of every face. 0 uses half the height of the lat-long map.
+    CubemapFilter filter        = CUBEMAP_FILTER_BILINEAR;
+    int           supersampling = 1; // Samples per axis for every output texel, 1 takes a single sample at the texel center.
+};
+
+struct OctahedralOptions
+{
+    int size   = 0; // Width and height of mip 0 including the gutter. 0 uses twice the face size of the cubemap.
+    int gutter = 2; // Texels on every side of every mip that continue the map across its folded edges.
+};
+
+struct RadiancePrefilterOptions
+{
+    int              face_size    = 256; // Face size of mip 0.
+    int              mip_levels   = 7;   // Number of roughness levels, the last one is fully rough.
+    int              sample_count = 64;  // GGX importance samples per texel.
+    RoughnessMapping mapping      = ROUGHNESS_MAPPING_LINEAR;
+};
+
+/**
+     * Returns the direction through a point on a cubemap face. Faces are ordered +X, -X, +Y, -Y, +Z, -Z with the same
+     * orientation as cmft and OpenGL cubemaps.
+     * @param face Face index (0-5).
+     * @param s Horizontal face coordinate in [-1, 1].
+     * @param t Vertical face coordinate in [-1, 1], pointing down the face.
+     * @param dir Receives the direction, which is not normalized.
+     */
+extern void cubemap_direction(int face, float s, float t, float* dir);
+/**
+     * Resamples an equirectangular (lat-long) map into a cubemap with 6 array slices and a single mip. Faces and rows
+     * are converted in parallel and the direction to lat-long mapping is vectorized.
+     * @param src Lat-long map with a 2:1 aspect ratio. Only mip 0 of the first array slice is used.
+     * @param dst Receives the cubemap, with the pixel type and component count of the source.
+     * @param options Face size, filter and supersampling settings.
+     * @return bool Returns false if the source is not a lat-long map or uses an unsupported pixel type.
+     */
+extern bool latlong_to_cubemap(const Image& src, Image& dst, const CubemapConversionOptions& options);
+/**
+     * Builds luminance weighted importance sampling tables for a lat-long map, so renderers do not need to build them
+     * on load. Row y of the first height rows holds the conditional CDF of table row y (width + 1 entries, starting at
+     * 0 and ending at 1), and the last row holds the marginal CDF over rows (height + 1 entries, zero padded). Texel
+     * weights are luminance times sin(theta), so the pdf of a texel follows from the CDF steps:
+     * p(x, y) = (cdf_y[x + 1] - cdf_y[x]) * width * (marginal[y + 1] - marginal[y]) * height per unit uv area.
+     * Rows are built in parallel.
+     * @param src Uncompressed lat-long map with a 2:1 aspect ratio and at least 3 components. Only mip 0 is used.
+     * @param dst Receives a FLOAT32 image with 1 component, (width + 1) x (height + 1) texels.
+     * @param width Table width. The source is box filtered down to it, weighting texels by the part of a table texel they cover, 0 keeps the source resolution.
+     * @return bool Returns false if the source is not an uncompressed lat-long map.
+     */
+extern bool latlong_sampling_tables(const Image& src, Image& dst, int width);
+/**
+     * Returns the direction of a point on an octahedral map. The +Z hemisphere maps to the inner diamond and the -Z
+     * hemisphere is folded into the corners.
+     * @param u Horizontal map coordinate in [0, 1].
+     * @param v Vertical map coordinate in [0, 1].
+     * @param dir Receives the normalized direction.
+     */
+extern void octahedral_direction(float u, float v, float* dir);
+/**
+     * Resamples every mip of a cubemap into a single octahedral 2D texture, so prefiltered mips stay prefiltered.
+     * Every mip has a gutter that repeats the texels across the folded edges of the map, so bilinear filtering is
+     * seamless as long as lookups are remapped to the inner region, uv' = (gutter + uv * (size - 2 * gutter)) / size
+     * with the size of the sampled mip. Mips stop once the inner region would vanish. Rows of all mips are resampled in parallel.
+     * @param src Uncompressed cubemap with 6 array slices.
+     * @param dst Receives the octahedral map, with the pixel type and component count of the source.
+     * @param options Size and gutter settings.
+     * @return bool Returns false if the source is not an uncompressed cubemap.
+     */
+extern bool cubemap_to_octahedral(const Image& src, Image& dst, const OctahedralOptions& options);
+/**
+     * Returns the perceptual GGX roughness stored in a mip of a prefiltered radiance cubemap.
+     * @param mip Mip level.
+     * @param mip_levels Number of mips in the cubemap.
+     * @param mapping Roughness to mip mapping.
+     * @return float Roughness in [0, 1].
+     */
+extern float radiance_mip_roughness(int mip, int mip_levels, RoughnessMapping mapping);
+/**
+     * Prefilters a cubemap with the GGX distribution for image based specular lighting, assuming N = V = R. Every
+     * sample reads a mip of the source picked from its solid angle (filtered importance sampling), so few samples are
+     * needed without aliasing. Work is split into tiles across all faces and mips and runs in parallel.
+     * @param src Cubemap with 6 array slices. Only mip 0 is used.
+     * @param dst Receives the prefiltered cubemap, with the pixel type and component count of the source.
+     * @param options Size, mip count, sample count and roughness mapping.
+     * @return bool Returns false if the source is not an uncompressed cubemap.
+     */
+extern bool prefilter_ggx(const Image& src, Image& dst, const RadiancePrefilterOptions& options);
+} // namespace ast
@@ -4,6 +4,7 @@
 #    define FileSystem_h
 
 #    include <string>
+#    include <vector>
 
 struct FileHandle
 {
@@ -93,6 +94,27 @@ extern void write(void* _Buffer, size_t _Size, size_t _Count, long _Offset);
 extern void write_end();
 
 extern void copy_file(std::string input, std::string output);
+/**
+     * Returns a path next to a file to write it to before publishing it with publish_file. The path is unique to the
+     * calling process and thread, so concurrent writers of the same file never share a temporary file.
+     * @param path Path of the file.
+     * @return string Temporary path in the same directory.
+     */
+extern std::string temp_file_path(const std::string& path);
+/**
+     * Replaces a file with a completely written temporary file in a single rename, so readers such as a hot reloading
+     * engine see either the old or the new file but never a partial one. The temporary file is removed on failure.
+     * @param temp_path Path of the written file, from temp_file_path.
+     * @param path Path to publish it at.
+     * @return bool Returns false if the file could not be renamed.
+     */
+extern bool publish_file(const std::string& temp_path, const std::string& path);
+/**
+     * Lists the regular files in a directory.
+     * @param path Path of the directory.
+     * @return vector File names without the directory, sorted by name. Empty if the directory cannot be read.
+     */
+extern std::vector<std::string> list_files(const std::string& path);
 
 extern void destroy_handle(FileHandle& handle);
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ast
+{
+/**
+     * Converts a float to an IEEE 754 half float bit pattern, rounding to nearest even.
+     * @param value Value to convert. Values above 65504 become infinity.
+     * @return uint16_t Half float bits.
+     */
+extern uint16_t float_to_half(float value);
+/**
+     * Converts an IEEE 754 half float bit pattern to a float.
+     * @param value Half float bits.
+     * @return float Converted value.
+     */
+extern float half_to_float(uint16_t value);
+/**
+     * Converts an array of floats to half floats, using F16C when available.
+     * @param src Source values.
+     * @param dst Destination half float bits.
+     * @param count Number of values.
+     */
+extern void float_to_half(const float* src, uint16_t* dst, size_t count);
+/**
+     * Converts an array of half floats to floats, using F16C when available.
+     * @param src Source half float bits.
+     * @param dst Destination values.
+     * @param count Number of values.
+     */
+extern void half_to_float(const uint16_t* src, float* dst, size_t count);
+} // namespace ast
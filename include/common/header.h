@@ -2,7 +2,7 @@
 
 #include <stdint.h>
 
-#define AST_VERSION 1
+#define AST_VERSION 2
 
 namespace ast
 {
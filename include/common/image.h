@@ -1,26 +1,45 @@
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace ast
 {
 enum CompressionType
 {
-    COMPRESSION_NONE = 0,
-    COMPRESSION_BC1  = 1,
-    COMPRESSION_BC1a = 2,
-    COMPRESSION_BC2  = 3,
-    COMPRESSION_BC3  = 4,
-    COMPRESSION_BC3n = 5,
-    COMPRESSION_BC4  = 6,
-    COMPRESSION_BC5  = 7,
-    COMPRESSION_BC6  = 8,
-    COMPRESSION_BC7  = 9,
-    COMPRESSION_ETC1 = 10,
-    COMPRESSION_ETC2 = 11,
-    COMPRESSION_PVR  = 12
+    COMPRESSION_NONE      = 0,
+    COMPRESSION_BC1       = 1,
+    COMPRESSION_BC1a      = 2,
+    COMPRESSION_BC2       = 3,
+    COMPRESSION_BC3       = 4,
+    COMPRESSION_BC3n      = 5,
+    COMPRESSION_BC4       = 6,
+    COMPRESSION_BC5       = 7,
+    COMPRESSION_BC6       = 8,
+    COMPRESSION_BC7       = 9,
+    COMPRESSION_ETC1      = 10,
+    COMPRESSION_ETC2      = 11,
+    COMPRESSION_PVR       = 12,
+    COMPRESSION_ETC2_RGBA = 13,
+    COMPRESSION_EAC_R11   = 14,
+    COMPRESSION_EAC_RG11  = 15
+};
+
+enum CompressionQuality
+{
+    COMPRESSION_QUALITY_FAST   = 0,
+    COMPRESSION_QUALITY_NORMAL = 1,
+    COMPRESSION_QUALITY_HIGH   = 2
+};
+
+enum ColorSpace
+{
+    COLOR_SPACE_UNKNOWN = 0, // Follows the export options.
+    COLOR_SPACE_SRGB    = 1, // Declared by the file, such as a DDS file with an _SRGB DXGI format.
+    COLOR_SPACE_LINEAR  = 2  // Declared by the file, such as a DDS file with a UNORM DXGI format.
 };
 
 enum PixelType
@@ -46,6 +65,56 @@ struct BINMipSliceHeader
     int      size;
 };
 
+enum SwizzleChannel
+{
+    SWIZZLE_R    = 0,
+    SWIZZLE_G    = 1,
+    SWIZZLE_B    = 2,
+    SWIZZLE_A    = 3,
+    SWIZZLE_ZERO = 4,
+    SWIZZLE_ONE  = 5
+};
+
+extern size_t compressed_block_size(const CompressionType& compression);
+extern size_t compressed_size(const CompressionType& compression, int width, int height);
+/**
+     * Returns the size of a PVRTC 4bpp level. PVRTC blocks cover 4x4 pixels, but a level holds at least 2x2 blocks.
+     * @param width Width of the level in pixels.
+     * @param height Height of the level in pixels.
+     * @return size_t Size in bytes.
+     */
+extern size_t pvrtc_size(int width, int height);
+/**
+     * Reorders, expands and optionally flips the green channel of interleaved pixels in a single pass.
+     * Source channels that do not exist read as zero. src and dst may only alias if both have the same component count.
+     * @param src Source pixels.
+     * @param src_components Number of interleaved source channels (1-4).
+     * @param dst Destination pixels.
+     * @param dst_components Number of interleaved destination channels (1-4).
+     * @param mapping Source channel or constant for every destination channel.
+     * @param type Pixel type shared by source and destination. One is 255 for UNORM8 and 1.0 for float types.
+     * @param count Number of pixels.
+     * @param flip_green Store one minus the value for destination channels mapped to SWIZZLE_G.
+     */
+extern void swizzle_pixels(const void*           src,
+                           int                   src_components,
+                           void*                 dst,
+                           int                   dst_components,
+                           const SwizzleChannel* mapping,
+                           const PixelType&      type,
+                           size_t                count,
+                           bool                  flip_green);
+/**
+     * Converts interleaved values between pixel types. Float to half conversion uses F16C when available, float to
+     * UNORM8 clamps to [0, 1] and rounds to nearest.
+     * @param src Source values.
+     * @param src_type Pixel type of the source.
+     * @param dst Destination values. Must not alias src unless both types are the same size.
+     * @param dst_type Pixel type of the destination.
+     * @param count Number of values, i.e. pixels times components.
+     */
+extern void convert_pixels(const void* src, const PixelType& src_type, void* dst, const PixelType& dst_type, size_t count);
+
 struct Image
 {
     template <typename T, size_t N>
@@ -62,27 +131,37 @@ struct Image
         size_t size;
     };
 
-    int             components;
-    int             mip_slices;
-    int             array_slices;
-    Data            data[16][16];
-    std::string     name;
-    PixelType       type;
-    CompressionType compression;
+    int                               components;
+    int                               mip_slices;
+    int                               array_slices;
+    std::vector<std::array<Data, 16>> data;    // Indexed as data[array_slice][mip_slice], holds at least 16 array slices.
+    void*                             storage; // Single aligned block with every level in file order, null if each level owns its data.
+    std::string                       name;
+    PixelType                         type;
+    CompressionType                   compression;
+    bool                              cubemap;     // Array slices are cube faces, 6 per cube. Written as a cubemap to KTX2 files.
+    ColorSpace                        color_space; // Encoding of the color channels declared by the source file, if any.
 
     Image(const PixelType& pixel_type = PIXEL_TYPE_UNORM8);
+    Image(const Image& other);
+    Image(Image&& other);
     ~Image();
-    Image& operator=(Image other);
+    Image& operator=(const Image& other);
+    Image& operator=(Image&& other);
     void   allocate(const PixelType& pixel_type,
                     const uint32_t&  base_mip_width,
                     const uint32_t&  base_mip_height,
                     const uint32_t&  component_count,
                     const uint32_t&  array_slice_count,
                     const uint32_t&  mip_slice_count);
+    void   allocate_storage();
     void   deallocate();
     size_t size(int array_slice, int mip_slice) const;
+    size_t storage_size() const;
     void   to_bgra(int array_slice, int mip_slice);
     void   argb_to_rgba(int array_slice, int mip_slice);
     bool   to_rgba(Image& img, int array_slice, int mip_slice);
+    void   flip_green(int array_slice, int mip_slice);
+    bool   convert(const PixelType& pixel_type);
 };
 } // namespace ast
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <common/image.h>
+#include <vector>
+
+#define KTX2_IDENTIFIER_SIZE 12
+#define KTX2_LEVEL_ALIGNMENT 8
+
+namespace ast
+{
+extern const uint8_t kKTX2Identifier[KTX2_IDENTIFIER_SIZE];
+
+struct KTX2Header
+{
+    uint8_t  identifier[KTX2_IDENTIFIER_SIZE];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count; // 0 for textures that are not arrays.
+    uint32_t face_count;  // 6 for cubemaps, otherwise 1.
+    uint32_t level_count;
+    uint32_t supercompression_scheme;
+    uint32_t dfd_byte_offset;
+    uint32_t dfd_byte_length;
+    uint32_t kvd_byte_offset;
+    uint32_t kvd_byte_length;
+    uint64_t sgd_byte_offset;
+    uint64_t sgd_byte_length;
+};
+
+struct KTX2LevelIndex
+{
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length; // Equal to byte_length as long as no supercompression scheme is used.
+};
+
+/**
+     * Returns the Vulkan format that stores an image in a KTX2 file.
+     * @param compression Block compression of the image. BC3n is stored as BC3.
+     * @param type Pixel type of uncompressed images. Ignored for block compressed images.
+     * @param components Component count of uncompressed images. Ignored for block compressed images.
+     * @param srgb Pick the sRGB variant of the format if there is one.
+     * @return uint32_t VkFormat value, 0 (VK_FORMAT_UNDEFINED) if the image has no matching format.
+     */
+extern uint32_t ktx2_vk_format(const CompressionType& compression, const PixelType& type, int components, bool srgb);
+/**
+     * Returns the image layout of a Vulkan format written by ktx2_vk_format.
+     * @param vk_format VkFormat value.
+     * @param compression Receives the block compression.
+     * @param type Receives the pixel type. Block compressed formats report UNORM8, except BC6H which reports FLOAT16.
+     * @param components Receives the component count.
+     * @return bool Returns false if the format is not supported.
+     */
+extern bool ktx2_image_format(uint32_t vk_format, CompressionType& compression, PixelType& type, int& components);
+/**
+     * Returns the size of a texel block of a Vulkan format written by ktx2_vk_format, i.e. the size of a 4x4 block for
+     * block compressed formats and of a pixel otherwise.
+     * @param vk_format VkFormat value.
+     * @return uint32_t Block size in bytes, 0 if the format is not supported.
+     */
+extern uint32_t ktx2_texel_block_size(uint32_t vk_format);
+/**
+     * Builds the Khronos Data Format Descriptor of a Vulkan format written by ktx2_vk_format, as stored in KTX2 files.
+     * @param vk_format VkFormat value.
+     * @param dfd Receives the descriptor, starting with its total size.
+     * @return bool Returns false if the format is not supported.
+     */
+extern bool ktx2_data_format_descriptor(uint32_t vk_format, std::vector<uint32_t>& dfd);
+} // namespace ast
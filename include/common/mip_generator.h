@@ -0,0 +1,37 @@
+#pragma once
+
+#include <common/image.h>
+
+namespace ast
+{
+enum MipFilter
+{
+    MIP_FILTER_BOX    = 0,
+    MIP_FILTER_KAISER = 1
+};
+
+struct MipGenerationOptions
+{
+    MipFilter filter         = MIP_FILTER_BOX;
+    int       mip_levels     = -1;    // Total number of levels including mip 0. -1 generates the full chain.
+    bool      srgb           = true;  // Filter the color channels of UNORM8 images in linear space. Float images are always linear.
+    bool      normal_map     = false; // The first three channels hold a packed unit vector that is renormalized on every level.
+    float     alpha_coverage = 0.0f;  // Alpha test reference. If greater than 0, alpha is scaled so every level keeps the coverage of mip 0.
+};
+
+/**
+     * Returns the number of levels in a full mip chain, which ends once either dimension reaches 1.
+     * @param width Width of mip 0.
+     * @param height Height of mip 0.
+     * @return int Level count including mip 0, at most 16.
+     */
+extern int mip_chain_length(int width, int height);
+/**
+     * Replaces every mip below mip 0 of each array slice with levels filtered from mip 0. The whole chain ends up in one contiguous allocation.
+     * Filtering is separable and runs in float, multi-threaded over rows. UNORM8, FLOAT16 and FLOAT32 images are supported.
+     * @param image Image to generate mips for. Mip 0 must be allocated.
+     * @param options Filter and color space settings.
+     * @return bool Returns false if the image cannot be filtered.
+     */
+extern bool generate_mips(Image& image, const MipGenerationOptions& options);
+} // namespace ast
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ast
+{
+/**
+     * Returns the number of threads used by parallel_for.
+     * @return uint32_t Worker count (at least 1).
+     */
+extern uint32_t worker_count();
+/**
+     * Runs func for every index in [begin, end) across all available hardware threads.
+     * The calling thread participates and the function returns once every index has been processed. Calls made from
+     * a TaskPool task are split into tasks of the same pool, so a single large task still uses every worker. Calls
+     * made from inside another parallel_for run on the calling thread, so nested parallelism does not oversubscribe
+     * the CPU.
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param func Function invoked with each index.
+     */
+extern void parallel_for(int32_t begin, int32_t end, const std::function<void(int32_t)>& func);
+
+// Work-stealing pool for independent tasks that may submit more tasks. Every worker owns a queue, runs its newest
+// task first and steals the oldest task of another worker once its own queue is empty. parallel_for calls made from
+// inside a task queue their iterations as tasks of the pool and run other tasks while they wait for them.
+class TaskPool
+{
+public:
+    /**
+     * Starts the worker threads.
+     * @param num_threads Number of workers, 0 uses worker_count().
+     */
+    TaskPool(uint32_t num_threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    /**
+     * Queues a task. Tasks submitted from a worker go to the queue of that worker.
+     * @param task Function to run.
+     */
+    void submit(std::function<void()> task);
+    /**
+     * Returns once every submitted task, including tasks submitted by other tasks, has finished. The calling thread
+     * runs queued tasks while it waits. Must not be called from inside a task of the same pool.
+     */
+    void wait();
+    /**
+     * Runs queued tasks on the calling thread until a counter, decremented by the tasks being waited for, drops to
+     * zero. Lets a task join tasks it submitted without blocking its worker.
+     * @param counter Number of unfinished tasks.
+     */
+    void wait(const std::atomic<int32_t>& counter);
+    /**
+     * Returns the number of worker threads.
+     * @return uint32_t Worker count.
+     */
+    inline uint32_t num_threads() const { return uint32_t(m_threads.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool pop(uint32_t queue, std::function<void()>& task);
+    void run(std::function<void()>& task);
+    void worker_main(uint32_t index);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_threads;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_condition;
+    std::atomic<int32_t>                m_queued;
+    std::atomic<int32_t>                m_pending;
+    std::atomic<uint32_t>               m_next_queue;
+    std::atomic<int32_t>                m_joining; // Threads in wait(counter), woken after every finished task.
+    bool                                m_stop = false;
+};
+} // namespace ast
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <common/image.h>
+
+#define SH_MAX_ORDER 5
+#define SH_MAX_COEFFICIENTS (SH_MAX_ORDER * SH_MAX_ORDER)
+
+namespace ast
+{
+struct SHCoefficients
+{
+    int   order                     = 3;  // Number of bands, 3 gives the 9 coefficients of L2 and 5 the 25 of L4.
+    float c[SH_MAX_COEFFICIENTS][3] = {}; // RGB radiance coefficients.
+};
+
+/**
+     * Evaluates the real SH basis for a normalized direction. Uses the same sign convention as the projection.
+     * @param dir Normalized direction.
+     * @param order Number of bands (1 to SH_MAX_ORDER).
+     * @param basis Receives order * order values.
+     */
+extern void sh_basis(const float* dir, int order, float* basis);
+/**
+     * Projects the radiance of a cubemap onto spherical harmonics. Texel directions and solid angles are precomputed
+     * once per face size and shared by all later projections. Rows of all faces are reduced in parallel with SIMD
+     * basis evaluation, and the partial sums are combined in a fixed order so results do not depend on thread timing.
+     * @param cubemap Uncompressed cubemap with 6 array slices and at least 3 components. Only mip 0 is used.
+     * @param coefficients Receives the coefficients. order selects the number of bands.
+     * @return bool Returns false if the cubemap or order is not supported.
+     */
+extern bool project_sh(const Image& cubemap, SHCoefficients& coefficients);
+/**
+     * Projects the radiance of an equirectangular (lat-long) map onto spherical harmonics without a cubemap
+     * intermediate. Every texel is weighted by the exact solid angle of its row.
+     * @param latlong Uncompressed lat-long map with a 2:1 aspect ratio and at least 3 components. Only mip 0 of the first array slice is used.
+     * @param coefficients Receives the coefficients. order selects the number of bands.
+     * @return bool Returns false if the map or order is not supported.
+     */
+extern bool project_sh_latlong(const Image& latlong, SHCoefficients& coefficients);
+/**
+     * Convolves radiance coefficients with the clamped cosine lobe, turning them into irradiance coefficients.
+     * Irradiance for a normal is then the dot product of the coefficients with sh_basis of the normal.
+     * @param coefficients Radiance coefficients, replaced by irradiance coefficients.
+     */
+extern void sh_convolve_cosine(SHCoefficients& coefficients);
+} // namespace ast
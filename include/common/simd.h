@@ -0,0 +1,90 @@
+#pragma once
+
+#include <math.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+namespace ast
+{
+// Thin wrappers so vectorized loops are written once for scalar, SSE and AVX lanes. Masks are lane values with all
+// bits set or cleared, as returned by the comparisons.
+struct ScalarLanes
+{
+    typedef float Type;
+    static const int kWidth = 1;
+
+    static inline Type load(const float* p) { return *p; }
+    static inline void store(float* p, Type a) { *p = a; }
+    static inline Type set(float v) { return v; }
+    static inline Type add(Type a, Type b) { return a + b; }
+    static inline Type sub(Type a, Type b) { return a - b; }
+    static inline Type mul(Type a, Type b) { return a * b; }
+    static inline Type div(Type a, Type b) { return a / b; }
+    static inline Type minimum(Type a, Type b) { return a < b ? a : b; }
+    static inline Type maximum(Type a, Type b) { return a > b ? a : b; }
+    static inline Type sqrt(Type a) { return sqrtf(a); }
+    static inline Type select(bool mask, Type a, Type b) { return mask ? a : b; }
+    static inline bool greater(Type a, Type b) { return a > b; }
+    static inline float sum(Type a) { return a; }
+};
+
+#if defined(__SSE4_1__)
+struct SSELanes
+{
+    typedef __m128 Type;
+    static const int kWidth = 4;
+
+    static inline Type load(const float* p) { return _mm_loadu_ps(p); }
+    static inline void store(float* p, Type a) { _mm_storeu_ps(p, a); }
+    static inline Type set(float v) { return _mm_set1_ps(v); }
+    static inline Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static inline Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+    static inline Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+    static inline Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+    static inline Type minimum(Type a, Type b) { return _mm_min_ps(a, b); }
+    static inline Type maximum(Type a, Type b) { return _mm_max_ps(a, b); }
+    static inline Type sqrt(Type a) { return _mm_sqrt_ps(a); }
+    static inline Type select(Type mask, Type a, Type b) { return _mm_blendv_ps(b, a, mask); }
+    static inline Type greater(Type a, Type b) { return _mm_cmpgt_ps(a, b); }
+
+    static inline float sum(Type a)
+    {
+        a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+        return _mm_cvtss_f32(a);
+    }
+};
+#endif
+
+#if defined(__AVX2__)
+struct AVXLanes
+{
+    typedef __m256 Type;
+    static const int kWidth = 8;
+
+    static inline Type load(const float* p) { return _mm256_loadu_ps(p); }
+    static inline void store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+    static inline Type set(float v) { return _mm256_set1_ps(v); }
+    static inline Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static inline Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+    static inline Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static inline Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+    static inline Type minimum(Type a, Type b) { return _mm256_min_ps(a, b); }
+    static inline Type maximum(Type a, Type b) { return _mm256_max_ps(a, b); }
+    static inline Type sqrt(Type a) { return _mm256_sqrt_ps(a); }
+    static inline Type select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+    static inline Type greater(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static inline float sum(Type a) { return SSELanes::sum(_mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+};
+
+typedef AVXLanes WideLanes;
+#elif defined(__SSE4_1__)
+typedef SSELanes WideLanes;
+#else
+typedef ScalarLanes WideLanes;
+#endif
+} // namespace ast
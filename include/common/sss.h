@@ -0,0 +1,52 @@
+#pragma once
+
+#include <common/image.h>
+#include <vector>
+
+namespace ast
+{
+struct DiffusionGaussian
+{
+    float variance;  // Variance in mm^2.
+    float weight[3]; // RGB weight of the Gaussian.
+};
+
+struct DiffusionProfile
+{
+    std::vector<DiffusionGaussian> gaussians; // Radial profile R(r) = sum of weight / (2 pi v) * exp(-r^2 / (2 v)).
+};
+
+struct SSSLUTOptions
+{
+    int   size               = 256;  // Width and height of the scattering LUT.
+    int   sample_count       = 1024; // Integration steps along the surface for every texel.
+    float max_curvature      = 1.0f; // Curvature (1 / radius in mm) of the top row. The bottom row is flat.
+    int   transmittance_size = 256;  // Width of the transmittance table.
+    float max_thickness      = 5.0f; // Thickness in mm of the last transmittance texel.
+};
+
+/**
+     * Returns the three layer skin profile of d'Eon and Luebke as a sum of six Gaussians.
+     * @return DiffusionProfile Skin profile, the weights of every channel sum to roughly 1.
+     */
+extern DiffusionProfile skin_diffusion_profile();
+/**
+     * Pre-integrates diffuse scattering over a ring of the given curvature (Penner 2011). x maps N.L from -1 to 1 and
+     * y maps curvature from 0 (bottom) to max_curvature (top). Every row integrates the profile along the surface once
+     * and texels of a row are evaluated in parallel SIMD lanes.
+     * @param profile Diffusion profile.
+     * @param lut Receives an uncompressed FLOAT32 RGB image.
+     * @param options Size, sample count and curvature range.
+     * @return bool Returns false if the profile is empty or the options are not valid.
+     */
+extern bool generate_sss_lut(const DiffusionProfile& profile, Image& lut, const SSSLUTOptions& options);
+/**
+     * Tabulates the transmittance of light through a slab, T(s) = sum of weight * exp(-s^2 / v), as used for
+     * translucent and subsurface materials (Jimenez et al. 2010). x maps thickness from 0 to max_thickness.
+     * @param profile Diffusion profile.
+     * @param lut Receives an uncompressed FLOAT32 RGB image with a single row.
+     * @param options Table size and thickness range.
+     * @return bool Returns false if the profile is empty or the options are not valid.
+     */
+extern bool generate_transmittance_lut(const DiffusionProfile& profile, Image& lut, const SSSLUTOptions& options);
+} // namespace ast
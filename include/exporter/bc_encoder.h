@@ -0,0 +1,71 @@
+#pragma once
+
+#include <common/image.h>
+
+namespace ast
+{
+struct BCSearchPreset
+{
+    uint32_t modes             = 0xFFFFFFFF; // Bit mask of block modes the search may emit.
+    int      max_partitions    = 64;         // Number of best-ranked partitions encoded per mode.
+    int      refine_iterations = 1;          // Least squares endpoint refinement passes per candidate.
+    bool     exhaustive        = false;      // Try every p-bit/transform combination instead of the closest one.
+};
+
+/**
+     * Checks if the in-tree block encoder can produce the given format.
+     * @param compression Target block compression format.
+     * @return bool Returns true for BC1, BC1a, BC3, BC4, BC5 and BC7.
+     */
+extern bool bc_encoder_supports(const CompressionType& compression);
+/**
+     * Encodes a single UNORM8 mip level into BC blocks, multi-threaded over block rows.
+     * Missing source channels are treated as 0, missing alpha as 255. BC1a makes pixels with alpha below 128 transparent.
+     * @param compression Target block compression format.
+     * @param quality Speed tier used for endpoint selection.
+     * @param src Interleaved source pixels.
+     * @param width Width of the source in pixels.
+     * @param height Height of the source in pixels.
+     * @param components Number of interleaved source channels (1-4).
+     * @param dst Output buffer of at least compressed_size(compression, width, height) bytes.
+     */
+extern void bc_encode(const CompressionType&    compression,
+                      const CompressionQuality& quality,
+                      const uint8_t*            src,
+                      int                       width,
+                      int                       height,
+                      int                       components,
+                      void*                     dst);
+/**
+     * Returns the BC7 mode and partition limits used for a quality tier.
+     * @param quality Speed tier.
+     * @return BCSearchPreset Fast only uses mode 6, normal ranks 8 partitions, high searches all 64.
+     */
+extern BCSearchPreset bc7_preset(const CompressionQuality& quality);
+/**
+     * Returns the BC6H mode and partition limits used for a quality tier.
+     * @param quality Speed tier.
+     * @return BCSearchPreset Fast only uses the single region modes, normal ranks 8 partitions, high searches all 32.
+     */
+extern BCSearchPreset bc6h_preset(const CompressionQuality& quality);
+/**
+     * Encodes a single UNORM8 mip level into BC7 blocks using modes 1, 3, 6 and 7.
+     * @param preset Modes and partitions searched per block.
+     * @param src Interleaved source pixels.
+     * @param width Width of the source in pixels.
+     * @param height Height of the source in pixels.
+     * @param components Number of interleaved source channels (1-4).
+     * @param dst Output buffer of at least compressed_size(COMPRESSION_BC7, width, height) bytes.
+     */
+extern void bc7_encode(const BCSearchPreset& preset, const uint8_t* src, int width, int height, int components, void* dst);
+/**
+     * Encodes a single FLOAT32 mip level into unsigned BC6H blocks. Negative values are clamped to 0.
+     * @param preset Modes and partitions searched per block.
+     * @param src Interleaved source pixels.
+     * @param width Width of the source in pixels.
+     * @param height Height of the source in pixels.
+     * @param components Number of interleaved source channels (1-4), alpha is ignored.
+     * @param dst Output buffer of at least compressed_size(COMPRESSION_BC6, width, height) bytes.
+     */
+extern void bc6h_encode(const BCSearchPreset& preset, const float* src, int width, int height, int components, void* dst);
+} // namespace ast
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <common/image.h>
+#include <string>
+#include <vector>
+
+namespace ast
+{
+struct CompressionTarget
+{
+    float min_psnr          = 40.0f; // Peak signal to noise ratio of the source channels in dB.
+    float min_ssim          = 0.97f; // Mean structural similarity of the source channels over 8x8 windows.
+    float max_normal_error  = 2.0f;  // Mean angular error of normal maps in degrees. Normal maps are only held to this target.
+    int   sample_tiles      = 64;    // 64x64 tiles of mip 0 spread over the image that are analyzed. 0 analyzes the whole image.
+    bool  allow_bc5_normals = false; // Normal maps with Z may be stored as X and Y only in BC5, the shader rebuilds Z.
+};
+
+struct CompressionCandidate
+{
+    CompressionType compression  = COMPRESSION_NONE;
+    float           psnr         = 0.0f;
+    float           ssim         = 0.0f;
+    float           normal_error = 0.0f; // Only measured for normal maps.
+    bool            passed       = false;
+};
+
+struct CompressionSelection
+{
+    CompressionType                   compression = COMPRESSION_NONE;
+    bool                              analyzed    = false; // False if the format followed from the image alone, such as for block compressed images.
+    bool                              normal_map  = false; // Candidates were judged by their normal error.
+    bool                              grayscale   = false; // Red, green and blue are equal, BC4 only stores red.
+    std::vector<CompressionCandidate> candidates;          // Smallest format first.
+};
+
+/**
+     * Picks the smallest block compression format whose mip 0 meets a quality target. Every candidate that fits the
+     * channels and content of mip 0 is encoded with the in-tree encoder and decoded again: BC4 or BC7 for 1 channel,
+     * BC1, BC5 or BC7 for 2 channels, BC1 or BC7 for normal maps and BC5 as well with allow_bc5_normals, BC1 or BC7
+     * for opaque color, BC3 or BC7 with alpha. Opaque color whose channels are all equal also tries BC4, alpha that is
+     * only 0 or 255 also tries BC1a. Of equally sized candidates that pass, the most accurate one is used. If none
+     * passes, the most accurate candidate is used. Block compressed images keep their format. Float images only try
+     * BC6, measured on a log2(1 + x) scale, and stay uncompressed if it misses the target or their alpha is used.
+     * @param img Image to analyze.
+     * @param normal_map Measure the angular error of the decoded normals instead of PSNR and SSIM.
+     * @param quality Speed tier of the candidate encodes, which should match the final encode.
+     * @param target Quality target and analyzed area.
+     * @param selection Receives the picked format and the measurements of every candidate.
+     * @return bool Returns false if the image has no pixels.
+     */
+extern bool select_compression(const Image&              img,
+                               bool                      normal_map,
+                               const CompressionQuality& quality,
+                               const CompressionTarget&  target,
+                               CompressionSelection&     selection);
+/**
+     * Returns the path of the metadata written next to an image whose compression was selected automatically.
+     * @param image_path Path of the exported image.
+     * @return string [image path without extension]_compression.json
+     */
+extern std::string compression_metadata_path(const std::string& image_path);
+/**
+     * Writes the picked format, the target and the measurements of every candidate to a JSON file. Grayscale color
+     * stored as BC4 also writes "swizzle": "rrr1", so the loader can spread red over the color channels, and normal maps
+     * stored as BC5 write "reconstruct_z": true.
+     * @param path Output path, see compression_metadata_path.
+     * @param target Target the selection was made for.
+     * @param selection Result of select_compression.
+     * @return bool Returns false if the file could not be written.
+     */
+extern bool write_compression_metadata(const std::string& path, const CompressionTarget& target, const CompressionSelection& selection);
+} // namespace ast
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <common/image.h>
+
+namespace ast
+{
+/**
+     * Checks if the in-tree ETC/EAC encoder can produce the given format.
+     * @param compression Target block compression format.
+     * @return bool Returns true for ETC1, ETC2 RGB, ETC2 RGBA, EAC R11 and EAC RG11.
+     */
+extern bool etc_encoder_supports(const CompressionType& compression);
+/**
+     * Encodes a single UNORM8 mip level into ETC/EAC blocks, multi-threaded over block rows.
+     * Missing source channels are treated as 0, missing alpha as 255.
+     * @param compression Target block compression format.
+     * @param quality Speed tier used for the base color and modifier search.
+     * @param src Interleaved source pixels.
+     * @param width Width of the source in pixels.
+     * @param height Height of the source in pixels.
+     * @param components Number of interleaved source channels (1-4).
+     * @param dst Output buffer of at least compressed_size(compression, width, height) bytes.
+     */
+extern void etc_encode(const CompressionType&    compression,
+                       const CompressionQuality& quality,
+                       const uint8_t*            src,
+                       int                       width,
+                       int                       height,
+                       int                       components,
+                       void*                     dst);
+} // namespace ast
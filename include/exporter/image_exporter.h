@@ -1,38 +1,105 @@
 #pragma once
 
 #include <importer/image_importer.h>
+#include <common/mip_generator.h>
+#include <common/cubemap.h>
+#include <common/artifact_store.h>
+#include <exporter/compression_selector.h>
 #include <ostream>
 #include <fstream>
 
 namespace ast
 {
+enum ImageContainer
+{
+    IMAGE_CONTAINER_AST  = 0, // .ast file.
+    IMAGE_CONTAINER_KTX2 = 1  // .ktx2 file with 8-byte aligned levels that can be uploaded without reordering.
+};
+
+struct EncodeStats
+{
+    uint64_t encoded_pixels = 0;   // Pixels of every level compressed by the in-tree encoders.
+    double   encode_seconds = 0.0; // Time spent in the in-tree encoders.
+};
+
 struct ImageExportOptions
 {
     std::string     path;
-    PixelType       pixel_type  = PIXEL_TYPE_UNORM8;
+    PixelType       pixel_type  = PIXEL_TYPE_UNORM8; // Uncompressed float images are converted to FLOAT16 or FLOAT32. UNORM8 keeps the source type.
     CompressionType compression = COMPRESSION_NONE;
     bool            normal_map  = false;
     bool            flip_green  = false;
 #if defined(ENABLE_DEBUG_OUTPUT)
     bool debug_output = false;
 #endif
-    int output_mips = 0;
+    int                output_mips         = 0;
+    MipFilter          mip_filter          = MIP_FILTER_BOX;
+    bool               srgb                = true; // Color channels of UNORM8 images are sRGB encoded and filtered in linear space.
+    float              alpha_coverage      = 0.0f; // Alpha test reference used to preserve coverage in generated mips. 0 disables it.
+    CompressionQuality quality             = COMPRESSION_QUALITY_NORMAL;
+    bool               use_builtin_encoder = true; // Use the in-tree encoders for BC1, BC3-BC7, ETC1, ETC2 and EAC. Other formats always go through NVTT.
+    ImageContainer     container           = IMAGE_CONTAINER_AST;
+    ArtifactStore*     store               = nullptr; // Store checked for the converted image before doing any work. Null always converts.
+    bool               auto_compression    = false;   // Ignore compression and use the smallest format meeting compression_target, see select_compression.
+    CompressionTarget  compression_target;            // The selection is written to [name]_compression.json next to the image.
+    EncodeStats*       stats               = nullptr; // Accumulates the throughput of the in-tree encoders. Null skips the timing.
+};
+
+enum EnvironmentLayout
+{
+    ENVIRONMENT_LAYOUT_CUBEMAP    = 0, // 6 array slices.
+    ENVIRONMENT_LAYOUT_OCTAHEDRAL = 1  // Single 2D texture with gutters, see cubemap_to_octahedral.
 };
 
 struct CubemapImageExportOptions
 {
-    std::string     path;
-    CompressionType compression = COMPRESSION_NONE;
-    int             output_mips = 0;
-    int             force_cmp   = 0;
-    bool            irradiance  = false;
-    bool            radiance    = false;
+    std::string       path;
+    CompressionType   compression       = COMPRESSION_NONE;
+    PixelType         pixel_type        = PIXEL_TYPE_FLOAT32; // Stored precision of float sources. FLOAT16 halves the size of uncompressed probes.
+    int               output_mips       = 0;
+    int               force_cmp         = 0;
+    bool              irradiance        = false;
+    bool              irradiance_sh     = false; // Project the lat-long map to SH9 irradiance and export the 9 coefficients as a 9x1 RGB float image.
+    bool              sampling_tables   = false; // Export luminance importance sampling CDFs of the lat-long map as a companion [name]_sampling asset.
+    int               sampling_width    = 0;     // Width of the sampling tables, 0 keeps the lat-long resolution.
+    bool              radiance          = false;
+    int               face_size         = 0;   // 0 uses half the height of the lat-long map.
+    CubemapFilter     filter            = CUBEMAP_FILTER_BILINEAR;
+    int               supersampling     = 1;   // Samples per axis for every cubemap texel.
+    int               radiance_size     = 256; // Face size of the first radiance mip.
+    int               radiance_mips     = 7;   // Roughness levels in the radiance map, the last one is fully rough.
+    int               radiance_samples  = 64;  // GGX importance samples per radiance texel.
+    RoughnessMapping  roughness_mapping = ROUGHNESS_MAPPING_LINEAR;
+    EnvironmentLayout layout            = ENVIRONMENT_LAYOUT_CUBEMAP; // Layout of the environment, irradiance and radiance maps.
+    int               octahedral_gutter = 2;                          // Gutter texels around every mip of octahedral maps.
+    ImageContainer    container         = IMAGE_CONTAINER_AST;        // Container of every exported map.
+    ArtifactStore*    store             = nullptr;                    // Store checked for every exported map, see ImageExportOptions.
+    EncodeStats*      stats             = nullptr;                    // Accumulates the throughput of the in-tree encoders for every map.
 #if defined(ENABLE_DEBUG_OUTPUT)
     bool debug_output = false;
 #endif
 };
 
 extern bool export_image(Image& img, const ImageExportOptions& options);
+/**
+     * Hashes every option that changes the exported data, for build cache keys. The output path is not included.
+     * @param options Export options.
+     * @return uint64_t Hash of the options.
+     */
+extern uint64_t hash_export_options(const ImageExportOptions& options);
+/**
+     * Hashes every option that changes the exported maps, for build cache keys. The output path is not included.
+     * @param options Export options.
+     * @return uint64_t Hash of the options.
+     */
+extern uint64_t hash_export_options(const CubemapImageExportOptions& options);
+/**
+     * Returns the paths of every map cubemap_from_latlong writes for a lat-long map.
+     * @param input Path of the lat-long map.
+     * @param options Export options.
+     * @return vector Output paths, the environment map first.
+     */
+extern std::vector<std::string> cubemap_output_files(const std::string& input, const CubemapImageExportOptions& options);
 extern bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options);
 extern bool cubemap_from_latlong(const std::string& input, const CubemapImageExportOptions& options);
 }; // namespace ast
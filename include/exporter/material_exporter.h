@@ -2,15 +2,91 @@
 
 #include <common/material.h>
 #include <common/image.h>
+#include <common/parallel.h>
+#include <common/build_cache.h>
+#include <common/artifact_store.h>
+#include <exporter/compression_selector.h>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
 
 namespace ast
 {
 struct MaterialExportOptions
 {
-    std::string output_root_folder_path_absolute;
-    bool        use_compression       = true;
-    bool        normal_map_flip_green = false;
+    std::string       output_root_folder_path_absolute;
+    bool              use_compression       = true; // Compress every texture with the smallest format meeting compression_target.
+    CompressionTarget compression_target;
+    bool              normal_map_flip_green = false;
+    BuildCache*       cache                 = nullptr; // Skips textures whose source and settings are unchanged. Null exports every texture.
+    ArtifactStore*    store                 = nullptr; // Copies textures converted from the same source bytes and settings from the store instead of converting them.
 };
 
+// Conversion of one texture of a material.
+struct MaterialTexture
+{
+    std::string source;        // Source image path.
+    std::string output_folder; // Folder the .ast file is written to.
+    std::string output_file;   // Path of the .ast file.
+    bool        normal_map = false;
+    bool        flip_green = false;
+    bool        srgb       = false; // Color textures (base color, emissive and sheen color) are filtered in linear space.
+};
+
+// Output paths of textures that are written or being written by an export. Shared by all materials of a mesh, so a
+// texture used by several materials is converted only once.
+struct TextureRegistry
+{
+    std::mutex                      mutex;
+    std::unordered_set<std::string> claimed;
+    std::atomic<bool>               failed { false }; // Set by texture tasks that could not import or write their texture.
+
+    /**
+     * Claims a texture output path.
+     * @param path Absolute output path.
+     * @return bool Returns true for the first caller, which exports it.
+     */
+    bool claim(const std::string& path);
+};
+
+/**
+     * Lists the textures of a material with their output paths and settings, in the order of Material::textures.
+     * @param desc Material description.
+     * @param options Output folder and normal map settings.
+     * @param textures Receives the textures, appended to the existing elements.
+     */
+extern void material_textures(const Material& desc, const MaterialExportOptions& options, std::vector<MaterialTexture>& textures);
+/**
+     * Converts a single texture on the calling thread. Lets callers that schedule their own work, such as asset_build,
+     * export textures without export_material_textures.
+     * @param texture Texture from material_textures.
+     * @param options Compression settings and build cache.
+     * @param up_to_date Optionally receives whether the texture was skipped because the build cache had it.
+     * @return bool Returns false if the texture could not be imported or exported.
+     */
+extern bool export_material_texture(const MaterialTexture& texture, const MaterialExportOptions& options, bool* up_to_date = nullptr);
+/**
+     * Queues the conversion of every texture of a material that has not been exported yet. Every texture is hashed
+     * and checked against the build cache, then decoded in one task, which queues its mip generation, compression and
+     * write as another task. Failed textures set registry.failed, check it once the pool has finished.
+     * @param desc Material description.
+     * @param options Output folder and compression settings.
+     * @param pool Pool that runs the texture tasks.
+     * @param registry Registry shared by every material of the export.
+     */
+extern void export_material_textures(const Material& desc, const MaterialExportOptions& options, TaskPool& pool, TextureRegistry& registry);
+/**
+     * Writes the material JSON. Should run after the textures of the material have finished.
+     * @param desc Material description.
+     * @param options Output folder settings.
+     * @return bool Returns false if the JSON could not be written.
+     */
+extern bool write_material(const Material& desc, const MaterialExportOptions& options);
+/**
+     * Exports the textures of a material in parallel, then writes its JSON.
+     * @param desc Material description.
+     * @param options Output folder and compression settings.
+     * @return bool Returns false if a texture or the JSON could not be written.
+     */
 extern bool export_material(const Material& desc, const MaterialExportOptions& options);
 } // namespace ast
@@ -2,16 +2,41 @@
 
 #include <common/mesh.h>
 #include <common/image.h>
+#include <common/build_cache.h>
+#include <common/artifact_store.h>
+#include <exporter/compression_selector.h>
+#include <importer/mesh_importer.h>
 
 namespace ast
 {
 struct MeshExportOption
 {
-    std::string output_root_folder_path;
-    bool        use_compression       = true;
-    bool        normal_map_flip_green = false;
-    bool        output_metadata       = false;
+    std::string       output_root_folder_path;
+    bool              use_compression       = true; // Compress textures with the smallest format meeting compression_target.
+    CompressionTarget compression_target;
+    bool              normal_map_flip_green = false;
+    bool              output_metadata       = false;
+    BuildCache*       cache                 = nullptr; // Skips textures whose source and settings are unchanged. Null exports every texture.
+    bool              export_textures       = true;    // False only writes the mesh and material files, the caller converts the textures (see material_textures).
+    ArtifactStore*    store                 = nullptr; // Store checked for every texture before converting it.
 };
 
+/**
+     * Writes a mesh and its material JSONs, and converts its textures with export_textures.
+     * @param import_result Imported mesh.
+     * @param options Output folder, texture and build cache settings.
+     * @return bool Returns false if the mesh or one of its textures could not be written. The mesh and material files are still written if only a texture failed.
+     */
 extern bool export_mesh(const MeshImportResult& import_result, const MeshExportOption& options);
+/**
+     * Computes the build cache key of a mesh: its source bytes, the textures it uses and every option that changes the
+     * output. Pass the textures recorded the last time the mesh was built to check whether it is up to date.
+     * @param input Path of the source mesh.
+     * @param dependencies Paths of the source textures.
+     * @param import_options Import options.
+     * @param export_options Export options.
+     * @param key Receives the key.
+     * @return bool Returns false if a file could not be read, in which case the mesh has to be rebuilt.
+     */
+extern bool mesh_build_key(const std::string& input, const std::vector<std::string>& dependencies, const MeshImportOptions& import_options, const MeshExportOption& export_options, uint64_t& key);
 } // namespace ast
@@ -4,5 +4,32 @@
 
 namespace ast
 {
-extern bool import_image(Image& img, const std::string& file, const PixelType& type = PIXEL_TYPE_UNORM8, int force_cmp = 0);
+/**
+     * Imports an image file. DDS files are imported with every array slice, cubemap face and mip they contain.
+     * @param img Receives the image.
+     * @param file Path of the image.
+     * @param type Pixel type of uncompressed images. Float types are not supported for DDS files that are decoded.
+     * @param force_cmp Number of components to expand or reduce to, 0 keeps the components of the file. Ignored for DDS files.
+     * @param keep_compressed Keep the blocks of DDS files stored in a supported CompressionType as they are instead of
+     * decoding them. The image then has its compression set and can only be exported with the same compression.
+     * @return bool Returns false if the file could not be read or uses an unsupported format.
+     */
+extern bool import_image(Image& img, const std::string& file, const PixelType& type = PIXEL_TYPE_UNORM8, int force_cmp = 0, bool keep_compressed = false);
+/**
+     * Reads the size of an image from its header without decoding it.
+     * @param file Path of the image.
+     * @param width Receives the width of mip 0.
+     * @param height Receives the height of mip 0.
+     * @param components Receives the number of components. DDS files report the components of their block format, or 3 or 4
+     * if they are decoded.
+     * @return bool Returns false if the file could not be read.
+     */
+extern bool image_info(const std::string& file, int& width, int& height, int& components);
+/**
+     * Reads the format of a block compressed DDS file, whose blocks import_image keeps as they are with keep_compressed.
+     * @param file Path of the image.
+     * @param compression Receives the compression of the blocks.
+     * @return bool Returns false if the file is not a DDS file stored in a supported CompressionType.
+     */
+extern bool image_block_compression(const std::string& file, CompressionType& compression);
 }
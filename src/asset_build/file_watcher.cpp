@@ -0,0 +1,249 @@
+#include "file_watcher.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#if defined(__linux__)
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+// Interval between two scans of the watched directories on platforms without inotify.
+#define FILE_WATCHER_POLL_INTERVAL_MS 250
+
+#if defined(__linux__)
+FileWatcher::FileWatcher()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_fd < 0)
+        printf("ERROR: Failed to initialize inotify\n");
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool FileWatcher::valid() const
+{
+    return m_fd >= 0;
+}
+
+bool FileWatcher::watch(const std::string& directory)
+{
+    if (m_fd < 0)
+        return false;
+
+    for (const auto& it : m_directories)
+    {
+        if (it.second == directory)
+            return true;
+    }
+
+    // Editors either write files in place or write a temporary file and move it over the old one.
+    const int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (wd < 0)
+    {
+        printf("ERROR: Failed to watch directory: %s\n", directory.c_str());
+        return false;
+    }
+
+    m_directories[wd] = directory;
+
+    return true;
+}
+
+void FileWatcher::unwatch(const std::string& directory)
+{
+    for (auto it = m_directories.begin(); it != m_directories.end(); it++)
+    {
+        if (it->second == directory)
+        {
+            // Events of the watch that are still queued are dropped by read_events, their descriptor is unknown.
+            inotify_rm_watch(m_fd, it->first);
+            m_directories.erase(it);
+            return;
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::directories() const
+{
+    std::vector<std::string> directories;
+
+    for (const auto& it : m_directories)
+        directories.push_back(it.second);
+
+    return directories;
+}
+
+// Waits up to timeout_ms for events, -1 waits forever, and adds every changed file. Returns false on a timeout.
+bool FileWatcher::read_events(int timeout_ms, std::unordered_set<std::string>& changed)
+{
+    pollfd fd;
+
+    fd.fd     = m_fd;
+    fd.events = POLLIN;
+
+    if (poll(&fd, 1, timeout_ms) <= 0)
+        return false;
+
+    alignas(inotify_event) char buffer[4096];
+
+    ssize_t size;
+
+    while ((size = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* ptr = buffer; ptr < buffer + size;)
+        {
+            const inotify_event* event = (const inotify_event*)ptr;
+
+            auto it = m_directories.find(event->wd);
+
+            if (it != m_directories.end() && event->len > 0)
+                changed.insert(it->second + "/" + event->name);
+
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return true;
+}
+
+void FileWatcher::wait(std::vector<std::string>& changed, uint32_t debounce_ms)
+{
+    changed.clear();
+
+    if (m_fd < 0)
+        return;
+
+    std::unordered_set<std::string> files;
+
+    read_events(-1, files);
+
+    while (read_events(int(debounce_ms), files))
+        ;
+
+    changed.assign(files.begin(), files.end());
+}
+#else
+FileWatcher::FileWatcher()
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+bool FileWatcher::valid() const
+{
+    return true;
+}
+
+bool FileWatcher::watch(const std::string& directory)
+{
+    if (std::find(m_directories.begin(), m_directories.end(), directory) != m_directories.end())
+        return true;
+
+    std::error_code error;
+
+    if (!std::filesystem::is_directory(directory, error))
+    {
+        printf("ERROR: Failed to watch directory: %s\n", directory.c_str());
+        return false;
+    }
+
+    std::unordered_set<std::string> changed;
+
+    m_directories.push_back(directory);
+    scan(directory, false, changed);
+
+    return true;
+}
+
+void FileWatcher::unwatch(const std::string& directory)
+{
+    auto it = std::find(m_directories.begin(), m_directories.end(), directory);
+
+    if (it == m_directories.end())
+        return;
+
+    m_directories.erase(it);
+
+    // Watching is not recursive, so the files of the directory are the paths without another separator after it.
+    const std::string prefix = directory + "/";
+
+    for (auto time = m_times.begin(); time != m_times.end();)
+    {
+        if (time->first.compare(0, prefix.size(), prefix) == 0 && time->first.find('/', prefix.size()) == std::string::npos)
+            time = m_times.erase(time);
+        else
+            time++;
+    }
+}
+
+std::vector<std::string> FileWatcher::directories() const
+{
+    return m_directories;
+}
+
+// Records the modification time of every file in a directory and optionally reports files whose time changed.
+// Returns true if a time changed.
+bool FileWatcher::scan(const std::string& directory, bool report, std::unordered_set<std::string>& changed)
+{
+    std::error_code error;
+    bool            modified = false;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file(error))
+            continue;
+
+        const std::string                     path = directory + "/" + entry.path().filename().string();
+        const std::filesystem::file_time_type time = entry.last_write_time(error);
+
+        auto it = m_times.find(path);
+
+        if (it == m_times.end() || it->second != time)
+        {
+            if (report)
+                changed.insert(path);
+
+            m_times[path] = time;
+            modified      = true;
+        }
+    }
+
+    return modified;
+}
+
+void FileWatcher::wait(std::vector<std::string>& changed, uint32_t debounce_ms)
+{
+    std::unordered_set<std::string> files;
+
+    auto last_change = std::chrono::steady_clock::now();
+
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(FILE_WATCHER_POLL_INTERVAL_MS));
+
+        bool modified = false;
+
+        for (const auto& directory : m_directories)
+            modified |= scan(directory, true, files);
+
+        const auto now = std::chrono::steady_clock::now();
+
+        if (modified)
+            last_change = now;
+        else if (!files.empty() && now - last_change >= std::chrono::milliseconds(debounce_ms))
+            break;
+    }
+
+    changed.assign(files.begin(), files.end());
+}
+#endif
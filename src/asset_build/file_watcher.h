@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#if !defined(__linux__)
+#    include <filesystem>
+#endif
+
+// Reports files that were written or moved into a set of directories. Uses inotify on Linux and compares the
+// modification times of the files in every directory on other platforms. Directories are not watched recursively.
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /**
+     * Checks whether the watcher can report changes. Fails on Linux if inotify could not be initialized.
+     * @return bool Returns false if wait would return without waiting for changes.
+     */
+    bool valid() const;
+    /**
+     * Starts watching a directory. Watching a directory twice has no effect.
+     * @param directory Absolute path of the directory.
+     * @return bool Returns false if the directory could not be watched.
+     */
+    bool watch(const std::string& directory);
+    /**
+     * Stops watching a directory. Changes already reported for other directories are kept.
+     * @param directory Absolute path of the directory.
+     */
+    void unwatch(const std::string& directory);
+    /**
+     * Returns the watched directories.
+     * @return vector Absolute paths passed to watch.
+     */
+    std::vector<std::string> directories() const;
+    /**
+     * Blocks until a file changes, then keeps collecting changes until none arrived for the debounce interval, so an
+     * editor saving several files or writing a file in pieces triggers a single rebuild.
+     * @param changed Receives the absolute paths of the changed files, without duplicates.
+     * @param debounce_ms Quiet time in milliseconds that ends a batch of changes.
+     */
+    void wait(std::vector<std::string>& changed, uint32_t debounce_ms);
+
+private:
+#if defined(__linux__)
+    bool read_events(int timeout_ms, std::unordered_set<std::string>& changed);
+
+    int                                  m_fd = -1;
+    std::unordered_map<int, std::string> m_directories;
+#else
+    bool scan(const std::string& directory, bool report, std::unordered_set<std::string>& changed);
+
+    std::vector<std::string>                                         m_directories;
+    std::unordered_map<std::string, std::filesystem::file_time_type> m_times;
+#endif
+};
@@ -0,0 +1,135 @@
+#include "job_graph.h"
+#include <stdio.h>
+#include <chrono>
+
+static const char* kResultNames[] = { "OK", "UP TO DATE", "FAILED" };
+
+JobGraph::JobGraph(ast::TaskPool& pool, size_t memory_budget, uint32_t max_running) :
+    m_pool(pool), m_memory_budget(memory_budget), m_max_running(max_running > 0 ? max_running : ast::worker_count())
+{
+}
+
+uint32_t JobGraph::add(const std::string& kind, const std::string& name, size_t memory, std::function<JobResult()> run, const std::vector<uint32_t>& dependencies)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const uint32_t id = uint32_t(m_jobs.size());
+
+    std::unique_ptr<Job> job = std::make_unique<Job>();
+
+    job->kind   = kind;
+    job->name   = name;
+    job->memory = memory;
+    job->run    = std::move(run);
+
+    for (uint32_t dependency : dependencies)
+    {
+        if (!m_jobs[dependency]->finished)
+        {
+            m_jobs[dependency]->dependents.push_back(id);
+            job->remaining++;
+        }
+    }
+
+    const bool ready = job->remaining == 0;
+
+    m_jobs.push_back(std::move(job));
+
+    if (ready)
+    {
+        m_ready.push_back(id);
+        admit();
+    }
+
+    return id;
+}
+
+JobResult JobGraph::result(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_jobs[id]->result;
+}
+
+void JobGraph::wait()
+{
+    m_pool.wait();
+}
+
+bool JobGraph::report(double seconds)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    printf("\n%u built, %u up to date, %u failed in %f seconds\n", m_counts[JOB_RESULT_BUILT], m_counts[JOB_RESULT_UP_TO_DATE], m_counts[JOB_RESULT_FAILED], seconds);
+
+    for (uint32_t id : m_failed)
+        printf("  FAILED %s %s\n", m_jobs[id]->kind.c_str(), m_jobs[id]->name.c_str());
+
+    printf("\n");
+
+    return m_failed.empty();
+}
+
+// Starts ready jobs in order while they fit. The first job always starts when nothing is running, so a job larger
+// than the budget cannot stall the build. Must be called with m_mutex held.
+void JobGraph::admit()
+{
+    while (!m_ready.empty() && m_running < m_max_running)
+    {
+        const uint32_t id  = m_ready.front();
+        const Job&     job = *m_jobs[id];
+
+        if (m_running > 0 && m_memory_used + job.memory > m_memory_budget)
+            break;
+
+        m_ready.pop_front();
+        m_running++;
+        m_memory_used += job.memory;
+
+        m_pool.submit([this, id]() { execute(id); });
+    }
+}
+
+void JobGraph::execute(uint32_t id)
+{
+    std::function<JobResult()> run;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        run = std::move(m_jobs[id]->run);
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const JobResult result = run();
+
+    auto                          finish = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time   = finish - start;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Job& job = *m_jobs[id];
+
+    job.finished = true;
+    job.result   = result;
+
+    m_running--;
+    m_memory_used -= job.memory;
+    m_finished++;
+    m_counts[result]++;
+
+    if (result == JOB_RESULT_FAILED)
+        m_failed.push_back(id);
+
+    // Jobs added by a running job count towards the total, so it can grow while the build runs.
+    printf("[%u/%u] %-10s %s %s (%f seconds)\n", m_finished, uint32_t(m_jobs.size()), kResultNames[result], job.kind.c_str(), job.name.c_str(), time.count());
+    fflush(stdout);
+
+    for (uint32_t dependent : job.dependents)
+    {
+        if (--m_jobs[dependent]->remaining == 0)
+            m_ready.push_back(dependent);
+    }
+
+    admit();
+}
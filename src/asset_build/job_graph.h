@@ -0,0 +1,90 @@
+#pragma once
+
+#include <common/parallel.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum JobResult
+{
+    JOB_RESULT_BUILT      = 0,
+    JOB_RESULT_UP_TO_DATE = 1,
+    JOB_RESULT_FAILED     = 2
+};
+
+// Runs build jobs on a TaskPool once their dependencies have finished. Jobs carry an estimate of the memory they
+// peak at, and a ready job only starts while the estimates of all running jobs fit into the memory budget, so a
+// handful of 8K textures do not decode and compress at the same time. A job larger than the whole budget runs on its
+// own. Ready jobs start in the order they became ready, and a job that does not fit holds back the jobs behind it so
+// it is not starved by smaller ones. Jobs can add more jobs while they run. All functions are thread safe.
+class JobGraph
+{
+public:
+    /**
+     * @param pool Pool that runs the jobs.
+     * @param memory_budget Bytes the running jobs may use together.
+     * @param max_running Maximum number of jobs running at once, 0 uses worker_count().
+     */
+    JobGraph(ast::TaskPool& pool, size_t memory_budget, uint32_t max_running = 0);
+
+    /**
+     * Adds a job, which starts as soon as all of its dependencies have finished and it fits into the memory budget.
+     * Dependents run even if a dependency failed, and can check with result().
+     * @param kind Kind of asset, used for the progress report.
+     * @param name Name of the asset, used for the progress report.
+     * @param memory Estimated peak memory use in bytes.
+     * @param run Function that builds the asset.
+     * @param dependencies Jobs that have to finish first.
+     * @return uint32_t Job id.
+     */
+    uint32_t add(const std::string& kind, const std::string& name, size_t memory, std::function<JobResult()> run, const std::vector<uint32_t>& dependencies = std::vector<uint32_t>());
+    /**
+     * Returns the result of a finished job.
+     * @param id Job id.
+     * @return JobResult Result, JOB_RESULT_FAILED while the job has not finished.
+     */
+    JobResult result(uint32_t id);
+    /**
+     * Runs queued tasks until every job, including jobs added by other jobs, has finished. Must not be called from a job.
+     */
+    void wait();
+    /**
+     * Prints the number of built, skipped and failed jobs followed by every failed job.
+     * @param seconds Wall time of the build.
+     * @return bool Returns false if a job failed.
+     */
+    bool report(double seconds);
+
+private:
+    struct Job
+    {
+        std::string                kind;
+        std::string                name;
+        size_t                     memory = 0;
+        std::function<JobResult()> run;
+        std::vector<uint32_t>      dependents;
+        uint32_t                   remaining = 0;
+        bool                       finished  = false;
+        JobResult                  result    = JOB_RESULT_FAILED;
+    };
+
+    void admit();
+    void execute(uint32_t id);
+
+    ast::TaskPool&                    m_pool;
+    std::mutex                        m_mutex;
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::deque<uint32_t>              m_ready;
+    size_t                            m_memory_budget;
+    size_t                            m_memory_used = 0;
+    uint32_t                          m_max_running;
+    uint32_t                          m_running   = 0;
+    uint32_t                          m_finished  = 0;
+    uint32_t                          m_counts[3] = { 0, 0, 0 };
+    std::vector<uint32_t>             m_failed;
+};
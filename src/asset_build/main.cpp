@@ -0,0 +1,772 @@
+#include "file_watcher.h"
+#include "job_graph.h"
+#include "manifest.h"
+#include <exporter/material_exporter.h>
+#include <common/filesystem.h>
+#include <common/build_cache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#if defined(_WIN32)
+#    define NOMINMAX
+#    include <Windows.h>
+#else
+#    include <unistd.h>
+#endif
+
+// Peak memory estimates of the jobs, used to keep the running jobs within the memory budget.
+#define TEXTURE_BYTES_PER_PIXEL 16     // Decoded source, float mips and compressed output.
+#define ENVIRONMENT_BYTES_PER_PIXEL 48 // Float lat-long map, its cubemap and the prefiltered maps.
+#define BRDF_LUT_BYTES_PER_PIXEL 16
+#define MESH_BYTES_PER_FILE_BYTE 16
+#define MESH_MIN_BYTES (64ull << 20)
+#define DEFAULT_MEMORY_BUDGET (4ull << 30) // Used if the physical memory size is not known.
+#define WATCH_DEBOUNCE_MS 200
+
+void print_usage()
+{
+    printf("usage: asset_build [options] manifest\n\n");
+
+    printf("Options:\n");
+    printf("  -F			Rebuild everything, ignoring the build cache.\n");
+    printf("  -M[mb]		Memory budget of the running jobs in MB (default half the physical memory).\n");
+    printf("  -T[n]			Maximum number of jobs running at once (default one per hardware thread).\n");
+    printf("  -W			Keep running after the build and rebuild the assets whose sources change.\n");
+}
+
+// Texture of a mesh imported by this process.
+struct MeshTexture
+{
+    ast::MaterialTexture          texture;
+    ast::MaterialExportOptions    options;
+    std::vector<const MeshAsset*> meshes; // Meshes that use the texture.
+};
+
+// State shared by every job of a build.
+struct Build
+{
+    JobGraph*           graph = nullptr;
+    ast::BuildCache*    cache = nullptr; // Null rebuilds everything.
+    ast::ArtifactStore* store = nullptr; // Null converts everything that is not up to date.
+    std::string         output;
+
+    // Texture outputs that already have a job, so a texture shared by several meshes or also listed in the manifest
+    // is converted once, with the settings of whoever added it first.
+    std::mutex                                mutex;
+    std::unordered_map<std::string, uint32_t> textures;
+
+    // Textures of the imported meshes by source path, so the watch mode can convert a changed texture again without
+    // importing every mesh that uses it.
+    std::unordered_map<std::string, MeshTexture> mesh_textures;
+};
+
+// Absolute, normalized path used to match changed files with sources.
+std::string normal_path(const std::string& path)
+{
+    std::error_code error;
+    return std::filesystem::absolute(path, error).lexically_normal().string();
+}
+
+std::string mesh_output(const Build& build, const MeshAsset& mesh)
+{
+    return build.output + "/mesh/" + filesystem::get_filename(mesh.source) + ".ast";
+}
+
+// Records the current key of a mesh whose textures were converted again without importing the mesh.
+void update_mesh_key(Build& build, const MeshAsset& mesh)
+{
+    if (!build.cache)
+        return;
+
+    const std::string              output_path  = mesh_output(build, mesh);
+    const std::vector<std::string> dependencies = build.cache->dependencies(output_path);
+
+    uint64_t key;
+
+    if (ast::mesh_build_key(mesh.source, dependencies, mesh.import_options, mesh.export_options, key))
+        build.cache->update(output_path, key, dependencies);
+}
+
+size_t physical_memory()
+{
+#if defined(_WIN32)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+
+    if (GlobalMemoryStatusEx(&status))
+        return size_t(status.ullTotalPhys);
+
+    return 0;
+#else
+    const long pages     = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+
+    if (pages <= 0 || page_size <= 0)
+        return 0;
+
+    return size_t(pages) * size_t(page_size);
+#endif
+}
+
+size_t image_memory(const std::string& source, size_t bytes_per_pixel)
+{
+    int width, height, components;
+
+    if (!ast::image_info(source, width, height, components))
+        return 0;
+
+    return size_t(width) * size_t(height) * bytes_per_pixel;
+}
+
+JobResult build_texture(Build& build, const TextureAsset& texture, const std::string& output_file)
+{
+    ast::ImageExportOptions options = texture.options;
+    options.path                    = build.output + "/texture";
+    options.store                   = build.store;
+    options.auto_compression        = texture.compression == "auto";
+
+    uint64_t   key    = 0;
+    const bool hashed = build.cache && ast::hash_file(texture.source, key);
+
+    if (hashed)
+    {
+        key = ast::hash_combine(key, ast::hash_export_options(options));
+        key = ast::hash_string(key, texture.compression);
+
+        if (build.cache->up_to_date(output_file, key))
+            return JOB_RESULT_UP_TO_DATE;
+    }
+
+    ast::Image img;
+
+    // Block compressed DDS files are copied as they are unless they have to be decoded for ETC or no compression.
+    if (!ast::import_image(img, texture.source, ast::PIXEL_TYPE_UNORM8, 0, texture.compression != "none" && texture.compression != "etc"))
+    {
+        printf("ERROR: Failed to import texture: %s\n", texture.source.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    if (img.compression != ast::COMPRESSION_NONE)
+        options.compression = img.compression;
+    else
+        texture_compression(texture.compression, img.components, options.compression);
+
+    if (!ast::export_image(img, options))
+    {
+        printf("ERROR: Failed to export texture: %s\n", texture.source.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    if (hashed)
+        build.cache->update(output_file, key);
+
+    return JOB_RESULT_BUILT;
+}
+
+void add_texture(Build& build, const TextureAsset& texture)
+{
+    const std::string output_file = build.output + "/texture/" + filesystem::get_filename(texture.source) + (texture.options.container == ast::IMAGE_CONTAINER_KTX2 ? ".ktx2" : ".ast");
+
+    std::lock_guard<std::mutex> lock(build.mutex);
+
+    if (build.textures.find(output_file) != build.textures.end())
+    {
+        printf("WARNING: Skipping %s, another texture is written to %s\n", texture.source.c_str(), output_file.c_str());
+        return;
+    }
+
+    build.textures[output_file] = build.graph->add("texture", texture.source, image_memory(texture.source, TEXTURE_BYTES_PER_PIXEL), [&build, &texture, output_file]() {
+        return build_texture(build, texture, output_file);
+    });
+}
+
+// Adds a job for a mesh texture unless its output already has one. The keys of the meshes passed in are updated once
+// the texture is converted, for meshes that are not imported again.
+uint32_t add_material_texture(Build& build, const ast::MaterialTexture& texture, const ast::MaterialExportOptions& options, const std::vector<const MeshAsset*>& meshes = std::vector<const MeshAsset*>())
+{
+    std::lock_guard<std::mutex> lock(build.mutex);
+
+    auto it = build.textures.find(texture.output_file);
+
+    if (it != build.textures.end())
+        return it->second;
+
+    const uint32_t id = build.graph->add("texture", texture.source, image_memory(texture.source, TEXTURE_BYTES_PER_PIXEL), [&build, texture, options, meshes]() {
+        bool up_to_date = false;
+
+        if (!ast::export_material_texture(texture, options, &up_to_date))
+            return JOB_RESULT_FAILED;
+
+        for (const MeshAsset* mesh : meshes)
+            update_mesh_key(build, *mesh);
+
+        return up_to_date ? JOB_RESULT_UP_TO_DATE : JOB_RESULT_BUILT;
+    });
+
+    build.textures[texture.output_file] = id;
+
+    return id;
+}
+
+// Writes the mesh and its materials once its textures have finished.
+JobResult write_mesh(Build& build, const MeshAsset& mesh, const ast::MeshImportResult& import_result, const ast::MeshExportOption& export_options, const std::vector<uint32_t>& textures)
+{
+    if (!ast::export_mesh(import_result, export_options))
+    {
+        printf("ERROR: Failed to export mesh: %s\n", mesh.source.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    // A mesh with a failed texture is not recorded, so the texture is tried again by the next build.
+    const bool textures_built = std::none_of(textures.begin(), textures.end(), [&](uint32_t id) { return build.graph->result(id) == JOB_RESULT_FAILED; });
+
+    if (build.cache && textures_built)
+    {
+        const std::string output_path = mesh_output(build, mesh);
+
+        std::vector<std::string> dependencies;
+
+        for (const auto& material : import_result.materials)
+        {
+            for (const auto& texture : material->textures)
+                dependencies.push_back(texture.path);
+        }
+
+        uint64_t key;
+
+        if (ast::mesh_build_key(mesh.source, dependencies, mesh.import_options, export_options, key))
+            build.cache->update(output_path, key, dependencies);
+    }
+
+    return JOB_RESULT_BUILT;
+}
+
+// Imports a mesh, then adds a job for every texture it uses and a job that writes the mesh after them. Skips all of
+// it if neither the mesh nor the textures it used last time changed.
+JobResult load_mesh(Build& build, const MeshAsset& mesh)
+{
+    ast::MeshExportOption export_options = mesh.export_options;
+
+    export_options.output_root_folder_path = build.output;
+    export_options.cache                   = build.cache;
+    export_options.store                   = build.store;
+    export_options.export_textures         = false;
+
+    if (build.cache)
+    {
+        const std::string output_path = mesh_output(build, mesh);
+
+        uint64_t key;
+
+        if (ast::mesh_build_key(mesh.source, build.cache->dependencies(output_path), mesh.import_options, export_options, key) && build.cache->up_to_date(output_path, key))
+            return JOB_RESULT_UP_TO_DATE;
+    }
+
+    std::shared_ptr<ast::MeshImportResult> import_result = std::make_shared<ast::MeshImportResult>();
+
+    if (!ast::import_mesh(mesh.source, *import_result, mesh.import_options))
+    {
+        printf("ERROR: Failed to import mesh: %s\n", mesh.source.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    ast::MaterialExportOptions material_options;
+
+    material_options.output_root_folder_path_absolute = build.output;
+    material_options.use_compression                  = export_options.use_compression;
+    material_options.compression_target               = export_options.compression_target;
+    material_options.normal_map_flip_green            = export_options.normal_map_flip_green;
+    material_options.cache                            = build.cache;
+    material_options.store                            = build.store;
+
+    std::vector<ast::MaterialTexture> textures;
+
+    for (const auto& material : import_result->materials)
+        ast::material_textures(*material, material_options, textures);
+
+    {
+        std::lock_guard<std::mutex> lock(build.mutex);
+
+        for (const auto& texture : textures)
+        {
+            MeshTexture& mesh_texture = build.mesh_textures[normal_path(texture.source)];
+
+            if (mesh_texture.meshes.empty())
+            {
+                mesh_texture.texture = texture;
+                mesh_texture.options = material_options;
+            }
+
+            if (std::find(mesh_texture.meshes.begin(), mesh_texture.meshes.end(), &mesh) == mesh_texture.meshes.end())
+                mesh_texture.meshes.push_back(&mesh);
+        }
+    }
+
+    std::vector<uint32_t> dependencies;
+
+    for (const auto& texture : textures)
+        dependencies.push_back(add_material_texture(build, texture, material_options));
+
+    build.graph->add("mesh", mesh.source, 0, [&build, &mesh, import_result, export_options, dependencies]() {
+        return write_mesh(build, mesh, *import_result, export_options, dependencies);
+    },
+                     dependencies);
+
+    return JOB_RESULT_BUILT;
+}
+
+void add_mesh(Build& build, const MeshAsset& mesh)
+{
+    const size_t memory = std::max(size_t(filesystem::get_file_size(mesh.source)) * MESH_BYTES_PER_FILE_BYTE, size_t(MESH_MIN_BYTES));
+
+    build.graph->add("import", mesh.source, memory, [&build, &mesh]() { return load_mesh(build, mesh); });
+}
+
+JobResult build_environment(Build& build, const EnvironmentAsset& environment)
+{
+    ast::CubemapImageExportOptions options = environment.options;
+    options.path                           = build.output + "/environment";
+    options.store                          = build.store;
+
+    const std::vector<std::string> outputs = ast::cubemap_output_files(environment.source, options);
+
+    uint64_t   key    = 0;
+    const bool hashed = build.cache && ast::hash_file(environment.source, key);
+
+    if (hashed)
+    {
+        key = ast::hash_combine(key, ast::hash_export_options(options));
+
+        if (std::all_of(outputs.begin(), outputs.end(), [&](const std::string& output) { return build.cache->up_to_date(output, key); }))
+            return JOB_RESULT_UP_TO_DATE;
+    }
+
+    if (!ast::cubemap_from_latlong(environment.source, options))
+    {
+        printf("ERROR: Failed to export environment: %s\n", environment.source.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    if (hashed)
+    {
+        for (const auto& output : outputs)
+            build.cache->update(output, key);
+    }
+
+    return JOB_RESULT_BUILT;
+}
+
+JobResult build_brdf_lut(Build& build, const Manifest& manifest)
+{
+    const std::string output_file = build.output + "/brdf_lut.ast";
+
+    uint64_t key = ast::hash_string(0, "brdf_lut");
+
+    key = ast::hash_combine(key, manifest.brdf_lut_options.size);
+    key = ast::hash_combine(key, manifest.brdf_lut_options.sample_count);
+    key = ast::hash_combine(key, manifest.brdf_lut_options.multi_lut);
+    key = ast::hash_combine(key, manifest.brdf_lut_pixel_type);
+
+    if (build.cache && build.cache->up_to_date(output_file, key))
+        return JOB_RESULT_UP_TO_DATE;
+
+    ast::Image img;
+
+    if (!ast::generate_brdf_lut(img, manifest.brdf_lut_options))
+        return JOB_RESULT_FAILED;
+
+    img.name = "brdf_lut";
+
+    ast::ImageExportOptions options;
+
+    options.path        = build.output;
+    options.compression = ast::COMPRESSION_NONE;
+    options.pixel_type  = manifest.brdf_lut_pixel_type;
+    options.output_mips = 0;
+    options.store       = build.store;
+
+    if (!ast::export_image(img, options))
+    {
+        printf("ERROR: Failed to export BRDF LUT: %s\n", output_file.c_str());
+        return JOB_RESULT_FAILED;
+    }
+
+    if (build.cache)
+        build.cache->update(output_file, key);
+
+    return JOB_RESULT_BUILT;
+}
+
+void add_environment(Build& build, const EnvironmentAsset& environment)
+{
+    build.graph->add("environment", environment.source, image_memory(environment.source, ENVIRONMENT_BYTES_PER_PIXEL), [&build, &environment]() {
+        return build_environment(build, environment);
+    });
+}
+
+void add_brdf_lut(Build& build, const Manifest& manifest)
+{
+    const size_t memory = size_t(manifest.brdf_lut_options.size) * size_t(manifest.brdf_lut_options.size) * BRDF_LUT_BYTES_PER_PIXEL;
+
+    build.graph->add("brdf_lut", "brdf_lut", memory, [&build, &manifest]() { return build_brdf_lut(build, manifest); });
+}
+
+void add_all(Build& build, const Manifest& manifest)
+{
+    // Textures listed in the manifest are added first, so their settings win over meshes that use the same file.
+    for (const auto& texture : manifest.textures)
+        add_texture(build, texture);
+
+    for (const auto& mesh : manifest.meshes)
+        add_mesh(build, mesh);
+
+    for (const auto& environment : manifest.environments)
+        add_environment(build, environment);
+
+    if (manifest.brdf_lut)
+        add_brdf_lut(build, manifest);
+}
+
+// Adds the jobs affected by a batch of changed files. A changed mesh texture is converted again on its own and only
+// updates the keys of the meshes that use it. Meshes whose textures are only known from the build cache, because
+// they were up to date when this process started, are imported again. Returns false if nothing is affected.
+bool add_changed(Build& build, const Manifest& manifest, const std::unordered_set<std::string>& changed)
+{
+    std::vector<const TextureAsset*>     textures;
+    std::vector<const MeshAsset*>        meshes;
+    std::vector<MeshTexture>             mesh_textures;
+    std::vector<const EnvironmentAsset*> environments;
+
+    for (const auto& texture : manifest.textures)
+    {
+        if (changed.count(texture.source))
+            textures.push_back(&texture);
+    }
+
+    for (const auto& mesh : manifest.meshes)
+    {
+        bool affected = changed.count(mesh.source) > 0;
+
+        if (!affected && build.cache)
+        {
+            for (const auto& dependency : build.cache->dependencies(mesh_output(build, mesh)))
+            {
+                const std::string path = normal_path(dependency);
+
+                if (changed.count(path) && !build.mesh_textures.count(path))
+                    affected = true;
+            }
+        }
+
+        if (affected)
+            meshes.push_back(&mesh);
+    }
+
+    for (const auto& it : build.mesh_textures)
+    {
+        if (!changed.count(it.first))
+            continue;
+
+        // Meshes that are imported again convert their textures themselves.
+        MeshTexture mesh_texture = it.second;
+
+        mesh_texture.meshes.erase(std::remove_if(mesh_texture.meshes.begin(), mesh_texture.meshes.end(), [&](const MeshAsset* mesh) { return std::find(meshes.begin(), meshes.end(), mesh) != meshes.end(); }), mesh_texture.meshes.end());
+
+        if (!mesh_texture.meshes.empty())
+            mesh_textures.push_back(mesh_texture);
+    }
+
+    for (const auto& environment : manifest.environments)
+    {
+        if (changed.count(environment.source))
+            environments.push_back(&environment);
+    }
+
+    if (textures.empty() && meshes.empty() && mesh_textures.empty() && environments.empty())
+        return false;
+
+    // Jobs start as soon as they are added, so everything above is collected before mesh imports update
+    // build.mesh_textures.
+    for (const TextureAsset* texture : textures)
+        add_texture(build, *texture);
+
+    for (const MeshTexture& mesh_texture : mesh_textures)
+        add_material_texture(build, mesh_texture.texture, mesh_texture.options, mesh_texture.meshes);
+
+    for (const MeshAsset* mesh : meshes)
+        add_mesh(build, *mesh);
+
+    for (const EnvironmentAsset* environment : environments)
+        add_environment(build, *environment);
+
+    return true;
+}
+
+// Watches the directories of the manifest, every source and every texture of the meshes, and stops watching directories
+// that none of them is in anymore. The watcher is kept across manifest changes, so changes made during a build are not
+// lost.
+void watch_sources(FileWatcher& watcher, Build& build, const Manifest& manifest, const std::string& manifest_path)
+{
+    std::unordered_set<std::string> files = { manifest_path };
+
+    for (const auto& texture : manifest.textures)
+        files.insert(texture.source);
+
+    for (const auto& environment : manifest.environments)
+        files.insert(environment.source);
+
+    for (const auto& mesh : manifest.meshes)
+    {
+        files.insert(mesh.source);
+
+        if (build.cache)
+        {
+            for (const auto& dependency : build.cache->dependencies(mesh_output(build, mesh)))
+                files.insert(normal_path(dependency));
+        }
+    }
+
+    for (const auto& it : build.mesh_textures)
+        files.insert(it.first);
+
+    std::unordered_set<std::string> directories;
+
+    for (const auto& file : files)
+        directories.insert(std::filesystem::path(file).parent_path().string());
+
+    for (const auto& directory : watcher.directories())
+    {
+        if (!directories.count(directory))
+            watcher.unwatch(directory);
+    }
+
+    for (const auto& directory : directories)
+        watcher.watch(directory);
+}
+
+// Runs a build over the jobs added by add_jobs, then saves the build cache and reports the results.
+bool build_pass(Build& build, ast::TaskPool& pool, size_t memory_budget, uint32_t max_running, const std::function<bool()>& add_jobs)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    JobGraph graph(pool, memory_budget, max_running);
+
+    build.graph = &graph;
+    build.textures.clear();
+
+    if (!add_jobs())
+    {
+        build.graph = nullptr;
+        return true;
+    }
+
+    graph.wait();
+
+    build.graph = nullptr;
+
+    if (build.cache)
+        build.cache->save();
+
+    auto                          finish = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time   = finish - start;
+
+    return graph.report(time.count());
+}
+
+// Creates the output folder of a manifest and loads its build cache.
+bool open_output(Build& build, ast::BuildCache& cache, const Manifest& manifest, bool use_cache)
+{
+    std::error_code error;
+    std::filesystem::create_directories(manifest.output, error);
+
+    if (error)
+    {
+        printf("ERROR: Failed to create output folder: %s\n", manifest.output.c_str());
+        return false;
+    }
+
+    build.output = manifest.output;
+    build.cache  = use_cache ? &cache : nullptr;
+
+    if (use_cache)
+        cache.load(manifest.output + "/" + BUILD_CACHE_FILE_NAME);
+
+    return true;
+}
+
+// Opens the artifact store of the manifest, or else the one named by the environment.
+void open_store(Build& build, ast::ArtifactStore& store, const Manifest& manifest)
+{
+    bool opened = false;
+
+    if (!manifest.artifact_store.empty())
+        opened = store.open(manifest.artifact_store, manifest.artifact_store_size > 0 ? manifest.artifact_store_size : ARTIFACT_STORE_DEFAULT_SIZE);
+    else
+        opened = store.open_from_environment();
+
+    build.store = opened ? &store : nullptr;
+}
+
+// The command line overrides the manifest, which overrides the default of half the physical memory.
+size_t memory_budget(size_t command_line, const Manifest& manifest)
+{
+    if (command_line > 0)
+        return command_line;
+
+    if (manifest.memory_budget > 0)
+        return manifest.memory_budget;
+
+    const size_t memory = physical_memory();
+
+    return memory > 0 ? memory / 2 : DEFAULT_MEMORY_BUDGET;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 1)
+    {
+        print_usage();
+        return 1;
+    }
+    else
+    {
+        std::string manifest_path;
+        size_t      budget      = 0;
+        uint32_t    max_running = 0;
+        bool        use_cache   = true;
+        bool        watch       = false;
+
+        for (int32_t i = 1; i < argc; i++)
+        {
+            if (argv[i][0] == '-')
+            {
+                char c = tolower(argv[i][1]);
+
+                if (c == 'f')
+                    use_cache = false;
+                else if (c == 'm')
+                    budget = size_t(std::max(atoi(&argv[i][2]), 1)) << 20;
+                else if (c == 't')
+                    max_running = uint32_t(std::max(atoi(&argv[i][2]), 1));
+                else if (c == 'w')
+                    watch = true;
+            }
+            else
+                manifest_path = argv[i];
+        }
+
+        if (manifest_path.size() == 0)
+        {
+            printf("ERROR: Invalid manifest path\n\n");
+            print_usage();
+
+            return 1;
+        }
+
+        manifest_path = normal_path(manifest_path);
+
+        Manifest manifest;
+
+        if (!load_manifest(manifest_path, manifest))
+            return 1;
+
+        ast::BuildCache    cache;
+        ast::ArtifactStore store;
+        Build              build;
+
+        if (!open_output(build, cache, manifest, use_cache))
+            return 1;
+
+        open_store(build, store, manifest);
+
+        // Jobs are tasks of one pool. parallel_for calls inside a job queue their iterations as tasks of the same pool
+        // and the job helps run them while it waits, so a large asset spreads over idle workers without starting more
+        // threads than the pool has.
+        ast::TaskPool pool;
+
+        printf("Building %s with a memory budget of %u MB\n\n", manifest_path.c_str(), uint32_t(memory_budget(budget, manifest) >> 20));
+
+        const bool built = build_pass(build, pool, memory_budget(budget, manifest), max_running, [&]() {
+            add_all(build, manifest);
+            return true;
+        });
+
+        if (!watch)
+            return built ? 0 : 1;
+
+        // The process stays warm between rebuilds: the pool, the build cache and the textures of imported meshes are
+        // kept, and every output is published with a rename so engines can hot reload it.
+        FileWatcher watcher;
+
+        // Waiting would return at once and spin, so a build that cannot watch its sources ends after the first pass.
+        if (!watcher.valid())
+        {
+            printf("ERROR: Watch mode is not available.\n");
+            return 1;
+        }
+
+        watch_sources(watcher, build, manifest, manifest_path);
+
+        printf("Watching for changes, press Ctrl+C to stop.\n\n");
+
+        std::vector<std::string> changed;
+
+        while (true)
+        {
+            watcher.wait(changed, WATCH_DEBOUNCE_MS);
+
+            std::unordered_set<std::string> files;
+
+            for (const auto& file : changed)
+                files.insert(normal_path(file));
+
+            if (files.count(manifest_path))
+            {
+                Manifest reloaded;
+
+                // A manifest that does not parse is reported and the last one is kept.
+                if (!load_manifest(manifest_path, reloaded))
+                    continue;
+
+                if (reloaded.output != manifest.output)
+                {
+                    if (build.cache)
+                        build.cache->save();
+
+                    if (!open_output(build, cache, reloaded, use_cache))
+                        continue;
+                }
+
+                manifest = reloaded;
+                build.mesh_textures.clear();
+
+                open_store(build, store, manifest);
+
+                printf("Manifest changed, rebuilding %s\n\n", manifest_path.c_str());
+
+                build_pass(build, pool, memory_budget(budget, manifest), max_running, [&]() {
+                    add_all(build, manifest);
+                    return true;
+                });
+            }
+            else
+            {
+                build_pass(build, pool, memory_budget(budget, manifest), max_running, [&]() {
+                    return add_changed(build, manifest, files);
+                });
+            }
+
+            // Sources may have moved to other directories.
+            watch_sources(watcher, build, manifest, manifest_path);
+        }
+
+        return 0;
+    }
+}
@@ -0,0 +1,246 @@
+#include "manifest.h"
+#include <json.hpp>
+#include <stdio.h>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+
+struct CompressionName
+{
+    const char*          name;
+    ast::CompressionType compression;
+};
+
+static const CompressionName kCompressionNames[] = {
+    { "none", ast::COMPRESSION_NONE },
+    { "bc1", ast::COMPRESSION_BC1 },
+    { "bc3", ast::COMPRESSION_BC3 },
+    { "bc4", ast::COMPRESSION_BC4 },
+    { "bc5", ast::COMPRESSION_BC5 },
+    { "bc6", ast::COMPRESSION_BC6 },
+    { "bc7", ast::COMPRESSION_BC7 }
+};
+
+bool texture_compression(const std::string& name, int components, ast::CompressionType& compression)
+{
+    // Auto is measured by export_image, like image_export -C. Etc uses the same formats as image_export -T.
+    if (name == "auto")
+    {
+        compression = ast::COMPRESSION_NONE;
+        return true;
+    }
+    else if (name == "etc")
+    {
+        if (components == 1)
+            compression = ast::COMPRESSION_EAC_R11;
+        else if (components == 2)
+            compression = ast::COMPRESSION_EAC_RG11;
+        else if (components == 3)
+            compression = ast::COMPRESSION_ETC2;
+        else
+            compression = ast::COMPRESSION_ETC2_RGBA;
+
+        return true;
+    }
+
+    for (const auto& it : kCompressionNames)
+    {
+        if (name == it.name)
+        {
+            compression = it.compression;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Reads an optional "quality_target": { "psnr": 40, "ssim": 0.97, "normal_error": 2, "sample_tiles": 64, "bc5_normals": false }.
+static void parse_compression_target(const nlohmann::json& json, ast::CompressionTarget& target)
+{
+    if (!json.contains("quality_target"))
+        return;
+
+    const nlohmann::json& target_json = json["quality_target"];
+
+    target.min_psnr          = target_json.value("psnr", target.min_psnr);
+    target.min_ssim          = target_json.value("ssim", target.min_ssim);
+    target.max_normal_error  = target_json.value("normal_error", target.max_normal_error);
+    target.sample_tiles      = target_json.value("sample_tiles", target.sample_tiles);
+    target.allow_bc5_normals = target_json.value("bc5_normals", target.allow_bc5_normals);
+}
+
+static std::string resolve_path(const std::filesystem::path& folder, const std::string& path)
+{
+    return (folder / path).lexically_normal().string();
+}
+
+static bool parse_texture(const nlohmann::json& json, const std::filesystem::path& folder, TextureAsset& texture)
+{
+    texture.source      = resolve_path(folder, json.at("source").get<std::string>());
+    texture.compression = json.value("compression", std::string("auto"));
+
+    ast::CompressionType compression;
+
+    if (!texture_compression(texture.compression, 4, compression))
+    {
+        printf("ERROR: Unknown compression '%s' for texture: %s\n", texture.compression.c_str(), texture.source.c_str());
+        return false;
+    }
+
+    const std::string quality = json.value("quality", std::string("normal"));
+
+    texture.options.output_mips    = json.value("mips", true) ? -1 : 0;
+    texture.options.normal_map     = json.value("normal_map", false);
+    texture.options.flip_green     = json.value("flip_green", false);
+    texture.options.srgb           = json.value("srgb", true);
+    texture.options.alpha_coverage = json.value("alpha_coverage", 0.0f);
+    texture.options.mip_filter     = json.value("mip_filter", std::string("box")) == "kaiser" ? ast::MIP_FILTER_KAISER : ast::MIP_FILTER_BOX;
+    texture.options.quality        = quality == "fast" ? ast::COMPRESSION_QUALITY_FAST : (quality == "high" ? ast::COMPRESSION_QUALITY_HIGH : ast::COMPRESSION_QUALITY_NORMAL);
+    texture.options.pixel_type     = json.value("half", false) ? ast::PIXEL_TYPE_FLOAT16 : ast::PIXEL_TYPE_UNORM8;
+    texture.options.container      = json.value("ktx2", false) ? ast::IMAGE_CONTAINER_KTX2 : ast::IMAGE_CONTAINER_AST;
+
+    parse_compression_target(json, texture.options.compression_target);
+
+    return true;
+}
+
+static bool parse_mesh(const nlohmann::json& json, const std::filesystem::path& folder, MeshAsset& mesh)
+{
+    mesh.source = resolve_path(folder, json.at("source").get<std::string>());
+
+    mesh.import_options.displacement_as_normal = json.value("displacement_as_normal", false);
+    mesh.import_options.is_orca_mesh           = json.value("orca", false);
+
+    mesh.export_options.use_compression       = json.value("compression", true);
+    mesh.export_options.normal_map_flip_green = json.value("flip_green", false);
+    mesh.export_options.output_metadata       = json.value("metadata", false);
+
+    parse_compression_target(json, mesh.export_options.compression_target);
+
+    return true;
+}
+
+static bool parse_environment(const nlohmann::json& json, const std::filesystem::path& folder, EnvironmentAsset& environment)
+{
+    environment.source = resolve_path(folder, json.at("source").get<std::string>());
+
+    const std::string compression = json.value("compression", std::string("none"));
+
+    if (compression != "none" && compression != "bc6")
+    {
+        printf("ERROR: Environments only support none or bc6 compression: %s\n", environment.source.c_str());
+        return false;
+    }
+
+    ast::CubemapImageExportOptions& options = environment.options;
+
+    options.compression      = compression == "bc6" ? ast::COMPRESSION_BC6 : ast::COMPRESSION_NONE;
+    options.pixel_type       = json.value("half", false) ? ast::PIXEL_TYPE_FLOAT16 : ast::PIXEL_TYPE_FLOAT32;
+    options.irradiance       = json.value("irradiance", false);
+    options.irradiance_sh    = json.value("sh", false);
+    options.sampling_tables  = json.value("sampling_tables", false);
+    options.sampling_width   = json.value("sampling_width", 0);
+    options.radiance         = json.value("radiance", false);
+    options.face_size        = json.value("face_size", 0);
+    options.supersampling    = json.value("supersampling", 1);
+    options.radiance_size    = json.value("radiance_size", options.radiance_size);
+    options.radiance_mips    = json.value("radiance_mips", options.radiance_mips);
+    options.radiance_samples = json.value("radiance_samples", options.radiance_samples);
+    options.layout           = json.value("octahedral", false) ? ast::ENVIRONMENT_LAYOUT_OCTAHEDRAL : ast::ENVIRONMENT_LAYOUT_CUBEMAP;
+    options.container        = json.value("ktx2", false) ? ast::IMAGE_CONTAINER_KTX2 : ast::IMAGE_CONTAINER_AST;
+
+    return true;
+}
+
+bool load_manifest(const std::string& path, Manifest& manifest)
+{
+    std::ifstream f(path);
+
+    if (!f.is_open())
+    {
+        printf("ERROR: Failed to open manifest: %s\n", path.c_str());
+        return false;
+    }
+
+    nlohmann::json json = nlohmann::json::parse(f, nullptr, false);
+
+    if (json.is_discarded() || !json.is_object())
+    {
+        printf("ERROR: Failed to parse manifest: %s\n", path.c_str());
+        return false;
+    }
+
+    const std::filesystem::path folder = std::filesystem::absolute(path).parent_path();
+
+    manifest = Manifest();
+
+    // Missing sources and options of the wrong type throw.
+    try
+    {
+        manifest.output        = resolve_path(folder, json.value("output", std::string("build")));
+        manifest.memory_budget = json.value("memory_budget_mb", size_t(0)) * 1024 * 1024;
+
+        if (json.contains("artifact_store"))
+        {
+            const nlohmann::json& store = json["artifact_store"];
+
+            manifest.artifact_store      = resolve_path(folder, store.at("path").get<std::string>());
+            manifest.artifact_store_size = store.value("max_size_mb", uint64_t(0)) * 1024 * 1024;
+        }
+
+        if (json.contains("textures"))
+        {
+            for (const auto& texture : json["textures"])
+            {
+                manifest.textures.push_back(TextureAsset());
+
+                if (!parse_texture(texture, folder, manifest.textures.back()))
+                    return false;
+            }
+        }
+
+        if (json.contains("meshes"))
+        {
+            for (const auto& mesh : json["meshes"])
+            {
+                manifest.meshes.push_back(MeshAsset());
+
+                if (!parse_mesh(mesh, folder, manifest.meshes.back()))
+                    return false;
+            }
+        }
+
+        if (json.contains("environments"))
+        {
+            for (const auto& environment : json["environments"])
+            {
+                manifest.environments.push_back(EnvironmentAsset());
+
+                if (!parse_environment(environment, folder, manifest.environments.back()))
+                    return false;
+            }
+        }
+
+        if (json.contains("brdf_lut"))
+        {
+            const nlohmann::json& lut = json["brdf_lut"];
+
+            manifest.brdf_lut                      = true;
+            manifest.brdf_lut_options.size         = std::max(lut.value("size", 512), 2);
+            manifest.brdf_lut_options.sample_count = std::max(lut.value("sample_count", 1024), 1);
+            manifest.brdf_lut_options.multi_lut    = lut.value("multi_lut", false);
+
+            // Same as brdf_lut, the multi-scatter LUT is always stored as half floats.
+            if (lut.value("half", false) || manifest.brdf_lut_options.multi_lut)
+                manifest.brdf_lut_pixel_type = ast::PIXEL_TYPE_FLOAT16;
+        }
+    }
+    catch (const nlohmann::json::exception& e)
+    {
+        printf("ERROR: Invalid manifest %s: %s\n", path.c_str(), e.what());
+        return false;
+    }
+
+    return true;
+}
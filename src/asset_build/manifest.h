@@ -0,0 +1,84 @@
+#pragma once
+
+#include <exporter/image_exporter.h>
+#include <exporter/mesh_exporter.h>
+#include <importer/mesh_importer.h>
+#include <common/brdf.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// A project manifest is a JSON file listing every source asset of a project with its options. Source paths and the
+// output folder are relative to the manifest. Every option may be left out.
+//
+// {
+//     "output": "build",
+//     "memory_budget_mb": 8192,
+//     "artifact_store": { "path": "/mnt/shared/ast_store", "max_size_mb": 65536 },
+//     "textures": [
+//         { "source": "ui/logo.png", "compression": "bc7", "mips": false },
+//         { "source": "rock/normal.png", "compression": "bc5", "normal_map": true, "flip_green": true },
+//         { "source": "rock/albedo.png", "compression": "auto", "quality_target": { "psnr": 42, "ssim": 0.98 } }
+//     ],
+//     "meshes": [
+//         { "source": "sponza/sponza.obj", "compression": true, "metadata": true }
+//     ],
+//     "environments": [
+//         { "source": "sky.hdr", "irradiance": true, "radiance": true, "sh": true, "compression": "bc6", "half": true }
+//     ],
+//     "brdf_lut": { "size": 512, "multi_lut": true }
+// }
+//
+// Textures and mesh textures are written to [output]/texture, meshes to [output]/mesh with their materials in
+// [output]/material, environments to [output]/environment and the BRDF LUT to [output]/brdf_lut.ast. Without an
+// artifact_store entry, the store named by the AST_ARTIFACT_STORE environment variable is used, if any.
+
+struct TextureAsset
+{
+    std::string             source;
+    std::string             compression = "auto"; // none, auto (smallest BC format meeting the quality target), etc or bc1-bc7.
+    ast::ImageExportOptions options;              // Everything but the path, compression and auto_compression.
+};
+
+struct MeshAsset
+{
+    std::string            source;
+    ast::MeshImportOptions import_options;
+    ast::MeshExportOption  export_options; // Everything but the output folder and build cache.
+};
+
+struct EnvironmentAsset
+{
+    std::string                    source;
+    ast::CubemapImageExportOptions options; // Everything but the path.
+};
+
+struct Manifest
+{
+    std::string                   output;                  // Absolute path of the output folder.
+    size_t                        memory_budget       = 0; // Bytes, 0 uses the default of the tool.
+    std::string                   artifact_store;          // Absolute path of the artifact store, empty if the manifest has none.
+    uint64_t                      artifact_store_size = 0; // Bytes, 0 uses the default of ArtifactStore.
+    std::vector<TextureAsset>     textures;
+    std::vector<MeshAsset>        meshes;
+    std::vector<EnvironmentAsset> environments;
+    bool                          brdf_lut            = false;
+    ast::BRDFLUTOptions           brdf_lut_options;
+    ast::PixelType                brdf_lut_pixel_type = ast::PIXEL_TYPE_FLOAT32;
+};
+
+/**
+     * Reads a project manifest.
+     * @param path Path of the manifest.
+     * @param manifest Receives the assets with absolute source paths.
+     * @return bool Returns false if the manifest could not be read or has invalid options.
+     */
+extern bool load_manifest(const std::string& path, Manifest& manifest);
+/**
+     * Resolves the compression name of a texture for a decoded image.
+     * @param name Compression name from the manifest.
+     * @param components Component count of the image.
+     * @param compression Receives the compression, none for auto which export_image selects.
+     * @return bool Returns false if the name is not known.
+     */
+extern bool texture_compression(const std::string& name, int components, ast::CompressionType& compression);
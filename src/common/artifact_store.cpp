@@ -0,0 +1,211 @@
+#include <common/artifact_store.h>
+#include <common/filesystem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+// Evicting walks the whole store, so it only runs once 1/ARTIFACT_STORE_EVICTION_INTERVAL of the size limit has been
+// published by this process.
+#define ARTIFACT_STORE_EVICTION_INTERVAL 16
+#define ARTIFACT_STORE_LOW_WATER_MARK 0.9
+// Temporary files older than this were left behind by interrupted writers.
+#define ARTIFACT_STORE_STALE_TEMP_SECONDS 3600
+
+namespace ast
+{
+bool ArtifactStore::open(const std::string& root, uint64_t max_size)
+{
+    std::error_code error;
+    std::filesystem::create_directories(root, error);
+
+    if (error)
+    {
+        std::cout << "ERROR::Failed to open artifact store: " << root << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_root      = root;
+    m_max_size  = max_size;
+    m_published = 0;
+
+    return true;
+}
+
+bool ArtifactStore::open_from_environment()
+{
+    const char* root = getenv(ARTIFACT_STORE_ENV);
+
+    if (!root || root[0] == '\0')
+        return false;
+
+    uint64_t    max_size = ARTIFACT_STORE_DEFAULT_SIZE;
+    const char* size     = getenv(ARTIFACT_STORE_SIZE_ENV);
+
+    if (size && atoll(size) > 0)
+        max_size = uint64_t(atoll(size)) << 20;
+
+    return open(root, max_size);
+}
+
+std::string ArtifactStore::artifact_path(uint64_t key) const
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016" PRIx64, key);
+
+    return m_root + "/" + std::string(name, 2) + "/" + name;
+}
+
+bool ArtifactStore::fetch(uint64_t key, const std::string& output)
+{
+    if (m_root.empty())
+        return false;
+
+    const std::string path      = artifact_path(key);
+    const std::string temp_path = filesystem::temp_file_path(output);
+
+    std::error_code error;
+
+    // Another process may evict the artifact at any time, in which case the copy fails and the caller converts the
+    // file itself.
+    if (!std::filesystem::copy_file(path, temp_path, std::filesystem::copy_options::overwrite_existing, error) || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    if (!filesystem::publish_file(temp_path, output))
+        return false;
+
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    return true;
+}
+
+bool ArtifactStore::publish(uint64_t key, const std::string& file)
+{
+    if (m_root.empty())
+        return false;
+
+    const std::string path = artifact_path(key);
+
+    std::error_code error;
+
+    if (std::filesystem::exists(path, error))
+    {
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        return true;
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    const std::string temp_path = filesystem::temp_file_path(path);
+
+    if (!std::filesystem::copy_file(file, temp_path, std::filesystem::copy_options::overwrite_existing, error) || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        std::cout << "ERROR::Failed to publish artifact: " << file << std::endl;
+        return false;
+    }
+
+    // Writers of the same key store the same bytes, so it does not matter whose rename lands last.
+    if (!filesystem::publish_file(temp_path, path))
+    {
+        std::cout << "ERROR::Failed to publish artifact: " << file << std::endl;
+        return false;
+    }
+
+    const uint64_t size = std::filesystem::file_size(path, error);
+    bool           full = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_published += error ? 0 : size;
+
+        if (m_published >= m_max_size / ARTIFACT_STORE_EVICTION_INTERVAL)
+        {
+            m_published = 0;
+            full        = true;
+        }
+    }
+
+    if (full)
+        evict();
+
+    return true;
+}
+
+void ArtifactStore::evict()
+{
+    if (m_root.empty())
+        return;
+
+    struct Artifact
+    {
+        std::string                     path;
+        uint64_t                        size;
+        std::filesystem::file_time_type time;
+    };
+
+    std::vector<Artifact> artifacts;
+    uint64_t              total = 0;
+
+    const auto now = std::filesystem::file_time_type::clock::now();
+
+    std::error_code error;
+
+    for (auto it = std::filesystem::recursive_directory_iterator(m_root, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        std::error_code entry_error;
+
+        if (!it->is_regular_file(entry_error))
+            continue;
+
+        const std::filesystem::file_time_type time = it->last_write_time(entry_error);
+
+        if (it->path().filename().string().find(".tmp.") != std::string::npos)
+        {
+            if (now - time > std::chrono::seconds(ARTIFACT_STORE_STALE_TEMP_SECONDS))
+                std::filesystem::remove(it->path(), entry_error);
+
+            continue;
+        }
+
+        Artifact artifact;
+
+        artifact.path = it->path().string();
+        artifact.size = it->file_size(entry_error);
+        artifact.time = time;
+
+        if (entry_error)
+            continue;
+
+        total += artifact.size;
+        artifacts.push_back(artifact);
+    }
+
+    if (total <= m_max_size)
+        return;
+
+    std::sort(artifacts.begin(), artifacts.end(), [](const Artifact& a, const Artifact& b) { return a.time < b.time; });
+
+    const uint64_t target = uint64_t(double(m_max_size) * ARTIFACT_STORE_LOW_WATER_MARK);
+
+    // Artifacts another process is copying may fail to be removed on some platforms, they are tried again next time.
+    for (const auto& artifact : artifacts)
+    {
+        if (total <= target)
+            break;
+
+        if (std::filesystem::remove(artifact.path, error))
+            total -= artifact.size;
+    }
+}
+} // namespace ast
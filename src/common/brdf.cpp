@@ -0,0 +1,213 @@
+#include <common/brdf.h>
+#include <common/parallel.h>
+#include <common/simd.h>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+namespace ast
+{
+static const float kPi = 3.14159265359f;
+
+// Lowest sheen roughness, the Charlie distribution degenerates when alpha reaches 0.
+static const float kMinSheenAlpha = 1.0f / 128.0f;
+
+// Half vectors of every sample for one roughness. They do not depend on NdotV, so a row of the LUT shares them and
+// only the view dependent terms are evaluated per texel.
+struct BRDFSamples
+{
+    std::vector<float> ggx_x;      // GGX importance sampled half vectors, in the plane of V.
+    std::vector<float> ggx_z;
+    std::vector<float> charlie_x;  // Uniform hemisphere half vectors for the sheen integral.
+    std::vector<float> charlie_z;
+    std::vector<float> charlie_d;  // Charlie distribution of every uniform half vector.
+};
+
+// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+static float radical_inverse_vdc(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
+}
+
+static void build_samples(float roughness, int sample_count, bool sheen, BRDFSamples& samples)
+{
+    const float a  = roughness * roughness;
+    const float a2 = a * a;
+
+    samples.ggx_x.resize(sample_count);
+    samples.ggx_z.resize(sample_count);
+
+    if (sheen)
+    {
+        samples.charlie_x.resize(sample_count);
+        samples.charlie_z.resize(sample_count);
+        samples.charlie_d.resize(sample_count);
+    }
+
+    const float sheen_alpha = std::max(a, kMinSheenAlpha);
+    const float inv_alpha   = 1.0f / sheen_alpha;
+
+    for (int i = 0; i < sample_count; i++)
+    {
+        const float u   = float(i) / float(sample_count);
+        const float v   = radical_inverse_vdc(uint32_t(i));
+        const float phi = 2.0f * kPi * u;
+
+        // Only the component of H in the plane of V matters, V lies in the XZ plane.
+        const float cos_theta = sqrtf((1.0f - v) / (1.0f + (a2 - 1.0f) * v));
+        const float sin_theta = sqrtf(1.0f - cos_theta * cos_theta);
+
+        samples.ggx_x[i] = cosf(phi) * sin_theta;
+        samples.ggx_z[i] = cos_theta;
+
+        if (sheen)
+        {
+            const float cos_h = 1.0f - v;
+            const float sin2h = std::max(1.0f - cos_h * cos_h, 0.0078125f);
+
+            samples.charlie_x[i] = cosf(phi) * sqrtf(1.0f - cos_h * cos_h);
+            samples.charlie_z[i] = cos_h;
+            samples.charlie_d[i] = (2.0f + inv_alpha) * powf(sin2h, inv_alpha * 0.5f) / (2.0f * kPi);
+        }
+    }
+}
+
+// Integrates texels [begin, end) of a row. Writes scale, bias and the sheen DFG of every texel.
+template <typename L>
+static int integrate_row(const BRDFSamples& samples, float roughness, int sample_count, bool sheen, const float* n_dot_v, int begin, int end, float* scale, float* bias, float* dfg_sheen)
+{
+    typedef typename L::Type V;
+
+    const V zero = L::set(0.0f);
+    const V one  = L::set(1.0f);
+    const V two  = L::set(2.0f);
+
+    // Schlick-GGX with the IBL k. G / NdotV is folded into the denominator, which keeps NdotV = 0 finite.
+    const float k = roughness * roughness * 0.5f;
+
+    const V vk     = L::set(k);
+    const V vk_inv = L::set(1.0f - k);
+
+    int i = begin;
+
+    for (; i + L::kWidth <= end; i += L::kWidth)
+    {
+        const V nv  = L::load(n_dot_v + i);
+        const V vx  = L::sqrt(L::maximum(L::sub(one, L::mul(nv, nv)), zero));
+        const V gv  = L::add(L::mul(nv, vk_inv), vk);
+
+        V a = zero;
+        V b = zero;
+        V s = zero;
+
+        for (int j = 0; j < sample_count; j++)
+        {
+            const V hx = L::set(samples.ggx_x[j]);
+            const V hz = L::set(samples.ggx_z[j]);
+
+            const V v_dot_h = L::maximum(L::add(L::mul(vx, hx), L::mul(nv, hz)), zero);
+            const V n_dot_l = L::sub(L::mul(L::mul(two, v_dot_h), hz), nv);
+
+            const V g_l   = L::div(n_dot_l, L::add(L::mul(n_dot_l, vk_inv), vk));
+            const V g_vis = L::div(L::mul(g_l, v_dot_h), L::mul(hz, gv));
+
+            const V fc  = L::sub(one, v_dot_h);
+            const V fc2 = L::mul(fc, fc);
+            const V fc5 = L::mul(L::mul(fc2, fc2), fc);
+
+            const V mask = L::greater(n_dot_l, zero);
+
+            a = L::add(a, L::select(mask, L::mul(L::sub(one, fc5), g_vis), zero));
+            b = L::add(b, L::select(mask, L::mul(fc5, g_vis), zero));
+
+            if (sheen)
+            {
+                const V cx = L::set(samples.charlie_x[j]);
+                const V cz = L::set(samples.charlie_z[j]);
+
+                const V c_v_dot_h = L::maximum(L::add(L::mul(vx, cx), L::mul(nv, cz)), zero);
+                const V c_n_dot_l = L::sub(L::mul(L::mul(two, c_v_dot_h), cz), nv);
+
+                // Neubelt visibility, 1 / (4 (NdotL + NdotV - NdotL NdotV)).
+                const V c_mask = L::greater(c_n_dot_l, zero);
+                const V denom  = L::sub(L::add(c_n_dot_l, nv), L::mul(c_n_dot_l, nv));
+                const V term   = L::div(L::mul(L::mul(L::set(samples.charlie_d[j]), c_n_dot_l), c_v_dot_h), L::mul(L::set(4.0f), L::maximum(denom, L::set(1e-6f))));
+
+                s = L::add(s, L::select(c_mask, term, zero));
+            }
+        }
+
+        const V inv_count = L::set(1.0f / float(sample_count));
+
+        L::store(scale + i, L::mul(a, inv_count));
+        L::store(bias + i, L::mul(b, inv_count));
+
+        if (sheen)
+            L::store(dfg_sheen + i, L::mul(s, L::set(8.0f * kPi / float(sample_count))));
+    }
+
+    return i;
+}
+
+bool generate_brdf_lut(Image& lut, const BRDFLUTOptions& options)
+{
+    if (options.size < 2 || options.sample_count < 1)
+    {
+        std::cout << "ERROR::Invalid BRDF LUT size or sample count!" << std::endl;
+        return false;
+    }
+
+    const int  size       = options.size;
+    const int  components = options.multi_lut ? 4 : 2;
+    const bool sheen      = options.multi_lut;
+
+    lut.allocate(PIXEL_TYPE_FLOAT32, size, size, components, 1, 1);
+
+    std::vector<float> n_dot_v(size);
+
+    for (int x = 0; x < size; x++)
+        n_dot_v[x] = float(x) / float(size - 1);
+
+    float* pixels = (float*)lut.data[0][0].data;
+
+    parallel_for(0, size, [&](int32_t y) {
+        const float roughness = float(y) / float(size - 1);
+
+        BRDFSamples samples;
+        build_samples(roughness, options.sample_count, sheen, samples);
+
+        std::vector<float> scale(size);
+        std::vector<float> bias(size);
+        std::vector<float> dfg_sheen(sheen ? size : 0);
+
+        const int done = integrate_row<WideLanes>(samples, roughness, options.sample_count, sheen, n_dot_v.data(), 0, size, scale.data(), bias.data(), dfg_sheen.data());
+        integrate_row<ScalarLanes>(samples, roughness, options.sample_count, sheen, n_dot_v.data(), done, size, scale.data(), bias.data(), dfg_sheen.data());
+
+        // Roughness grows from the bottom row to the top one.
+        float* row = pixels + size_t(size - 1 - y) * size * components;
+
+        for (int x = 0; x < size; x++)
+        {
+            float* texel = row + size_t(x) * components;
+
+            texel[0] = scale[x];
+            texel[1] = bias[x];
+
+            if (options.multi_lut)
+            {
+                const float albedo = scale[x] + bias[x];
+
+                texel[2] = albedo > 0.0f ? 1.0f / albedo - 1.0f : 0.0f;
+                texel[3] = dfg_sheen[x];
+            }
+        }
+    });
+
+    return true;
+}
+} // namespace ast
@@ -0,0 +1,232 @@
+#include <common/build_cache.h>
+#include <common/filesystem.h>
+#include <common/header.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fstream>
+#include <iostream>
+
+#define HASH_FILE_CHUNK_SIZE (1 << 20)
+
+namespace ast
+{
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int      r = 47;
+
+    uint64_t h = seed ^ (size * m);
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    const size_t   words = size / 8;
+
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t k;
+        memcpy(&k, bytes + i * 8, sizeof(uint64_t));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    const uint8_t* tail = bytes + words * 8;
+
+    switch (size & 7)
+    {
+        case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+        case 1:
+            h ^= uint64_t(tail[0]);
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+uint64_t hash_combine(uint64_t seed, uint64_t value)
+{
+    return hash_bytes(&value, sizeof(uint64_t), seed);
+}
+
+uint64_t hash_string(uint64_t seed, const std::string& str)
+{
+    return hash_bytes(str.data(), str.size(), hash_combine(seed, str.size()));
+}
+
+bool hash_file(const std::string& path, uint64_t& hash)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if (!f)
+        return false;
+
+    std::vector<uint8_t> chunk(HASH_FILE_CHUNK_SIZE);
+    size_t               read = 0;
+
+    hash = 0;
+
+    // Every chunk is seeded with the hash of the previous ones.
+    while ((read = fread(chunk.data(), 1, chunk.size(), f)) > 0)
+        hash = hash_bytes(chunk.data(), read, hash);
+
+    const bool ok = !ferror(f);
+    fclose(f);
+
+    return ok;
+}
+
+bool BuildCache::load(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_path = path;
+    m_entries.clear();
+    m_dirty = false;
+
+    std::ifstream f(path);
+
+    if (!f.is_open())
+        return false;
+
+    std::string line;
+
+    if (!std::getline(f, line) || line != "ast_build_cache " + std::to_string(BUILD_CACHE_VERSION) + " " + std::to_string(AST_VERSION))
+    {
+        std::cout << "WARNING::Ignoring build cache written by another version: " << path << std::endl;
+        return false;
+    }
+
+    // Every entry is a line with the key in hex and the output path, followed by one tab indented line per dependency.
+    Entry* entry = nullptr;
+
+    while (std::getline(f, line))
+    {
+        if (line.empty())
+            continue;
+
+        if (line[0] == '\t')
+        {
+            if (entry)
+                entry->dependencies.push_back(line.substr(1));
+
+            continue;
+        }
+
+        const size_t separator = line.find(' ');
+
+        if (separator == std::string::npos)
+            continue;
+
+        entry               = &m_entries[line.substr(separator + 1)];
+        entry->key          = strtoull(line.substr(0, separator).c_str(), nullptr, 16);
+        entry->dependencies = std::vector<std::string>();
+    }
+
+    return true;
+}
+
+bool BuildCache::save()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_dirty || m_path.empty())
+        return true;
+
+    // Concurrent builds writing the same cache each publish a complete file, the last one wins.
+    const std::string temp_path = filesystem::temp_file_path(m_path);
+
+    {
+        std::ofstream f(temp_path, std::ios::out | std::ios::trunc);
+
+        if (!f.is_open())
+        {
+            std::cout << "ERROR::Failed to write build cache: " << temp_path << std::endl;
+            return false;
+        }
+
+        f << "ast_build_cache " << BUILD_CACHE_VERSION << " " << AST_VERSION << "\n";
+
+        char key[17];
+
+        for (const auto& it : m_entries)
+        {
+            snprintf(key, sizeof(key), "%016" PRIx64, it.second.key);
+            f << key << " " << it.first << "\n";
+
+            for (const auto& dependency : it.second.dependencies)
+                f << "\t" << dependency << "\n";
+        }
+
+        f.close();
+
+        if (f.fail())
+        {
+            remove(temp_path.c_str());
+            std::cout << "ERROR::Failed to write build cache: " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    if (!filesystem::publish_file(temp_path, m_path))
+    {
+        remove(temp_path.c_str());
+        std::cout << "ERROR::Failed to replace build cache: " << m_path << std::endl;
+        return false;
+    }
+
+    m_dirty = false;
+
+    return true;
+}
+
+bool BuildCache::up_to_date(const std::string& output, uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(output);
+
+        if (it == m_entries.end() || it->second.key != key)
+            return false;
+    }
+
+    return filesystem::does_file_exist(output);
+}
+
+std::vector<std::string> BuildCache::dependencies(const std::string& output)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_entries.find(output);
+
+    if (it == m_entries.end())
+        return std::vector<std::string>();
+
+    return it->second.dependencies;
+}
+
+void BuildCache::update(const std::string& output, uint64_t key, const std::vector<std::string>& dependencies)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry& entry = m_entries[output];
+
+    entry.key          = key;
+    entry.dependencies = dependencies;
+
+    m_dirty = true;
+}
+} // namespace ast
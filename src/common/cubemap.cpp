@@ -0,0 +1,889 @@
+#include <common/cubemap.h>
+#include <common/half.h>
+#include <common/mip_generator.h>
+#include <common/parallel.h>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+#if defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+#define MAX_SUPERSAMPLING 8
+#define PREFILTER_TILE_ROWS 8
+
+namespace ast
+{
+static const float kPi = 3.14159265359f;
+
+// U axis, V axis and normal of every face, matching cmft so existing probes keep their orientation.
+static const float kFaceAxes[6][3][3] = {
+    { { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, // +X
+    { { 0.0f, 0.0f, 1.0f }, { 0.0f, -1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f } }, // -X
+    { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f } },   // +Y
+    { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f } }, // -Y
+    { { 1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },  // +Z
+    { { -1.0f, 0.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f } } // -Z
+};
+
+struct LatLongSource
+{
+    const uint8_t* data;
+    int            width;
+    int            height;
+    int            components;
+    PixelType      type;
+    size_t         row_pitch;
+};
+
+// Minimax polynomial for atan on [-1, 1], accurate to about 1e-5 radians. The SIMD path uses the same coefficients
+// so both paths produce the same texels.
+static inline float atan_unit(float t)
+{
+    const float t2 = t * t;
+    return t * (0.99986600f + t2 * (-0.33029950f + t2 * (0.18014100f + t2 * (-0.08513300f + t2 * 0.02083510f))));
+}
+
+static inline float fast_atan2(float y, float x)
+{
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    const float hi = std::max(ax, ay);
+    const float r  = atan_unit(hi > 0.0f ? std::min(ax, ay) / hi : 0.0f);
+    const float a  = ay > ax ? 0.5f * kPi - r : r;
+    const float b  = x < 0.0f ? kPi - a : a;
+
+    return y < 0.0f ? -b : b;
+}
+
+// Lat-long coordinates in [0, 1] for an unnormalized direction. Longitude starts at -Z and the first row is +Y.
+static inline void direction_to_latlong(float x, float y, float z, float& u, float& v)
+{
+    u = (kPi + fast_atan2(x, z)) * (0.5f / kPi);
+    v = fast_atan2(sqrtf(x * x + z * z), y) * (1.0f / kPi);
+}
+
+#if defined(__SSE4_1__)
+static inline __m128 atan_unit(__m128 t)
+{
+    const __m128 t2 = _mm_mul_ps(t, t);
+
+    __m128 p = _mm_set1_ps(0.02083510f);
+    p        = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(-0.08513300f));
+    p        = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.18014100f));
+    p        = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(-0.33029950f));
+    p        = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(0.99986600f));
+
+    return _mm_mul_ps(p, t);
+}
+
+static inline __m128 fast_atan2(__m128 y, __m128 x)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 ax   = _mm_andnot_ps(sign, x);
+    const __m128 ay   = _mm_andnot_ps(sign, y);
+    const __m128 hi   = _mm_max_ps(ax, ay);
+    const __m128 q    = _mm_and_ps(_mm_div_ps(_mm_min_ps(ax, ay), hi), _mm_cmpgt_ps(hi, zero));
+    const __m128 r    = atan_unit(q);
+    const __m128 a    = _mm_blendv_ps(r, _mm_sub_ps(_mm_set1_ps(0.5f * kPi), r), _mm_cmpgt_ps(ay, ax));
+    const __m128 b    = _mm_blendv_ps(a, _mm_sub_ps(_mm_set1_ps(kPi), a), _mm_cmplt_ps(x, zero));
+
+    return _mm_blendv_ps(b, _mm_xor_ps(b, sign), _mm_cmplt_ps(y, zero));
+}
+#endif
+
+void cubemap_direction(int face, float s, float t, float* dir)
+{
+    const float(*axes)[3] = kFaceAxes[face];
+
+    for (int c = 0; c < 3; c++)
+        dir[c] = axes[0][c] * s + axes[1][c] * t + axes[2][c];
+}
+
+// Lat-long coordinates of count evenly spaced samples along a row of a face, starting half a sample from the left edge.
+static void face_row_to_latlong(int face, float t, int count, float* u, float* v)
+{
+    const float(*axes)[3] = kFaceAxes[face];
+    const float step      = 2.0f / count;
+    const float s0        = step * 0.5f - 1.0f;
+
+    int i = 0;
+
+#if defined(__SSE4_1__)
+    const __m128 lane_s  = _mm_add_ps(_mm_set1_ps(s0), _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(step)));
+    const __m128 inv_2pi = _mm_set1_ps(0.5f / kPi);
+    const __m128 inv_pi  = _mm_set1_ps(1.0f / kPi);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 s = _mm_add_ps(lane_s, _mm_set1_ps(step * i));
+        const __m128 x = _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(axes[0][0])), _mm_set1_ps(axes[1][0] * t + axes[2][0]));
+        const __m128 y = _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(axes[0][1])), _mm_set1_ps(axes[1][1] * t + axes[2][1]));
+        const __m128 z = _mm_add_ps(_mm_mul_ps(s, _mm_set1_ps(axes[0][2])), _mm_set1_ps(axes[1][2] * t + axes[2][2]));
+
+        const __m128 xz = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+
+        _mm_storeu_ps(u + i, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(kPi), fast_atan2(x, z)), inv_2pi));
+        _mm_storeu_ps(v + i, _mm_mul_ps(fast_atan2(xz, y), inv_pi));
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        float dir[3];
+        cubemap_direction(face, s0 + step * i, t, dir);
+        direction_to_latlong(dir[0], dir[1], dir[2], u[i], v[i]);
+    }
+}
+
+static inline void fetch_texel(const LatLongSource& src, int x, int y, float* texel)
+{
+    const uint8_t* row = src.data + src.row_pitch * y;
+
+    if (src.type == PIXEL_TYPE_FLOAT32)
+    {
+        const float* p = (const float*)row + size_t(x) * src.components;
+
+        for (int c = 0; c < src.components; c++)
+            texel[c] = p[c];
+    }
+    else if (src.type == PIXEL_TYPE_FLOAT16)
+    {
+        const uint16_t* p = (const uint16_t*)row + size_t(x) * src.components;
+
+        for (int c = 0; c < src.components; c++)
+            texel[c] = half_to_float(p[c]);
+    }
+    else
+    {
+        const uint8_t* p = row + size_t(x) * src.components;
+
+        for (int c = 0; c < src.components; c++)
+            texel[c] = p[c] * (1.0f / 255.0f);
+    }
+}
+
+static inline int wrap_x(const LatLongSource& src, int x)
+{
+    x %= src.width;
+    return x < 0 ? x + src.width : x;
+}
+
+static inline int clamp_y(const LatLongSource& src, int y)
+{
+    return std::min(std::max(y, 0), src.height - 1);
+}
+
+// Longitude wraps around the seam, latitude clamps at the poles.
+static inline void sample_bilinear(const LatLongSource& src, float u, float v, float* result)
+{
+    const float px = u * src.width - 0.5f;
+    const float py = v * src.height - 0.5f;
+    const float fx = floorf(px);
+    const float fy = floorf(py);
+    const float tx = px - fx;
+    const float ty = py - fy;
+    const int   x0 = wrap_x(src, int(fx));
+    const int   x1 = wrap_x(src, int(fx) + 1);
+    const int   y0 = clamp_y(src, int(fy));
+    const int   y1 = clamp_y(src, int(fy) + 1);
+
+    float t00[4], t10[4], t01[4], t11[4];
+
+    fetch_texel(src, x0, y0, t00);
+    fetch_texel(src, x1, y0, t10);
+    fetch_texel(src, x0, y1, t01);
+    fetch_texel(src, x1, y1, t11);
+
+    for (int c = 0; c < src.components; c++)
+    {
+        const float top    = t00[c] + (t10[c] - t00[c]) * tx;
+        const float bottom = t01[c] + (t11[c] - t01[c]) * tx;
+
+        result[c] += top + (bottom - top) * ty;
+    }
+}
+
+static inline void catmull_rom_weights(float t, float* w)
+{
+    w[0] = t * (-0.5f + t * (1.0f - 0.5f * t));
+    w[1] = 1.0f + t * t * (-2.5f + 1.5f * t);
+    w[2] = t * (0.5f + t * (2.0f - 1.5f * t));
+    w[3] = t * t * (-0.5f + 0.5f * t);
+}
+
+static inline void sample_bicubic(const LatLongSource& src, float u, float v, float* result)
+{
+    const float px = u * src.width - 0.5f;
+    const float py = v * src.height - 0.5f;
+    const float fx = floorf(px);
+    const float fy = floorf(py);
+
+    float wx[4], wy[4];
+
+    catmull_rom_weights(px - fx, wx);
+    catmull_rom_weights(py - fy, wy);
+
+    int xs[4];
+
+    for (int i = 0; i < 4; i++)
+        xs[i] = wrap_x(src, int(fx) - 1 + i);
+
+    float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int j = 0; j < 4; j++)
+    {
+        const int y = clamp_y(src, int(fy) - 1 + j);
+
+        for (int i = 0; i < 4; i++)
+        {
+            float       texel[4];
+            const float w = wx[i] * wy[j];
+
+            fetch_texel(src, xs[i], y, texel);
+
+            for (int c = 0; c < src.components; c++)
+                sum[c] += texel[c] * w;
+        }
+    }
+
+    // Catmull-Rom overshoots next to sharp HDR features such as the sun, which must not turn into negative light.
+    for (int c = 0; c < src.components; c++)
+        result[c] += std::max(sum[c], 0.0f);
+}
+
+bool latlong_to_cubemap(const Image& src, Image& dst, const CubemapConversionOptions& options)
+{
+    if (src.compression != COMPRESSION_NONE)
+    {
+        std::cout << "ERROR::Compressed lat-long maps cannot be converted to a cubemap!" << std::endl;
+        return false;
+    }
+
+    if (src.type != PIXEL_TYPE_UNORM8 && src.type != PIXEL_TYPE_FLOAT16 && src.type != PIXEL_TYPE_FLOAT32)
+    {
+        std::cout << "ERROR::Unsupported pixel type for cubemap conversion!" << std::endl;
+        return false;
+    }
+
+    LatLongSource source;
+
+    source.data       = (const uint8_t*)src.data[0][0].data;
+    source.width      = src.data[0][0].width;
+    source.height     = src.data[0][0].height;
+    source.components = src.components;
+    source.type       = src.type;
+    source.row_pitch  = size_t(source.width) * source.components * size_t(source.type);
+
+    if (!source.data || source.height == 0 || fabsf(float(source.width) / float(source.height) - 2.0f) > 0.01f)
+    {
+        std::cout << "ERROR::Image is not a lat-long map!" << std::endl;
+        return false;
+    }
+
+    const int face_size     = options.face_size > 0 ? options.face_size : std::max(source.height / 2, 1);
+    const int supersampling = std::min(std::max(options.supersampling, 1), MAX_SUPERSAMPLING);
+    const int row_samples   = face_size * supersampling;
+    const int components    = src.components;
+
+    dst.name    = src.name;
+    dst.cubemap = true;
+    dst.allocate(src.type, face_size, face_size, components, 6, 1);
+
+    parallel_for(0, 6 * face_size, [&](int32_t task) {
+        const int face = task / face_size;
+        const int y    = task % face_size;
+
+        std::vector<float> u(row_samples);
+        std::vector<float> v(row_samples);
+        std::vector<float> row(size_t(face_size) * components, 0.0f);
+
+        for (int sy = 0; sy < supersampling; sy++)
+        {
+            const float t = (float(y * supersampling + sy) + 0.5f) * (2.0f / row_samples) - 1.0f;
+
+            face_row_to_latlong(face, t, row_samples, u.data(), v.data());
+
+            for (int i = 0; i < row_samples; i++)
+            {
+                float* texel = &row[size_t(i / supersampling) * components];
+
+                if (options.filter == CUBEMAP_FILTER_BICUBIC)
+                    sample_bicubic(source, u[i], v[i], texel);
+                else
+                    sample_bilinear(source, u[i], v[i], texel);
+            }
+        }
+
+        if (supersampling > 1)
+        {
+            const float scale = 1.0f / float(supersampling * supersampling);
+
+            for (float& value : row)
+                value *= scale;
+        }
+
+        uint8_t* dst_row = (uint8_t*)dst.data[face][0].data + size_t(y) * face_size * components * size_t(dst.type);
+        convert_pixels(row.data(), PIXEL_TYPE_FLOAT32, dst_row, dst.type, row.size());
+    });
+
+    return true;
+}
+
+// Builds a CDF with count + 1 entries from count non-negative values. Rows without energy fall back to uniform.
+static void build_cdf(const double* values, int count, float* cdf)
+{
+    double total = 0.0;
+
+    for (int i = 0; i < count; i++)
+        total += values[i];
+
+    double sum = 0.0;
+
+    cdf[0] = 0.0f;
+
+    for (int i = 0; i < count; i++)
+    {
+        sum += total > 0.0 ? values[i] / total : 1.0 / count;
+        cdf[i + 1] = float(sum);
+    }
+
+    cdf[count] = 1.0f;
+}
+
+bool latlong_sampling_tables(const Image& src, Image& dst, int width)
+{
+    if (src.compression != COMPRESSION_NONE || src.components < 3)
+    {
+        std::cout << "ERROR::Sampling tables need an uncompressed RGB lat-long map!" << std::endl;
+        return false;
+    }
+
+    const int src_width  = src.data[0][0].width;
+    const int src_height = src.data[0][0].height;
+
+    if (!src.data[0][0].data || src_height == 0 || fabsf(float(src_width) / float(src_height) - 2.0f) > 0.01f)
+    {
+        std::cout << "ERROR::Image is not a lat-long map!" << std::endl;
+        return false;
+    }
+
+    const int table_width  = width > 0 ? std::min(width, src_width) : src_width;
+    const int table_height = std::max(table_width / 2, 1);
+    const int components   = src.components;
+
+    dst.name = src.name;
+    dst.name += "_sampling";
+    dst.allocate(PIXEL_TYPE_FLOAT32, table_width + 1, table_height + 1, 1, 1, 1);
+
+    float*    tables    = (float*)dst.data[0][0].data;
+    const int row_pitch = table_width + 1;
+
+    // Energy of every table row, weighted by the solid angle of the row.
+    std::vector<double> row_energy(table_height);
+
+    // Table texels are box filtered with the fractional coverage of every source texel. In units where a source texel is
+    // table_width wide and a table texel src_width wide, both sides are integers and every table texel covers the same
+    // area, so sizes that do not divide evenly neither skew the pdf nor leave table texels empty.
+    parallel_for(0, table_height, [&](int32_t y) {
+        const int64_t row_begin = int64_t(y) * src_height;
+        const int64_t row_end   = int64_t(y + 1) * src_height;
+        const int     y0        = int(row_begin / table_height);
+        const int     y1        = std::min(int((row_end + table_height - 1) / table_height), src_height);
+
+        std::vector<float>  texels(size_t(src_width) * components);
+        std::vector<double> texel_luminance(src_width);
+        std::vector<double> luminance(table_width, 0.0);
+
+        for (int sy = y0; sy < y1; sy++)
+        {
+            const uint8_t* src_row    = (const uint8_t*)src.data[0][0].data + size_t(sy) * src_width * components * size_t(src.type);
+            const int64_t  row_weight = std::min(int64_t(sy + 1) * table_height, row_end) - std::max(int64_t(sy) * table_height, row_begin);
+
+            convert_pixels(src_row, src.type, texels.data(), PIXEL_TYPE_FLOAT32, texels.size());
+
+            for (int x = 0; x < src_width; x++)
+            {
+                const float* texel = &texels[size_t(x) * components];
+
+                texel_luminance[x] = 0.2126 * texel[0] + 0.7152 * texel[1] + 0.0722 * texel[2];
+            }
+
+            for (int x = 0; x < table_width; x++)
+            {
+                const int64_t column_begin = int64_t(x) * src_width;
+                const int64_t column_end   = int64_t(x + 1) * src_width;
+                const int     x1           = std::min(int((column_end + table_width - 1) / table_width), src_width);
+
+                for (int sx = int(column_begin / table_width); sx < x1; sx++)
+                {
+                    const int64_t column_weight = std::min(int64_t(sx + 1) * table_width, column_end) - std::max(int64_t(sx) * table_width, column_begin);
+
+                    luminance[x] += texel_luminance[sx] * double(column_weight * row_weight);
+                }
+            }
+        }
+
+        // Every table texel covers src_width * src_height units, which turns the sums into averages.
+        for (double& l : luminance)
+            l /= double(src_width) * double(src_height);
+
+        const double sin_theta = sin((y + 0.5) * kPi / table_height);
+
+        for (double& l : luminance)
+            l = std::max(l, 0.0) * sin_theta;
+
+        double energy = 0.0;
+
+        for (double l : luminance)
+            energy += l;
+
+        row_energy[y] = energy;
+
+        build_cdf(luminance.data(), table_width, tables + size_t(y) * row_pitch);
+    });
+
+    float* marginal = tables + size_t(table_height) * row_pitch;
+
+    build_cdf(row_energy.data(), table_height, marginal);
+
+    for (int x = table_height + 1; x < row_pitch; x++)
+        marginal[x] = 0.0f;
+
+    return true;
+}
+
+float radiance_mip_roughness(int mip, int mip_levels, RoughnessMapping mapping)
+{
+    if (mip_levels <= 1)
+        return 0.0f;
+
+    const float t = float(mip) / float(mip_levels - 1);
+
+    return mapping == ROUGHNESS_MAPPING_QUADRATIC ? t * t : t;
+}
+
+struct CubeSource
+{
+    const Image* image;
+    int          levels;
+    int          components;
+};
+
+static inline float radical_inverse_vdc(uint32_t bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10f;
+}
+
+// Picks the face a direction points at and its face coordinates, the inverse of cubemap_direction.
+static inline void direction_to_face(const float* dir, int& face, float& s, float& t)
+{
+    const float ax = fabsf(dir[0]);
+    const float ay = fabsf(dir[1]);
+    const float az = fabsf(dir[2]);
+
+    float major;
+
+    if (ax >= ay && ax >= az)
+    {
+        face  = dir[0] >= 0.0f ? 0 : 1;
+        major = ax;
+    }
+    else if (ay >= az)
+    {
+        face  = dir[1] >= 0.0f ? 2 : 3;
+        major = ay;
+    }
+    else
+    {
+        face  = dir[2] >= 0.0f ? 4 : 5;
+        major = az;
+    }
+
+    const float(*axes)[3] = kFaceAxes[face];
+    const float inv_major = 1.0f / major;
+
+    s = (dir[0] * axes[0][0] + dir[1] * axes[0][1] + dir[2] * axes[0][2]) * inv_major;
+    t = (dir[0] * axes[1][0] + dir[1] * axes[1][1] + dir[2] * axes[1][2]) * inv_major;
+}
+
+// Bilinear lookup within a single face, clamped to its edges. Expects a FLOAT32 source.
+static inline void sample_face(const CubeSource& src, int face, int mip, float s, float t, float weight, float* result)
+{
+    const Image::Data& level  = src.image->data[face][mip];
+    const int          size   = level.width;
+    const float*       texels = (const float*)level.data;
+
+    const float px = (s * 0.5f + 0.5f) * size - 0.5f;
+    const float py = (t * 0.5f + 0.5f) * size - 0.5f;
+    const float fx = floorf(px);
+    const float fy = floorf(py);
+    const float tx = px - fx;
+    const float ty = py - fy;
+    const int   x0 = std::min(std::max(int(fx), 0), size - 1);
+    const int   x1 = std::min(std::max(int(fx) + 1, 0), size - 1);
+    const int   y0 = std::min(std::max(int(fy), 0), size - 1);
+    const int   y1 = std::min(std::max(int(fy) + 1, 0), size - 1);
+
+    const float* t00 = texels + (size_t(y0) * size + x0) * src.components;
+    const float* t10 = texels + (size_t(y0) * size + x1) * src.components;
+    const float* t01 = texels + (size_t(y1) * size + x0) * src.components;
+    const float* t11 = texels + (size_t(y1) * size + x1) * src.components;
+
+    const float w00 = (1.0f - tx) * (1.0f - ty) * weight;
+    const float w10 = tx * (1.0f - ty) * weight;
+    const float w01 = (1.0f - tx) * ty * weight;
+    const float w11 = tx * ty * weight;
+
+    for (int c = 0; c < src.components; c++)
+        result[c] += t00[c] * w00 + t10[c] * w10 + t01[c] * w01 + t11[c] * w11;
+}
+
+// Trilinear lookup between the two mips around lod.
+static inline void sample_cube(const CubeSource& src, const float* dir, float lod, float weight, float* result)
+{
+    int   face;
+    float s, t;
+
+    direction_to_face(dir, face, s, t);
+
+    lod = std::min(std::max(lod, 0.0f), float(src.levels - 1));
+
+    const int   mip0 = int(lod);
+    const int   mip1 = std::min(mip0 + 1, src.levels - 1);
+    const float frac = lod - float(mip0);
+
+    sample_face(src, face, mip0, s, t, weight * (1.0f - frac), result);
+
+    if (frac > 0.0f)
+        sample_face(src, face, mip1, s, t, weight * frac, result);
+}
+
+struct GGXSample
+{
+    float l[3]; // Light direction in the tangent frame of N, where N = V = (0, 0, 1).
+    float n_dot_l;
+    float lod;
+};
+
+// Importance samples are identical for every texel of a mip, so their directions and source lods are computed once.
+static void build_ggx_samples(std::vector<GGXSample>& samples, float roughness, int sample_count, int source_size, int source_levels)
+{
+    const float a               = std::max(roughness * roughness, 1e-4f);
+    const float a2              = a * a;
+    const float texel_solid_ang = 4.0f * kPi / (6.0f * float(source_size) * float(source_size));
+
+    samples.clear();
+
+    for (int i = 0; i < sample_count; i++)
+    {
+        const float u         = float(i) / float(sample_count);
+        const float v         = radical_inverse_vdc(uint32_t(i));
+        const float phi       = 2.0f * kPi * u;
+        const float cos_theta = sqrtf((1.0f - v) / (1.0f + (a2 - 1.0f) * v));
+        const float sin_theta = sqrtf(1.0f - cos_theta * cos_theta);
+
+        const float h[3] = { cosf(phi) * sin_theta, sinf(phi) * sin_theta, cos_theta };
+
+        GGXSample sample;
+
+        // L = reflect(-V, H) with V = N = (0, 0, 1).
+        sample.l[0]    = 2.0f * cos_theta * h[0];
+        sample.l[1]    = 2.0f * cos_theta * h[1];
+        sample.l[2]    = 2.0f * cos_theta * h[2] - 1.0f;
+        sample.n_dot_l = sample.l[2];
+
+        if (sample.n_dot_l <= 0.0f)
+            continue;
+
+        // With N = V the pdf of L reduces to D(h) / 4. The sample covers 1 / (count * pdf) steradians, which selects the
+        // source mip whose texels are as large. The bias of one level smooths out the remaining noise.
+        const float d          = a2 / (kPi * powf(cos_theta * cos_theta * (a2 - 1.0f) + 1.0f, 2.0f));
+        const float pdf        = d * 0.25f;
+        const float sample_ang = 1.0f / (float(sample_count) * pdf + 1e-6f);
+
+        sample.lod = std::min(std::max(0.5f * log2f(sample_ang / texel_solid_ang) + 1.0f, 0.0f), float(source_levels - 1));
+
+        samples.push_back(sample);
+    }
+}
+
+bool prefilter_ggx(const Image& src, Image& dst, const RadiancePrefilterOptions& options)
+{
+    if (src.compression != COMPRESSION_NONE || src.array_slices != 6 || src.data[0][0].width != src.data[0][0].height)
+    {
+        std::cout << "ERROR::GGX prefiltering needs an uncompressed cubemap with square faces!" << std::endl;
+        return false;
+    }
+
+    // The source is widened to float and given its own mip chain, which the samples read from.
+    Image chain;
+    chain.allocate(PIXEL_TYPE_FLOAT32, src.data[0][0].width, src.data[0][0].height, src.components, 6, 1);
+
+    for (int i = 0; i < 6; i++)
+        convert_pixels(src.data[i][0].data, src.type, chain.data[i][0].data, PIXEL_TYPE_FLOAT32, size_t(src.data[i][0].width) * src.data[i][0].height * src.components);
+
+    MipGenerationOptions mip_options;
+
+    mip_options.filter = MIP_FILTER_BOX;
+    mip_options.srgb   = false;
+
+    if (!generate_mips(chain, mip_options))
+        return false;
+
+    CubeSource cube;
+
+    cube.image      = &chain;
+    cube.levels     = chain.mip_slices;
+    cube.components = chain.components;
+
+    const int face_size   = std::max(options.face_size, 1);
+    const int mip_levels  = std::min(std::max(options.mip_levels, 1), mip_chain_length(face_size, face_size));
+    const int source_size = chain.data[0][0].width;
+    const int components  = src.components;
+
+    dst.name    = src.name;
+    dst.cubemap = true;
+    dst.allocate(src.type, face_size, face_size, components, 6, mip_levels);
+
+    std::vector<std::vector<GGXSample>> samples(mip_levels);
+
+    for (int mip = 1; mip < mip_levels; mip++)
+        build_ggx_samples(samples[mip], radiance_mip_roughness(mip, mip_levels, options.mapping), std::max(options.sample_count, 1), source_size, cube.levels);
+
+    // Tiles of rows from every face and mip go into a single task list, so the small rough mips do not leave threads idle.
+    struct Tile
+    {
+        int mip;
+        int face;
+        int y;
+    };
+
+    std::vector<Tile> tiles;
+
+    for (int mip = 0; mip < mip_levels; mip++)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            for (int y = 0; y < dst.data[face][mip].height; y += PREFILTER_TILE_ROWS)
+                tiles.push_back({ mip, face, y });
+        }
+    }
+
+    parallel_for(0, int32_t(tiles.size()), [&](int32_t index) {
+        const Tile& tile = tiles[index];
+        const int   size = dst.data[tile.face][tile.mip].width;
+        const int   rows = std::min(PREFILTER_TILE_ROWS, size - tile.y);
+
+        std::vector<float> row(size_t(size) * components);
+
+        // Mip 0 is the mirror reflection, it only needs the source at a matching resolution.
+        const float mirror_lod = std::max(log2f(float(source_size) / float(size)), 0.0f);
+
+        for (int y = tile.y; y < tile.y + rows; y++)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+
+            for (int x = 0; x < size; x++)
+            {
+                float* texel = &row[size_t(x) * components];
+                float  n[3];
+
+                cubemap_direction(tile.face, (x + 0.5f) * (2.0f / size) - 1.0f, (y + 0.5f) * (2.0f / size) - 1.0f, n);
+
+                const float inv_len = 1.0f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (int c = 0; c < 3; c++)
+                    n[c] *= inv_len;
+
+                if (tile.mip == 0)
+                {
+                    sample_cube(cube, n, mirror_lod, 1.0f, texel);
+                    continue;
+                }
+
+                const float up[3]      = { 0.0f, fabsf(n[2]) < 0.999f ? 0.0f : 1.0f, fabsf(n[2]) < 0.999f ? 1.0f : 0.0f };
+                float       tangent[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+                const float inv_t      = 1.0f / sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+
+                for (int c = 0; c < 3; c++)
+                    tangent[c] *= inv_t;
+
+                const float bitangent[3] = { n[1] * tangent[2] - n[2] * tangent[1], n[2] * tangent[0] - n[0] * tangent[2], n[0] * tangent[1] - n[1] * tangent[0] };
+
+                float total_weight = 0.0f;
+
+                for (const GGXSample& sample : samples[tile.mip])
+                {
+                    float l[3];
+
+                    for (int c = 0; c < 3; c++)
+                        l[c] = tangent[c] * sample.l[0] + bitangent[c] * sample.l[1] + n[c] * sample.l[2];
+
+                    sample_cube(cube, l, sample.lod, sample.n_dot_l, texel);
+                    total_weight += sample.n_dot_l;
+                }
+
+                if (total_weight > 0.0f)
+                {
+                    for (int c = 0; c < components; c++)
+                        texel[c] /= total_weight;
+                }
+            }
+
+            uint8_t* dst_row = (uint8_t*)dst.data[tile.face][tile.mip].data + size_t(y) * size * components * size_t(dst.type);
+            convert_pixels(row.data(), PIXEL_TYPE_FLOAT32, dst_row, dst.type, row.size());
+        }
+    });
+
+    return true;
+}
+
+void octahedral_direction(float u, float v, float* dir)
+{
+    float x = u * 2.0f - 1.0f;
+    float y = v * 2.0f - 1.0f;
+
+    const float z = 1.0f - fabsf(x) - fabsf(y);
+
+    if (z < 0.0f)
+    {
+        const float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+
+        x = fx;
+        y = fy;
+    }
+
+    const float inv_len = 1.0f / sqrtf(x * x + y * y + z * z);
+
+    dir[0] = x * inv_len;
+    dir[1] = y * inv_len;
+    dir[2] = z * inv_len;
+}
+
+// Folds a coordinate outside [0, 1] back into the map. Opposite points along each edge are the same direction, so
+// crossing an edge mirrors the other coordinate.
+static inline void fold_octahedral(float& u, float& v)
+{
+    if (u < 0.0f || u > 1.0f)
+    {
+        u = u < 0.0f ? -u : 2.0f - u;
+        v = 1.0f - v;
+    }
+
+    if (v < 0.0f || v > 1.0f)
+    {
+        v = v < 0.0f ? -v : 2.0f - v;
+        u = 1.0f - u;
+    }
+}
+
+bool cubemap_to_octahedral(const Image& src, Image& dst, const OctahedralOptions& options)
+{
+    if (src.compression != COMPRESSION_NONE || src.array_slices != 6 || src.data[0][0].width != src.data[0][0].height)
+    {
+        std::cout << "ERROR::Octahedral conversion needs an uncompressed cubemap with square faces!" << std::endl;
+        return false;
+    }
+
+    const int gutter     = std::max(options.gutter, 0);
+    const int size       = options.size > 0 ? options.size : src.data[0][0].width * 2;
+    const int components = src.components;
+
+    if (size <= 2 * gutter)
+    {
+        std::cout << "ERROR::Octahedral map is too small for its gutter!" << std::endl;
+        return false;
+    }
+
+    int mip_levels = 0;
+
+    while (mip_levels < src.mip_slices && (size >> mip_levels) > 2 * gutter)
+        mip_levels++;
+
+    // An octahedral level of size L has as many texels as a cube with faces of L / 2, so every level reads the cube mip
+    // closest to that face size. With the default size, mip N reads cube mip N.
+    std::vector<int> source_mips(mip_levels);
+    int              source_levels = 1;
+
+    for (int mip = 0; mip < mip_levels; mip++)
+    {
+        const float level_size = float(std::max(size >> mip, 1));
+        const int   source_mip = int(floorf(log2f(2.0f * float(src.data[0][0].width) / level_size) + 0.5f));
+
+        source_mips[mip] = std::min(std::max(source_mip, 0), src.mip_slices - 1);
+        source_levels    = std::max(source_levels, source_mips[mip] + 1);
+    }
+
+    // sample_face reads floats, so the used mips are widened once.
+    Image source;
+    source.allocate(PIXEL_TYPE_FLOAT32, src.data[0][0].width, src.data[0][0].height, components, 6, source_levels);
+
+    for (int face = 0; face < 6; face++)
+    {
+        for (int mip = 0; mip < source_levels; mip++)
+            convert_pixels(src.data[face][mip].data, src.type, source.data[face][mip].data, PIXEL_TYPE_FLOAT32, size_t(src.data[face][mip].width) * src.data[face][mip].height * components);
+    }
+
+    CubeSource cube;
+
+    cube.image      = &source;
+    cube.levels     = source_levels;
+    cube.components = components;
+
+    dst.name = src.name;
+    dst.allocate(src.type, size, size, components, 1, mip_levels);
+
+    struct Row
+    {
+        int mip;
+        int y;
+    };
+
+    std::vector<Row> rows;
+
+    for (int mip = 0; mip < mip_levels; mip++)
+    {
+        for (int y = 0; y < dst.data[0][mip].height; y++)
+            rows.push_back({ mip, y });
+    }
+
+    parallel_for(0, int32_t(rows.size()), [&](int32_t index) {
+        const Row& task  = rows[index];
+        const int  width = dst.data[0][task.mip].width;
+        const int  inner = width - 2 * gutter;
+
+        std::vector<float> row(size_t(width) * components, 0.0f);
+
+        for (int x = 0; x < width; x++)
+        {
+            float u = (x - gutter + 0.5f) / float(inner);
+            float v = (task.y - gutter + 0.5f) / float(inner);
+
+            fold_octahedral(u, v);
+
+            float dir[3];
+            octahedral_direction(u, v, dir);
+
+            int   face;
+            float s, t;
+
+            direction_to_face(dir, face, s, t);
+            sample_face(cube, face, source_mips[task.mip], s, t, 1.0f, &row[size_t(x) * components]);
+        }
+
+        uint8_t* dst_row = (uint8_t*)dst.data[0][task.mip].data + size_t(task.y) * width * components * size_t(dst.type);
+        convert_pixels(row.data(), PIXEL_TYPE_FLOAT32, dst_row, dst.type, row.size());
+    });
+
+    return true;
+}
+} // namespace ast
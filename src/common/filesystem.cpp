@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <iterator>
 #include <fstream>
+#include <filesystem>
+#include <functional>
+#include <thread>
 
 #ifdef _WIN32
 #    include <direct.h>
@@ -13,13 +16,14 @@
 #    define getcwd _getcwd
 #else
 #    include <unistd.h>
+#    include <dirent.h>
+#    include <sys/stat.h>
+#    include <errno.h>
+#    include <string.h>
 #endif
 
 #ifdef __APPLE__
 #    include <mach-o/dyld.h>
-#    include <dirent.h>
-#    include <sys/stat.h>
-#    include <errno.h>
 #endif
 
 #define PATH_MAX_STRING_SIZE 256
@@ -33,7 +37,7 @@ FILE*                    m_CurrentWriteTarget;
 bool find_directory(std::string _path)
 {
     {
-        for (int i = 0; i < m_directory_list.size(); i++)
+        for (size_t i = 0; i < m_directory_list.size(); i++)
         {
             if (m_directory_list[i] == _path)
                 return true;
@@ -46,7 +50,7 @@ bool find_directory(std::string _path)
 bool find_archive(std::string _path)
 {
     {
-        for (int i = 0; i < m_archive_list.size(); i++)
+        for (size_t i = 0; i < m_archive_list.size(); i++)
         {
             if (m_archive_list[i] == _path)
                 return true;
@@ -103,7 +107,7 @@ FileHandle read_file(std::string _path, bool _text, bool _absolute)
     std::string cwd = get_current_working_directory();
 #endif
 
-    for (int i = 0; i < m_directory_list.size(); i++)
+    for (size_t i = 0; i < m_directory_list.size(); i++)
     {
         std::string currentDirectory;
 
@@ -307,6 +311,73 @@ void copy_file(std::string input, std::string output)
     dest.close();
 }
 
+std::string temp_file_path(const std::string& path)
+{
+#ifdef _WIN32
+    const unsigned long process = GetCurrentProcessId();
+#else
+    const unsigned long process = (unsigned long)getpid();
+#endif
+    const size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+    return path + ".tmp." + std::to_string(process) + "." + std::to_string(thread);
+}
+
+bool publish_file(const std::string& temp_path, const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+
+    if (error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::string> list_files(const std::string& path)
+{
+    std::vector<std::string> files;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA find_data;
+    HANDLE           find = FindFirstFileA((path + "\\*").c_str(), &find_data);
+
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                files.push_back(find_data.cFileName);
+        } while (FindNextFileA(find, &find_data));
+
+        FindClose(find);
+    }
+#else
+    DIR* dir = opendir(path.c_str());
+
+    if (dir)
+    {
+        while (dirent* entry = readdir(dir))
+        {
+            struct stat st;
+            std::string file = path + "/" + entry->d_name;
+
+            if (stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode))
+                files.push_back(entry->d_name);
+        }
+
+        closedir(dir);
+    }
+#endif
+
+    std::sort(files.begin(), files.end());
+
+    return files;
+}
+
 void destroy_handle(FileHandle& handle)
 {
     if (handle.buffer)
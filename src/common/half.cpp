@@ -0,0 +1,106 @@
+#include <common/half.h>
+#include <string.h>
+
+#if defined(__F16C__)
+#    include <immintrin.h>
+#endif
+
+namespace ast
+{
+uint16_t float_to_half(float value)
+{
+#if defined(__F16C__)
+    return uint16_t(_mm_extract_epi16(_mm_cvtps_ph(_mm_set_ss(value), 0), 0));
+#else
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    int32_t  exponent = int32_t((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31)
+        return uint16_t(sign | 0x7C00 | (((bits & 0x7FFFFFFF) > 0x7F800000) ? 0x200 : 0));
+
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return uint16_t(sign);
+
+        mantissa |= 0x800000;
+
+        uint32_t shift   = uint32_t(14 - exponent);
+        uint32_t rounded = (mantissa + (1u << (shift - 1)) - 1 + ((mantissa >> shift) & 1)) >> shift;
+
+        return uint16_t(sign | rounded);
+    }
+
+    uint32_t rounded = (mantissa + 0xFFF + ((mantissa >> 13) & 1)) >> 13;
+
+    return uint16_t(sign + (uint32_t(exponent) << 10) + rounded);
+#endif
+}
+
+float half_to_float(uint16_t value)
+{
+#if defined(__F16C__)
+    return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtsi32_si128(value)));
+#else
+    uint32_t sign     = uint32_t(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+
+    if (exponent == 31)
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    else if (exponent != 0)
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    else if (mantissa != 0)
+    {
+        // Denormal, shift the mantissa up until the implicit bit is set.
+        exponent = 127 - 15 + 1;
+
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+    else
+        bits = sign;
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+
+    return result;
+#endif
+}
+
+void float_to_half(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), 0));
+#endif
+
+    for (; i < count; i++)
+        dst[i] = float_to_half(src[i]);
+}
+
+void half_to_float(const uint16_t* src, float* dst, size_t count)
+{
+    size_t i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(src + i))));
+#endif
+
+    for (; i < count; i++)
+        dst[i] = half_to_float(src[i]);
+}
+} // namespace ast
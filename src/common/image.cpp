@@ -1,79 +1,399 @@
 #include <common/image.h>
+#include <common/half.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#    include <malloc.h>
+#endif
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSSE3__)
+#    include <tmmintrin.h>
+#endif
 
 namespace ast
 {
-#define TO_BGRA(type, imgData)                                                 \
-    Pixel<type, 4>* src = (Pixel<type, 4>*)imgData.data;                       \
-                                                                               \
-    for (int y = 0; y < imgData.height; y++)                                   \
-    {                                                                          \
-        for (int x = 0; x < imgData.width; x++)                                \
-        {                                                                      \
-            type g = src[y * imgData.width + x].c[2];                          \
-                                                                               \
-            src[y * imgData.width + x].c[2] = src[y * imgData.width + x].c[0]; \
-            src[y * imgData.width + x].c[0] = g;                               \
-        }                                                                      \
-    }
-
-#define ARGB_TO_RGBA(type, imgData)                      \
-    Pixel<type, 4>* src = (Pixel<type, 4>*)imgData.data; \
-                                                         \
-    for (int y = 0; y < imgData.height; y++)             \
-    {                                                    \
-        for (int x = 0; x < imgData.width; x++)          \
-        {                                                \
-            type r = src[y * imgData.width + x].c[0];    \
-            type g = src[y * imgData.width + x].c[1];    \
-            type b = src[y * imgData.width + x].c[2];    \
-            type a = src[y * imgData.width + x].c[3];    \
-                                                         \
-            src[y * imgData.width + x].c[0] = g;         \
-            src[y * imgData.width + x].c[1] = b;         \
-            src[y * imgData.width + x].c[2] = a;         \
-            src[y * imgData.width + x].c[3] = r;         \
-        }                                                \
-    }
-
-#define TO_RGBA(type, num_components, dst_data)                                    \
-    Pixel<type, 4>*              dst = (Pixel<type, 4>*)dst_data;                  \
-    Pixel<type, num_components>* src = (Pixel<type, num_components>*)imgData.data; \
-                                                                                   \
-    for (int y = 0; y < imgData.height; y++)                                       \
-    {                                                                              \
-        for (int x = 0; x < imgData.width; x++)                                    \
-        {                                                                          \
-            dst[y * imgData.width + x].c[0] = 0;                                   \
-            dst[y * imgData.width + x].c[1] = 0;                                   \
-            dst[y * imgData.width + x].c[2] = 0;                                   \
-            dst[y * imgData.width + x].c[3] = std::numeric_limits<type>::max();    \
-                                                                                   \
-            for (int c = 0; c < num_components; c++)                               \
-            {                                                                      \
-                dst[y * imgData.width + x].c[c] = src[y * imgData.width + x].c[c]; \
-            }                                                                      \
-        }                                                                          \
-    }
+struct SwizzleMasks
+{
+    alignas(16) uint8_t shuffle[3][16];
+    alignas(16) uint8_t bits[3][16]; // XORed after the shuffle, sets constant ones and negates flipped float channels.
+    alignas(32) float add[3][8];     // Added after the XOR so flipped float channels become 1 - x.
+    bool add_needed;
+};
 
-Image::Image(const PixelType& pixel_type) :
-    mip_slices(0), array_slices(0), type(pixel_type), compression(COMPRESSION_NONE)
+// Builds the masks for a run of 16 byte output vectors. Shuffle indices are relative to a source load starting at
+// the first pixel of each vector, which only holds whole pixels when the destination pixel size divides 16.
+static void build_swizzle_masks(SwizzleMasks& masks, int vectors, int src_components, int dst_components, const SwizzleChannel* mapping, const PixelType& type, bool flip_green)
 {
-    for (int i = 0; i < 16; i++)
+    const int      element_size = int(type);
+    const int      pixel_size   = dst_components * element_size;
+    const uint16_t half_one     = 0x3C00;
+    const float    float_one    = 1.0f;
+    uint8_t        one[4]       = { 0xFF, 0, 0, 0 };
+    uint8_t        flip[4]      = { 0xFF, 0, 0, 0 };
+
+    if (type == PIXEL_TYPE_FLOAT16)
+    {
+        memcpy(one, &half_one, sizeof(half_one));
+        flip[0] = 0x00;
+        flip[1] = 0x80;
+    }
+    else if (type == PIXEL_TYPE_FLOAT32)
+    {
+        memcpy(one, &float_one, sizeof(float_one));
+        flip[0] = 0x00;
+        flip[3] = 0x80;
+    }
+
+    masks.add_needed = flip_green && type != PIXEL_TYPE_UNORM8;
+
+    for (int k = 0; k < vectors; k++)
     {
+        const int first_pixel = (k * 16) / pixel_size;
+
         for (int j = 0; j < 16; j++)
-            data[i][j].data = nullptr;
+        {
+            const int            byte    = k * 16 + j;
+            const int            b       = byte % element_size;
+            const int            pixel   = byte / pixel_size;
+            const SwizzleChannel channel = mapping[(byte / element_size) % dst_components];
+            const bool           flipped = flip_green && channel == SWIZZLE_G;
+
+            if (channel < src_components)
+                masks.shuffle[k][j] = uint8_t(((pixel - first_pixel) * src_components + channel) * element_size + b);
+            else
+                masks.shuffle[k][j] = 0x80;
+
+            masks.bits[k][j] = channel == SWIZZLE_ONE ? one[b] : (flipped ? flip[b] : 0);
+
+            if (b == 0 && type != PIXEL_TYPE_UNORM8)
+                masks.add[k][j / element_size] = flipped ? 1.0f : 0.0f;
+        }
+    }
+}
+
+#if defined(__SSSE3__)
+static inline __m128i finish_swizzle(__m128i v, const SwizzleMasks& masks, int k, const PixelType& type)
+{
+    v = _mm_xor_si128(v, _mm_load_si128((const __m128i*)masks.bits[k]));
+
+    if (masks.add_needed && type == PIXEL_TYPE_FLOAT32)
+        v = _mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(v), _mm_load_ps(masks.add[k])));
+#    if defined(__F16C__)
+    else if (masks.add_needed)
+        v = _mm256_cvtps_ph(_mm256_add_ps(_mm256_cvtph_ps(v), _mm256_load_ps(masks.add[k])), 0);
+#    endif
+
+    return v;
+}
+#endif
+
+template <typename T, typename FlipFunc>
+static void swizzle_scalar(const T* src, int src_components, T* dst, int dst_components, const SwizzleChannel* mapping, T one, bool flip_green, FlipFunc flip, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        T pixel[6] = { T(0), T(0), T(0), T(0), T(0), one };
+
+        for (int c = 0; c < src_components; c++)
+            pixel[c] = src[i * src_components + c];
+
+        for (int c = 0; c < dst_components; c++)
+            dst[i * dst_components + c] = flip_green && mapping[c] == SWIZZLE_G ? flip(pixel[SWIZZLE_G]) : pixel[mapping[c]];
     }
 }
 
+void swizzle_pixels(const void*           src,
+                    int                   src_components,
+                    void*                 dst,
+                    int                   dst_components,
+                    const SwizzleChannel* mapping,
+                    const PixelType&      type,
+                    size_t                count,
+                    bool                  flip_green)
+{
+    size_t done = 0;
+
+#if defined(__SSSE3__)
+    const int      element_size = int(type);
+    const size_t   src_stride   = size_t(src_components) * element_size;
+    const size_t   dst_stride   = size_t(dst_components) * element_size;
+    const uint8_t* src_bytes    = (const uint8_t*)src;
+    uint8_t*       dst_bytes    = (uint8_t*)dst;
+    bool           identity     = src_components == dst_components;
+
+    for (int c = 0; c < dst_components; c++)
+        identity = identity && mapping[c] == c;
+
+#    if defined(__F16C__)
+    const bool vectorizable = true;
+#    else
+    const bool vectorizable = !flip_green || type != PIXEL_TYPE_FLOAT16;
+#    endif
+
+    SwizzleMasks masks;
+
+    if (vectorizable && identity)
+    {
+        // Every pixel size up to 16 bytes divides 48, so three vectors cover a whole number of pixels.
+        const size_t block_pixels = 48 / dst_stride;
+
+        build_swizzle_masks(masks, 3, src_components, dst_components, mapping, type, flip_green);
+
+        for (; done + block_pixels <= count; done += block_pixels)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                __m128i v = _mm_loadu_si128((const __m128i*)(src_bytes + done * src_stride + k * 16));
+                _mm_storeu_si128((__m128i*)(dst_bytes + done * dst_stride + k * 16), finish_swizzle(v, masks, k, type));
+            }
+        }
+    }
+    else if (vectorizable && src_components <= dst_components && 16 % dst_stride == 0)
+    {
+        // The source of one output vector is never larger than 16 bytes, the last vectors are left to the scalar path
+        // so the unaligned loads never read past the end of the source.
+        const size_t vector_pixels = 16 / dst_stride;
+        const size_t safe_pixels   = count * src_stride >= 16 ? (count * src_stride - 16) / src_stride + 1 : 0;
+
+        build_swizzle_masks(masks, 1, src_components, dst_components, mapping, type, flip_green);
+
+        const __m128i shuffle = _mm_load_si128((const __m128i*)masks.shuffle[0]);
+
+#    if defined(__AVX2__)
+        const __m256i shuffle2 = _mm256_broadcastsi128_si256(shuffle);
+        const __m256i bits2    = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)masks.bits[0]));
+
+        for (; done + 2 * vector_pixels <= safe_pixels; done += 2 * vector_pixels)
+        {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(src_bytes + done * src_stride));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(src_bytes + (done + vector_pixels) * src_stride));
+            __m256i v  = _mm256_xor_si256(_mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuffle2), bits2);
+
+            if (masks.add_needed && type == PIXEL_TYPE_FLOAT32)
+                v = _mm256_castps_si256(_mm256_add_ps(_mm256_castsi256_ps(v), _mm256_broadcast_ps((const __m128*)masks.add[0])));
+#        if defined(__F16C__)
+            else if (masks.add_needed)
+            {
+                __m256 add = _mm256_load_ps(masks.add[0]);
+                lo         = _mm256_cvtps_ph(_mm256_add_ps(_mm256_cvtph_ps(_mm256_castsi256_si128(v)), add), 0);
+                hi         = _mm256_cvtps_ph(_mm256_add_ps(_mm256_cvtph_ps(_mm256_extracti128_si256(v, 1)), add), 0);
+                v          = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            }
+#        endif
+
+            _mm256_storeu_si256((__m256i*)(dst_bytes + done * dst_stride), v);
+        }
+#    endif
+
+        for (; done + vector_pixels <= safe_pixels; done += vector_pixels)
+        {
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src_bytes + done * src_stride)), shuffle);
+            _mm_storeu_si128((__m128i*)(dst_bytes + done * dst_stride), finish_swizzle(v, masks, 0, type));
+        }
+    }
+#endif
+
+    if (type == PIXEL_TYPE_UNORM8)
+        swizzle_scalar((const uint8_t*)src, src_components, (uint8_t*)dst, dst_components, mapping, uint8_t(255), flip_green, [](uint8_t v) { return uint8_t(255 - v); }, done, count);
+    else if (type == PIXEL_TYPE_FLOAT16)
+        swizzle_scalar((const uint16_t*)src, src_components, (uint16_t*)dst, dst_components, mapping, uint16_t(0x3C00), flip_green, [](uint16_t v) { return float_to_half(1.0f - half_to_float(v)); }, done, count);
+    else if (type == PIXEL_TYPE_FLOAT32)
+        swizzle_scalar((const float*)src, src_components, (float*)dst, dst_components, mapping, 1.0f, flip_green, [](float v) { return 1.0f - v; }, done, count);
+}
+
+#define CONVERT_CHUNK_SIZE 1024
+
+static void load_floats(const void* src, const PixelType& type, float* dst, size_t count)
+{
+    if (type == PIXEL_TYPE_UNORM8)
+    {
+        for (size_t i = 0; i < count; i++)
+            dst[i] = ((const uint8_t*)src)[i] * (1.0f / 255.0f);
+    }
+    else if (type == PIXEL_TYPE_FLOAT16)
+        half_to_float((const uint16_t*)src, dst, count);
+    else
+        memcpy(dst, src, count * sizeof(float));
+}
+
+static void store_floats(const float* src, void* dst, const PixelType& type, size_t count)
+{
+    if (type == PIXEL_TYPE_UNORM8)
+    {
+        for (size_t i = 0; i < count; i++)
+            ((uint8_t*)dst)[i] = uint8_t(std::min(std::max(src[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+    else if (type == PIXEL_TYPE_FLOAT16)
+        float_to_half(src, (uint16_t*)dst, count);
+    else
+        memcpy(dst, src, count * sizeof(float));
+}
+
+void convert_pixels(const void* src, const PixelType& src_type, void* dst, const PixelType& dst_type, size_t count)
+{
+    if (src_type == dst_type)
+        memmove(dst, src, count * size_t(src_type));
+    else if (src_type == PIXEL_TYPE_FLOAT32)
+        store_floats((const float*)src, dst, dst_type, count);
+    else if (dst_type == PIXEL_TYPE_FLOAT32)
+        load_floats(src, src_type, (float*)dst, count);
+    else
+    {
+        // UNORM8 <-> FLOAT16 goes through a small float buffer that stays in L1.
+        float chunk[CONVERT_CHUNK_SIZE];
+
+        for (size_t i = 0; i < count; i += CONVERT_CHUNK_SIZE)
+        {
+            const size_t n = std::min(count - i, size_t(CONVERT_CHUNK_SIZE));
+
+            load_floats((const uint8_t*)src + i * size_t(src_type), src_type, chunk, n);
+            store_floats(chunk, (uint8_t*)dst + i * size_t(dst_type), dst_type, n);
+        }
+    }
+}
+
+size_t compressed_block_size(const CompressionType& compression)
+{
+    switch (compression)
+    {
+        case COMPRESSION_BC1:
+        case COMPRESSION_BC1a:
+        case COMPRESSION_BC4:
+        case COMPRESSION_ETC1:
+        case COMPRESSION_ETC2:
+        case COMPRESSION_EAC_R11:
+        case COMPRESSION_PVR:
+            return 8;
+        case COMPRESSION_BC2:
+        case COMPRESSION_BC3:
+        case COMPRESSION_BC3n:
+        case COMPRESSION_BC5:
+        case COMPRESSION_BC6:
+        case COMPRESSION_BC7:
+        case COMPRESSION_ETC2_RGBA:
+        case COMPRESSION_EAC_RG11:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t pvrtc_size(int width, int height)
+{
+    const size_t blocks_x = std::max(2, (width + 3) / 4);
+    const size_t blocks_y = std::max(2, (height + 3) / 4);
+
+    return blocks_x * blocks_y * 8;
+}
+
+size_t compressed_size(const CompressionType& compression, int width, int height)
+{
+    if (compression == COMPRESSION_PVR)
+        return pvrtc_size(width, height);
+
+    size_t blocks_x = std::max(1, (width + 3) / 4);
+    size_t blocks_y = std::max(1, (height + 3) / 4);
+
+    return blocks_x * blocks_y * compressed_block_size(compression);
+}
+
+#define IMAGE_STORAGE_ALIGNMENT 64
+
+static void* aligned_malloc(size_t size)
+{
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, IMAGE_STORAGE_ALIGNMENT);
+#else
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, IMAGE_STORAGE_ALIGNMENT, std::max(size, size_t(1))) == 0 ? ptr : nullptr;
+#endif
+}
+
+static void aligned_free(void* ptr)
+{
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+Image::Image(const PixelType& pixel_type) :
+    components(0), mip_slices(0), array_slices(0), data(16), storage(nullptr), type(pixel_type), compression(COMPRESSION_NONE), cubemap(false), color_space(COLOR_SPACE_UNKNOWN)
+{
+}
+
+Image::Image(const Image& other) :
+    Image(other.type)
+{
+    *this = other;
+}
+
+Image::Image(Image&& other) :
+    Image(other.type)
+{
+    *this = std::move(other);
+}
+
 Image::~Image()
 {
     deallocate();
 }
 
-Image& Image::operator=(Image other)
+Image& Image::operator=(const Image& other)
+{
+    if (this == &other)
+        return *this;
+
+    deallocate();
+
+    components   = other.components;
+    mip_slices   = other.mip_slices;
+    array_slices = other.array_slices;
+    name         = other.name;
+    type         = other.type;
+    compression  = other.compression;
+    cubemap      = other.cubemap;
+    color_space  = other.color_space;
+    data         = other.data;
+
+    allocate_storage();
+
+    for (int i = 0; i < array_slices; i++)
+    {
+        for (int j = 0; j < mip_slices; j++)
+            memcpy(data[i][j].data, other.data[i][j].data, data[i][j].size);
+    }
+
+    return *this;
+}
+
+Image& Image::operator=(Image&& other)
 {
+    if (this == &other)
+        return *this;
+
     deallocate();
-    allocate(other.type, other.data[other.array_slices][other.mip_slices].width, other.data[other.array_slices][other.mip_slices].height, other.components, other.array_slices, other.mip_slices);
+
+    components   = other.components;
+    mip_slices   = other.mip_slices;
+    array_slices = other.array_slices;
+    name         = std::move(other.name);
+    type         = other.type;
+    compression  = other.compression;
+    cubemap      = other.cubemap;
+    color_space  = other.color_space;
+    data         = std::move(other.data);
+    storage      = other.storage;
+
+    other.mip_slices   = 0;
+    other.array_slices = 0;
+    other.storage      = nullptr;
+    other.data.assign(16, std::array<Data, 16>());
 
     return *this;
 }
@@ -90,37 +410,62 @@ void Image::allocate(const PixelType& pixel_type,
     mip_slices   = mip_slice_count;
     array_slices = array_slice_count;
 
-    for (uint32_t i = 0; i < array_slices; i++)
+    if (data.size() < array_slice_count)
+        data.resize(array_slice_count);
+
+    for (uint32_t i = 0; i < array_slice_count; i++)
     {
         uint32_t w = base_mip_width;
         uint32_t h = base_mip_height;
 
-        for (uint32_t j = 0; j < mip_slices; j++)
+        for (uint32_t j = 0; j < mip_slice_count; j++)
         {
             data[i][j].width  = w;
             data[i][j].height = h;
-            data[i][j].data   = malloc(w * h * components * size_t(type));
             data[i][j].size   = w * h * components * size_t(type);
 
-            w /= 2;
-            h /= 2;
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
         }
     }
+
+    allocate_storage();
 }
 
-void Image::deallocate()
+void Image::allocate_storage()
 {
+    storage = aligned_malloc(storage_size());
+
+    uint8_t* ptr = (uint8_t*)storage;
+
     for (int i = 0; i < array_slices; i++)
     {
         for (int j = 0; j < mip_slices; j++)
         {
-            if (data[i][j].data)
-            {
+            data[i][j].data = ptr;
+            ptr += data[i][j].size;
+        }
+    }
+}
+
+void Image::deallocate()
+{
+    for (int i = 0; i < std::min(array_slices, int(data.size())); i++)
+    {
+        for (int j = 0; j < mip_slices; j++)
+        {
+            if (data[i][j].data && !storage)
                 free(data[i][j].data);
-                data[i][j].data = nullptr;
-            }
+
+            data[i][j].data = nullptr;
         }
     }
+
+    if (storage)
+    {
+        aligned_free(storage);
+        storage = nullptr;
+    }
 }
 
 size_t Image::size(int array_slice, int mip_slice) const
@@ -128,106 +473,107 @@ size_t Image::size(int array_slice, int mip_slice) const
     return size_t(type) * data[array_slice][mip_slice].width * data[array_slice][mip_slice].height * components;
 }
 
-void Image::to_bgra(int array_slice, int mip_slice)
+size_t Image::storage_size() const
 {
-    Data& imgData = data[array_slice][mip_slice];
+    size_t total = 0;
 
-    if (type == PIXEL_TYPE_UNORM8)
-    {
-        TO_BGRA(uint8_t, imgData)
-    }
-    else if (type == PIXEL_TYPE_FLOAT16)
-    {
-        TO_BGRA(int16_t, imgData)
-    }
-    else if (type == PIXEL_TYPE_FLOAT32)
+    for (int i = 0; i < array_slices; i++)
     {
-        TO_BGRA(float, imgData)
+        for (int j = 0; j < mip_slices; j++)
+            total += data[i][j].size;
     }
+
+    return total;
+}
+
+void Image::to_bgra(int array_slice, int mip_slice)
+{
+    static const SwizzleChannel kToBGRA[4] = { SWIZZLE_B, SWIZZLE_G, SWIZZLE_R, SWIZZLE_A };
+
+    Data& imgData = data[array_slice][mip_slice];
+
+    if (components >= 3)
+        swizzle_pixels(imgData.data, components, imgData.data, components, kToBGRA, type, size_t(imgData.width) * imgData.height, false);
 }
 
 void Image::argb_to_rgba(int array_slice, int mip_slice)
 {
+    static const SwizzleChannel kToRGBA[4] = { SWIZZLE_G, SWIZZLE_B, SWIZZLE_A, SWIZZLE_R };
+
     Data& imgData = data[array_slice][mip_slice];
 
-    if (type == PIXEL_TYPE_UNORM8)
-    {
-        ARGB_TO_RGBA(uint8_t, imgData);
-    }
-    else if (type == PIXEL_TYPE_FLOAT16)
-    {
-        ARGB_TO_RGBA(int16_t, imgData);
-    }
-    else if (type == PIXEL_TYPE_FLOAT32)
-    {
-        ARGB_TO_RGBA(float, imgData);
-    }
+    if (components == 4)
+        swizzle_pixels(imgData.data, 4, imgData.data, 4, kToRGBA, type, size_t(imgData.width) * imgData.height, false);
 }
 
 bool Image::to_rgba(Image& img, int array_slice, int mip_slice)
 {
-    if (components == 4)
-    {
-        img = *this;
-        return true;
-    }
+    static const SwizzleChannel kToRGBA[4] = { SWIZZLE_R, SWIZZLE_G, SWIZZLE_B, SWIZZLE_A };
 
-    Data& imgData  = data[array_slice][mip_slice];
-    void* new_data = malloc(imgData.width * imgData.height * 4 * size_t(type));
+    Data&  imgData  = data[array_slice][mip_slice];
+    size_t size     = size_t(imgData.width) * imgData.height * 4 * size_t(type);
+    void*  new_data = malloc(size);
 
-    if (type == PIXEL_TYPE_UNORM8)
+    swizzle_pixels(imgData.data, components, new_data, 4, kToRGBA, type, size_t(imgData.width) * imgData.height, false);
+
+    img.type                                = type;
+    img.components                          = 4;
+    img.array_slices                        = array_slices;
+    img.mip_slices                          = mip_slices;
+    img.data[array_slice][mip_slice].data   = new_data;
+    img.data[array_slice][mip_slice].width  = imgData.width;
+    img.data[array_slice][mip_slice].height = imgData.height;
+    img.data[array_slice][mip_slice].size   = size;
+
+    return true;
+}
+
+void Image::flip_green(int array_slice, int mip_slice)
+{
+    static const SwizzleChannel kIdentity[4] = { SWIZZLE_R, SWIZZLE_G, SWIZZLE_B, SWIZZLE_A };
+
+    Data& imgData = data[array_slice][mip_slice];
+
+    if (components >= 2)
+        swizzle_pixels(imgData.data, components, imgData.data, components, kIdentity, type, size_t(imgData.width) * imgData.height, true);
+}
+
+bool Image::convert(const PixelType& pixel_type)
+{
+    if (pixel_type == type)
+        return true;
+
+    if (compression != COMPRESSION_NONE)
     {
-        if (components == 3)
-        {
-            TO_RGBA(uint8_t, 3, new_data)
-        }
-        else if (components == 2)
-        {
-            TO_RGBA(uint8_t, 2, new_data)
-        }
-        else if (components == 1)
-        {
-            TO_RGBA(uint8_t, 1, new_data)
-        }
+        std::cout << "ERROR::Compressed images cannot be converted to another pixel type!" << std::endl;
+        return false;
     }
-    else if (type == PIXEL_TYPE_FLOAT16)
+
+    Image converted(pixel_type);
+
+    converted.components   = components;
+    converted.mip_slices   = mip_slices;
+    converted.array_slices = array_slices;
+    converted.name         = name;
+    converted.cubemap      = cubemap;
+    converted.color_space  = color_space;
+    converted.data         = data;
+
+    for (int i = 0; i < array_slices; i++)
     {
-        if (components == 3)
-        {
-            TO_RGBA(int16_t, 3, new_data)
-        }
-        else if (components == 2)
-        {
-            TO_RGBA(int16_t, 2, new_data)
-        }
-        else if (components == 1)
-        {
-            TO_RGBA(int16_t, 1, new_data)
-        }
+        for (int j = 0; j < mip_slices; j++)
+            converted.data[i][j].size = converted.size(i, j);
     }
-    else if (type == PIXEL_TYPE_FLOAT32)
+
+    converted.allocate_storage();
+
+    for (int i = 0; i < array_slices; i++)
     {
-        if (components == 3)
-        {
-            TO_RGBA(float, 3, new_data)
-        }
-        else if (components == 2)
-        {
-            TO_RGBA(float, 2, new_data)
-        }
-        else if (components == 1)
-        {
-            TO_RGBA(float, 1, new_data)
-        }
+        for (int j = 0; j < mip_slices; j++)
+            convert_pixels(data[i][j].data, type, converted.data[i][j].data, pixel_type, size_t(data[i][j].width) * data[i][j].height * components);
     }
 
-    img.components                          = 4;
-    img.array_slices                        = array_slices;
-    img.mip_slices                          = mip_slices;
-    img.data[array_slice][mip_slice].data   = new_data;
-    img.data[array_slice][mip_slice].width  = data[array_slice][mip_slice].width;
-    img.data[array_slice][mip_slice].height = data[array_slice][mip_slice].height;
-    img.data[array_slice][mip_slice].size   = data[array_slice][mip_slice].size;
+    *this = std::move(converted);
 
     return true;
 }
@@ -0,0 +1,214 @@
+#include <common/ktx2.h>
+
+// Khronos Data Format constants used by the descriptors below.
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC2 129
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC4 131
+#define KHR_DF_MODEL_BC5 132
+#define KHR_DF_MODEL_BC6H 133
+#define KHR_DF_MODEL_BC7 134
+#define KHR_DF_MODEL_ETC2 161
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_TRANSFER_SRGB 2
+#define KHR_DF_CHANNEL_ALPHA 15
+#define KHR_DF_CHANNEL_NONE 0xFF
+#define KHR_DF_SAMPLE_DATATYPE_LINEAR 0x10
+#define KHR_DF_SAMPLE_DATATYPE_SIGNED 0x40
+#define KHR_DF_SAMPLE_DATATYPE_FLOAT 0x80
+#define KHR_DF_FLOAT_ZERO 0x00000000u
+#define KHR_DF_FLOAT_ONE 0x3F800000u
+#define KHR_DF_FLOAT_MINUS_ONE 0xBF800000u
+#define KHR_DF_FLOAT_INFINITY 0x7F800000u
+
+namespace ast
+{
+const uint8_t kKTX2Identifier[KTX2_IDENTIFIER_SIZE] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+struct KTX2Format
+{
+    uint32_t        vk_format;
+    CompressionType compression;
+    PixelType       type;
+    int             components;
+    bool            srgb;
+    uint8_t         color_model;
+    uint8_t         block_channels[2]; // Channels of the two 64-bit halves of a block. A single channel covers the whole block.
+};
+
+// Uncompressed formats describe one sample per component, so their block channels are unused.
+static const KTX2Format kFormats[] = {
+    { 9, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 1, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 15, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 1, true, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 16, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 2, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 22, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 2, true, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 23, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 3, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 29, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 3, true, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 37, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 43, COMPRESSION_NONE, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 76, COMPRESSION_NONE, PIXEL_TYPE_FLOAT16, 1, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 83, COMPRESSION_NONE, PIXEL_TYPE_FLOAT16, 2, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 90, COMPRESSION_NONE, PIXEL_TYPE_FLOAT16, 3, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 97, COMPRESSION_NONE, PIXEL_TYPE_FLOAT16, 4, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 100, COMPRESSION_NONE, PIXEL_TYPE_FLOAT32, 1, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 103, COMPRESSION_NONE, PIXEL_TYPE_FLOAT32, 2, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 106, COMPRESSION_NONE, PIXEL_TYPE_FLOAT32, 3, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 109, COMPRESSION_NONE, PIXEL_TYPE_FLOAT32, 4, false, KHR_DF_MODEL_RGBSDA, { KHR_DF_CHANNEL_NONE, KHR_DF_CHANNEL_NONE } },
+    { 131, COMPRESSION_BC1, PIXEL_TYPE_UNORM8, 3, false, KHR_DF_MODEL_BC1A, { 0, KHR_DF_CHANNEL_NONE } },
+    { 132, COMPRESSION_BC1, PIXEL_TYPE_UNORM8, 3, true, KHR_DF_MODEL_BC1A, { 0, KHR_DF_CHANNEL_NONE } },
+    { 133, COMPRESSION_BC1a, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_BC1A, { 1, KHR_DF_CHANNEL_NONE } },
+    { 134, COMPRESSION_BC1a, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_BC1A, { 1, KHR_DF_CHANNEL_NONE } },
+    { 135, COMPRESSION_BC2, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_BC2, { KHR_DF_CHANNEL_ALPHA, 0 } },
+    { 136, COMPRESSION_BC2, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_BC2, { KHR_DF_CHANNEL_ALPHA, 0 } },
+    { 137, COMPRESSION_BC3, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_BC3, { KHR_DF_CHANNEL_ALPHA, 0 } },
+    { 138, COMPRESSION_BC3, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_BC3, { KHR_DF_CHANNEL_ALPHA, 0 } },
+    { 139, COMPRESSION_BC4, PIXEL_TYPE_UNORM8, 1, false, KHR_DF_MODEL_BC4, { 0, KHR_DF_CHANNEL_NONE } },
+    { 141, COMPRESSION_BC5, PIXEL_TYPE_UNORM8, 2, false, KHR_DF_MODEL_BC5, { 0, 1 } },
+    { 143, COMPRESSION_BC6, PIXEL_TYPE_FLOAT16, 3, false, KHR_DF_MODEL_BC6H, { 0, KHR_DF_CHANNEL_NONE } },
+    { 145, COMPRESSION_BC7, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_BC7, { 0, KHR_DF_CHANNEL_NONE } },
+    { 146, COMPRESSION_BC7, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_BC7, { 0, KHR_DF_CHANNEL_NONE } },
+    { 147, COMPRESSION_ETC2, PIXEL_TYPE_UNORM8, 3, false, KHR_DF_MODEL_ETC2, { 2, KHR_DF_CHANNEL_NONE } },
+    { 148, COMPRESSION_ETC2, PIXEL_TYPE_UNORM8, 3, true, KHR_DF_MODEL_ETC2, { 2, KHR_DF_CHANNEL_NONE } },
+    { 151, COMPRESSION_ETC2_RGBA, PIXEL_TYPE_UNORM8, 4, false, KHR_DF_MODEL_ETC2, { KHR_DF_CHANNEL_ALPHA, 2 } },
+    { 152, COMPRESSION_ETC2_RGBA, PIXEL_TYPE_UNORM8, 4, true, KHR_DF_MODEL_ETC2, { KHR_DF_CHANNEL_ALPHA, 2 } },
+    { 153, COMPRESSION_EAC_R11, PIXEL_TYPE_UNORM8, 1, false, KHR_DF_MODEL_ETC2, { 0, KHR_DF_CHANNEL_NONE } },
+    { 155, COMPRESSION_EAC_RG11, PIXEL_TYPE_UNORM8, 2, false, KHR_DF_MODEL_ETC2, { 0, 1 } }
+};
+
+static const KTX2Format* find_format(uint32_t vk_format)
+{
+    for (const KTX2Format& format : kFormats)
+    {
+        if (format.vk_format == vk_format)
+            return &format;
+    }
+
+    return nullptr;
+}
+
+uint32_t ktx2_vk_format(const CompressionType& compression, const PixelType& type, int components, bool srgb)
+{
+    // BC3n only swizzles the channels before encoding and ETC1 blocks are valid ETC2 blocks.
+    CompressionType stored = compression;
+
+    if (stored == COMPRESSION_BC3n)
+        stored = COMPRESSION_BC3;
+    else if (stored == COMPRESSION_ETC1)
+        stored = COMPRESSION_ETC2;
+
+    uint32_t linear = 0;
+
+    for (const KTX2Format& format : kFormats)
+    {
+        if (format.compression != stored)
+            continue;
+
+        if (stored == COMPRESSION_NONE && (format.type != type || format.components != components))
+            continue;
+
+        if (format.srgb == srgb)
+            return format.vk_format;
+
+        if (!format.srgb)
+            linear = format.vk_format;
+    }
+
+    // Formats without an sRGB variant fall back to the linear one.
+    return linear;
+}
+
+bool ktx2_image_format(uint32_t vk_format, CompressionType& compression, PixelType& type, int& components)
+{
+    const KTX2Format* format = find_format(vk_format);
+
+    if (!format)
+        return false;
+
+    compression = format->compression;
+    type        = format->type;
+    components  = format->components;
+
+    return true;
+}
+
+uint32_t ktx2_texel_block_size(uint32_t vk_format)
+{
+    const KTX2Format* format = find_format(vk_format);
+
+    if (!format)
+        return 0;
+
+    if (format->compression != COMPRESSION_NONE)
+        return uint32_t(compressed_block_size(format->compression));
+
+    return uint32_t(format->type) * format->components;
+}
+
+static void write_sample(std::vector<uint32_t>& dfd, uint32_t bit_offset, uint32_t bit_length, uint32_t channel, uint32_t lower, uint32_t upper)
+{
+    dfd.push_back(bit_offset | ((bit_length - 1) << 16) | (channel << 24));
+    dfd.push_back(0); // Sample position, always the origin of the block.
+    dfd.push_back(lower);
+    dfd.push_back(upper);
+}
+
+bool ktx2_data_format_descriptor(uint32_t vk_format, std::vector<uint32_t>& dfd)
+{
+    const KTX2Format* format = find_format(vk_format);
+
+    if (!format)
+        return false;
+
+    const bool     compressed = format->compression != COMPRESSION_NONE;
+    const uint32_t block_size = ktx2_texel_block_size(vk_format);
+    const uint32_t transfer   = format->srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+    dfd.clear();
+    dfd.push_back(0); // Total size, filled in once the samples are known.
+    dfd.push_back(0); // Khronos vendor and basic descriptor type.
+    dfd.push_back(0); // Version and block size, filled in below.
+    dfd.push_back(format->color_model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    dfd.push_back(compressed ? (3 | (3 << 8)) : 0); // Texel block dimensions minus one.
+    dfd.push_back(block_size);
+    dfd.push_back(0);
+
+    if (!compressed)
+    {
+        const uint32_t bits = uint32_t(format->type) * 8;
+
+        for (int c = 0; c < format->components; c++)
+        {
+            uint32_t channel = c == 3 ? KHR_DF_CHANNEL_ALPHA : c;
+
+            if (format->type == PIXEL_TYPE_UNORM8)
+            {
+                // Alpha is never sRGB encoded.
+                if (format->srgb && c == 3)
+                    channel |= KHR_DF_SAMPLE_DATATYPE_LINEAR;
+
+                write_sample(dfd, c * bits, bits, channel, 0, 255);
+            }
+            else
+                write_sample(dfd, c * bits, bits, channel | KHR_DF_SAMPLE_DATATYPE_SIGNED | KHR_DF_SAMPLE_DATATYPE_FLOAT, KHR_DF_FLOAT_MINUS_ONE, KHR_DF_FLOAT_ONE);
+        }
+    }
+    else if (format->compression == COMPRESSION_BC6)
+        write_sample(dfd, 0, 128, format->block_channels[0] | KHR_DF_SAMPLE_DATATYPE_FLOAT, KHR_DF_FLOAT_ZERO, KHR_DF_FLOAT_INFINITY);
+    else if (format->block_channels[1] == KHR_DF_CHANNEL_NONE)
+        write_sample(dfd, 0, block_size * 8, format->block_channels[0], 0, 0xFFFFFFFFu);
+    else
+    {
+        write_sample(dfd, 0, 64, format->block_channels[0], 0, 0xFFFFFFFFu);
+        write_sample(dfd, 64, 64, format->block_channels[1], 0, 0xFFFFFFFFu);
+    }
+
+    const uint32_t descriptor_size = uint32_t(dfd.size() - 1) * sizeof(uint32_t);
+
+    dfd[0] = uint32_t(dfd.size()) * sizeof(uint32_t);
+    dfd[2] = 2 | (descriptor_size << 16);
+
+    return true;
+}
+} // namespace ast
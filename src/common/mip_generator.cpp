@@ -0,0 +1,578 @@
+#include <common/mip_generator.h>
+#include <common/half.h>
+#include <common/parallel.h>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+#define MIP_ROWS_PER_BAND 16
+#define KAISER_WIDTH 3.0f
+#define KAISER_ALPHA 4.0f
+#define ALPHA_SCALE_ITERATIONS 10
+
+namespace ast
+{
+static const float kPi = 3.14159265359f;
+
+static float srgb_to_linear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+struct SRGBTables
+{
+    float to_linear[256];
+    float thresholds[256]; // Linear value halfway between two consecutive sRGB codes, the last entry is never reached.
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            to_linear[i]  = srgb_to_linear(i / 255.0f);
+            thresholds[i] = i < 255 ? srgb_to_linear((i + 0.5f) / 255.0f) : INFINITY;
+        }
+    }
+};
+
+static const SRGBTables kSRGB;
+
+// Binary search over the code midpoints, which rounds in sRGB space without evaluating pow per channel.
+static inline uint8_t linear_to_srgb8(float value)
+{
+    int code = 0;
+
+    for (int step = 128; step > 0; step >>= 1)
+    {
+        if (value >= kSRGB.thresholds[code + step - 1])
+            code += step;
+    }
+
+    return uint8_t(code);
+}
+
+static inline uint8_t float_to_unorm8(float value)
+{
+    return uint8_t(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+static float bessel0(float x)
+{
+    float sum  = 1.0f;
+    float term = 1.0f;
+
+    for (int k = 1; k < 64 && term > sum * 1e-8f; k++)
+    {
+        float t = x / (2.0f * k);
+        term *= t * t;
+        sum += term;
+    }
+
+    return sum;
+}
+
+static float kaiser(float x)
+{
+    if (fabsf(x) >= KAISER_WIDTH)
+        return 0.0f;
+
+    float t    = x / KAISER_WIDTH;
+    float sinc = x == 0.0f ? 1.0f : sinf(kPi * x) / (kPi * x);
+
+    return sinc * bessel0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / bessel0(KAISER_ALPHA);
+}
+
+// A fixed number of taps per output sample. Indices are clamped to the source so edges never read outside the image.
+struct FilterTaps
+{
+    int                count = 0;
+    std::vector<int>   index;
+    std::vector<float> weights;
+};
+
+static void build_taps(FilterTaps& taps, int src_size, int dst_size, MipFilter filter)
+{
+    const float scale   = float(src_size) / float(dst_size);
+    const float support = (filter == MIP_FILTER_KAISER ? KAISER_WIDTH : 0.5f) * scale;
+
+    taps.count = 0;
+
+    for (int x = 0; x < dst_size; x++)
+    {
+        float center = (x + 0.5f) * scale;
+        taps.count   = std::max(taps.count, int(ceilf(center + support)) - int(floorf(center - support)));
+    }
+
+    taps.index.resize(size_t(dst_size) * taps.count);
+    taps.weights.resize(size_t(dst_size) * taps.count);
+
+    for (int x = 0; x < dst_size; x++)
+    {
+        const float center  = (x + 0.5f) * scale;
+        const int   first   = int(floorf(center - support));
+        int*        index   = &taps.index[size_t(x) * taps.count];
+        float*      weights = &taps.weights[size_t(x) * taps.count];
+        float       total   = 0.0f;
+
+        for (int k = 0; k < taps.count; k++)
+        {
+            int i = first + k;
+
+            // The box weight is the overlap of the source texel with the footprint of the destination texel.
+            if (filter == MIP_FILTER_KAISER)
+                weights[k] = kaiser((i + 0.5f - center) / scale);
+            else
+                weights[k] = std::max(0.0f, std::min(float(i + 1), center + support) - std::max(float(i), center - support));
+
+            index[k] = std::min(std::max(i, 0), src_size - 1);
+            total += weights[k];
+        }
+
+        for (int k = 0; k < taps.count; k++)
+            weights[k] /= total;
+    }
+}
+
+struct MipSource
+{
+    const void*  data;
+    const float* values; // Set when the level can be read in place, otherwise rows are decoded through data.
+    const float* decode; // UNORM8 to float table per channel.
+    PixelType    type;
+    int          width;
+    int          height;
+    int          components;
+    bool         packed_normals; // Channels 0-2 are stored as 0..1 and unpacked to -1..1 on decode.
+};
+
+static void decode_row(const MipSource& src, int y, float* dst)
+{
+    const size_t count = size_t(src.width) * src.components;
+
+    if (src.type == PIXEL_TYPE_UNORM8)
+    {
+        const uint8_t* row = (const uint8_t*)src.data + y * count;
+
+        for (size_t i = 0; i < count; i += src.components)
+        {
+            for (int c = 0; c < src.components; c++)
+                dst[i + c] = src.decode[c * 256 + row[i + c]];
+        }
+
+        return;
+    }
+
+    if (src.type == PIXEL_TYPE_FLOAT16)
+        half_to_float((const uint16_t*)src.data + y * count, dst, count);
+    else
+        memcpy(dst, (const float*)src.data + y * count, count * sizeof(float));
+
+    if (src.packed_normals)
+    {
+        for (size_t i = 0; i < count; i += src.components)
+        {
+            for (int c = 0; c < std::min(src.components, 3); c++)
+                dst[i + c] = dst[i + c] * 2.0f - 1.0f;
+        }
+    }
+}
+
+static void accumulate_row(float* dst, const float* src, float weight, int count)
+{
+    int i = 0;
+
+#if defined(__AVX2__)
+    const __m256 w8 = _mm256_set1_ps(weight);
+
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), w8, _mm256_loadu_ps(dst + i)));
+#elif defined(__SSE4_1__)
+    const __m128 w4 = _mm_set1_ps(weight);
+
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), w4)));
+#endif
+
+    for (; i < count; i++)
+        dst[i] += src[i] * weight;
+}
+
+static void filter_row(const float* src, const FilterTaps& taps, int dst_width, int components, float* dst)
+{
+    const int*   index   = taps.index.data();
+    const float* weights = taps.weights.data();
+
+#if defined(__SSE4_1__)
+    if (components == 4)
+    {
+        for (int x = 0; x < dst_width; x++, index += taps.count, weights += taps.count)
+        {
+            __m128 sum = _mm_setzero_ps();
+
+            for (int k = 0; k < taps.count; k++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(src + index[k] * 4), _mm_set1_ps(weights[k])));
+
+            _mm_storeu_ps(dst + x * 4, sum);
+        }
+
+        return;
+    }
+#endif
+
+    for (int x = 0; x < dst_width; x++, index += taps.count, weights += taps.count)
+    {
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        for (int k = 0; k < taps.count; k++)
+        {
+            for (int c = 0; c < components; c++)
+                sum[c] += src[index[k] * components + c] * weights[k];
+        }
+
+        for (int c = 0; c < components; c++)
+            dst[x * components + c] = sum[c];
+    }
+}
+
+static void renormalize_row(float* row, int width, int components)
+{
+    for (int x = 0; x < width; x++, row += components)
+    {
+        float len = sqrtf(row[0] * row[0] + row[1] * row[1] + row[2] * row[2]);
+
+        if (len > 0.0f)
+        {
+            row[0] /= len;
+            row[1] /= len;
+            row[2] /= len;
+        }
+        else
+        {
+            row[0] = 0.0f;
+            row[1] = 0.0f;
+            row[2] = 1.0f;
+        }
+    }
+}
+
+// Vertical pass first so the horizontal pass only runs on the already halved row count. Rows are processed in bands
+// so every decoded source row is shared by all destination rows of the band.
+static void filter_level(const MipSource& src, MipFilter filter, bool renormalize, int dst_width, int dst_height, float* dst)
+{
+    FilterTaps taps_x;
+    FilterTaps taps_y;
+
+    build_taps(taps_x, src.width, dst_width, filter);
+    build_taps(taps_y, src.height, dst_height, filter);
+
+    const int row_length = src.width * src.components;
+    const int bands      = (dst_height + MIP_ROWS_PER_BAND - 1) / MIP_ROWS_PER_BAND;
+
+    parallel_for(0, bands, [&](int32_t band) {
+        const int y_begin = band * MIP_ROWS_PER_BAND;
+        const int y_end   = std::min(dst_height, y_begin + MIP_ROWS_PER_BAND);
+        const int first   = taps_y.index[size_t(y_begin) * taps_y.count];
+        const int last    = taps_y.index[size_t(y_end) * taps_y.count - 1];
+
+        std::vector<float> decoded;
+        std::vector<float> column(row_length);
+
+        if (!src.values)
+        {
+            decoded.resize(size_t(last - first + 1) * row_length);
+
+            for (int y = first; y <= last; y++)
+                decode_row(src, y, &decoded[size_t(y - first) * row_length]);
+        }
+
+        for (int y = y_begin; y < y_end; y++)
+        {
+            const int*   index   = &taps_y.index[size_t(y) * taps_y.count];
+            const float* weights = &taps_y.weights[size_t(y) * taps_y.count];
+
+            std::fill(column.begin(), column.end(), 0.0f);
+
+            for (int k = 0; k < taps_y.count; k++)
+            {
+                if (weights[k] == 0.0f)
+                    continue;
+
+                const float* row = src.values ? src.values + size_t(index[k]) * row_length : &decoded[size_t(index[k] - first) * row_length];
+                accumulate_row(column.data(), row, weights[k], row_length);
+            }
+
+            float* out = dst + size_t(y) * dst_width * src.components;
+
+            filter_row(column.data(), taps_x, dst_width, src.components, out);
+
+            if (renormalize && src.components >= 3)
+                renormalize_row(out, dst_width, src.components);
+        }
+    });
+}
+
+static float alpha_coverage(const MipSource& src, float scale, float reference)
+{
+    std::vector<uint32_t> covered(src.height, 0);
+
+    parallel_for(0, src.height, [&](int32_t y) {
+        std::vector<float> decoded;
+        const float*       row;
+
+        if (src.values)
+            row = src.values + size_t(y) * src.width * src.components;
+        else
+        {
+            decoded.resize(size_t(src.width) * src.components);
+            decode_row(src, y, decoded.data());
+            row = decoded.data();
+        }
+
+        for (int x = 0; x < src.width; x++)
+        {
+            if (row[x * src.components + 3] * scale > reference)
+                covered[y]++;
+        }
+    });
+
+    uint64_t total = 0;
+
+    for (uint32_t count : covered)
+        total += count;
+
+    return float(total) / (float(src.width) * float(src.height));
+}
+
+// Bisects the alpha scale that brings the coverage of the level closest to the coverage of mip 0.
+static float find_alpha_scale(const MipSource& level, float target, float reference)
+{
+    float min_scale  = 0.0f;
+    float max_scale  = 4.0f;
+    float scale      = 1.0f;
+    float best_scale = 1.0f;
+    float best_error = INFINITY;
+
+    // Coverage is a step function of the scale, so keep the closest tested scale rather than the last midpoint.
+    for (int i = 0; i < ALPHA_SCALE_ITERATIONS; i++)
+    {
+        float coverage = alpha_coverage(level, scale, reference);
+
+        if (fabsf(coverage - target) < best_error)
+        {
+            best_error = fabsf(coverage - target);
+            best_scale = scale;
+        }
+
+        if (coverage < target)
+        {
+            min_scale = scale;
+            scale     = (scale + max_scale) * 0.5f;
+        }
+        else
+        {
+            max_scale = scale;
+            scale     = (min_scale + scale) * 0.5f;
+        }
+    }
+
+    return best_scale;
+}
+
+static void store_level(const float* values, int width, int height, int components, PixelType type, bool srgb, bool normal_map, float alpha_scale, void* dst)
+{
+    const size_t row_length = size_t(width) * components;
+
+    parallel_for(0, height, [&](int32_t y) {
+        const float* src = values + y * row_length;
+
+        if (type == PIXEL_TYPE_UNORM8)
+        {
+            uint8_t* out = (uint8_t*)dst + y * row_length;
+
+            for (size_t i = 0; i < row_length; i += components)
+            {
+                for (int c = 0; c < components; c++)
+                {
+                    if (c == 3)
+                        out[i + c] = float_to_unorm8(src[i + c] * alpha_scale);
+                    else if (normal_map)
+                        out[i + c] = float_to_unorm8(src[i + c] * 0.5f + 0.5f);
+                    else if (srgb)
+                        out[i + c] = linear_to_srgb8(src[i + c]);
+                    else
+                        out[i + c] = float_to_unorm8(src[i + c]);
+                }
+            }
+
+            return;
+        }
+
+        std::vector<float> row(src, src + row_length);
+
+        for (size_t i = 0; i < row_length; i += components)
+        {
+            for (int c = 0; c < components; c++)
+            {
+                if (c == 3)
+                    row[i + c] *= alpha_scale;
+                else if (normal_map)
+                    row[i + c] = row[i + c] * 0.5f + 0.5f;
+            }
+        }
+
+        if (type == PIXEL_TYPE_FLOAT16)
+            float_to_half(row.data(), (uint16_t*)dst + y * row_length, row_length);
+        else
+            memcpy((float*)dst + y * row_length, row.data(), row_length * sizeof(float));
+    });
+}
+
+int mip_chain_length(int width, int height)
+{
+    int levels = 1;
+
+    while (width > 1 && height > 1 && levels < 16)
+    {
+        width /= 2;
+        height /= 2;
+        levels++;
+    }
+
+    return levels;
+}
+
+bool generate_mips(Image& image, const MipGenerationOptions& options)
+{
+    if (image.type != PIXEL_TYPE_UNORM8 && image.type != PIXEL_TYPE_FLOAT16 && image.type != PIXEL_TYPE_FLOAT32)
+    {
+        std::cout << "ERROR::Unsupported pixel type for mip generation: " << image.type << std::endl;
+        return false;
+    }
+
+    if (image.compression != COMPRESSION_NONE)
+    {
+        std::cout << "ERROR::Cannot generate mips for block compressed images" << std::endl;
+        return false;
+    }
+
+    if (image.components < 1 || image.components > 4 || image.array_slices < 1 || image.mip_slices < 1)
+    {
+        std::cout << "ERROR::Image must contain at least one miplevel" << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < image.array_slices; i++)
+    {
+        if (!image.data[i][0].data)
+        {
+            std::cout << "ERROR::Image must contain at least one miplevel" << std::endl;
+            return false;
+        }
+    }
+
+    int levels = mip_chain_length(image.data[0][0].width, image.data[0][0].height);
+
+    if (options.mip_levels > 0)
+        levels = std::min(levels, options.mip_levels);
+
+    const bool  srgb         = options.srgb && !options.normal_map && image.type == PIXEL_TYPE_UNORM8;
+    const bool  use_coverage = options.alpha_coverage > 0.0f && image.components == 4;
+    const float reference    = options.alpha_coverage;
+
+    std::vector<float> decode(4 * 256);
+
+    for (int c = 0; c < 4; c++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            if (c < 3 && options.normal_map)
+                decode[c * 256 + i] = i / 255.0f * 2.0f - 1.0f;
+            else if (c < 3 && srgb)
+                decode[c * 256 + i] = kSRGB.to_linear[i];
+            else
+                decode[c * 256 + i] = i / 255.0f;
+        }
+    }
+
+    // The new chain lives in one contiguous allocation, mip 0 is copied over and everything else is filtered into place.
+    Image chain(image.type);
+
+    chain.name         = image.name;
+    chain.compression  = image.compression;
+    chain.cubemap      = image.cubemap;
+    chain.color_space  = image.color_space;
+    chain.components   = image.components;
+    chain.array_slices = image.array_slices;
+    chain.mip_slices   = levels;
+    chain.data.resize(image.data.size());
+
+    for (int i = 0; i < image.array_slices; i++)
+    {
+        int w = image.data[i][0].width;
+        int h = image.data[i][0].height;
+
+        for (int j = 0; j < levels; j++)
+        {
+            chain.data[i][j].width  = w;
+            chain.data[i][j].height = h;
+            chain.data[i][j].size   = size_t(w) * h * image.components * size_t(image.type);
+
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+    }
+
+    chain.allocate_storage();
+
+    for (int i = 0; i < image.array_slices; i++)
+        memcpy(chain.data[i][0].data, image.data[i][0].data, chain.data[i][0].size);
+
+    std::vector<float> level[2];
+
+    for (int i = 0; i < image.array_slices; i++)
+    {
+        MipSource src;
+
+        src.data           = chain.data[i][0].data;
+        src.values         = image.type == PIXEL_TYPE_FLOAT32 && !options.normal_map ? (const float*)src.data : nullptr;
+        src.decode         = decode.data();
+        src.type           = image.type;
+        src.width          = image.data[i][0].width;
+        src.height         = image.data[i][0].height;
+        src.components     = image.components;
+        src.packed_normals = options.normal_map;
+
+        const float target = use_coverage ? alpha_coverage(src, 1.0f, reference) : 0.0f;
+
+        for (int mip = 1; mip < levels; mip++)
+        {
+            const int dst_width  = std::max(1, src.width / 2);
+            const int dst_height = std::max(1, src.height / 2);
+
+            std::vector<float>& dst = level[mip & 1];
+            dst.resize(size_t(dst_width) * dst_height * image.components);
+
+            filter_level(src, options.filter, options.normal_map, dst_width, dst_height, dst.data());
+
+            // Later levels are filtered from the unquantized float chain, so rounding errors never accumulate.
+            src.values = dst.data();
+            src.width  = dst_width;
+            src.height = dst_height;
+
+            float alpha_scale = use_coverage ? find_alpha_scale(src, target, reference) : 1.0f;
+
+            store_level(dst.data(), dst_width, dst_height, image.components, image.type, srgb, options.normal_map, alpha_scale, chain.data[i][mip].data);
+        }
+    }
+
+    image = std::move(chain);
+
+    return true;
+}
+} // namespace ast
@@ -0,0 +1,249 @@
+#include <common/parallel.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ast
+{
+// Set on threads that are running a parallel_for body outside of a pool, nested loops then run inline instead of
+// spawning more threads.
+static thread_local bool g_in_parallel_region = false;
+
+// Pool and queue owned by the current thread if it is a TaskPool worker.
+static thread_local TaskPool* g_worker_pool  = nullptr;
+static thread_local uint32_t  g_worker_queue = 0;
+
+// Pool whose task the current thread is running, which also covers threads helping in TaskPool::wait.
+static thread_local TaskPool* g_task_pool = nullptr;
+
+uint32_t worker_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(int32_t begin, int32_t end, const std::function<void(int32_t)>& func)
+{
+    if (end <= begin)
+        return;
+
+    TaskPool* pool        = g_task_pool;
+    uint32_t  num_threads = std::min(pool ? pool->num_threads() : (g_in_parallel_region ? 1 : worker_count()), uint32_t(end - begin));
+
+    if (num_threads == 1)
+    {
+        for (int32_t i = begin; i < end; i++)
+            func(i);
+
+        return;
+    }
+
+    std::atomic<int32_t> next(begin);
+
+    // Inside a task, helpers are queued on the pool instead of new threads. Idle workers steal them while the calling
+    // task works through the indices itself, then runs other tasks until every helper has returned.
+    if (pool)
+    {
+        std::atomic<int32_t> helpers(int32_t(num_threads - 1));
+
+        auto helper = [&]() {
+            for (int32_t i = next++; i < end; i = next++)
+                func(i);
+
+            helpers--;
+        };
+
+        for (uint32_t i = 1; i < num_threads; i++)
+            pool->submit(helper);
+
+        for (int32_t i = next++; i < end; i = next++)
+            func(i);
+
+        pool->wait(helpers);
+
+        return;
+    }
+
+    auto worker = [&]() {
+        g_in_parallel_region = true;
+
+        for (int32_t i = next++; i < end; i = next++)
+            func(i);
+
+        g_in_parallel_region = false;
+    };
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t i = 1; i < num_threads; i++)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+TaskPool::TaskPool(uint32_t num_threads) :
+    m_queued(0), m_pending(0), m_next_queue(0), m_joining(0)
+{
+    const uint32_t count = num_threads > 0 ? num_threads : worker_count();
+
+    for (uint32_t i = 0; i < count; i++)
+        m_queues.emplace_back(new Queue());
+
+    for (uint32_t i = 0; i < count; i++)
+        m_threads.emplace_back(&TaskPool::worker_main, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void TaskPool::submit(std::function<void()> task)
+{
+    const uint32_t queue = g_worker_pool == this ? g_worker_queue : m_next_queue++ % uint32_t(m_queues.size());
+
+    m_pending++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(std::move(task));
+    }
+
+    // Counted under the wake up mutex, so a worker can not check the count and go to sleep in between.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued++;
+    }
+
+    m_condition.notify_all();
+}
+
+bool TaskPool::pop(uint32_t queue, std::function<void()>& task)
+{
+    const uint32_t count = uint32_t(m_queues.size());
+
+    // The newest task of the own queue is likely to touch data that is still in cache.
+    {
+        Queue&                      own = *m_queues[queue % count];
+        std::lock_guard<std::mutex> lock(own.mutex);
+
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+
+            return true;
+        }
+    }
+
+    for (uint32_t i = 1; i < count; i++)
+    {
+        Queue&                      victim = *m_queues[(queue + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued--;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskPool::run(std::function<void()>& task)
+{
+    TaskPool* task_pool = g_task_pool;
+
+    g_task_pool = this;
+    task();
+    g_task_pool = task_pool;
+
+    task = nullptr;
+
+    // Joining threads wait for a counter the task may have just decremented.
+    if (--m_pending == 0 || m_joining > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_condition.notify_all();
+    }
+}
+
+void TaskPool::worker_main(uint32_t index)
+{
+    g_worker_pool  = this;
+    g_worker_queue = index;
+
+    std::function<void()> task;
+
+    while (true)
+    {
+        if (pop(index, task))
+        {
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&]() { return m_stop || m_queued > 0; });
+
+        if (m_stop && m_queued == 0)
+            return;
+    }
+}
+
+void TaskPool::wait()
+{
+    std::function<void()> task;
+
+    while (m_pending > 0)
+    {
+        if (pop(g_worker_pool == this ? g_worker_queue : 0, task))
+        {
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&]() { return m_pending == 0 || m_queued > 0; });
+    }
+}
+
+void TaskPool::wait(const std::atomic<int32_t>& counter)
+{
+    std::function<void()> task;
+
+    m_joining++;
+
+    while (counter > 0)
+    {
+        if (pop(g_worker_pool == this ? g_worker_queue : 0, task))
+        {
+            run(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [&]() { return counter == 0 || m_queued > 0; });
+    }
+
+    m_joining--;
+}
+} // namespace ast
@@ -0,0 +1,445 @@
+#include <common/sh.h>
+#include <common/cubemap.h>
+#include <common/parallel.h>
+#include <common/simd.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <math.h>
+
+#define SH_ROWS_PER_TASK 16
+
+namespace ast
+{
+static const double kPi = 3.14159265358979323846;
+
+// Face local texel directions and solid angles. They only depend on the face size, every face is a rotation of the
+// same grid, so one table covers all six faces.
+struct SHTexelTable
+{
+    int                size;
+    std::vector<float> s;      // Normalized direction in the (U, V, N) frame of a face.
+    std::vector<float> t;
+    std::vector<float> n;
+    std::vector<float> weight; // Solid angle, scaled so the six faces integrate to exactly 4 pi.
+};
+
+static double area_integral(double x, double y)
+{
+    return atan2(x * y, sqrt(x * x + y * y + 1.0));
+}
+
+static std::unique_ptr<SHTexelTable> build_texel_table(int size)
+{
+    std::unique_ptr<SHTexelTable> table(new SHTexelTable());
+
+    const size_t count = size_t(size) * size;
+
+    table->size = size;
+    table->s.resize(count);
+    table->t.resize(count);
+    table->n.resize(count);
+    table->weight.resize(count);
+
+    const double texel = 2.0 / size;
+    double       total = 0.0;
+
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            const double s  = (x + 0.5) * texel - 1.0;
+            const double t  = (y + 0.5) * texel - 1.0;
+            const double x0 = s - 0.5 * texel;
+            const double y0 = t - 0.5 * texel;
+            const double x1 = s + 0.5 * texel;
+            const double y1 = t + 0.5 * texel;
+
+            const double solid_angle = area_integral(x0, y0) - area_integral(x0, y1) - area_integral(x1, y0) + area_integral(x1, y1);
+            const double inv_len     = 1.0 / sqrt(s * s + t * t + 1.0);
+            const size_t i           = size_t(y) * size + x;
+
+            table->s[i]      = float(s * inv_len);
+            table->t[i]      = float(t * inv_len);
+            table->n[i]      = float(inv_len);
+            table->weight[i] = float(solid_angle);
+
+            total += solid_angle;
+        }
+    }
+
+    const float scale = float(4.0 * kPi / (6.0 * total));
+
+    for (float& w : table->weight)
+        w *= scale;
+
+    return table;
+}
+
+static const SHTexelTable& texel_table(int size)
+{
+    static std::mutex                                   mutex;
+    static std::map<int, std::unique_ptr<SHTexelTable>> tables;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unique_ptr<SHTexelTable>& table = tables[size];
+
+    if (!table)
+        table = build_texel_table(size);
+
+    return *table;
+}
+
+struct SHRow
+{
+    const float* s;
+    const float* t;
+    const float* n;
+    const float* weight;
+    const float* rgb[3];
+};
+
+// Real SH basis with the Condon-Shortley phase, so odd m are negated. Bands above order are skipped.
+template <typename L>
+static inline void evaluate_basis(typename L::Type x, typename L::Type y, typename L::Type z, int order, typename L::Type* basis)
+{
+    typedef typename L::Type V;
+
+    basis[0] = L::set(0.282095f);
+
+    if (order < 2)
+        return;
+
+    basis[1] = L::mul(L::set(-0.488603f), y);
+    basis[2] = L::mul(L::set(0.488603f), z);
+    basis[3] = L::mul(L::set(-0.488603f), x);
+
+    if (order < 3)
+        return;
+
+    const V xx = L::mul(x, x);
+    const V yy = L::mul(y, y);
+    const V zz = L::mul(z, z);
+
+    basis[4] = L::mul(L::set(1.092548f), L::mul(x, y));
+    basis[5] = L::mul(L::set(-1.092548f), L::mul(y, z));
+    basis[6] = L::sub(L::mul(L::set(0.946176f), zz), L::set(0.315392f));
+    basis[7] = L::mul(L::set(-1.092548f), L::mul(x, z));
+    basis[8] = L::mul(L::set(0.546274f), L::sub(xx, yy));
+
+    if (order < 4)
+        return;
+
+    const V xx3_yy = L::sub(L::mul(L::set(3.0f), xx), yy);
+    const V xx_yy3 = L::sub(xx, L::mul(L::set(3.0f), yy));
+    const V zz5_1  = L::sub(L::mul(L::set(5.0f), zz), L::set(1.0f));
+
+    basis[9]  = L::mul(L::set(-0.590044f), L::mul(y, xx3_yy));
+    basis[10] = L::mul(L::set(2.890611f), L::mul(L::mul(x, y), z));
+    basis[11] = L::mul(L::set(-0.457046f), L::mul(y, zz5_1));
+    basis[12] = L::mul(L::set(0.373176f), L::mul(z, L::sub(L::mul(L::set(5.0f), zz), L::set(3.0f))));
+    basis[13] = L::mul(L::set(-0.457046f), L::mul(x, zz5_1));
+    basis[14] = L::mul(L::set(1.445306f), L::mul(z, L::sub(xx, yy)));
+    basis[15] = L::mul(L::set(-0.590044f), L::mul(x, xx_yy3));
+
+    if (order < 5)
+        return;
+
+    const V zz7_1 = L::sub(L::mul(L::set(7.0f), zz), L::set(1.0f));
+    const V zz7_3 = L::sub(L::mul(L::set(7.0f), zz), L::set(3.0f));
+
+    basis[16] = L::mul(L::set(2.503343f), L::mul(L::mul(x, y), L::sub(xx, yy)));
+    basis[17] = L::mul(L::set(-1.770131f), L::mul(L::mul(y, z), xx3_yy));
+    basis[18] = L::mul(L::set(0.946175f), L::mul(L::mul(x, y), zz7_1));
+    basis[19] = L::mul(L::set(-0.669047f), L::mul(L::mul(y, z), zz7_3));
+    basis[20] = L::mul(L::set(0.105786f), L::add(L::mul(zz, L::sub(L::mul(L::set(35.0f), zz), L::set(30.0f))), L::set(3.0f)));
+    basis[21] = L::mul(L::set(-0.669047f), L::mul(L::mul(x, z), zz7_3));
+    basis[22] = L::mul(L::set(0.473087f), L::mul(L::sub(xx, yy), zz7_1));
+    basis[23] = L::mul(L::set(-1.770131f), L::mul(L::mul(x, z), xx_yy3));
+    basis[24] = L::mul(L::set(0.625836f), L::sub(L::mul(xx, xx_yy3), L::mul(yy, xx3_yy)));
+}
+
+// Accumulates texels [begin, end) of a row. frame holds the world space U, V and N axes of the face.
+template <typename L>
+static int accumulate_row(const SHRow& row, const float (*frame)[3], int order, int begin, int end, typename L::Type* acc)
+{
+    typedef typename L::Type V;
+
+    const int count = order * order;
+
+    int i = begin;
+
+    for (; i + L::kWidth <= end; i += L::kWidth)
+    {
+        const V s = L::load(row.s + i);
+        const V t = L::load(row.t + i);
+        const V n = L::load(row.n + i);
+
+        V d[3];
+
+        for (int c = 0; c < 3; c++)
+            d[c] = L::add(L::add(L::mul(s, L::set(frame[0][c])), L::mul(t, L::set(frame[1][c]))), L::mul(n, L::set(frame[2][c])));
+
+        V basis[SH_MAX_COEFFICIENTS];
+        evaluate_basis<L>(d[0], d[1], d[2], order, basis);
+
+        const V w = L::load(row.weight + i);
+
+        V color[3];
+
+        for (int c = 0; c < 3; c++)
+            color[c] = L::mul(L::load(row.rgb[c] + i), w);
+
+        for (int k = 0; k < count; k++)
+        {
+            for (int c = 0; c < 3; c++)
+                acc[k * 3 + c] = L::add(acc[k * 3 + c], L::mul(basis[k], color[c]));
+        }
+    }
+
+    return i;
+}
+
+// Combines the per-task partial sums in task order, so results do not depend on thread timing.
+static void reduce_partials(const std::vector<std::array<double, SH_MAX_COEFFICIENTS * 3>>& partials, SHCoefficients& coefficients)
+{
+    const int count = coefficients.order * coefficients.order;
+
+    for (int k = 0; k < SH_MAX_COEFFICIENTS; k++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            double sum = 0.0;
+
+            if (k < count)
+            {
+                for (const std::array<double, SH_MAX_COEFFICIENTS * 3>& partial : partials)
+                    sum += partial[k * 3 + c];
+            }
+
+            coefficients.c[k][c] = float(sum);
+        }
+    }
+}
+
+void sh_basis(const float* dir, int order, float* basis)
+{
+    evaluate_basis<ScalarLanes>(dir[0], dir[1], dir[2], std::min(std::max(order, 1), SH_MAX_ORDER), basis);
+}
+
+bool project_sh(const Image& cubemap, SHCoefficients& coefficients)
+{
+    if (cubemap.compression != COMPRESSION_NONE || cubemap.array_slices != 6 || cubemap.components < 3 || cubemap.data[0][0].width != cubemap.data[0][0].height)
+    {
+        std::cout << "ERROR::SH projection needs an uncompressed RGB cubemap with square faces!" << std::endl;
+        return false;
+    }
+
+    if (coefficients.order < 1 || coefficients.order > SH_MAX_ORDER)
+    {
+        std::cout << "ERROR::Unsupported SH order: " << coefficients.order << std::endl;
+        return false;
+    }
+
+    const int           size  = cubemap.data[0][0].width;
+    const SHTexelTable& table = texel_table(size);
+
+    float frames[6][3][3];
+
+    for (int face = 0; face < 6; face++)
+    {
+        float origin[3], right[3], down[3];
+
+        cubemap_direction(face, 0.0f, 0.0f, origin);
+        cubemap_direction(face, 1.0f, 0.0f, right);
+        cubemap_direction(face, 0.0f, 1.0f, down);
+
+        for (int c = 0; c < 3; c++)
+        {
+            frames[face][0][c] = right[c] - origin[c];
+            frames[face][1][c] = down[c] - origin[c];
+            frames[face][2][c] = origin[c];
+        }
+    }
+
+    const int blocks_per_face = (size + SH_ROWS_PER_TASK - 1) / SH_ROWS_PER_TASK;
+    const int num_tasks       = 6 * blocks_per_face;
+
+    // Every task owns its partial sums, they are combined in task order afterwards.
+    std::vector<std::array<double, SH_MAX_COEFFICIENTS * 3>> partials(num_tasks);
+
+    parallel_for(0, num_tasks, [&](int32_t task) {
+        const int face = task / blocks_per_face;
+        const int y0   = (task % blocks_per_face) * SH_ROWS_PER_TASK;
+        const int y1   = std::min(y0 + SH_ROWS_PER_TASK, size);
+
+        std::vector<float> texels(size_t(size) * cubemap.components);
+        std::vector<float> rgb(size_t(size) * 3);
+
+        WideLanes::Type   wide[SH_MAX_COEFFICIENTS * 3];
+        ScalarLanes::Type scalar[SH_MAX_COEFFICIENTS * 3];
+
+        for (int k = 0; k < SH_MAX_COEFFICIENTS * 3; k++)
+        {
+            wide[k]   = WideLanes::set(0.0f);
+            scalar[k] = 0.0f;
+        }
+
+        for (int y = y0; y < y1; y++)
+        {
+            const uint8_t* src = (const uint8_t*)cubemap.data[face][0].data + size_t(y) * size * cubemap.components * size_t(cubemap.type);
+
+            convert_pixels(src, cubemap.type, texels.data(), PIXEL_TYPE_FLOAT32, texels.size());
+
+            for (int x = 0; x < size; x++)
+            {
+                for (int c = 0; c < 3; c++)
+                    rgb[c * size + x] = texels[size_t(x) * cubemap.components + c];
+            }
+
+            SHRow row;
+
+            row.s      = &table.s[size_t(y) * size];
+            row.t      = &table.t[size_t(y) * size];
+            row.n      = &table.n[size_t(y) * size];
+            row.weight = &table.weight[size_t(y) * size];
+
+            for (int c = 0; c < 3; c++)
+                row.rgb[c] = &rgb[size_t(c) * size];
+
+            const int done = accumulate_row<WideLanes>(row, frames[face], coefficients.order, 0, size, wide);
+            accumulate_row<ScalarLanes>(row, frames[face], coefficients.order, done, size, scalar);
+        }
+
+        for (int k = 0; k < SH_MAX_COEFFICIENTS * 3; k++)
+            partials[task][k] = double(WideLanes::sum(wide[k])) + double(scalar[k]);
+    });
+
+    reduce_partials(partials, coefficients);
+
+    return true;
+}
+
+bool project_sh_latlong(const Image& latlong, SHCoefficients& coefficients)
+{
+    const int width  = latlong.data[0][0].width;
+    const int height = latlong.data[0][0].height;
+
+    if (latlong.compression != COMPRESSION_NONE || latlong.components < 3 || width != height * 2)
+    {
+        std::cout << "ERROR::SH projection needs an uncompressed RGB lat-long map with a 2:1 aspect ratio!" << std::endl;
+        return false;
+    }
+
+    if (coefficients.order < 1 || coefficients.order > SH_MAX_ORDER)
+    {
+        std::cout << "ERROR::Unsupported SH order: " << coefficients.order << std::endl;
+        return false;
+    }
+
+    // Directions are already in world space, so the rows are accumulated with an identity frame.
+    static const float kIdentity[3][3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+
+    // Columns share the azimuth, matching the u = (pi + atan2(x, z)) / (2 pi) mapping of latlong_to_cubemap.
+    std::vector<float> sin_phi(width);
+    std::vector<float> cos_phi(width);
+
+    for (int x = 0; x < width; x++)
+    {
+        const double phi = (x + 0.5) * 2.0 * kPi / width - kPi;
+
+        sin_phi[x] = float(sin(phi));
+        cos_phi[x] = float(cos(phi));
+    }
+
+    const int num_tasks = (height + SH_ROWS_PER_TASK - 1) / SH_ROWS_PER_TASK;
+
+    std::vector<std::array<double, SH_MAX_COEFFICIENTS * 3>> partials(num_tasks);
+
+    parallel_for(0, num_tasks, [&](int32_t task) {
+        const int y0 = task * SH_ROWS_PER_TASK;
+        const int y1 = std::min(y0 + SH_ROWS_PER_TASK, height);
+
+        std::vector<float> texels(size_t(width) * latlong.components);
+        std::vector<float> rgb(size_t(width) * 3);
+        std::vector<float> dir(size_t(width) * 3);
+        std::vector<float> weight(width);
+
+        WideLanes::Type   wide[SH_MAX_COEFFICIENTS * 3];
+        ScalarLanes::Type scalar[SH_MAX_COEFFICIENTS * 3];
+
+        for (int k = 0; k < SH_MAX_COEFFICIENTS * 3; k++)
+        {
+            wide[k]   = WideLanes::set(0.0f);
+            scalar[k] = 0.0f;
+        }
+
+        for (int y = y0; y < y1; y++)
+        {
+            // Every texel of a row covers the same solid angle, the exact area of its band divided by the width.
+            const double theta0      = y * kPi / height;
+            const double theta1      = (y + 1) * kPi / height;
+            const double theta       = (y + 0.5) * kPi / height;
+            const float  solid_angle = float(2.0 * kPi * (cos(theta0) - cos(theta1)) / width);
+            const float  sin_theta   = float(sin(theta));
+            const float  cos_theta   = float(cos(theta));
+
+            for (int x = 0; x < width; x++)
+            {
+                dir[x]             = sin_theta * sin_phi[x];
+                dir[width + x]     = cos_theta;
+                dir[2 * width + x] = sin_theta * cos_phi[x];
+                weight[x]          = solid_angle;
+            }
+
+            const uint8_t* src = (const uint8_t*)latlong.data[0][0].data + size_t(y) * width * latlong.components * size_t(latlong.type);
+
+            convert_pixels(src, latlong.type, texels.data(), PIXEL_TYPE_FLOAT32, texels.size());
+
+            for (int x = 0; x < width; x++)
+            {
+                for (int c = 0; c < 3; c++)
+                    rgb[c * width + x] = texels[size_t(x) * latlong.components + c];
+            }
+
+            SHRow row;
+
+            row.s      = &dir[0];
+            row.t      = &dir[width];
+            row.n      = &dir[2 * width];
+            row.weight = &weight[0];
+
+            for (int c = 0; c < 3; c++)
+                row.rgb[c] = &rgb[size_t(c) * width];
+
+            const int done = accumulate_row<WideLanes>(row, kIdentity, coefficients.order, 0, width, wide);
+            accumulate_row<ScalarLanes>(row, kIdentity, coefficients.order, done, width, scalar);
+        }
+
+        for (int k = 0; k < SH_MAX_COEFFICIENTS * 3; k++)
+            partials[task][k] = double(WideLanes::sum(wide[k])) + double(scalar[k]);
+    });
+
+    reduce_partials(partials, coefficients);
+
+    return true;
+}
+
+void sh_convolve_cosine(SHCoefficients& coefficients)
+{
+    // Zonal coefficients of the clamped cosine lobe. Bands above L2 hold almost no energy and odd bands are zero.
+    static const float kCosineLobe[SH_MAX_ORDER] = { 3.141593f, 2.094395f, 0.785398f, 0.0f, -0.130900f };
+
+    for (int l = 0; l < coefficients.order; l++)
+    {
+        for (int k = l * l; k < (l + 1) * (l + 1); k++)
+        {
+            for (int c = 0; c < 3; c++)
+                coefficients.c[k][c] *= kCosineLobe[l];
+        }
+    }
+}
+} // namespace ast
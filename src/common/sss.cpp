@@ -0,0 +1,227 @@
+#include <common/sss.h>
+#include <common/parallel.h>
+#include <common/simd.h>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+namespace ast
+{
+static const float kPi = 3.14159265359f;
+
+// Distance in standard deviations of the widest Gaussian after which the profile is treated as zero.
+static const float kProfileExtent = 4.0f;
+
+// Lowest curvature, a flat surface is integrated as a very large ring.
+static const float kMinCurvature = 1e-4f;
+
+static bool validate(const DiffusionProfile& profile, int size, int sample_count)
+{
+    if (profile.gaussians.empty() || size < 2 || sample_count < 2)
+    {
+        std::cout << "ERROR::Invalid diffusion profile or LUT size!" << std::endl;
+        return false;
+    }
+
+    for (const DiffusionGaussian& gaussian : profile.gaussians)
+    {
+        if (gaussian.variance <= 0.0f)
+        {
+            std::cout << "ERROR::Diffusion profile variances must be positive!" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void evaluate_profile(const DiffusionProfile& profile, float r, float* rgb)
+{
+    rgb[0] = rgb[1] = rgb[2] = 0.0f;
+
+    for (const DiffusionGaussian& gaussian : profile.gaussians)
+    {
+        const float g = expf(-r * r / (2.0f * gaussian.variance)) / (2.0f * kPi * gaussian.variance);
+
+        for (int c = 0; c < 3; c++)
+            rgb[c] += gaussian.weight[c] * g;
+    }
+}
+
+DiffusionProfile skin_diffusion_profile()
+{
+    DiffusionProfile profile;
+
+    profile.gaussians = {
+        { 0.0064f, { 0.233f, 0.455f, 0.649f } },
+        { 0.0484f, { 0.100f, 0.336f, 0.344f } },
+        { 0.187f, { 0.118f, 0.198f, 0.0f } },
+        { 0.567f, { 0.113f, 0.007f, 0.007f } },
+        { 1.99f, { 0.358f, 0.004f, 0.0f } },
+        { 7.41f, { 0.078f, 0.0f, 0.0f } }
+    };
+
+    return profile;
+}
+
+// Integrates texels [begin, end) of a row. The samples are angular offsets around the ring with their profile
+// weights, so every texel is a weighted sum of saturate(cos(theta + x)).
+template <typename L>
+static int integrate_row(const float* cos_x, const float* sin_x, const float* const* weights, int sample_count, const float* cos_theta, const float* sin_theta, int begin, int end, float* const* out)
+{
+    typedef typename L::Type V;
+
+    const V zero = L::set(0.0f);
+
+    int i = begin;
+
+    for (; i + L::kWidth <= end; i += L::kWidth)
+    {
+        const V ct = L::load(cos_theta + i);
+        const V st = L::load(sin_theta + i);
+
+        V sum[3] = { zero, zero, zero };
+
+        for (int j = 0; j < sample_count; j++)
+        {
+            const V irradiance = L::maximum(L::sub(L::mul(ct, L::set(cos_x[j])), L::mul(st, L::set(sin_x[j]))), zero);
+
+            for (int c = 0; c < 3; c++)
+                sum[c] = L::add(sum[c], L::mul(irradiance, L::set(weights[c][j])));
+        }
+
+        for (int c = 0; c < 3; c++)
+            L::store(out[c] + i, sum[c]);
+    }
+
+    return i;
+}
+
+bool generate_sss_lut(const DiffusionProfile& profile, Image& lut, const SSSLUTOptions& options)
+{
+    if (!validate(profile, options.size, options.sample_count))
+        return false;
+
+    const int size    = options.size;
+    const int samples = options.sample_count;
+
+    float max_variance = 0.0f;
+
+    for (const DiffusionGaussian& gaussian : profile.gaussians)
+        max_variance = std::max(max_variance, gaussian.variance);
+
+    const float extent = kProfileExtent * sqrtf(max_variance);
+
+    std::vector<float> cos_theta(size);
+    std::vector<float> sin_theta(size);
+
+    for (int x = 0; x < size; x++)
+    {
+        const float n_dot_l = float(x) / float(size - 1) * 2.0f - 1.0f;
+        const float theta   = acosf(n_dot_l);
+
+        cos_theta[x] = cosf(theta);
+        sin_theta[x] = sinf(theta);
+    }
+
+    lut.allocate(PIXEL_TYPE_FLOAT32, size, size, 3, 1, 1);
+
+    float* pixels = (float*)lut.data[0][0].data;
+
+    parallel_for(0, size, [&](int32_t y) {
+        const float curvature = std::max(float(y) / float(size - 1) * options.max_curvature, kMinCurvature);
+        const float radius    = 1.0f / curvature;
+
+        // Samples are spaced evenly in arc length, so narrow Gaussians stay resolved on large rings.
+        const float half_length = std::min(kPi * radius, extent);
+        const float step        = 2.0f * half_length / float(samples);
+
+        std::vector<float> cos_x(samples);
+        std::vector<float> sin_x(samples);
+        std::vector<float> weights[3];
+
+        for (int c = 0; c < 3; c++)
+            weights[c].resize(samples);
+
+        double total[3] = {};
+
+        for (int j = 0; j < samples; j++)
+        {
+            const float s = -half_length + (j + 0.5f) * step;
+            const float x = s / radius;
+
+            // Chord length between the shaded point and the sample on the ring.
+            float rgb[3];
+            evaluate_profile(profile, 2.0f * radius * sinf(0.5f * x), rgb);
+
+            cos_x[j] = cosf(x);
+            sin_x[j] = sinf(x);
+
+            for (int c = 0; c < 3; c++)
+            {
+                weights[c][j] = rgb[c];
+                total[c] += rgb[c];
+            }
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            const float scale = total[c] > 0.0 ? float(1.0 / total[c]) : 0.0f;
+
+            for (float& w : weights[c])
+                w *= scale;
+        }
+
+        std::vector<float> result(size_t(size) * 3);
+
+        const float* weight_ptrs[3] = { weights[0].data(), weights[1].data(), weights[2].data() };
+        float*       out_ptrs[3]    = { &result[0], &result[size], &result[size_t(2) * size] };
+
+        const int done = integrate_row<WideLanes>(cos_x.data(), sin_x.data(), weight_ptrs, samples, cos_theta.data(), sin_theta.data(), 0, size, out_ptrs);
+        integrate_row<ScalarLanes>(cos_x.data(), sin_x.data(), weight_ptrs, samples, cos_theta.data(), sin_theta.data(), done, size, out_ptrs);
+
+        // Curvature grows from the bottom row to the top one.
+        float* row = pixels + size_t(size - 1 - y) * size * 3;
+
+        for (int x = 0; x < size; x++)
+        {
+            for (int c = 0; c < 3; c++)
+                row[x * 3 + c] = out_ptrs[c][x];
+        }
+    });
+
+    return true;
+}
+
+bool generate_transmittance_lut(const DiffusionProfile& profile, Image& lut, const SSSLUTOptions& options)
+{
+    if (!validate(profile, options.transmittance_size, 2))
+        return false;
+
+    const int size = options.transmittance_size;
+
+    lut.allocate(PIXEL_TYPE_FLOAT32, size, 1, 3, 1, 1);
+
+    float* pixels = (float*)lut.data[0][0].data;
+
+    for (int x = 0; x < size; x++)
+    {
+        const float s = float(x) / float(size - 1) * options.max_thickness;
+
+        float rgb[3] = {};
+
+        for (const DiffusionGaussian& gaussian : profile.gaussians)
+        {
+            const float t = expf(-s * s / gaussian.variance);
+
+            for (int c = 0; c < 3; c++)
+                rgb[c] += gaussian.weight[c] * t;
+        }
+
+        for (int c = 0; c < 3; c++)
+            pixels[x * 3 + c] = rgb[c];
+    }
+
+    return true;
+}
+} // namespace ast
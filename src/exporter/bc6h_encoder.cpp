@@ -0,0 +1,820 @@
+#include <exporter/bc_encoder.h>
+#include <common/parallel.h>
+#include <common/half.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+namespace ast
+{
+// Shared with the BC7 encoder, BC6H uses the first 32 two subset partitions.
+extern const uint16_t kBC7Partitions2[64];
+extern const uint8_t  kBC7Anchors2[64];
+
+struct BC6HModeInfo
+{
+    uint16_t value;
+    int      regions;
+    bool     transformed;
+    int      endpoint_bits;
+    int      delta_bits[3];
+};
+
+static const BC6HModeInfo kBC6HModes[14] = {
+    { 0x00, 2, true, 10, { 5, 5, 5 } },
+    { 0x01, 2, true, 7, { 6, 6, 6 } },
+    { 0x02, 2, true, 11, { 5, 4, 4 } },
+    { 0x06, 2, true, 11, { 4, 5, 4 } },
+    { 0x0A, 2, true, 11, { 4, 4, 5 } },
+    { 0x0E, 2, true, 9, { 5, 5, 5 } },
+    { 0x12, 2, true, 8, { 6, 5, 5 } },
+    { 0x16, 2, true, 8, { 5, 6, 5 } },
+    { 0x1A, 2, true, 8, { 5, 5, 6 } },
+    { 0x1E, 2, false, 6, { 6, 6, 6 } },
+    { 0x03, 1, false, 10, { 10, 10, 10 } },
+    { 0x07, 1, true, 11, { 9, 9, 9 } },
+    { 0x0B, 1, true, 12, { 8, 8, 8 } },
+    { 0x0F, 1, true, 16, { 4, 4, 4 } }
+};
+
+static const uint32_t kBC6HOneRegionModes = (1 << 10) | (1 << 11) | (1 << 12) | (1 << 13);
+
+// Header bit layouts in the same order as kBC6HModes. Each entry is (field << 4) | bit, stored LSB first.
+// Fields: 0 = mode, 1 = partition, 2 + endpoint * 3 + channel = endpoint value (w, x, y, z as RGB).
+static const uint8_t kBC6HLayouts[14][82] = {
+    // Mode 0x00
+    {
+        0x00, 0x01, 0x94, 0xA4, 0xD4, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0xC4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x01
+    {
+        0x00, 0x01, 0x95, 0xC4, 0xC5, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0xD0, 0xD1, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0xA5, 0xD2, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0xD3, 0xD5, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x02
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0x2A, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x3A, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x4A, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x06
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x2A, 0xC4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x3A, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x4A, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0xD0, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0x94, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x0A
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x2A, 0xA4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x3A, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0x4A, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0xD1, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xD4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x0E
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0xC4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x12
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xC4, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0xD2, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0xD3, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x16
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xD0, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x95, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0xC5, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0xC4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0xD1, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x1A
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0xD1, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0xA5, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0xD5, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0xC4, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0xD0, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0xD2, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xD3, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x1E
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0xC4, 0xD0, 0xD1, 0xA4, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x95, 0xA5, 0xD2, 0x94, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0xC5,
+        0xD3, 0xD5, 0xD4, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x90, 0x91, 0x92, 0x93, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0xC0, 0xC1, 0xC2, 0xC3, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0xA0, 0xA1, 0xA2,
+        0xA3, 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0x10, 0x11, 0x12,
+        0x13, 0x14
+    },
+    // Mode 0x03
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+        0x79
+    },
+    // Mode 0x07
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x2A, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x3A, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+        0x4A
+    },
+    // Mode 0x0B
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x2B, 0x2A, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x3B, 0x3A, 0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x4B,
+        0x4A
+    },
+    // Mode 0x0F
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x30,
+        0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+        0x47, 0x48, 0x49, 0x50, 0x51, 0x52, 0x53, 0x2F, 0x2E, 0x2D, 0x2C, 0x2B, 0x2A, 0x60, 0x61, 0x62,
+        0x63, 0x3F, 0x3E, 0x3D, 0x3C, 0x3B, 0x3A, 0x70, 0x71, 0x72, 0x73, 0x4F, 0x4E, 0x4D, 0x4C, 0x4B,
+        0x4A
+    }
+};
+
+static const int kBC6HWeights3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int kBC6HWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Pixels are kept as unsigned half bit patterns, which is roughly logarithmic and matches the BC6H interpolation domain.
+struct alignas(32) BC6HBlock
+{
+    float c[3][16];
+};
+
+struct BC6HCandidate
+{
+    int     endpoints[2][2][3]; // Quantized [region][endpoint][channel], deltas already applied
+    uint8_t indices[16];
+    float   error;
+};
+
+static inline int bc6h_unquantize(int value, int bits)
+{
+    if (bits >= 15)
+        return value;
+    else if (value == 0)
+        return 0;
+    else if (value == (1 << bits) - 1)
+        return 0xFFFF;
+    else
+        return ((value << 16) + 0x8000) >> bits;
+}
+
+static inline int bc6h_finish_unquantize(int value)
+{
+    return (value * 31) >> 6;
+}
+
+static inline int bc6h_quantize(float value, int bits)
+{
+    const int max = (1 << bits) - 1;
+    const int q   = std::min(std::max(int(value * (64.0f / 31.0f) * float(1 << bits) / 65536.0f), 0), max);
+
+    // The estimate above can be one step off because of the rounding in the decoder, keep whichever reconstructs closer.
+    if (q < max && fabsf(float(bc6h_finish_unquantize(bc6h_unquantize(q + 1, bits))) - value) < fabsf(float(bc6h_finish_unquantize(bc6h_unquantize(q, bits))) - value))
+        return q + 1;
+
+    return q;
+}
+
+// Finds the closest palette entry for every pixel of a region. Anchor pixels are restricted to the lower half of
+// the palette since their most significant index bit is implicit.
+static float fit_region(const BC6HBlock& block, uint16_t region_mask, int anchor, const float palette[16][3], int palette_size, uint8_t* indices)
+{
+    alignas(32) float   dist[16];
+    alignas(32) int32_t idx[16];
+
+#if defined(__AVX2__)
+    for (int i = 0; i < 16; i += 8)
+    {
+        __m256 best     = _mm256_set1_ps(1e30f);
+        __m256 best_idx = _mm256_setzero_ps();
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            __m256 d = _mm256_setzero_ps();
+
+            for (int ch = 0; ch < 3; ch++)
+            {
+                __m256 diff = _mm256_sub_ps(_mm256_load_ps(block.c[ch] + i), _mm256_set1_ps(palette[p][ch]));
+                d           = _mm256_fmadd_ps(diff, diff, d);
+            }
+
+            __m256 mask = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+
+            best     = _mm256_blendv_ps(best, d, mask);
+            best_idx = _mm256_blendv_ps(best_idx, _mm256_castsi256_ps(_mm256_set1_epi32(p)), mask);
+        }
+
+        _mm256_store_ps(dist + i, best);
+        _mm256_store_si256((__m256i*)(idx + i), _mm256_castps_si256(best_idx));
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 best     = _mm_set1_ps(1e30f);
+        __m128 best_idx = _mm_setzero_ps();
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            __m128 d = _mm_setzero_ps();
+
+            for (int ch = 0; ch < 3; ch++)
+            {
+                __m128 diff = _mm_sub_ps(_mm_load_ps(block.c[ch] + i), _mm_set1_ps(palette[p][ch]));
+                d           = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+            }
+
+            __m128 mask = _mm_cmplt_ps(d, best);
+
+            best     = _mm_blendv_ps(best, d, mask);
+            best_idx = _mm_blendv_ps(best_idx, _mm_castsi128_ps(_mm_set1_epi32(p)), mask);
+        }
+
+        _mm_store_ps(dist + i, best);
+        _mm_store_si128((__m128i*)(idx + i), _mm_castps_si128(best_idx));
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        dist[i] = 1e30f;
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            float d = 0.0f;
+
+            for (int ch = 0; ch < 3; ch++)
+                d += (block.c[ch][i] - palette[p][ch]) * (block.c[ch][i] - palette[p][ch]);
+
+            if (d < dist[i])
+            {
+                dist[i] = d;
+                idx[i]  = p;
+            }
+        }
+    }
+#endif
+
+    float error = 0.0f;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (!((region_mask >> i) & 1))
+            continue;
+
+        if (i == anchor && idx[i] >= palette_size / 2)
+        {
+            dist[i] = 1e30f;
+
+            for (int p = 0; p < palette_size / 2; p++)
+            {
+                float d = 0.0f;
+
+                for (int ch = 0; ch < 3; ch++)
+                    d += (block.c[ch][i] - palette[p][ch]) * (block.c[ch][i] - palette[p][ch]);
+
+                if (d < dist[i])
+                {
+                    dist[i] = d;
+                    idx[i]  = p;
+                }
+            }
+        }
+
+        indices[i] = uint8_t(idx[i]);
+        error += dist[i];
+    }
+
+    return error;
+}
+
+// Fits a line through the region pixels and returns its extents, oriented so that the anchor lies nearer to the first endpoint.
+static void principal_axis_endpoints(const BC6HBlock& block, uint16_t region_mask, int anchor, float endpoints[2][3])
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    int   count   = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if ((region_mask >> i) & 1)
+        {
+            for (int ch = 0; ch < 3; ch++)
+                mean[ch] += block.c[ch][i];
+
+            count++;
+        }
+    }
+
+    for (int ch = 0; ch < 3; ch++)
+        mean[ch] /= float(count);
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        if ((region_mask >> i) & 1)
+        {
+            float r = block.c[0][i] - mean[0];
+            float g = block.c[1][i] - mean[1];
+            float b = block.c[2][i] - mean[2];
+
+            cov[0] += r * r;
+            cov[1] += r * g;
+            cov[2] += r * b;
+            cov[3] += g * g;
+            cov[4] += g * b;
+            cov[5] += b * b;
+        }
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+
+    for (int iter = 0; iter < 4; iter++)
+    {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float m = std::max(fabsf(x), std::max(fabsf(y), fabsf(z)));
+
+        if (m < 1e-6f)
+            break;
+
+        axis[0] = x / m;
+        axis[1] = y / m;
+        axis[2] = z / m;
+    }
+
+    float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+    for (int ch = 0; ch < 3; ch++)
+        axis[ch] /= len;
+
+    float t_min    = 1e30f;
+    float t_max    = -1e30f;
+    float t_anchor = 0.0f;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if ((region_mask >> i) & 1)
+        {
+            float t = (block.c[0][i] - mean[0]) * axis[0] + (block.c[1][i] - mean[1]) * axis[1] + (block.c[2][i] - mean[2]) * axis[2];
+
+            t_min = std::min(t_min, t);
+            t_max = std::max(t_max, t);
+
+            if (i == anchor)
+                t_anchor = t;
+        }
+    }
+
+    if (t_anchor - t_min > t_max - t_anchor)
+        std::swap(t_min, t_max);
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        endpoints[0][ch] = std::min(std::max(mean[ch] + axis[ch] * t_min, 0.0f), float(0x7BFF));
+        endpoints[1][ch] = std::min(std::max(mean[ch] + axis[ch] * t_max, 0.0f), float(0x7BFF));
+    }
+}
+
+// Least squares endpoints for the current indices of a region.
+static bool refine_endpoints(const BC6HBlock& block, uint16_t region_mask, const int* weights, const uint8_t* indices, float endpoints[2][3])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ap[3] = { 0.0f, 0.0f, 0.0f };
+    float bp[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (!((region_mask >> i) & 1))
+            continue;
+
+        float beta  = weights[indices[i]] / 64.0f;
+        float alpha = 1.0f - beta;
+
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+
+        for (int ch = 0; ch < 3; ch++)
+        {
+            ap[ch] += alpha * block.c[ch][i];
+            bp[ch] += beta * block.c[ch][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+
+    if (fabsf(det) < 1e-6f)
+        return false;
+
+    float inv_det = 1.0f / det;
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        endpoints[0][ch] = std::min(std::max((ap[ch] * bb - bp[ch] * ab) * inv_det, 0.0f), float(0x7BFF));
+        endpoints[1][ch] = std::min(std::max((bp[ch] * aa - ap[ch] * ab) * inv_det, 0.0f), float(0x7BFF));
+    }
+
+    return true;
+}
+
+// Quantizes the endpoints for a mode, applying the delta range of transformed modes. Returns false if a delta had to be clamped.
+static bool quantize_endpoints(const BC6HModeInfo& mode, const float endpoints[2][2][3], int quantized[2][2][3])
+{
+    bool      exact = true;
+    const int max   = (1 << mode.endpoint_bits) - 1;
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        const int base = bc6h_quantize(endpoints[0][0][ch], mode.endpoint_bits);
+
+        quantized[0][0][ch] = base;
+
+        for (int e = 1; e < mode.regions * 2; e++)
+        {
+            int q = bc6h_quantize(endpoints[e / 2][e % 2][ch], mode.endpoint_bits);
+
+            if (mode.transformed)
+            {
+                const int range = 1 << (mode.delta_bits[ch] - 1);
+                const int delta = std::min(std::max(q - base, std::max(-range, -base)), std::min(range - 1, max - base));
+
+                exact &= delta == q - base;
+                q = base + delta;
+            }
+
+            quantized[e / 2][e % 2][ch] = q;
+        }
+    }
+
+    return exact;
+}
+
+static float evaluate_mode(const BC6HBlock& block, const BC6HModeInfo& mode, int partition, const int quantized[2][2][3], BC6HCandidate& candidate)
+{
+    const int* weights      = mode.regions == 2 ? kBC6HWeights3 : kBC6HWeights4;
+    const int  palette_size = mode.regions == 2 ? 8 : 16;
+    const int  anchors[2]   = { 0, mode.regions == 2 ? kBC7Anchors2[partition] : -1 };
+    uint16_t   masks[2]     = { 0xFFFF, 0 };
+
+    if (mode.regions == 2)
+    {
+        masks[1] = kBC7Partitions2[partition];
+        masks[0] = uint16_t(~masks[1]);
+    }
+
+    memcpy(candidate.endpoints, quantized, sizeof(candidate.endpoints));
+    candidate.error = 0.0f;
+
+    for (int r = 0; r < mode.regions; r++)
+    {
+        int   unquantized[2][3];
+        float palette[16][3];
+
+        for (int e = 0; e < 2; e++)
+        {
+            for (int ch = 0; ch < 3; ch++)
+                unquantized[e][ch] = bc6h_unquantize(quantized[r][e][ch], mode.endpoint_bits);
+        }
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            for (int ch = 0; ch < 3; ch++)
+                palette[p][ch] = float(bc6h_finish_unquantize(((64 - weights[p]) * unquantized[0][ch] + weights[p] * unquantized[1][ch] + 32) >> 6));
+        }
+
+        candidate.error += fit_region(block, masks[r], anchors[r], palette, palette_size, candidate.indices);
+    }
+
+    return candidate.error;
+}
+
+static void encode_mode(const BC6HBlock& block, const BC6HModeInfo& mode, int partition, const BCSearchPreset& preset, const float initial[2][2][3], BC6HCandidate& best)
+{
+    const int* weights  = mode.regions == 2 ? kBC6HWeights3 : kBC6HWeights4;
+    uint16_t   masks[2] = { 0xFFFF, 0 };
+    float      endpoints[2][2][3];
+
+    if (mode.regions == 2)
+    {
+        masks[1] = kBC7Partitions2[partition];
+        masks[0] = uint16_t(~masks[1]);
+    }
+
+    memcpy(endpoints, initial, sizeof(endpoints));
+
+    BC6HCandidate local;
+    local.error = 1e30f;
+
+    for (int iter = 0; iter <= preset.refine_iterations; iter++)
+    {
+        int           quantized[2][2][3];
+        BC6HCandidate candidate;
+
+        // Without an exhaustive search, transformed modes whose deltas do not fit are left to the modes with more precision.
+        if (!quantize_endpoints(mode, endpoints, quantized) && !preset.exhaustive && iter == 0)
+            return;
+
+        if (evaluate_mode(block, mode, partition, quantized, candidate) < local.error)
+            local = candidate;
+        else
+            break;
+
+        if (local.error == 0.0f || iter == preset.refine_iterations)
+            break;
+
+        bool refined = true;
+
+        for (int r = 0; r < mode.regions; r++)
+            refined &= refine_endpoints(block, masks[r], weights, local.indices, endpoints[r]);
+
+        if (!refined)
+            break;
+    }
+
+    if (local.error < best.error)
+        best = local;
+}
+
+struct BC6HBitWriter
+{
+    uint8_t* data;
+    int      offset = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++, offset++)
+        {
+            if ((value >> i) & 1)
+                data[offset >> 3] |= uint8_t(1 << (offset & 7));
+        }
+    }
+};
+
+static void write_block(int mode_index, int partition, const BC6HCandidate& candidate, uint8_t* dst)
+{
+    const BC6HModeInfo& mode        = kBC6HModes[mode_index];
+    const int           header_bits = mode.regions == 2 ? 82 : 65;
+    const int           index_bits  = mode.regions == 2 ? 3 : 4;
+    const int           anchors[2]  = { 0, mode.regions == 2 ? kBC7Anchors2[partition] : 0 };
+
+    memset(dst, 0, 16);
+
+    BC6HBitWriter writer;
+    writer.data = dst;
+
+    for (int i = 0; i < header_bits; i++)
+    {
+        const int field = kBC6HLayouts[mode_index][i] >> 4;
+        const int bit   = kBC6HLayouts[mode_index][i] & 15;
+        uint32_t  value;
+
+        if (field == 0)
+            value = mode.value;
+        else if (field == 1)
+            value = uint32_t(partition);
+        else
+        {
+            const int endpoint = (field - 2) / 3;
+            const int channel  = (field - 2) % 3;
+            const int base     = candidate.endpoints[0][0][channel];
+
+            value = uint32_t(candidate.endpoints[endpoint / 2][endpoint % 2][channel]);
+
+            if (endpoint > 0 && mode.transformed)
+                value = uint32_t(int(value) - base) & ((1u << mode.delta_bits[channel]) - 1);
+        }
+
+        writer.write((value >> bit) & 1, 1);
+    }
+
+    for (int i = 0; i < 16; i++)
+        writer.write(candidate.indices[i], (i == anchors[0] || i == anchors[1]) ? index_bits - 1 : index_bits);
+}
+
+// Residual of fitting each region with a line, used to rank partitions before encoding them.
+static float estimate_partition_error(const BC6HBlock& block, uint16_t mask)
+{
+    float error = 0.0f;
+
+    for (int r = 0; r < 2; r++)
+    {
+        uint16_t region_mask = r == 0 ? uint16_t(~mask) : mask;
+        float    endpoints[2][3];
+        float    axis[3];
+        float    len = 0.0f;
+
+        principal_axis_endpoints(block, region_mask, -1, endpoints);
+
+        for (int ch = 0; ch < 3; ch++)
+        {
+            axis[ch] = endpoints[1][ch] - endpoints[0][ch];
+            len += axis[ch] * axis[ch];
+        }
+
+        float inv_len = len > 0.0f ? 1.0f / len : 0.0f;
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (!((region_mask >> i) & 1))
+                continue;
+
+            float d[3];
+            float t = 0.0f;
+
+            for (int ch = 0; ch < 3; ch++)
+            {
+                d[ch] = block.c[ch][i] - endpoints[0][ch];
+                t += d[ch] * axis[ch];
+            }
+
+            t *= inv_len;
+
+            for (int ch = 0; ch < 3; ch++)
+            {
+                float r = d[ch] - axis[ch] * t;
+                error += r * r;
+            }
+        }
+    }
+
+    return error;
+}
+
+static void encode_bc6h_block(const BC6HBlock& block, const BCSearchPreset& preset, uint8_t* dst)
+{
+    BC6HCandidate best;
+    int           best_mode      = -1;
+    int           best_partition = 0;
+
+    best.error = 1e30f;
+
+    // One region modes. Mode 0x03 has no deltas so it always produces a valid encoding.
+    {
+        float endpoints[2][2][3];
+        principal_axis_endpoints(block, 0xFFFF, 0, endpoints[0]);
+
+        for (int mode_index = 10; mode_index < 14; mode_index++)
+        {
+            if (mode_index != 10 && !(preset.modes & (1 << mode_index)))
+                continue;
+
+            float error = best.error;
+            encode_mode(block, kBC6HModes[mode_index], 0, preset, endpoints, best);
+
+            if (best.error < error)
+                best_mode = mode_index;
+        }
+    }
+
+    const uint32_t two_region_modes = preset.modes & ~kBC6HOneRegionModes & 0x3FFF;
+
+    if (best.error > 0.0f && preset.max_partitions > 0 && two_region_modes)
+    {
+        int   order[32];
+        float estimates[32];
+
+        for (int p = 0; p < 32; p++)
+        {
+            order[p]     = p;
+            estimates[p] = estimate_partition_error(block, kBC7Partitions2[p]);
+        }
+
+        const int count = std::min(preset.max_partitions, 32);
+
+        std::partial_sort(order, order + count, order + 32, [&](int a, int b) { return estimates[a] < estimates[b]; });
+
+        for (int i = 0; i < count; i++)
+        {
+            const int      partition = order[i];
+            const uint16_t mask      = kBC7Partitions2[partition];
+            float          endpoints[2][2][3];
+
+            principal_axis_endpoints(block, uint16_t(~mask), 0, endpoints[0]);
+            principal_axis_endpoints(block, mask, kBC7Anchors2[partition], endpoints[1]);
+
+            for (int mode_index = 0; mode_index < 10; mode_index++)
+            {
+                if (!(two_region_modes & (1 << mode_index)))
+                    continue;
+
+                float error = best.error;
+                encode_mode(block, kBC6HModes[mode_index], partition, preset, endpoints, best);
+
+                if (best.error < error)
+                {
+                    best_mode      = mode_index;
+                    best_partition = partition;
+                }
+            }
+        }
+    }
+
+    write_block(best_mode, best_partition, best, dst);
+}
+
+BCSearchPreset bc6h_preset(const CompressionQuality& quality)
+{
+    BCSearchPreset preset;
+
+    if (quality == COMPRESSION_QUALITY_FAST)
+    {
+        preset.modes             = kBC6HOneRegionModes;
+        preset.max_partitions    = 0;
+        preset.refine_iterations = 1;
+        preset.exhaustive        = false;
+    }
+    else if (quality == COMPRESSION_QUALITY_NORMAL)
+    {
+        preset.modes             = 0x3FFF;
+        preset.max_partitions    = 8;
+        preset.refine_iterations = 1;
+        preset.exhaustive        = false;
+    }
+    else
+    {
+        preset.modes             = 0x3FFF;
+        preset.max_partitions    = 32;
+        preset.refine_iterations = 2;
+        preset.exhaustive        = true;
+    }
+
+    return preset;
+}
+
+void bc6h_encode(const BCSearchPreset& preset, const float* src, int width, int height, int components, void* dst)
+{
+    const int blocks_x = std::max(1, (width + 3) / 4);
+    const int blocks_y = std::max(1, (height + 3) / 4);
+
+    parallel_for(0, blocks_y, [&](int32_t by) {
+        uint8_t*  out = (uint8_t*)dst + size_t(by) * blocks_x * 16;
+        BC6HBlock block;
+
+        for (int bx = 0; bx < blocks_x; bx++, out += 16)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                int sy = std::min(by * 4 + y, height - 1);
+
+                for (int x = 0; x < 4; x++)
+                {
+                    int          sx = std::min(bx * 4 + x, width - 1);
+                    const float* p  = src + (size_t(sy) * width + sx) * components;
+
+                    for (int ch = 0; ch < 3; ch++)
+                    {
+                        float value = ch < components ? p[ch] : 0.0f;
+
+                        // Unsigned BC6H has no sign and the largest finite half is 0x7BFF.
+                        block.c[ch][y * 4 + x] = value > 0.0f ? float(std::min<uint16_t>(float_to_half(value), 0x7BFF)) : 0.0f;
+                    }
+                }
+            }
+
+            encode_bc6h_block(block, preset, out);
+        }
+    });
+}
+} // namespace ast
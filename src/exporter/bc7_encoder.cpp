@@ -0,0 +1,837 @@
+#include <exporter/bc_encoder.h>
+#include <common/parallel.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+namespace ast
+{
+struct BC7ModeInfo
+{
+    int subsets;
+    int partition_bits;
+    int color_bits;
+    int alpha_bits;
+    int pbits; // 0 = none, 1 = shared per subset, 2 = unique per endpoint
+    int index_bits;
+};
+
+// Modes 0, 2, 4 and 5 are decoded by every BC7 decoder but never emitted by this encoder.
+static const BC7ModeInfo kBC7Modes[8] = {
+    { 3, 4, 4, 0, 2, 3 },
+    { 2, 6, 6, 0, 1, 3 },
+    { 3, 6, 5, 0, 0, 2 },
+    { 2, 6, 7, 0, 2, 2 },
+    { 1, 0, 5, 6, 0, 2 },
+    { 1, 0, 7, 8, 0, 2 },
+    { 1, 0, 7, 7, 2, 4 },
+    { 2, 6, 5, 5, 2, 2 }
+};
+
+static const uint32_t kBC7SupportedModes = (1 << 1) | (1 << 3) | (1 << 6) | (1 << 7);
+
+// Bit i is set when pixel i belongs to the second subset.
+extern const uint16_t kBC7Partitions2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Anchor pixel of the second subset. The first subset is always anchored at pixel 0.
+extern const uint8_t kBC7Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15,
+    2, 8, 2, 2, 8, 8, 2, 2,
+    15, 15, 6, 8, 2, 8, 15, 15,
+    2, 8, 2, 2, 2, 15, 15, 6,
+    6, 2, 6, 8, 15, 15, 2, 2,
+    15, 15, 15, 15, 15, 2, 2, 15
+};
+
+static const int kBC7Weights2[4]  = { 0, 21, 43, 64 };
+static const int kBC7Weights3[8]  = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int kBC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const int* bc7_weights(int index_bits)
+{
+    return index_bits == 2 ? kBC7Weights2 : (index_bits == 3 ? kBC7Weights3 : kBC7Weights4);
+}
+
+struct alignas(32) BC7Block
+{
+    float c[4][16];
+};
+
+// Pixels of one subset gathered into SoA order and padded to a multiple of 8 for the SIMD fit.
+struct alignas(32) BC7Subset
+{
+    float   c[4][16];
+    uint8_t pixels[16];
+    int     count;
+};
+
+struct BC7SubsetResult
+{
+    int     endpoints[2][4]; // Quantized, without the p-bit
+    int     pbits[2];
+    uint8_t indices[16]; // Per subset pixel
+    float   error;
+};
+
+static void gather_subset(const BC7Block& block, uint16_t mask, bool second, BC7Subset& subset)
+{
+    subset.count = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (((mask >> i) & 1) == (second ? 1 : 0))
+        {
+            for (int ch = 0; ch < 4; ch++)
+                subset.c[ch][subset.count] = block.c[ch][i];
+
+            subset.pixels[subset.count++] = uint8_t(i);
+        }
+    }
+
+    for (int i = subset.count; i < 16; i++)
+    {
+        for (int ch = 0; ch < 4; ch++)
+            subset.c[ch][i] = subset.c[ch][0];
+    }
+}
+
+// Finds the closest palette entry for every pixel of the subset. Returns the summed squared error.
+static float fit_subset(const BC7Subset& subset, int channels, const float palette[16][4], int palette_size, uint8_t* indices)
+{
+    alignas(32) float   dist[16];
+    alignas(32) int32_t idx[16];
+
+#if defined(__AVX2__)
+    for (int i = 0; i < subset.count; i += 8)
+    {
+        __m256 best     = _mm256_set1_ps(1e30f);
+        __m256 best_idx = _mm256_setzero_ps();
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            __m256 d = _mm256_setzero_ps();
+
+            for (int ch = 0; ch < channels; ch++)
+            {
+                __m256 diff = _mm256_sub_ps(_mm256_load_ps(subset.c[ch] + i), _mm256_set1_ps(palette[p][ch]));
+                d           = _mm256_fmadd_ps(diff, diff, d);
+            }
+
+            __m256 mask = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+
+            best     = _mm256_blendv_ps(best, d, mask);
+            best_idx = _mm256_blendv_ps(best_idx, _mm256_castsi256_ps(_mm256_set1_epi32(p)), mask);
+        }
+
+        _mm256_store_ps(dist + i, best);
+        _mm256_store_si256((__m256i*)(idx + i), _mm256_castps_si256(best_idx));
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i < subset.count; i += 4)
+    {
+        __m128 best     = _mm_set1_ps(1e30f);
+        __m128 best_idx = _mm_setzero_ps();
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            __m128 d = _mm_setzero_ps();
+
+            for (int ch = 0; ch < channels; ch++)
+            {
+                __m128 diff = _mm_sub_ps(_mm_load_ps(subset.c[ch] + i), _mm_set1_ps(palette[p][ch]));
+                d           = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+            }
+
+            __m128 mask = _mm_cmplt_ps(d, best);
+
+            best     = _mm_blendv_ps(best, d, mask);
+            best_idx = _mm_blendv_ps(best_idx, _mm_castsi128_ps(_mm_set1_epi32(p)), mask);
+        }
+
+        _mm_store_ps(dist + i, best);
+        _mm_store_si128((__m128i*)(idx + i), _mm_castps_si128(best_idx));
+    }
+#else
+    for (int i = 0; i < subset.count; i++)
+    {
+        dist[i] = 1e30f;
+
+        for (int p = 0; p < palette_size; p++)
+        {
+            float d = 0.0f;
+
+            for (int ch = 0; ch < channels; ch++)
+                d += (subset.c[ch][i] - palette[p][ch]) * (subset.c[ch][i] - palette[p][ch]);
+
+            if (d < dist[i])
+            {
+                dist[i] = d;
+                idx[i]  = p;
+            }
+        }
+    }
+#endif
+
+    float error = 0.0f;
+
+    for (int i = 0; i < subset.count; i++)
+    {
+        indices[i] = uint8_t(idx[i]);
+        error += dist[i];
+    }
+
+    return error;
+}
+
+static inline int expand_bits(int value, int bits)
+{
+    return bits >= 8 ? value : ((value << (8 - bits)) | (value >> (2 * bits - 8)));
+}
+
+static inline int quantize_endpoint(float value, int bits, int pbit, bool has_pbit)
+{
+    int max = (1 << bits) - 1;
+
+    if (!has_pbit)
+        return std::min(std::max(int(value * max / 255.0f + 0.5f), 0), max);
+
+    float full = value * ((1 << (bits + 1)) - 1) / 255.0f;
+    return std::min(std::max(int((full - pbit) * 0.5f + 0.5f), 0), max);
+}
+
+static inline int dequantize_endpoint(int value, int bits, int pbit, bool has_pbit)
+{
+    if (has_pbit)
+        return expand_bits((value << 1) | pbit, bits + 1);
+    else
+        return expand_bits(value, bits);
+}
+
+// Quantizes the float endpoints with the given p-bits and fits the subset. Alpha is fixed to 255 for opaque modes.
+static float evaluate_subset(const BC7Subset& subset, const BC7ModeInfo& mode, int channels, const float endpoints[2][4], const int pbits[2], BC7SubsetResult& result)
+{
+    const int* weights      = bc7_weights(mode.index_bits);
+    const int  palette_size = 1 << mode.index_bits;
+    const bool has_pbit     = mode.pbits != 0;
+    int        expanded[2][4];
+
+    for (int e = 0; e < 2; e++)
+    {
+        result.pbits[e] = pbits[e];
+
+        for (int ch = 0; ch < 4; ch++)
+        {
+            int bits = ch < 3 ? mode.color_bits : mode.alpha_bits;
+
+            if (bits == 0)
+            {
+                result.endpoints[e][ch] = 0;
+                expanded[e][ch]         = 255;
+            }
+            else
+            {
+                result.endpoints[e][ch] = quantize_endpoint(endpoints[e][ch], bits, pbits[e], has_pbit);
+                expanded[e][ch]         = dequantize_endpoint(result.endpoints[e][ch], bits, pbits[e], has_pbit);
+            }
+        }
+    }
+
+    float palette[16][4];
+
+    for (int p = 0; p < palette_size; p++)
+    {
+        for (int ch = 0; ch < 4; ch++)
+            palette[p][ch] = float(((64 - weights[p]) * expanded[0][ch] + weights[p] * expanded[1][ch] + 32) >> 6);
+    }
+
+    result.error = fit_subset(subset, channels, palette, palette_size, result.indices);
+
+    return result.error;
+}
+
+static void principal_axis_endpoints(const BC7Subset& subset, int channels, float endpoints[2][4])
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < subset.count; i++)
+    {
+        for (int ch = 0; ch < channels; ch++)
+            mean[ch] += subset.c[ch][i];
+    }
+
+    for (int ch = 0; ch < channels; ch++)
+        mean[ch] /= float(subset.count);
+
+    float cov[4][4] = {};
+
+    for (int i = 0; i < subset.count; i++)
+    {
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = a; b < channels; b++)
+                cov[a][b] += (subset.c[a][i] - mean[a]) * (subset.c[b][i] - mean[b]);
+        }
+    }
+
+    for (int a = 0; a < channels; a++)
+    {
+        for (int b = 0; b < a; b++)
+            cov[a][b] = cov[b][a];
+    }
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    for (int iter = 0; iter < 4; iter++)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float m       = 0.0f;
+
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                next[a] += cov[a][b] * axis[b];
+
+            m = std::max(m, fabsf(next[a]));
+        }
+
+        if (m < 1e-6f)
+            break;
+
+        for (int a = 0; a < channels; a++)
+            axis[a] = next[a] / m;
+    }
+
+    float len = 0.0f;
+
+    for (int ch = 0; ch < channels; ch++)
+        len += axis[ch] * axis[ch];
+
+    len = sqrtf(len);
+
+    for (int ch = 0; ch < channels; ch++)
+        axis[ch] /= len;
+
+    float t_min = 1e30f;
+    float t_max = -1e30f;
+
+    for (int i = 0; i < subset.count; i++)
+    {
+        float t = 0.0f;
+
+        for (int ch = 0; ch < channels; ch++)
+            t += (subset.c[ch][i] - mean[ch]) * axis[ch];
+
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    for (int ch = 0; ch < 4; ch++)
+    {
+        float m = ch < channels ? mean[ch] : 255.0f;
+        float a = ch < channels ? axis[ch] : 0.0f;
+
+        endpoints[0][ch] = std::min(std::max(m + a * t_min, 0.0f), 255.0f);
+        endpoints[1][ch] = std::min(std::max(m + a * t_max, 0.0f), 255.0f);
+    }
+}
+
+// Least squares endpoints for the current indices.
+static bool refine_endpoints(const BC7Subset& subset, int channels, const int* weights, const uint8_t* indices, float endpoints[2][4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ap[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float bp[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < subset.count; i++)
+    {
+        float beta  = weights[indices[i]] / 64.0f;
+        float alpha = 1.0f - beta;
+
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+
+        for (int ch = 0; ch < channels; ch++)
+        {
+            ap[ch] += alpha * subset.c[ch][i];
+            bp[ch] += beta * subset.c[ch][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+
+    if (fabsf(det) < 1e-6f)
+        return false;
+
+    float inv_det = 1.0f / det;
+
+    for (int ch = 0; ch < channels; ch++)
+    {
+        endpoints[0][ch] = std::min(std::max((ap[ch] * bb - bp[ch] * ab) * inv_det, 0.0f), 255.0f);
+        endpoints[1][ch] = std::min(std::max((bp[ch] * aa - ap[ch] * ab) * inv_det, 0.0f), 255.0f);
+    }
+
+    return true;
+}
+
+// Picks the p-bits that reproduce the unquantized endpoints most closely.
+static void choose_pbits(const BC7ModeInfo& mode, int channels, const float endpoints[2][4], int pbits[2])
+{
+    float error[2][2] = {};
+
+    for (int e = 0; e < 2; e++)
+    {
+        for (int p = 0; p < 2; p++)
+        {
+            for (int ch = 0; ch < channels; ch++)
+            {
+                int   bits = ch < 3 ? mode.color_bits : mode.alpha_bits;
+                float d    = endpoints[e][ch] - dequantize_endpoint(quantize_endpoint(endpoints[e][ch], bits, p, true), bits, p, true);
+
+                error[e][p] += d * d;
+            }
+        }
+    }
+
+    if (mode.pbits == 1)
+    {
+        pbits[0] = pbits[1] = (error[0][1] + error[1][1] < error[0][0] + error[1][0]) ? 1 : 0;
+    }
+    else
+    {
+        pbits[0] = error[0][1] < error[0][0] ? 1 : 0;
+        pbits[1] = error[1][1] < error[1][0] ? 1 : 0;
+    }
+}
+
+static void encode_subset(const BC7Subset& subset, const BC7ModeInfo& mode, int channels, const BCSearchPreset& preset, const float initial[2][4], BC7SubsetResult& best)
+{
+    float endpoints[2][4];
+    memcpy(endpoints, initial, sizeof(endpoints));
+
+    best.error = 1e30f;
+
+    for (int iter = 0; iter <= preset.refine_iterations; iter++)
+    {
+        BC7SubsetResult candidate;
+
+        if (mode.pbits == 0)
+        {
+            int pbits[2] = { 0, 0 };
+            evaluate_subset(subset, mode, channels, endpoints, pbits, candidate);
+        }
+        else if (!preset.exhaustive)
+        {
+            int pbits[2];
+            choose_pbits(mode, channels, endpoints, pbits);
+            evaluate_subset(subset, mode, channels, endpoints, pbits, candidate);
+        }
+        else
+        {
+            candidate.error = 1e30f;
+
+            int combinations = mode.pbits == 1 ? 2 : 4;
+
+            for (int combination = 0; combination < combinations; combination++)
+            {
+                int             pbits[2] = { combination & 1, mode.pbits == 1 ? (combination & 1) : (combination >> 1) };
+                BC7SubsetResult result;
+
+                if (evaluate_subset(subset, mode, channels, endpoints, pbits, result) < candidate.error)
+                    candidate = result;
+            }
+        }
+
+        if (candidate.error < best.error)
+            best = candidate;
+        else
+            break;
+
+        if (best.error == 0.0f || iter == preset.refine_iterations)
+            break;
+
+        if (!refine_endpoints(subset, channels, bc7_weights(mode.index_bits), best.indices, endpoints))
+            break;
+    }
+}
+
+// Per block first and second order moments. Subset moments are sums over the partition mask,
+// which makes ranking all 64 partitions cheap compared to encoding them.
+struct BC7Moments
+{
+    float sum[16][4];
+    float products[16][10];
+    float total_sum[4];
+    float total_products[10];
+};
+
+static void compute_moments(const BC7Block& block, BC7Moments& moments)
+{
+    memset(moments.total_sum, 0, sizeof(moments.total_sum));
+    memset(moments.total_products, 0, sizeof(moments.total_products));
+
+    for (int i = 0; i < 16; i++)
+    {
+        int k = 0;
+
+        for (int a = 0; a < 4; a++)
+        {
+            moments.sum[i][a] = block.c[a][i];
+            moments.total_sum[a] += block.c[a][i];
+
+            for (int b = a; b < 4; b++, k++)
+            {
+                moments.products[i][k] = block.c[a][i] * block.c[b][i];
+                moments.total_products[k] += moments.products[i][k];
+            }
+        }
+    }
+}
+
+// Residual of fitting a subset with a line: trace of the covariance minus its largest eigenvalue.
+static float line_fit_residual(const float* sum, const float* products, int count, int channels)
+{
+    if (count == 0)
+        return 0.0f;
+
+    float cov[4][4];
+    float inv_count = 1.0f / float(count);
+
+    for (int a = 0, k = 0; a < 4; a++)
+    {
+        for (int b = a; b < 4; b++, k++)
+        {
+            cov[a][b] = products[k] - sum[a] * sum[b] * inv_count;
+            cov[b][a] = cov[a][b];
+        }
+    }
+
+    float trace   = 0.0f;
+    float lambda  = 0.0f;
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    for (int ch = 0; ch < channels; ch++)
+        trace += cov[ch][ch];
+
+    for (int iter = 0; iter < 3; iter++)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float len     = 0.0f;
+
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                next[a] += cov[a][b] * axis[b];
+
+            len += next[a] * next[a];
+        }
+
+        len = sqrtf(len);
+
+        if (len < 1e-6f)
+            break;
+
+        lambda = len;
+
+        for (int a = 0; a < channels; a++)
+            axis[a] = next[a] / len;
+    }
+
+    return std::max(trace - lambda, 0.0f);
+}
+
+static float estimate_partition_error(const BC7Moments& moments, uint16_t mask, int channels)
+{
+    float sum[4]       = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float products[10] = {};
+    int   count        = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (!((mask >> i) & 1))
+            continue;
+
+        for (int a = 0; a < 4; a++)
+            sum[a] += moments.sum[i][a];
+
+        for (int k = 0; k < 10; k++)
+            products[k] += moments.products[i][k];
+
+        count++;
+    }
+
+    float rest_sum[4];
+    float rest_products[10];
+
+    for (int a = 0; a < 4; a++)
+        rest_sum[a] = moments.total_sum[a] - sum[a];
+
+    for (int k = 0; k < 10; k++)
+        rest_products[k] = moments.total_products[k] - products[k];
+
+    return line_fit_residual(sum, products, count, channels) + line_fit_residual(rest_sum, rest_products, 16 - count, channels);
+}
+
+struct BC7BitWriter
+{
+    uint8_t* data;
+    int      offset = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++, offset++)
+        {
+            if ((value >> i) & 1)
+                data[offset >> 3] |= uint8_t(1 << (offset & 7));
+        }
+    }
+};
+
+static void write_block(int mode_index, int partition, BC7SubsetResult results[2], const BC7Subset subsets[2], uint8_t* dst)
+{
+    const BC7ModeInfo& mode = kBC7Modes[mode_index];
+
+    uint8_t indices[16];
+    int     anchors[2] = { 0, mode.subsets == 2 ? kBC7Anchors2[partition] : -1 };
+
+    for (int s = 0; s < mode.subsets; s++)
+    {
+        BC7SubsetResult& result = results[s];
+        const BC7Subset& subset = subsets[s];
+        const int        high   = 1 << (mode.index_bits - 1);
+        const int        max    = (1 << mode.index_bits) - 1;
+
+        // The anchor index is stored without its most significant bit, so swap the endpoints if it is set.
+        for (int i = 0; i < subset.count; i++)
+        {
+            if (subset.pixels[i] == anchors[s] && (result.indices[i] & high))
+            {
+                for (int ch = 0; ch < 4; ch++)
+                    std::swap(result.endpoints[0][ch], result.endpoints[1][ch]);
+
+                std::swap(result.pbits[0], result.pbits[1]);
+
+                for (int j = 0; j < subset.count; j++)
+                    result.indices[j] = uint8_t(max - result.indices[j]);
+
+                break;
+            }
+        }
+
+        for (int i = 0; i < subset.count; i++)
+            indices[subset.pixels[i]] = result.indices[i];
+    }
+
+    memset(dst, 0, 16);
+
+    BC7BitWriter writer;
+    writer.data = dst;
+
+    writer.write(1u << mode_index, mode_index + 1);
+    writer.write(partition, mode.partition_bits);
+
+    for (int ch = 0; ch < 4; ch++)
+    {
+        int bits = ch < 3 ? mode.color_bits : mode.alpha_bits;
+
+        for (int s = 0; s < mode.subsets && bits > 0; s++)
+        {
+            writer.write(results[s].endpoints[0][ch], bits);
+            writer.write(results[s].endpoints[1][ch], bits);
+        }
+    }
+
+    for (int s = 0; s < mode.subsets; s++)
+    {
+        if (mode.pbits == 2)
+        {
+            writer.write(results[s].pbits[0], 1);
+            writer.write(results[s].pbits[1], 1);
+        }
+        else if (mode.pbits == 1)
+            writer.write(results[s].pbits[0], 1);
+    }
+
+    for (int i = 0; i < 16; i++)
+        writer.write(indices[i], (i == anchors[0] || i == anchors[1]) ? mode.index_bits - 1 : mode.index_bits);
+}
+
+static void encode_bc7_block(const BC7Block& block, const BCSearchPreset& preset, uint8_t* dst)
+{
+    bool opaque = true;
+
+    for (int i = 0; i < 16; i++)
+        opaque &= block.c[3][i] == 255.0f;
+
+    float           best_error     = 1e30f;
+    int             best_mode      = -1;
+    int             best_partition = 0;
+    BC7SubsetResult best_results[2];
+    BC7Subset       best_subsets[2];
+
+    const uint32_t modes = preset.modes & kBC7SupportedModes;
+
+    // Single subset RGBA. Always evaluated so that every block has a valid encoding.
+    {
+        BC7Subset subset;
+        float     endpoints[2][4];
+
+        gather_subset(block, 0, false, subset);
+        principal_axis_endpoints(subset, 4, endpoints);
+
+        encode_subset(subset, kBC7Modes[6], 4, preset, endpoints, best_results[0]);
+
+        best_error      = best_results[0].error;
+        best_mode       = 6;
+        best_subsets[0] = subset;
+    }
+
+    const bool try_opaque_modes = opaque && (modes & ((1 << 1) | (1 << 3)));
+    const bool try_alpha_modes  = !opaque && (modes & (1 << 7));
+
+    if (best_error > 0.0f && preset.max_partitions > 0 && (try_opaque_modes || try_alpha_modes))
+    {
+        const int channels = opaque ? 3 : 4;
+
+        int        order[64];
+        float      estimates[64];
+        BC7Moments moments;
+
+        compute_moments(block, moments);
+
+        for (int p = 0; p < 64; p++)
+        {
+            order[p]     = p;
+            estimates[p] = estimate_partition_error(moments, kBC7Partitions2[p], channels);
+        }
+
+        const int count = std::min(preset.max_partitions, 64);
+
+        std::partial_sort(order, order + count, order + 64, [&](int a, int b) { return estimates[a] < estimates[b]; });
+
+        for (int i = 0; i < count; i++)
+        {
+            const int partition = order[i];
+            BC7Subset subsets[2];
+            float     endpoints[2][2][4];
+
+            gather_subset(block, kBC7Partitions2[partition], false, subsets[0]);
+            gather_subset(block, kBC7Partitions2[partition], true, subsets[1]);
+            principal_axis_endpoints(subsets[0], channels, endpoints[0]);
+            principal_axis_endpoints(subsets[1], channels, endpoints[1]);
+
+            for (int mode_index = 1; mode_index < 8; mode_index++)
+            {
+                if (!(modes & (1 << mode_index)) || kBC7Modes[mode_index].subsets != 2)
+                    continue;
+
+                // Modes without alpha are only valid for opaque blocks, mode 7 is only useful with alpha.
+                if ((kBC7Modes[mode_index].alpha_bits == 0) != opaque)
+                    continue;
+
+                BC7SubsetResult results[2];
+
+                encode_subset(subsets[0], kBC7Modes[mode_index], channels, preset, endpoints[0], results[0]);
+
+                if (results[0].error >= best_error)
+                    continue;
+
+                encode_subset(subsets[1], kBC7Modes[mode_index], channels, preset, endpoints[1], results[1]);
+
+                float error = results[0].error + results[1].error;
+
+                if (error < best_error)
+                {
+                    best_error      = error;
+                    best_mode       = mode_index;
+                    best_partition  = partition;
+                    best_results[0] = results[0];
+                    best_results[1] = results[1];
+                    best_subsets[0] = subsets[0];
+                    best_subsets[1] = subsets[1];
+                }
+            }
+        }
+    }
+
+    write_block(best_mode, best_partition, best_results, best_subsets, dst);
+}
+
+BCSearchPreset bc7_preset(const CompressionQuality& quality)
+{
+    BCSearchPreset preset;
+
+    if (quality == COMPRESSION_QUALITY_FAST)
+    {
+        preset.modes             = 1 << 6;
+        preset.max_partitions    = 0;
+        preset.refine_iterations = 1;
+        preset.exhaustive        = false;
+    }
+    else if (quality == COMPRESSION_QUALITY_NORMAL)
+    {
+        preset.modes             = kBC7SupportedModes;
+        preset.max_partitions    = 8;
+        preset.refine_iterations = 1;
+        preset.exhaustive        = false;
+    }
+    else
+    {
+        preset.modes             = kBC7SupportedModes;
+        preset.max_partitions    = 64;
+        preset.refine_iterations = 2;
+        preset.exhaustive        = true;
+    }
+
+    return preset;
+}
+
+void bc7_encode(const BCSearchPreset& preset, const uint8_t* src, int width, int height, int components, void* dst)
+{
+    const int blocks_x = std::max(1, (width + 3) / 4);
+    const int blocks_y = std::max(1, (height + 3) / 4);
+
+    parallel_for(0, blocks_y, [&](int32_t by) {
+        uint8_t* out = (uint8_t*)dst + size_t(by) * blocks_x * 16;
+        BC7Block block;
+
+        for (int bx = 0; bx < blocks_x; bx++, out += 16)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                int sy = std::min(by * 4 + y, height - 1);
+
+                for (int x = 0; x < 4; x++)
+                {
+                    int            sx = std::min(bx * 4 + x, width - 1);
+                    const uint8_t* p  = src + (size_t(sy) * width + sx) * components;
+
+                    block.c[0][y * 4 + x] = p[0];
+                    block.c[1][y * 4 + x] = components > 1 ? p[1] : 0.0f;
+                    block.c[2][y * 4 + x] = components > 2 ? p[2] : 0.0f;
+                    block.c[3][y * 4 + x] = components > 3 ? p[3] : 255.0f;
+                }
+            }
+
+            encode_bc7_block(block, preset, out);
+        }
+    });
+}
+} // namespace ast
@@ -0,0 +1,761 @@
+#include <exporter/bc_encoder.h>
+#include <common/parallel.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#endif
+
+namespace ast
+{
+// Pixels of a 4x4 block in structure-of-arrays layout so the index fit can run 4 or 8 pixels at a time.
+struct alignas(32) ColorBlock
+{
+    float r[16];
+    float g[16];
+    float b[16];
+    float a[16];
+};
+
+static void load_block(const uint8_t* src, int width, int height, int components, int bx, int by, ColorBlock& block)
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sy = std::min(by * 4 + y, height - 1);
+
+        for (int x = 0; x < 4; x++)
+        {
+            int            sx = std::min(bx * 4 + x, width - 1);
+            int            i  = y * 4 + x;
+            const uint8_t* p  = src + (size_t(sy) * width + sx) * components;
+
+            block.r[i] = p[0];
+            block.g[i] = components > 1 ? p[1] : 0.0f;
+            block.b[i] = components > 2 ? p[2] : 0.0f;
+            block.a[i] = components > 3 ? p[3] : 255.0f;
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// BC1 color block
+// ----------------------------------------------------------------------------
+
+static inline int quantize(float v, int max)
+{
+    int q = int(v * float(max) / 255.0f + 0.5f);
+    return std::min(std::max(q, 0), max);
+}
+
+static inline uint16_t pack_565(const float c[3])
+{
+    return uint16_t((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+}
+
+static inline void unpack_565(uint16_t c, float out[3])
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+
+    out[0] = float((r << 3) | (r >> 2));
+    out[1] = float((g << 2) | (g >> 4));
+    out[2] = float((b << 3) | (b >> 2));
+}
+
+// Finds the closest palette entry for every pixel. Returns the summed squared error.
+static float fit_color_indices(const ColorBlock& block, const float palette[4][3], uint32_t& indices)
+{
+    alignas(32) int32_t idx[16];
+    float               error = 0.0f;
+
+#if defined(__AVX2__)
+    for (int i = 0; i < 16; i += 8)
+    {
+        __m256 r        = _mm256_load_ps(block.r + i);
+        __m256 g        = _mm256_load_ps(block.g + i);
+        __m256 b        = _mm256_load_ps(block.b + i);
+        __m256 best     = _mm256_set1_ps(1e30f);
+        __m256 best_idx = _mm256_setzero_ps();
+
+        for (int p = 0; p < 4; p++)
+        {
+            __m256 dr   = _mm256_sub_ps(r, _mm256_set1_ps(palette[p][0]));
+            __m256 dg   = _mm256_sub_ps(g, _mm256_set1_ps(palette[p][1]));
+            __m256 db   = _mm256_sub_ps(b, _mm256_set1_ps(palette[p][2]));
+            __m256 d    = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)), _mm256_mul_ps(db, db));
+            __m256 mask = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+
+            best     = _mm256_blendv_ps(best, d, mask);
+            best_idx = _mm256_blendv_ps(best_idx, _mm256_castsi256_ps(_mm256_set1_epi32(p)), mask);
+        }
+
+        _mm256_store_si256((__m256i*)(idx + i), _mm256_castps_si256(best_idx));
+
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(best), _mm256_extractf128_ps(best, 1));
+        sum        = _mm_hadd_ps(sum, sum);
+        sum        = _mm_hadd_ps(sum, sum);
+        error += _mm_cvtss_f32(sum);
+    }
+#elif defined(__SSE4_1__)
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 r        = _mm_load_ps(block.r + i);
+        __m128 g        = _mm_load_ps(block.g + i);
+        __m128 b        = _mm_load_ps(block.b + i);
+        __m128 best     = _mm_set1_ps(1e30f);
+        __m128 best_idx = _mm_setzero_ps();
+
+        for (int p = 0; p < 4; p++)
+        {
+            __m128 dr   = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+            __m128 dg   = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+            __m128 db   = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+            __m128 d    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128 mask = _mm_cmplt_ps(d, best);
+
+            best     = _mm_blendv_ps(best, d, mask);
+            best_idx = _mm_blendv_ps(best_idx, _mm_castsi128_ps(_mm_set1_epi32(p)), mask);
+        }
+
+        _mm_store_si128((__m128i*)(idx + i), _mm_castps_si128(best_idx));
+
+        __m128 sum = _mm_hadd_ps(best, best);
+        sum        = _mm_hadd_ps(sum, sum);
+        error += _mm_cvtss_f32(sum);
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        float best = 1e30f;
+
+        for (int p = 0; p < 4; p++)
+        {
+            float dr = block.r[i] - palette[p][0];
+            float dg = block.g[i] - palette[p][1];
+            float db = block.b[i] - palette[p][2];
+            float d  = dr * dr + dg * dg + db * db;
+
+            if (d < best)
+            {
+                best   = d;
+                idx[i] = p;
+            }
+        }
+
+        error += best;
+    }
+#endif
+
+    indices = 0;
+
+    for (int i = 0; i < 16; i++)
+        indices |= uint32_t(idx[i]) << (2 * i);
+
+    return error;
+}
+
+struct BC1Candidate
+{
+    uint16_t c0;
+    uint16_t c1;
+    uint32_t indices;
+    float    error;
+};
+
+// Quantizes the endpoints, orders them for four-color mode and fits the indices.
+static BC1Candidate evaluate_bc1(const ColorBlock& block, const float e0[3], const float e1[3])
+{
+    BC1Candidate candidate;
+
+    candidate.c0 = pack_565(e0);
+    candidate.c1 = pack_565(e1);
+
+    if (candidate.c0 < candidate.c1)
+        std::swap(candidate.c0, candidate.c1);
+
+    float palette[4][3];
+
+    unpack_565(candidate.c0, palette[0]);
+    unpack_565(candidate.c1, palette[1]);
+
+    if (candidate.c0 == candidate.c1)
+    {
+        // Equal endpoints select three-color mode, so only index 0 is safe to use.
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = palette[0][c];
+            palette[3][c] = palette[0][c];
+        }
+
+        candidate.error   = fit_color_indices(block, palette, candidate.indices);
+        candidate.indices = 0;
+
+        return candidate;
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+        palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    candidate.error = fit_color_indices(block, palette, candidate.indices);
+
+    return candidate;
+}
+
+// Solves for the endpoints that minimize the squared error for the current indices.
+static bool refine_bc1(const ColorBlock& block, uint32_t indices, float e0[3], float e1[3])
+{
+    static const float kWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ap[3] = { 0.0f, 0.0f, 0.0f };
+    float bp[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        float alpha = kWeights[(indices >> (2 * i)) & 3];
+        float beta  = 1.0f - alpha;
+
+        aa += alpha * alpha;
+        ab += alpha * beta;
+        bb += beta * beta;
+
+        ap[0] += alpha * block.r[i];
+        ap[1] += alpha * block.g[i];
+        ap[2] += alpha * block.b[i];
+        bp[0] += beta * block.r[i];
+        bp[1] += beta * block.g[i];
+        bp[2] += beta * block.b[i];
+    }
+
+    float det = aa * bb - ab * ab;
+
+    if (fabsf(det) < 1e-6f)
+        return false;
+
+    float inv_det = 1.0f / det;
+
+    for (int c = 0; c < 3; c++)
+    {
+        e0[c] = std::min(std::max((ap[c] * bb - bp[c] * ab) * inv_det, 0.0f), 255.0f);
+        e1[c] = std::min(std::max((bp[c] * aa - ap[c] * ab) * inv_det, 0.0f), 255.0f);
+    }
+
+    return true;
+}
+
+// Bounding box endpoints, inset by 1/16 of the range and flipped along the dominant diagonal.
+static void bounding_box_endpoints(const ColorBlock& block, float e0[3], float e1[3])
+{
+    const float* channels[3] = { block.r, block.g, block.b };
+    float        center[3];
+
+    for (int c = 0; c < 3; c++)
+    {
+        float lo = 255.0f;
+        float hi = 0.0f;
+
+        for (int i = 0; i < 16; i++)
+        {
+            lo = std::min(lo, channels[c][i]);
+            hi = std::max(hi, channels[c][i]);
+        }
+
+        float inset = (hi - lo) / 16.0f;
+
+        e0[c]     = hi - inset;
+        e1[c]     = lo + inset;
+        center[c] = (lo + hi) * 0.5f;
+    }
+
+    float cov_rg = 0.0f;
+    float cov_bg = 0.0f;
+
+    for (int i = 0; i < 16; i++)
+    {
+        float dg = block.g[i] - center[1];
+
+        cov_rg += (block.r[i] - center[0]) * dg;
+        cov_bg += (block.b[i] - center[2]) * dg;
+    }
+
+    if (cov_rg < 0.0f)
+        std::swap(e0[0], e1[0]);
+
+    if (cov_bg < 0.0f)
+        std::swap(e0[2], e1[2]);
+}
+
+// Endpoints at the extremes of the projection onto the principal axis of the block colors.
+static void principal_axis_endpoints(const ColorBlock& block, float e0[3], float e1[3])
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        mean[0] += block.r[i];
+        mean[1] += block.g[i];
+        mean[2] += block.b[i];
+    }
+
+    for (int c = 0; c < 3; c++)
+        mean[c] /= 16.0f;
+
+    float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 16; i++)
+    {
+        float r = block.r[i] - mean[0];
+        float g = block.g[i] - mean[1];
+        float b = block.b[i] - mean[2];
+
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    float axis[3];
+    bounding_box_endpoints(block, e0, e1);
+
+    for (int c = 0; c < 3; c++)
+        axis[c] = e0[c] - e1[c];
+
+    if (axis[0] == 0.0f && axis[1] == 0.0f && axis[2] == 0.0f)
+    {
+        axis[0] = 1.0f;
+        axis[1] = 1.0f;
+        axis[2] = 1.0f;
+    }
+
+    // Power iteration converges quickly for the 3x3 covariance matrix.
+    for (int iter = 0; iter < 4; iter++)
+    {
+        float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+        float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+        float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+        float m = std::max(fabsf(x), std::max(fabsf(y), fabsf(z)));
+
+        if (m < 1e-6f)
+            break;
+
+        axis[0] = x / m;
+        axis[1] = y / m;
+        axis[2] = z / m;
+    }
+
+    float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+    for (int c = 0; c < 3; c++)
+        axis[c] /= len;
+
+    float t_min = 1e30f;
+    float t_max = -1e30f;
+
+    for (int i = 0; i < 16; i++)
+    {
+        float t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        e0[c] = std::min(std::max(mean[c] + axis[c] * t_max, 0.0f), 255.0f);
+        e1[c] = std::min(std::max(mean[c] + axis[c] * t_min, 0.0f), 255.0f);
+    }
+}
+
+static void encode_bc1_block(const ColorBlock& block, const CompressionQuality& quality, uint8_t* dst)
+{
+    float        e0[3], e1[3];
+    BC1Candidate best;
+
+    if (quality == COMPRESSION_QUALITY_FAST)
+    {
+        bounding_box_endpoints(block, e0, e1);
+        best = evaluate_bc1(block, e0, e1);
+    }
+    else
+    {
+        principal_axis_endpoints(block, e0, e1);
+        best = evaluate_bc1(block, e0, e1);
+
+        int iterations = quality == COMPRESSION_QUALITY_HIGH ? 3 : 1;
+
+        for (int iter = 0; iter < iterations && best.error > 0.0f; iter++)
+        {
+            if (!refine_bc1(block, best.indices, e0, e1))
+                break;
+
+            BC1Candidate refined = evaluate_bc1(block, e0, e1);
+
+            if (refined.error >= best.error)
+                break;
+
+            best = refined;
+        }
+
+        if (quality == COMPRESSION_QUALITY_HIGH && best.error > 0.0f)
+        {
+            // Greedy one-step search around the quantized endpoints.
+            static const uint16_t kSteps[3] = { 1 << 11, 1 << 5, 1 };
+            static const uint16_t kMasks[3] = { 31 << 11, 63 << 5, 31 };
+
+            bool improved = true;
+
+            while (improved)
+            {
+                improved = false;
+
+                for (int e = 0; e < 2; e++)
+                {
+                    for (int c = 0; c < 3; c++)
+                    {
+                        for (int dir = -1; dir <= 1; dir += 2)
+                        {
+                            uint16_t endpoint = e == 0 ? best.c0 : best.c1;
+                            int      field    = endpoint & kMasks[c];
+                            int      moved    = field + dir * kSteps[c];
+
+                            if (moved < 0 || moved > kMasks[c])
+                                continue;
+
+                            uint16_t candidate_endpoint = uint16_t((endpoint & ~kMasks[c]) | moved);
+                            float    a[3], b[3];
+
+                            unpack_565(e == 0 ? candidate_endpoint : best.c0, a);
+                            unpack_565(e == 0 ? best.c1 : candidate_endpoint, b);
+
+                            BC1Candidate candidate = evaluate_bc1(block, a, b);
+
+                            if (candidate.error < best.error)
+                            {
+                                best     = candidate;
+                                improved = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    memcpy(dst, &best.c0, 2);
+    memcpy(dst + 2, &best.c1, 2);
+    memcpy(dst + 4, &best.indices, 4);
+}
+
+// Three-color mode with index 3 as transparent black: c0 <= c1 and the only interpolant sits halfway between them.
+static BC1Candidate evaluate_bc1a(const ColorBlock& block, const bool transparent[16], const float e0[3], const float e1[3])
+{
+    BC1Candidate candidate;
+
+    candidate.c0 = pack_565(e0);
+    candidate.c1 = pack_565(e1);
+
+    if (candidate.c0 > candidate.c1)
+        std::swap(candidate.c0, candidate.c1);
+
+    float palette[3][3];
+
+    unpack_565(candidate.c0, palette[0]);
+    unpack_565(candidate.c1, palette[1]);
+
+    for (int c = 0; c < 3; c++)
+        palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+
+    candidate.indices = 0;
+    candidate.error   = 0.0f;
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (transparent[i])
+        {
+            candidate.indices |= 3u << (2 * i);
+            continue;
+        }
+
+        float    best     = 1e30f;
+        uint32_t best_idx = 0;
+
+        for (int p = 0; p < 3; p++)
+        {
+            float dr = block.r[i] - palette[p][0];
+            float dg = block.g[i] - palette[p][1];
+            float db = block.b[i] - palette[p][2];
+            float d  = dr * dr + dg * dg + db * db;
+
+            if (d < best)
+            {
+                best     = d;
+                best_idx = p;
+            }
+        }
+
+        candidate.indices |= best_idx << (2 * i);
+        candidate.error += best;
+    }
+
+    return candidate;
+}
+
+// Pixels with alpha below 128 become transparent. Blocks without any are encoded in four-color mode like BC1.
+static void encode_bc1a_block(const ColorBlock& block, const CompressionQuality& quality, uint8_t* dst)
+{
+    bool  transparent[16];
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    int   opaque  = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        transparent[i] = block.a[i] < 128.0f;
+
+        if (transparent[i])
+            continue;
+
+        mean[0] += block.r[i];
+        mean[1] += block.g[i];
+        mean[2] += block.b[i];
+        opaque++;
+    }
+
+    if (opaque == 16)
+    {
+        encode_bc1_block(block, quality, dst);
+        return;
+    }
+
+    BC1Candidate best;
+
+    if (opaque == 0)
+    {
+        best.c0      = 0;
+        best.c1      = 0;
+        best.indices = 0xFFFFFFFF;
+    }
+    else
+    {
+        // Transparent pixels are moved to the mean of the opaque ones, which neither widens the bounding box nor turns
+        // the principal axis.
+        ColorBlock opaque_block = block;
+
+        for (int i = 0; i < 16; i++)
+        {
+            if (!transparent[i])
+                continue;
+
+            opaque_block.r[i] = mean[0] / float(opaque);
+            opaque_block.g[i] = mean[1] / float(opaque);
+            opaque_block.b[i] = mean[2] / float(opaque);
+        }
+
+        float e0[3], e1[3];
+
+        bounding_box_endpoints(opaque_block, e0, e1);
+        best = evaluate_bc1a(opaque_block, transparent, e0, e1);
+
+        if (quality != COMPRESSION_QUALITY_FAST && best.error > 0.0f)
+        {
+            principal_axis_endpoints(opaque_block, e0, e1);
+
+            BC1Candidate candidate = evaluate_bc1a(opaque_block, transparent, e0, e1);
+
+            if (candidate.error < best.error)
+                best = candidate;
+        }
+    }
+
+    memcpy(dst, &best.c0, 2);
+    memcpy(dst + 2, &best.c1, 2);
+    memcpy(dst + 4, &best.indices, 4);
+}
+
+// ----------------------------------------------------------------------------
+// BC4 single channel block
+// ----------------------------------------------------------------------------
+
+static float fit_bc4_indices(const float* values, const float palette[8], uint64_t& indices)
+{
+    float error = 0.0f;
+
+    indices = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        float    best     = 1e30f;
+        uint64_t best_idx = 0;
+
+        for (int p = 0; p < 8; p++)
+        {
+            float d = (values[i] - palette[p]) * (values[i] - palette[p]);
+
+            if (d < best)
+            {
+                best     = d;
+                best_idx = p;
+            }
+        }
+
+        indices |= best_idx << (3 * i);
+        error += best;
+    }
+
+    return error;
+}
+
+static float evaluate_bc4(const float* values, int e0, int e1, uint64_t& indices)
+{
+    float palette[8];
+
+    palette[0] = float(e0);
+    palette[1] = float(e1);
+
+    if (e0 > e1)
+    {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = float(((7 - i) * e0 + i * e1) / 7);
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = float(((5 - i) * e0 + i * e1) / 5);
+
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+
+    return fit_bc4_indices(values, palette, indices);
+}
+
+static void encode_bc4_block(const float* values, const CompressionQuality& quality, uint8_t* dst)
+{
+    int lo = 255, hi = 0;
+    int inner_lo = 255, inner_hi = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        int v = int(values[i]);
+
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+
+        if (v != 0 && v != 255)
+        {
+            inner_lo = std::min(inner_lo, v);
+            inner_hi = std::max(inner_hi, v);
+        }
+    }
+
+    int      e0 = hi, e1 = lo;
+    uint64_t indices;
+    float    error = evaluate_bc4(values, e0, e1, indices);
+
+    if (quality != COMPRESSION_QUALITY_FAST && error > 0.0f)
+    {
+        // Six-value mode keeps exact 0 and 255 and spends the interpolants on the rest.
+        if ((lo == 0 || hi == 255) && inner_lo <= inner_hi)
+        {
+            uint64_t six_indices;
+            float    six_error = evaluate_bc4(values, inner_lo, inner_hi, six_indices);
+
+            if (six_error < error)
+            {
+                error   = six_error;
+                indices = six_indices;
+                e0      = inner_lo;
+                e1      = inner_hi;
+            }
+        }
+
+        if (quality == COMPRESSION_QUALITY_HIGH && hi - lo > 8)
+        {
+            for (int a = hi; a >= hi - 4; a--)
+            {
+                for (int b = lo; b <= lo + 4; b++)
+                {
+                    uint64_t candidate_indices;
+                    float    candidate_error = evaluate_bc4(values, a, b, candidate_indices);
+
+                    if (candidate_error < error)
+                    {
+                        error   = candidate_error;
+                        indices = candidate_indices;
+                        e0      = a;
+                        e1      = b;
+                    }
+                }
+            }
+        }
+    }
+
+    dst[0] = uint8_t(e0);
+    dst[1] = uint8_t(e1);
+
+    for (int i = 0; i < 6; i++)
+        dst[2 + i] = uint8_t(indices >> (8 * i));
+}
+
+// ----------------------------------------------------------------------------
+
+bool bc_encoder_supports(const CompressionType& compression)
+{
+    return compression == COMPRESSION_BC1 || compression == COMPRESSION_BC1a || compression == COMPRESSION_BC3 || compression == COMPRESSION_BC4 || compression == COMPRESSION_BC5 || compression == COMPRESSION_BC7;
+}
+
+void bc_encode(const CompressionType&    compression,
+               const CompressionQuality& quality,
+               const uint8_t*            src,
+               int                       width,
+               int                       height,
+               int                       components,
+               void*                     dst)
+{
+    if (compression == COMPRESSION_BC7)
+    {
+        bc7_encode(bc7_preset(quality), src, width, height, components, dst);
+        return;
+    }
+
+    const int    blocks_x   = std::max(1, (width + 3) / 4);
+    const int    blocks_y   = std::max(1, (height + 3) / 4);
+    const size_t block_size = compressed_block_size(compression);
+
+    parallel_for(0, blocks_y, [&](int32_t by) {
+        uint8_t*   out = (uint8_t*)dst + size_t(by) * blocks_x * block_size;
+        ColorBlock block;
+
+        for (int bx = 0; bx < blocks_x; bx++, out += block_size)
+        {
+            load_block(src, width, height, components, bx, by, block);
+
+            if (compression == COMPRESSION_BC1)
+                encode_bc1_block(block, quality, out);
+            else if (compression == COMPRESSION_BC1a)
+                encode_bc1a_block(block, quality, out);
+            else if (compression == COMPRESSION_BC3)
+            {
+                encode_bc4_block(block.a, quality, out);
+                encode_bc1_block(block, quality, out + 8);
+            }
+            else if (compression == COMPRESSION_BC4)
+                encode_bc4_block(block.r, quality, out);
+            else if (compression == COMPRESSION_BC5)
+            {
+                encode_bc4_block(block.r, quality, out);
+                encode_bc4_block(block.g, quality, out + 8);
+            }
+        }
+    });
+}
+} // namespace ast
@@ -0,0 +1,644 @@
+#include <exporter/compression_selector.h>
+#include <exporter/bc_encoder.h>
+#include <common/filesystem.h>
+#include <common/parallel.h>
+#include <nvimage/BlockDXT.h>
+#include <nvimage/ColorBlock.h>
+#include <nvmath/Vector.inl>
+#include <json.hpp>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// Size of the tiles analyzed on large images, a multiple of the block and SSIM window sizes.
+#define COMPRESSION_SAMPLE_TILE_SIZE 64
+#define COMPRESSION_SSIM_WINDOW 8
+// PSNR reported for candidates without any error.
+#define COMPRESSION_MAX_PSNR 100.0f
+
+namespace ast
+{
+static const char* compression_name(const CompressionType& compression)
+{
+    switch (compression)
+    {
+        case COMPRESSION_BC1:
+            return "bc1";
+        case COMPRESSION_BC1a:
+            return "bc1a";
+        case COMPRESSION_BC3:
+            return "bc3";
+        case COMPRESSION_BC4:
+            return "bc4";
+        case COMPRESSION_BC5:
+            return "bc5";
+        case COMPRESSION_BC6:
+            return "bc6";
+        case COMPRESSION_BC7:
+            return "bc7";
+        default:
+            return "none";
+    }
+}
+
+struct ImageContent
+{
+    bool opaque    = true; // Alpha is 255 everywhere, or there is no alpha channel.
+    bool cutout    = true; // Alpha is only 0 or 255.
+    bool grayscale = true; // Red, green and blue are equal everywhere.
+};
+
+static ImageContent analyze_content(const Image& img)
+{
+    ImageContent content;
+
+    const uint8_t* pixels = (const uint8_t*)img.data[0][0].data;
+    const size_t   count  = size_t(img.data[0][0].width) * img.data[0][0].height;
+
+    content.grayscale = img.components >= 3;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t* pixel = pixels + i * img.components;
+
+        if (content.grayscale && (pixel[0] != pixel[1] || pixel[0] != pixel[2]))
+            content.grayscale = false;
+
+        if (img.components == 4 && pixel[3] != 255)
+        {
+            content.opaque = false;
+
+            if (pixel[3] != 0)
+                content.cutout = false;
+        }
+    }
+
+    if (content.opaque)
+        content.cutout = false;
+
+    return content;
+}
+
+// Copies the analyzed part of mip 0 into a tightly packed buffer: the whole level, or tiles stacked in a column. Tile
+// rows are spread evenly over the image and tile columns follow the golden ratio sequence, so no column is favored.
+static void gather_samples(const Image& img, int sample_tiles, std::vector<uint8_t>& samples, int& width, int& height)
+{
+    const uint8_t* pixels     = (const uint8_t*)img.data[0][0].data;
+    const int      src_width  = img.data[0][0].width;
+    const int      src_height = img.data[0][0].height;
+    const int      tiles_x    = src_width / COMPRESSION_SAMPLE_TILE_SIZE;
+    const int      tiles_y    = src_height / COMPRESSION_SAMPLE_TILE_SIZE;
+    const size_t   pixel_size = img.components * size_t(img.type);
+
+    if (sample_tiles <= 0 || tiles_x * tiles_y <= sample_tiles)
+    {
+        width  = src_width;
+        height = src_height;
+
+        samples.assign(pixels, pixels + size_t(width) * height * pixel_size);
+        return;
+    }
+
+    width  = COMPRESSION_SAMPLE_TILE_SIZE;
+    height = COMPRESSION_SAMPLE_TILE_SIZE * sample_tiles;
+
+    samples.resize(size_t(width) * height * pixel_size);
+
+    for (int i = 0; i < sample_tiles; i++)
+    {
+        const int tile_x = std::min(int(fmodf(float(i) * 0.618034f, 1.0f) * float(tiles_x)), tiles_x - 1);
+        const int tile_y = ((2 * i + 1) * tiles_y) / (2 * sample_tiles);
+
+        for (int y = 0; y < COMPRESSION_SAMPLE_TILE_SIZE; y++)
+        {
+            const uint8_t* src = pixels + ((size_t(tile_y) * COMPRESSION_SAMPLE_TILE_SIZE + y) * src_width + size_t(tile_x) * COMPRESSION_SAMPLE_TILE_SIZE) * pixel_size;
+            uint8_t*       dst = samples.data() + (size_t(i) * COMPRESSION_SAMPLE_TILE_SIZE + y) * width * pixel_size;
+
+            std::copy(src, src + COMPRESSION_SAMPLE_TILE_SIZE * pixel_size, dst);
+        }
+    }
+}
+
+// Decodes BC1, BC1a, BC3, BC4, BC5 or BC7 blocks into RGBA8 pixels.
+static void decode_blocks(const CompressionType& compression, const uint8_t* blocks, int width, int height, uint8_t* dst)
+{
+    const int    blocks_x   = (width + 3) / 4;
+    const int    blocks_y   = (height + 3) / 4;
+    const size_t block_size = compressed_block_size(compression);
+
+    parallel_for(0, blocks_y, [&](int32_t block_y) {
+        for (int block_x = 0; block_x < blocks_x; block_x++)
+        {
+            const uint8_t* block = blocks + (size_t(block_y) * blocks_x + block_x) * block_size;
+
+            nv::ColorBlock colors;
+
+            if (compression == COMPRESSION_BC1 || compression == COMPRESSION_BC1a)
+                ((const nv::BlockDXT1*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC3)
+                ((const nv::BlockDXT5*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC4)
+                ((const nv::BlockATI1*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC5)
+                ((const nv::BlockATI2*)block)->decodeBlock(&colors);
+            else
+                ((const nv::BlockBC7*)block)->decodeBlock(&colors);
+
+            for (int y = 0; y < 4 && block_y * 4 + y < height; y++)
+            {
+                for (int x = 0; x < 4 && block_x * 4 + x < width; x++)
+                {
+                    const nv::Color32 color = colors.color(x, y);
+                    uint8_t*          pixel = dst + (size_t(block_y * 4 + y) * width + block_x * 4 + x) * 4;
+
+                    pixel[0] = color.r;
+                    pixel[1] = color.g;
+                    pixel[2] = color.b;
+                    pixel[3] = color.a;
+                }
+            }
+        }
+    });
+}
+
+// Decodes BC6H blocks into RGBA float pixels with an alpha of 1.
+static void decode_bc6_blocks(const uint8_t* blocks, int width, int height, float* dst)
+{
+    const int    blocks_x   = (width + 3) / 4;
+    const int    blocks_y   = (height + 3) / 4;
+    const size_t block_size = compressed_block_size(COMPRESSION_BC6);
+
+    parallel_for(0, blocks_y, [&](int32_t block_y) {
+        for (int block_x = 0; block_x < blocks_x; block_x++)
+        {
+            nv::Vector4 colors[16];
+
+            ((const nv::BlockBC6*)(blocks + (size_t(block_y) * blocks_x + block_x) * block_size))->decodeBlock(colors);
+
+            for (int y = 0; y < 4 && block_y * 4 + y < height; y++)
+            {
+                for (int x = 0; x < 4 && block_x * 4 + x < width; x++)
+                {
+                    const nv::Vector4& color = colors[y * 4 + x];
+                    float*             pixel = dst + (size_t(block_y * 4 + y) * width + block_x * 4 + x) * 4;
+
+                    pixel[0] = color.x;
+                    pixel[1] = color.y;
+                    pixel[2] = color.z;
+                    pixel[3] = 1.0f;
+                }
+            }
+        }
+    });
+}
+
+// Maps radiance to [0, 255] on a log2(1 + x) scale relative to the brightest sample, so an error in the shadows weighs
+// as much as a proportional error in the highlights. Negative values, which BC6H cannot store, map to 0.
+static void log_scale(const float* src, int components, size_t count, int channels, float peak, float* dst)
+{
+    const float scale = peak > 0.0f ? 255.0f / log2f(1.0f + peak) : 0.0f;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < channels; c++)
+            dst[i * 4 + c] = log2f(1.0f + std::max(src[i * components + c], 0.0f)) * scale;
+    }
+}
+
+template <typename T>
+static float measure_psnr(const T* src, int components, const T* decoded, size_t count, int channels)
+{
+    double error = 0.0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            const double delta = double(src[i * components + c]) - double(decoded[i * 4 + c]);
+            error += delta * delta;
+        }
+    }
+
+    const double mse = error / (double(count) * channels);
+
+    if (mse == 0.0)
+        return COMPRESSION_MAX_PSNR;
+
+    return std::min(float(10.0 * log10(255.0 * 255.0 / mse)), COMPRESSION_MAX_PSNR);
+}
+
+// Mean SSIM of every channel over non-overlapping windows, which matches the block granularity of the formats.
+template <typename T>
+static float measure_ssim(const T* src, int components, const T* decoded, int width, int height, int channels)
+{
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+    const int window_w  = std::min(width, COMPRESSION_SSIM_WINDOW);
+    const int window_h  = std::min(height, COMPRESSION_SSIM_WINDOW);
+    const int windows_x = width / window_w;
+    const int windows_y = height / window_h;
+
+    std::vector<double> row_ssim(windows_y, 0.0);
+
+    parallel_for(0, windows_y, [&](int32_t window_y) {
+        double sum = 0.0;
+
+        for (int window_x = 0; window_x < windows_x; window_x++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                double mean_a = 0.0, mean_b = 0.0, var_a = 0.0, var_b = 0.0, covar = 0.0;
+
+                for (int y = 0; y < window_h; y++)
+                {
+                    for (int x = 0; x < window_w; x++)
+                    {
+                        const size_t i = size_t(window_y * window_h + y) * width + window_x * window_w + x;
+                        const double a = src[i * components + c];
+                        const double b = decoded[i * 4 + c];
+
+                        mean_a += a;
+                        mean_b += b;
+                        var_a += a * a;
+                        var_b += b * b;
+                        covar += a * b;
+                    }
+                }
+
+                const double n = double(window_w * window_h);
+
+                mean_a /= n;
+                mean_b /= n;
+                var_a = var_a / n - mean_a * mean_a;
+                var_b = var_b / n - mean_b * mean_b;
+                covar = covar / n - mean_a * mean_b;
+
+                sum += ((2.0 * mean_a * mean_b + c1) * (2.0 * covar + c2)) / ((mean_a * mean_a + mean_b * mean_b + c1) * (var_a + var_b + c2));
+            }
+        }
+
+        row_ssim[window_y] = sum;
+    });
+
+    double sum = 0.0;
+
+    for (double ssim : row_ssim)
+        sum += ssim;
+
+    return float(sum / (double(windows_x) * windows_y * channels));
+}
+
+static void decode_normal(const uint8_t* pixel, int components, bool reconstruct_z, float* n)
+{
+    n[0] = float(pixel[0]) / 127.5f - 1.0f;
+    n[1] = float(pixel[1]) / 127.5f - 1.0f;
+
+    if (reconstruct_z || components < 3)
+        n[2] = sqrtf(std::max(1.0f - n[0] * n[0] - n[1] * n[1], 0.0f));
+    else
+        n[2] = float(pixel[2]) / 127.5f - 1.0f;
+}
+
+// Mean angle in degrees between the source and decoded normals. Two channel sources and BC5 store X and Y only, their
+// Z is reconstructed like a shader would.
+static float measure_normal_error(const uint8_t* src, int components, const uint8_t* decoded, size_t count, bool reconstruct_z)
+{
+    double error = 0.0;
+    size_t valid = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float a[3], b[3];
+
+        decode_normal(src + i * components, components, false, a);
+        decode_normal(decoded + i * 4, 4, reconstruct_z || components < 3, b);
+
+        const float length_a = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        const float length_b = sqrtf(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+
+        // Texels without a direction, such as unused atlas space, have no angular error.
+        if (length_a < 1e-3f || length_b < 1e-3f)
+            continue;
+
+        const float cos_angle = (a[0] * b[0] + a[1] * b[1] + a[2] * b[2]) / (length_a * length_b);
+
+        error += acos(std::min(std::max(cos_angle, -1.0f), 1.0f));
+        valid++;
+    }
+
+    return valid > 0 ? float(error / double(valid) * 180.0 / M_PI) : 0.0f;
+}
+
+// Alpha of 1 everywhere, BC6H does not store alpha.
+static bool is_opaque_float(const Image& img)
+{
+    if (img.components != 4)
+        return true;
+
+    const uint8_t* pixels = (const uint8_t*)img.data[0][0].data;
+    const int      width  = img.data[0][0].width;
+    const int      height = img.data[0][0].height;
+
+    std::vector<float> row(size_t(width) * 4);
+
+    for (int y = 0; y < height; y++)
+    {
+        convert_pixels(pixels + size_t(y) * width * 4 * size_t(img.type), img.type, row.data(), PIXEL_TYPE_FLOAT32, row.size());
+
+        for (int x = 0; x < width; x++)
+        {
+            if (row[size_t(x) * 4 + 3] != 1.0f)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Measures BC6H on the log scale against the PSNR and SSIM target. Float images keep their pixels if it misses, or if
+// their alpha channel is used.
+static void select_float_compression(const Image& img, const CompressionQuality& quality, const CompressionTarget& target, CompressionSelection& selection)
+{
+    selection.compression = COMPRESSION_NONE;
+    selection.analyzed    = true;
+
+    if (!is_opaque_float(img))
+        return;
+
+    std::vector<uint8_t> samples;
+    int                  width  = 0;
+    int                  height = 0;
+
+    gather_samples(img, target.sample_tiles, samples, width, height);
+
+    const size_t count    = size_t(width) * height;
+    const int    channels = std::min(img.components, 3);
+
+    std::vector<float> pixels(count * img.components);
+
+    convert_pixels(samples.data(), img.type, pixels.data(), PIXEL_TYPE_FLOAT32, pixels.size());
+
+    std::vector<uint8_t> blocks(compressed_size(COMPRESSION_BC6, width, height));
+    std::vector<float>   decoded(count * 4);
+
+    bc6h_encode(bc6h_preset(quality), pixels.data(), width, height, img.components, blocks.data());
+    decode_bc6_blocks(blocks.data(), width, height, decoded.data());
+
+    float peak = 0.0f;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < channels; c++)
+            peak = std::max(peak, pixels[i * img.components + c]);
+    }
+
+    std::vector<float> src_scaled(count * 4);
+    std::vector<float> decoded_scaled(count * 4);
+
+    log_scale(pixels.data(), img.components, count, channels, peak, src_scaled.data());
+    log_scale(decoded.data(), 4, count, channels, peak, decoded_scaled.data());
+
+    CompressionCandidate candidate;
+
+    candidate.compression = COMPRESSION_BC6;
+    candidate.psnr        = measure_psnr(src_scaled.data(), 4, decoded_scaled.data(), count, channels);
+    candidate.ssim        = measure_ssim(src_scaled.data(), 4, decoded_scaled.data(), width, height, channels);
+    candidate.passed      = candidate.psnr >= target.min_psnr && candidate.ssim >= target.min_ssim;
+
+    selection.candidates.push_back(candidate);
+
+    if (candidate.passed)
+        selection.compression = COMPRESSION_BC6;
+}
+
+// Higher is better. Normal maps are ranked by their angular error, color by PSNR with SSIM breaking ties.
+static bool more_accurate(const CompressionCandidate& a, const CompressionCandidate& b, bool normal_map)
+{
+    if (normal_map)
+        return a.normal_error < b.normal_error;
+
+    if (a.psnr != b.psnr)
+        return a.psnr > b.psnr;
+
+    return a.ssim > b.ssim;
+}
+
+bool select_compression(const Image& img, bool normal_map, const CompressionQuality& quality, const CompressionTarget& target, CompressionSelection& selection)
+{
+    selection = CompressionSelection();
+
+    if (img.data.empty() || img.data[0][0].width <= 0 || img.data[0][0].height <= 0 || img.components < 1 || img.components > 4)
+    {
+        std::cout << "ERROR::Cannot select a compression for an empty image!" << std::endl;
+        return false;
+    }
+
+    if (img.compression != COMPRESSION_NONE)
+    {
+        selection.compression = img.compression;
+        return true;
+    }
+
+    if (img.type != PIXEL_TYPE_UNORM8)
+    {
+        select_float_compression(img, quality, target, selection);
+        return true;
+    }
+
+    const ImageContent content = analyze_content(img);
+
+    // Normal maps with a meaningful alpha channel are judged like color, so the alpha channel is part of the error.
+    selection.normal_map = normal_map && img.components >= 2 && content.opaque;
+    selection.grayscale  = content.grayscale;
+
+    // PSNR and SSIM of normal maps cover X and Y, which every candidate stores.
+    const int channels = selection.normal_map ? 2 : ((img.components == 4 && content.opaque) ? 3 : img.components);
+
+    std::vector<CompressionType> formats;
+
+    // BC5 drops the Z of normal maps, which only shaders that rebuild it can read.
+    if (img.components == 2 || (selection.normal_map && target.allow_bc5_normals))
+        formats = { COMPRESSION_BC1, COMPRESSION_BC5, COMPRESSION_BC7 };
+    else if (selection.normal_map)
+        formats = { COMPRESSION_BC1, COMPRESSION_BC7 };
+    else if (img.components == 1)
+        formats = { COMPRESSION_BC4, COMPRESSION_BC7 };
+    else if (content.opaque && content.grayscale)
+        formats = { COMPRESSION_BC4, COMPRESSION_BC1, COMPRESSION_BC7 };
+    else if (content.opaque)
+        formats = { COMPRESSION_BC1, COMPRESSION_BC7 };
+    else if (content.cutout)
+        formats = { COMPRESSION_BC1a, COMPRESSION_BC3, COMPRESSION_BC7 };
+    else
+        formats = { COMPRESSION_BC3, COMPRESSION_BC7 };
+
+    std::vector<uint8_t> samples;
+    int                  width  = 0;
+    int                  height = 0;
+
+    gather_samples(img, target.sample_tiles, samples, width, height);
+
+    const size_t count = size_t(width) * height;
+
+    std::vector<uint8_t> blocks;
+    std::vector<uint8_t> decoded(count * 4);
+    std::vector<uint8_t> reference;
+
+    for (const CompressionType& format : formats)
+    {
+        blocks.resize(compressed_size(format, width, height));
+
+        bc_encode(format, quality, samples.data(), width, height, img.components, blocks.data());
+        decode_blocks(format, blocks.data(), width, height, decoded.data());
+
+        // The color of fully transparent cutout pixels is never seen, so it takes the decoded color and only alpha
+        // counts towards the error there.
+        const uint8_t* src = samples.data();
+
+        if (content.cutout)
+        {
+            reference = samples;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (reference[i * 4 + 3] == 0)
+                    std::copy(&decoded[i * 4], &decoded[i * 4 + 3], &reference[i * 4]);
+            }
+
+            src = reference.data();
+        }
+
+        CompressionCandidate candidate;
+
+        candidate.compression = format;
+        candidate.psnr        = measure_psnr(src, img.components, decoded.data(), count, channels);
+        candidate.ssim        = measure_ssim(src, img.components, decoded.data(), width, height, channels);
+
+        if (selection.normal_map)
+        {
+            candidate.normal_error = measure_normal_error(src, img.components, decoded.data(), count, format == COMPRESSION_BC5);
+            candidate.passed       = candidate.normal_error <= target.max_normal_error;
+        }
+        else
+            candidate.passed = candidate.psnr >= target.min_psnr && candidate.ssim >= target.min_ssim;
+
+        selection.candidates.push_back(candidate);
+    }
+
+    const CompressionCandidate* picked = nullptr;
+
+    for (const auto& candidate : selection.candidates)
+    {
+        if (!candidate.passed)
+            continue;
+
+        if (!picked)
+            picked = &candidate;
+        else if (compressed_block_size(candidate.compression) == compressed_block_size(picked->compression) && more_accurate(candidate, *picked, selection.normal_map))
+            picked = &candidate;
+    }
+
+    if (!picked)
+    {
+        for (const auto& candidate : selection.candidates)
+        {
+            if (!picked || more_accurate(candidate, *picked, selection.normal_map))
+                picked = &candidate;
+        }
+    }
+
+    selection.compression = picked->compression;
+    selection.analyzed    = true;
+
+    return true;
+}
+
+std::string compression_metadata_path(const std::string& image_path)
+{
+    const size_t extension = image_path.find_last_of('.');
+    const size_t separator = image_path.find_last_of("/\\");
+
+    if (extension == std::string::npos || (separator != std::string::npos && extension < separator))
+        return image_path + "_compression.json";
+
+    return image_path.substr(0, extension) + "_compression.json";
+}
+
+bool write_compression_metadata(const std::string& path, const CompressionTarget& target, const CompressionSelection& selection)
+{
+    nlohmann::json doc;
+
+    doc["compression"] = compression_name(selection.compression);
+    doc["analyzed"]    = selection.analyzed;
+
+    if (selection.compression == COMPRESSION_BC4 && selection.grayscale)
+        doc["swizzle"] = "rrr1";
+
+    if (selection.compression == COMPRESSION_BC5 && selection.normal_map)
+        doc["reconstruct_z"] = true;
+
+    nlohmann::json target_json;
+
+    if (selection.normal_map)
+        target_json["max_normal_error"] = target.max_normal_error;
+    else
+    {
+        target_json["min_psnr"] = target.min_psnr;
+        target_json["min_ssim"] = target.min_ssim;
+    }
+
+    target_json["sample_tiles"] = target.sample_tiles;
+
+    if (selection.normal_map)
+        target_json["allow_bc5_normals"] = target.allow_bc5_normals;
+
+    doc["target"] = target_json;
+
+    nlohmann::json candidates = nlohmann::json::array();
+
+    for (const auto& candidate : selection.candidates)
+    {
+        nlohmann::json candidate_json;
+
+        candidate_json["compression"]    = compression_name(candidate.compression);
+        candidate_json["bits_per_pixel"] = compressed_block_size(candidate.compression) / 2;
+        candidate_json["psnr"]           = candidate.psnr;
+        candidate_json["ssim"]           = candidate.ssim;
+
+        if (selection.normal_map)
+            candidate_json["normal_error"] = candidate.normal_error;
+
+        candidate_json["passed"] = candidate.passed;
+
+        candidates.push_back(candidate_json);
+    }
+
+    doc["candidates"] = candidates;
+
+    const std::string output_str = doc.dump(4);
+    const std::string temp_path  = filesystem::temp_file_path(path);
+
+    std::fstream f(temp_path, std::ios::out);
+
+    if (!f.is_open())
+    {
+        std::cout << "ERROR::Failed to open file: " << temp_path << std::endl;
+        return false;
+    }
+
+    f.write(output_str.c_str(), output_str.size());
+    f.close();
+
+    if (f.fail() || !filesystem::publish_file(temp_path, path))
+    {
+        remove(temp_path.c_str());
+        std::cout << "ERROR::Failed to write compression metadata: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+} // namespace ast
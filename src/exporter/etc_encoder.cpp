@@ -0,0 +1,552 @@
+#include <exporter/etc_encoder.h>
+#include <common/parallel.h>
+#include <algorithm>
+#include <math.h>
+
+namespace ast
+{
+// Modifiers in pixel index order: +a, +b, -a, -b.
+static const int kETCModifiers[8][4] = {
+    { 2, 8, -2, -8 },
+    { 5, 17, -5, -17 },
+    { 9, 29, -9, -29 },
+    { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 },
+    { 24, 80, -24, -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+};
+
+static const int kEACModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+// Pixels are stored row-major, ETC blocks index them column-major (x * 4 + y).
+struct ETCBlock
+{
+    int c[4][16];
+};
+
+struct ETCSubBlockFit
+{
+    int      color[3]; // Quantized base color
+    int      table;
+    uint32_t selectors; // Two bits per pixel, indexed by the row-major pixel position
+    int      error;
+};
+
+static inline int clamp255(int value)
+{
+    return std::min(std::max(value, 0), 255);
+}
+
+static inline int expand4(int value)
+{
+    return (value << 4) | value;
+}
+
+static inline int expand5(int value)
+{
+    return (value << 3) | (value >> 2);
+}
+
+static inline int expand6(int value)
+{
+    return (value << 2) | (value >> 4);
+}
+
+static inline int expand7(int value)
+{
+    return (value << 1) | (value >> 6);
+}
+
+static void store_big_endian(uint64_t bits, uint8_t* dst)
+{
+    for (int i = 0; i < 8; i++)
+        dst[i] = uint8_t(bits >> (56 - 8 * i));
+}
+
+// Picks the table and per-pixel modifiers for one sub-block around an expanded 8-bit base color.
+static void fit_subblock(const ETCBlock& block, const int* pixels, const int base[3], ETCSubBlockFit& fit)
+{
+    fit.error = 0x7FFFFFFF;
+
+    for (int table = 0; table < 8; table++)
+    {
+        int      error     = 0;
+        uint32_t selectors = 0;
+
+        for (int i = 0; i < 8 && error < fit.error; i++)
+        {
+            const int p        = pixels[i];
+            int       best     = 0x7FFFFFFF;
+            int       best_sel = 0;
+
+            for (int s = 0; s < 4; s++)
+            {
+                const int m  = kETCModifiers[table][s];
+                const int dr = clamp255(base[0] + m) - block.c[0][p];
+                const int dg = clamp255(base[1] + m) - block.c[1][p];
+                const int db = clamp255(base[2] + m) - block.c[2][p];
+                const int d  = dr * dr + dg * dg + db * db;
+
+                if (d < best)
+                {
+                    best     = d;
+                    best_sel = s;
+                }
+            }
+
+            error += best;
+            selectors |= uint32_t(best_sel) << (2 * p);
+        }
+
+        if (error < fit.error)
+        {
+            fit.error     = error;
+            fit.table     = table;
+            fit.selectors = selectors;
+        }
+    }
+}
+
+// Evaluates quantized base colors around the sub-block average. Fast only tries the rounded average, normal also
+// shifts its luminance by one step and high tries every per-channel neighbour.
+static int fit_subblock_candidates(const ETCBlock& block, const int* pixels, int bits, const CompressionQuality& quality, ETCSubBlockFit* fits)
+{
+    const int max = (1 << bits) - 1;
+    float     avg[3] = { 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < 8; i++)
+    {
+        for (int ch = 0; ch < 3; ch++)
+            avg[ch] += block.c[ch][pixels[i]];
+    }
+
+    int center[3];
+
+    for (int ch = 0; ch < 3; ch++)
+        center[ch] = std::min(std::max(int(avg[ch] / 8.0f * max / 255.0f + 0.5f), 0), max);
+
+    const int radius = quality == COMPRESSION_QUALITY_FAST ? 0 : 1;
+    int       count  = 0;
+
+    for (int dr = -radius; dr <= radius; dr++)
+    {
+        for (int dg = -radius; dg <= radius; dg++)
+        {
+            for (int db = -radius; db <= radius; db++)
+            {
+                if (quality != COMPRESSION_QUALITY_HIGH && (dg != dr || db != dr))
+                    continue;
+
+                ETCSubBlockFit& fit = fits[count];
+
+                fit.color[0] = center[0] + dr;
+                fit.color[1] = center[1] + dg;
+                fit.color[2] = center[2] + db;
+
+                if (fit.color[0] < 0 || fit.color[0] > max || fit.color[1] < 0 || fit.color[1] > max || fit.color[2] < 0 || fit.color[2] > max)
+                    continue;
+
+                int base[3];
+
+                for (int ch = 0; ch < 3; ch++)
+                    base[ch] = bits == 4 ? expand4(fit.color[ch]) : expand5(fit.color[ch]);
+
+                fit_subblock(block, pixels, base, fit);
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+static uint64_t pack_selectors(uint32_t selectors)
+{
+    uint64_t bits = 0;
+
+    for (int p = 0; p < 16; p++)
+    {
+        const int s = (selectors >> (2 * p)) & 3;
+        const int i = (p & 3) * 4 + (p >> 2);
+
+        bits |= uint64_t(s >> 1) << (16 + i);
+        bits |= uint64_t(s & 1) << i;
+    }
+
+    return bits;
+}
+
+// Individual and differential modes, which are shared by ETC1 and ETC2.
+static uint64_t encode_etc1_block(const ETCBlock& block, const CompressionQuality& quality, int& best_error)
+{
+    static const int kSubBlocks[2][2][8] = {
+        { { 0, 4, 8, 12, 1, 5, 9, 13 }, { 2, 6, 10, 14, 3, 7, 11, 15 } },
+        { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } }
+    };
+
+    uint64_t best_bits = 0;
+    best_error         = 0x7FFFFFFF;
+
+    for (int flip = 0; flip < 2; flip++)
+    {
+        ETCSubBlockFit fits[2][27];
+        int            counts[2];
+
+        // Differential: 555 base color plus a 333 signed delta for the second sub-block.
+        counts[0] = fit_subblock_candidates(block, kSubBlocks[flip][0], 5, quality, fits[0]);
+        counts[1] = fit_subblock_candidates(block, kSubBlocks[flip][1], 5, quality, fits[1]);
+
+        for (int a = 0; a < counts[0]; a++)
+        {
+            for (int b = 0; b < counts[1]; b++)
+            {
+                const ETCSubBlockFit& f0 = fits[0][a];
+                const ETCSubBlockFit& f1 = fits[1][b];
+
+                if (f0.error + f1.error >= best_error)
+                    continue;
+
+                int  delta[3];
+                bool valid = true;
+
+                for (int ch = 0; ch < 3; ch++)
+                {
+                    delta[ch] = f1.color[ch] - f0.color[ch];
+                    valid &= delta[ch] >= -4 && delta[ch] <= 3;
+                }
+
+                if (!valid)
+                    continue;
+
+                best_error = f0.error + f1.error;
+                best_bits  = (uint64_t(f0.color[0]) << 59) | (uint64_t(delta[0] & 7) << 56) |
+                            (uint64_t(f0.color[1]) << 51) | (uint64_t(delta[1] & 7) << 48) |
+                            (uint64_t(f0.color[2]) << 43) | (uint64_t(delta[2] & 7) << 40) |
+                            (uint64_t(f0.table) << 37) | (uint64_t(f1.table) << 34) | (uint64_t(1) << 33) | (uint64_t(flip) << 32) |
+                            pack_selectors(f0.selectors | f1.selectors);
+            }
+        }
+
+        // Individual: two independent 444 base colors.
+        counts[0] = fit_subblock_candidates(block, kSubBlocks[flip][0], 4, quality, fits[0]);
+        counts[1] = fit_subblock_candidates(block, kSubBlocks[flip][1], 4, quality, fits[1]);
+
+        const ETCSubBlockFit* f0 = std::min_element(fits[0], fits[0] + counts[0], [](const ETCSubBlockFit& x, const ETCSubBlockFit& y) { return x.error < y.error; });
+        const ETCSubBlockFit* f1 = std::min_element(fits[1], fits[1] + counts[1], [](const ETCSubBlockFit& x, const ETCSubBlockFit& y) { return x.error < y.error; });
+
+        if (f0->error + f1->error < best_error)
+        {
+            best_error = f0->error + f1->error;
+            best_bits  = (uint64_t(f0->color[0]) << 60) | (uint64_t(f1->color[0]) << 56) |
+                        (uint64_t(f0->color[1]) << 52) | (uint64_t(f1->color[1]) << 48) |
+                        (uint64_t(f0->color[2]) << 44) | (uint64_t(f1->color[2]) << 40) |
+                        (uint64_t(f0->table) << 37) | (uint64_t(f1->table) << 34) | (uint64_t(flip) << 32) |
+                        pack_selectors(f0->selectors | f1->selectors);
+        }
+    }
+
+    return best_bits;
+}
+
+static int planar_error(const ETCBlock& block, const int o[3], const int h[3], const int v[3])
+{
+    int error = 0;
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        const int eo = ch == 1 ? expand7(o[ch]) : expand6(o[ch]);
+        const int eh = ch == 1 ? expand7(h[ch]) : expand6(h[ch]);
+        const int ev = ch == 1 ? expand7(v[ch]) : expand6(v[ch]);
+
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                const int d = clamp255((4 * eo + x * (eh - eo) + y * (ev - eo) + 2) >> 2) - block.c[ch][y * 4 + x];
+                error += d * d;
+            }
+        }
+    }
+
+    return error;
+}
+
+// ETC2 planar mode: least squares fit of a gradient, then a greedy +-1 search on the quantized colors.
+static uint64_t encode_planar_block(const ETCBlock& block, const CompressionQuality& quality, int& error)
+{
+    int o[3], h[3], v[3];
+
+    for (int ch = 0; ch < 3; ch++)
+    {
+        float mean = 0.0f, gx = 0.0f, gy = 0.0f;
+
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                const float c = float(block.c[ch][y * 4 + x]);
+
+                mean += c;
+                gx += (x - 1.5f) * c;
+                gy += (y - 1.5f) * c;
+            }
+        }
+
+        // Both coordinates have a variance of 1.25 over the block, summed over 16 pixels.
+        const float dx  = gx / 20.0f;
+        const float dy  = gy / 20.0f;
+        const float co  = mean / 16.0f - 1.5f * dx - 1.5f * dy;
+        const int   max = ch == 1 ? 127 : 63;
+
+        o[ch] = std::min(std::max(int(co * max / 255.0f + 0.5f), 0), max);
+        h[ch] = std::min(std::max(int((co + 4.0f * dx) * max / 255.0f + 0.5f), 0), max);
+        v[ch] = std::min(std::max(int((co + 4.0f * dy) * max / 255.0f + 0.5f), 0), max);
+    }
+
+    error = planar_error(block, o, h, v);
+
+    if (quality != COMPRESSION_QUALITY_FAST)
+    {
+        int* values[3] = { o, h, v };
+
+        for (int pass = 0; pass < (quality == COMPRESSION_QUALITY_HIGH ? 2 : 1); pass++)
+        {
+            for (int ch = 0; ch < 3; ch++)
+            {
+                const int max = ch == 1 ? 127 : 63;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    for (int step = -1; step <= 1; step += 2)
+                    {
+                        const int original = values[k][ch];
+
+                        values[k][ch] = std::min(std::max(original + step, 0), max);
+
+                        const int e = planar_error(block, o, h, v);
+
+                        if (e < error)
+                            error = e;
+                        else
+                            values[k][ch] = original;
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t bits = (uint64_t(o[0]) << 57) | (uint64_t(o[1] >> 6) << 56) | (uint64_t(o[1] & 0x3F) << 49) |
+                    (uint64_t(o[2] >> 5) << 48) | (uint64_t((o[2] >> 3) & 3) << 43) | (uint64_t((o[2] >> 1) & 3) << 40) |
+                    (uint64_t(h[0] >> 1) << 34) | (uint64_t(1) << 33) | (uint64_t(h[0] & 1) << 32) | (uint64_t(o[2] & 1) << 39) |
+                    (uint64_t(h[1]) << 25) | (uint64_t(h[2]) << 19) |
+                    (uint64_t(v[0]) << 13) | (uint64_t(v[1]) << 6) | uint64_t(v[2]);
+
+    // Planar mode is signalled by valid red and green differentials and an overflowing blue one.
+    const int red   = int(bits >> 59) & 0x1F;
+    const int green = int(bits >> 51) & 0x1F;
+    const int blue  = int(bits >> 43) & 0x1F;
+    const int dr    = (int(bits >> 56) & 7) - ((bits >> 58) & 1 ? 8 : 0);
+    const int dg    = (int(bits >> 48) & 7) - ((bits >> 50) & 1 ? 8 : 0);
+    const int db    = int(bits >> 40) & 3;
+
+    if (red + dr < 0 || red + dr > 31)
+        bits |= uint64_t(1) << 63;
+
+    if (green + dg < 0 || green + dg > 31)
+        bits |= uint64_t(1) << 55;
+
+    if ((blue & 3) + db >= 4)
+        bits |= uint64_t(7) << 45;
+    else
+        bits |= uint64_t(1) << 42;
+
+    return bits;
+}
+
+static inline int eac_decode(int base, int multiplier, int modifier, bool eleven_bit)
+{
+    if (eleven_bit)
+        return std::min(std::max(base * 8 + 4 + modifier * (multiplier == 0 ? 1 : multiplier * 8), 0), 2047);
+    else
+        return clamp255(base + modifier * multiplier);
+}
+
+// Encodes one channel into an EAC block, either as 8-bit alpha for ETC2 RGBA or as R11/RG11.
+static void encode_eac_block(const int* values, bool eleven_bit, const CompressionQuality& quality, uint8_t* dst)
+{
+    int target[16];
+    int lo = 0x7FFFFFFF;
+    int hi = -1;
+
+    for (int i = 0; i < 16; i++)
+    {
+        target[i] = eleven_bit ? (values[i] * 2047 + 127) / 255 : values[i];
+        lo        = std::min(lo, target[i]);
+        hi        = std::max(hi, target[i]);
+    }
+
+    const int scale       = eleven_bit ? 8 : 1;
+    const int mul_radius  = quality == COMPRESSION_QUALITY_FAST ? 0 : 1;
+    const int base_radius = quality == COMPRESSION_QUALITY_FAST ? 0 : (quality == COMPRESSION_QUALITY_NORMAL ? 1 : 4);
+
+    int     best_error = 0x7FFFFFFF;
+    int     best_base = 0, best_mul = 1, best_table = 0;
+    uint8_t best_selectors[16] = {};
+
+    for (int table = 0; table < 16 && best_error > 0; table++)
+    {
+        const int   span   = (kEACModifiers[table][7] - kEACModifiers[table][3]) * scale;
+        const int   center = std::max(1, std::min(15, int(float(hi - lo) / span + 0.5f)));
+        const float mid    = (kEACModifiers[table][7] + kEACModifiers[table][3]) * 0.5f;
+
+        for (int mul = center - mul_radius; mul <= center + mul_radius; mul++)
+        {
+            if (mul < 1 || mul > 15)
+                continue;
+
+            const float offset    = (lo + hi) * 0.5f - mid * mul * scale;
+            const int   base_init = std::min(std::max(eleven_bit ? int(floorf((offset - 4.0f) / 8.0f + 0.5f)) : int(floorf(offset + 0.5f)), 0), 255);
+
+            for (int base = base_init - base_radius; base <= base_init + base_radius; base++)
+            {
+                if (base < 0 || base > 255)
+                    continue;
+
+                int     error = 0;
+                uint8_t selectors[16];
+
+                for (int i = 0; i < 16 && error < best_error; i++)
+                {
+                    int best = 0x7FFFFFFF;
+
+                    for (int s = 0; s < 8; s++)
+                    {
+                        const int d = eac_decode(base, mul, kEACModifiers[table][s], eleven_bit) - target[i];
+
+                        if (d * d < best)
+                        {
+                            best         = d * d;
+                            selectors[i] = uint8_t(s);
+                        }
+                    }
+
+                    error += best;
+                }
+
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_base  = base;
+                    best_mul   = mul;
+                    best_table = table;
+                    std::copy(selectors, selectors + 16, best_selectors);
+                }
+            }
+        }
+    }
+
+    uint64_t bits = (uint64_t(best_base) << 56) | (uint64_t(best_mul) << 52) | (uint64_t(best_table) << 48);
+
+    for (int p = 0; p < 16; p++)
+    {
+        const int i = (p & 3) * 4 + (p >> 2);
+        bits |= uint64_t(best_selectors[p]) << (45 - 3 * i);
+    }
+
+    store_big_endian(bits, dst);
+}
+
+static void encode_etc2_block(const ETCBlock& block, const CompressionQuality& quality, bool allow_planar, uint8_t* dst)
+{
+    int      error;
+    uint64_t bits = encode_etc1_block(block, quality, error);
+
+    if (allow_planar && error > 0)
+    {
+        int      planar_error;
+        uint64_t planar_bits = encode_planar_block(block, quality, planar_error);
+
+        if (planar_error < error)
+            bits = planar_bits;
+    }
+
+    store_big_endian(bits, dst);
+}
+
+bool etc_encoder_supports(const CompressionType& compression)
+{
+    return compression == COMPRESSION_ETC1 || compression == COMPRESSION_ETC2 || compression == COMPRESSION_ETC2_RGBA || compression == COMPRESSION_EAC_R11 || compression == COMPRESSION_EAC_RG11;
+}
+
+void etc_encode(const CompressionType&    compression,
+                const CompressionQuality& quality,
+                const uint8_t*            src,
+                int                       width,
+                int                       height,
+                int                       components,
+                void*                     dst)
+{
+    const int    blocks_x   = std::max(1, (width + 3) / 4);
+    const int    blocks_y   = std::max(1, (height + 3) / 4);
+    const size_t block_size = compressed_block_size(compression);
+
+    parallel_for(0, blocks_y, [&](int32_t by) {
+        uint8_t* out = (uint8_t*)dst + size_t(by) * blocks_x * block_size;
+        ETCBlock block;
+
+        for (int bx = 0; bx < blocks_x; bx++, out += block_size)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                const int sy = std::min(by * 4 + y, height - 1);
+
+                for (int x = 0; x < 4; x++)
+                {
+                    const int      sx = std::min(bx * 4 + x, width - 1);
+                    const uint8_t* p  = src + (size_t(sy) * width + sx) * components;
+
+                    block.c[0][y * 4 + x] = p[0];
+                    block.c[1][y * 4 + x] = components > 1 ? p[1] : 0;
+                    block.c[2][y * 4 + x] = components > 2 ? p[2] : 0;
+                    block.c[3][y * 4 + x] = components > 3 ? p[3] : 255;
+                }
+            }
+
+            if (compression == COMPRESSION_ETC1)
+                encode_etc2_block(block, quality, false, out);
+            else if (compression == COMPRESSION_ETC2)
+                encode_etc2_block(block, quality, true, out);
+            else if (compression == COMPRESSION_ETC2_RGBA)
+            {
+                encode_eac_block(block.c[3], false, quality, out);
+                encode_etc2_block(block, quality, true, out + 8);
+            }
+            else if (compression == COMPRESSION_EAC_R11)
+                encode_eac_block(block.c[0], true, quality, out);
+            else if (compression == COMPRESSION_EAC_RG11)
+            {
+                encode_eac_block(block.c[0], true, quality, out);
+                encode_eac_block(block.c[1], true, quality, out + 8);
+            }
+        }
+    });
+}
+} // namespace ast
@@ -1,24 +1,31 @@
 #include <exporter/image_exporter.h>
+#include <exporter/bc_encoder.h>
+#include <exporter/etc_encoder.h>
 #if defined(ENABLE_DEBUG_OUTPUT)
 #    include <loader/loader.h>
 #endif
+#include <common/build_cache.h>
 #include <common/filesystem.h>
 #include <common/header.h>
+#include <common/ktx2.h>
+#include <common/mip_generator.h>
+#include <common/sh.h>
 #include <cmft/image.h>
 #include <cmft/cubemapfilter.h>
 #include <nvtt/nvtt.h>
 #include <nvimage/Image.h>
 #include <nvimage/DirectDrawSurface.h>
+#include <stdio.h>
 #include <thread>
+#include <chrono>
+#include <vector>
+#include <numeric>
+#include <math.h>
+#include <string.h>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
-#define RADIANCE_MAP_SIZE 256
-#define CMFT_GLOSS_SCALE 10
-#define CMFT_GLOSS_BIAS 3
-#define RADIANCE_MAP_MIP_LEVELS 7
-
 #define WRITE_AND_OFFSET(stream, dest, size, offset) \
     stream.write((char*)dest, size);                 \
     offset += size;                                  \
@@ -36,16 +43,28 @@ const nvtt::Format kCompression[] = {
     nvtt::Format_BC4,
     nvtt::Format_BC5,
     nvtt::Format_BC6,
-    nvtt::Format_BC7
+    nvtt::Format_BC7,
+    nvtt::Format_ETC1,
+    nvtt::Format_ETC2_RGB,
+    nvtt::Format_PVR_4BPP_RGBA,
+    nvtt::Format_ETC2_RGBA,
+    nvtt::Format_ETC2_R,
+    nvtt::Format_ETC2_RG
+};
+
+const nvtt::Quality kQuality[] = {
+    nvtt::Quality_Fastest,
+    nvtt::Quality_Normal,
+    nvtt::Quality_Production
 };
 
 struct NVTTOutputHandler : public nvtt::OutputHandler
 {
-    std::fstream* stream;
-    long          offset;
-    int           mip_levels = 0;
-    int           mip_height;
-    int           compression_type;
+    std::vector<BINMipSliceHeader>* mip_headers;
+    std::vector<uint8_t>*           payload;
+    int                             mip_levels = 0;
+    int                             mip_height;
+    int                             compression_type;
 
     virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel) override
     {
@@ -59,9 +78,8 @@ struct NVTTOutputHandler : public nvtt::OutputHandler
         mip0Header.height = height;
         mip0Header.size   = size;
 
-        stream->write((char*)&mip0Header, sizeof(BINMipSliceHeader));
-        offset += sizeof(BINMipSliceHeader);
-        stream->seekp(offset);
+        mip_headers->push_back(mip0Header);
+        payload->reserve(payload->size() + size);
 
         mip_height = height;
         mip_levels++;
@@ -69,9 +87,7 @@ struct NVTTOutputHandler : public nvtt::OutputHandler
 
     virtual bool writeData(const void* data, int size) override
     {
-        stream->write((char*)data, size);
-        offset += size;
-        stream->seekp(offset);
+        payload->insert(payload->end(), (const uint8_t*)data, (const uint8_t*)data + size);
         return true;
     }
 
@@ -83,17 +99,6 @@ struct NVTTOutputHandler : public nvtt::OutputHandler
     }
 };
 
-#define FLIP_GREEN(type, num_components, dst_data)                                                \
-    Image::Pixel<type, num_components>* dst = (Image::Pixel<type, num_components>*)dst_data.data; \
-    for (int y = 0; y < dst_data.height; y++)                                                     \
-    {                                                                                             \
-        for (int x = 0; x < dst_data.width; x++)                                                  \
-        {                                                                                         \
-            type value                       = dst[y * dst_data.width + x].c[1];                  \
-            dst[y * dst_data.width + x].c[1] = std::numeric_limits<type>::max() - value;          \
-        }                                                                                         \
-    }
-
 #if defined(ENABLE_DEBUG_OUTPUT)
 void debug_export_image(const std::string& output, const std::string& name, ast::Image& image)
 {
@@ -148,8 +153,141 @@ void debug_read_and_export_image(const std::string& input, const std::string& na
 }
 #endif
 
-bool export_image(Image& img, const ImageExportOptions& options)
+// Writes the levels in KTX2 order: smallest mip first, and within every mip all array layers with their cubemap
+// faces back to back, so a mip of the whole texture is a single range of the file. level_data holds the levels in
+// .ast order (array slice major) with the sizes of mip_headers.
+static bool write_ktx2(const std::string&                    path,
+                       const Image&                          img,
+                       const CompressionType&                compression,
+                       bool                                  srgb,
+                       const std::vector<BINMipSliceHeader>& mip_headers,
+                       const uint8_t*                        level_data)
+{
+    const uint32_t vk_format = ktx2_vk_format(compression, img.type, img.components, srgb);
+
+    if (vk_format == 0)
+    {
+        std::cout << "ERROR::No KTX2 format for compression " << compression << " with " << img.components << " components of type " << img.type << std::endl;
+        return false;
+    }
+
+    if (img.cubemap && (img.array_slices % 6 != 0 || img.data[0][0].width != img.data[0][0].height))
+    {
+        std::cout << "ERROR::Cubemaps need square faces and 6 array slices per cube!" << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> dfd;
+    ktx2_data_format_descriptor(vk_format, dfd);
+
+    // The only key/value pair is the writer, which the spec asks every writer to record.
+    const char     key_value[]      = "KTXwriter\0asset-core";
+    const uint32_t key_value_length = sizeof(key_value);
+
+    std::vector<uint8_t> kvd((sizeof(uint32_t) + key_value_length + 3) & ~3u, 0);
+
+    memcpy(kvd.data(), &key_value_length, sizeof(uint32_t));
+    memcpy(kvd.data() + sizeof(uint32_t), key_value, key_value_length);
+
+    const int      mip_levels = img.mip_slices;
+    const uint32_t faces      = img.cubemap ? 6 : 1;
+    const uint32_t layers     = img.array_slices / faces;
+    const uint64_t alignment  = std::lcm(uint64_t(ktx2_texel_block_size(vk_format)), uint64_t(KTX2_LEVEL_ALIGNMENT));
+
+    KTX2Header header;
+
+    memcpy(header.identifier, kKTX2Identifier, KTX2_IDENTIFIER_SIZE);
+
+    header.vk_format               = vk_format;
+    header.type_size               = compression == COMPRESSION_NONE ? uint32_t(img.type) : 1;
+    header.pixel_width             = img.data[0][0].width;
+    header.pixel_height            = img.data[0][0].height;
+    header.pixel_depth             = 0;
+    header.layer_count             = layers > 1 ? layers : 0;
+    header.face_count              = faces;
+    header.level_count             = mip_levels;
+    header.supercompression_scheme = 0;
+    header.dfd_byte_offset         = uint32_t(sizeof(KTX2Header) + sizeof(KTX2LevelIndex) * mip_levels);
+    header.dfd_byte_length         = uint32_t(dfd.size() * sizeof(uint32_t));
+    header.kvd_byte_offset         = header.dfd_byte_offset + header.dfd_byte_length;
+    header.kvd_byte_length         = uint32_t(kvd.size());
+    header.sgd_byte_offset         = 0;
+    header.sgd_byte_length         = 0;
+
+    // Offsets of every level in level_data.
+    std::vector<size_t> src_offsets(mip_headers.size());
+    size_t              src_offset = 0;
+
+    for (size_t i = 0; i < mip_headers.size(); i++)
+    {
+        src_offsets[i] = src_offset;
+        src_offset += mip_headers[i].size;
+    }
+
+    std::vector<KTX2LevelIndex> level_index(mip_levels);
+    uint64_t                    offset = header.kvd_byte_offset + header.kvd_byte_length;
+
+    for (int mip = mip_levels - 1; mip >= 0; mip--)
+    {
+        offset = (offset + alignment - 1) / alignment * alignment;
+
+        level_index[mip].byte_offset = offset;
+        level_index[mip].byte_length = 0;
+
+        for (int i = 0; i < img.array_slices; i++)
+            level_index[mip].byte_length += mip_headers[i * mip_levels + mip].size;
+
+        level_index[mip].uncompressed_byte_length = level_index[mip].byte_length;
+        offset += level_index[mip].byte_length;
+    }
+
+    const std::string temp_path = filesystem::temp_file_path(path);
+
+    std::fstream f(temp_path, std::ios::out | std::ios::binary);
+
+    if (!f.is_open())
+    {
+        std::cout << "Failed to open file: " << temp_path << std::endl;
+        return false;
+    }
+
+    f.write((const char*)&header, sizeof(KTX2Header));
+    f.write((const char*)level_index.data(), sizeof(KTX2LevelIndex) * level_index.size());
+    f.write((const char*)dfd.data(), header.dfd_byte_length);
+    f.write((const char*)kvd.data(), kvd.size());
+
+    const std::vector<char> padding(alignment, 0);
+    uint64_t                written = header.kvd_byte_offset + header.kvd_byte_length;
+
+    for (int mip = mip_levels - 1; mip >= 0; mip--)
+    {
+        f.write(padding.data(), level_index[mip].byte_offset - written);
+
+        for (int i = 0; i < img.array_slices; i++)
+        {
+            const size_t level = i * mip_levels + mip;
+            f.write((const char*)level_data + src_offsets[level], mip_headers[level].size);
+        }
+
+        written = level_index[mip].byte_offset + level_index[mip].byte_length;
+    }
+
+    f.close();
+
+    if (f.fail())
+    {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    return filesystem::publish_file(temp_path, path);
+}
+
+static bool write_image(Image& img, const ImageExportOptions& options, const std::string& path)
 {
+    // A color space declared by the source file wins over the options, which only describe what the caller expects.
+    const bool srgb = img.color_space == COLOR_SPACE_UNKNOWN ? options.srgb : img.color_space == COLOR_SPACE_SRGB;
+
     // Make sure that float images either use no compression or BC6
     if ((img.type == PIXEL_TYPE_FLOAT16 || img.type == PIXEL_TYPE_FLOAT32) && (options.compression != COMPRESSION_NONE && options.compression != COMPRESSION_BC6))
     {
@@ -157,56 +295,48 @@ bool export_image(Image& img, const ImageExportOptions& options)
         return false;
     }
 
+    if (options.compression >= sizeof(kCompression) / sizeof(kCompression[0]))
+    {
+        std::cout << "ERROR::Unknown compression type: " << options.compression << std::endl;
+        return false;
+    }
+
+    // Block compressed sources, such as DDS files imported with keep_compressed, are written without decoding.
+    const bool passthrough = img.compression != COMPRESSION_NONE;
+
+    if (passthrough)
+    {
+        if (options.compression != img.compression)
+        {
+            std::cout << "ERROR::Block compressed images can only be exported with their own compression, import them decoded to change it!" << std::endl;
+            return false;
+        }
+
+        if (options.output_mips != 0 || options.flip_green)
+            std::cout << "WARNING::Mip generation and green channel flips are skipped for block compressed images. Existing mips are kept..." << std::endl;
+    }
+
     if (!filesystem::does_directory_exist(options.path))
         filesystem::create_directory(options.path);
 
 #if defined(ENABLE_DEBUG_OUTPUT)
-    if (options.debug_output)
+    if (options.debug_output && !passthrough)
         debug_export_image(options.path, img.name + "_post_import", img);
 #endif
 
-    if (options.flip_green)
+    const bool builtin_encoder = !passthrough && options.use_builtin_encoder && (((bc_encoder_supports(options.compression) || etc_encoder_supports(options.compression)) && img.type == PIXEL_TYPE_UNORM8) || (options.compression == COMPRESSION_BC6 && img.type != PIXEL_TYPE_UNORM8));
+    const bool nvtt_encoder    = !passthrough && options.compression != COMPRESSION_NONE && !builtin_encoder;
+
+    // Generated mips are filtered from the flipped mip 0. If NVTT gets the existing mips, the flip is fused into
+    // the BGRA conversion instead.
+    const bool flip_in_place = !passthrough && options.flip_green && !(nvtt_encoder && options.output_mips == 0);
+
+    if (flip_in_place)
     {
         for (uint32_t layer = 0; layer < img.array_slices; layer++)
         {
-            for (uint32_t mip = 0; mip < img.mip_slices; mip++)
-            {
-                Image::Data& data = img.data[layer][mip];
-
-                if (img.type == PIXEL_TYPE_UNORM8)
-                {
-                    if (img.components == 4)
-                    {
-                        FLIP_GREEN(uint8_t, 4, data)
-                    }
-                    else
-                    {
-                        FLIP_GREEN(uint8_t, 3, data)
-                    }
-                }
-                else if (img.type == PIXEL_TYPE_FLOAT16)
-                {
-                    if (img.components == 4)
-                    {
-                        FLIP_GREEN(int16_t, 4, data)
-                    }
-                    else
-                    {
-                        FLIP_GREEN(int16_t, 3, data)
-                    }
-                }
-                else if (img.type == PIXEL_TYPE_FLOAT32)
-                {
-                    if (img.components == 4)
-                    {
-                        FLIP_GREEN(float, 4, data)
-                    }
-                    else
-                    {
-                        FLIP_GREEN(float, 3, data)
-                    }
-                }
-            }
+            for (uint32_t mip = 0; mip < (options.output_mips == 0 ? img.mip_slices : 1); mip++)
+                img.flip_green(layer, mip);
         }
     }
 
@@ -222,41 +352,36 @@ bool export_image(Image& img, const ImageExportOptions& options)
 
     BINImageHeader image_header;
 
-    int x  = img.data[0][0].width;
-    int y  = img.data[0][0].height;
-    int mX = x;
-    int mY = y;
-
     // output_mips  =  -1 = a full mipchain will be generated.
     // output_mips  =   0 = the existing mips will be used. No new mips will be generated
     // output_mips  >=  1 = N number of miplevels will be generated.
 
-    int32_t mip_levels       = options.output_mips;
-    bool    generate_mipmaps = true;
-
-    if (mip_levels < -1)
-    {
+    if (options.output_mips < -1)
         std::cout << "WARNING::mipmaps_to_generate must be greater than or equal to -1. Generating full mipchain..." << std::endl;
-        mip_levels = -1;
-    }
 
-    if (options.output_mips == -1)
+    if (options.output_mips != 0 && !passthrough)
     {
-        mip_levels = 0;
+        MipGenerationOptions mip_options;
 
-        while (mX > 1 && mY > 1)
-        {
-            mX = x >> mip_levels;
-            mY = y >> mip_levels;
+        mip_options.filter         = options.mip_filter;
+        mip_options.mip_levels     = std::max(options.output_mips, -1);
+        mip_options.srgb           = srgb;
+        mip_options.normal_map     = options.normal_map;
+        mip_options.alpha_coverage = options.alpha_coverage;
 
-            mip_levels++;
-        }
+        if (!generate_mips(img, mip_options))
+            return false;
     }
-    else if (options.output_mips == 0)
-        mip_levels = img.mip_slices;
 
-    if (mip_levels == 1)
-        generate_mipmaps = false;
+    // Uncompressed float images are stored with the requested float precision. Mips are filtered before the
+    // conversion so half float levels do not accumulate rounding error. UNORM8 images are never converted.
+    if (options.compression == COMPRESSION_NONE && img.type != options.pixel_type && img.type != PIXEL_TYPE_UNORM8 && options.pixel_type != PIXEL_TYPE_UNORM8)
+    {
+        if (!img.convert(options.pixel_type))
+            return false;
+    }
+
+    const int32_t mip_levels = img.mip_slices;
 
     image_header.compression      = options.compression;
     image_header.channel_size     = img.type;
@@ -265,49 +390,120 @@ bool export_image(Image& img, const ImageExportOptions& options)
     image_header.num_mip_slices   = mip_levels;
 
     std::string filename = img.name;
-    std::string path;
+    // Version 2 files store every mip header up front followed by all levels back to back, so the level data can be
+    // written and read with a single call.
+    std::vector<BINMipSliceHeader> mip_headers;
+    std::vector<uint8_t>           payload;
 
-    if (options.path.size() > 0)
+    if (options.compression == COMPRESSION_NONE)
     {
-        path = options.path;
-        path += "/";
+        for (uint32_t i = 0; i < img.array_slices; i++)
+        {
+            for (uint32_t j = 0; j < mip_levels; j++)
+            {
+                BINMipSliceHeader mip_header;
+
+                mip_header.width  = img.data[i][j].width;
+                mip_header.height = img.data[i][j].height;
+                mip_header.size   = img.size(i, j);
+
+                mip_headers.push_back(mip_header);
+            }
+        }
+
+        // Images that were not allocated in one block, such as a freshly imported mip 0, are gathered first.
+        if (!img.storage)
+        {
+            for (uint32_t i = 0; i < img.array_slices; i++)
+            {
+                for (uint32_t j = 0; j < mip_levels; j++)
+                    payload.insert(payload.end(), (const uint8_t*)img.data[i][j].data, (const uint8_t*)img.data[i][j].data + img.size(i, j));
+            }
+        }
     }
+    else if (passthrough)
+    {
+        for (uint32_t i = 0; i < img.array_slices; i++)
+        {
+            for (uint32_t j = 0; j < mip_levels; j++)
+            {
+                BINMipSliceHeader mip_header;
 
-    path += filename;
-    path += ".ast";
+                mip_header.width  = img.data[i][j].width;
+                mip_header.height = img.data[i][j].height;
+                mip_header.size   = img.data[i][j].size;
 
-    std::fstream f(path, std::ios::out | std::ios::binary);
+                mip_headers.push_back(mip_header);
+            }
+        }
 
-    if (!f.is_open())
-        std::cout << "Failed to open file: " << path << std::endl;
+        if (!img.storage)
+        {
+            for (uint32_t i = 0; i < img.array_slices; i++)
+            {
+                for (uint32_t j = 0; j < mip_levels; j++)
+                    payload.insert(payload.end(), (const uint8_t*)img.data[i][j].data, (const uint8_t*)img.data[i][j].data + img.data[i][j].size);
+            }
+        }
+    }
+    else if (builtin_encoder)
+    {
+        size_t total_size = 0;
 
-    long offset = 0;
-    f.seekp(offset);
+        for (uint32_t i = 0; i < img.array_slices; i++)
+        {
+            for (int mip = 0; mip < mip_levels; mip++)
+            {
+                BINMipSliceHeader mip_header;
 
-    WRITE_AND_OFFSET(f, &fh, sizeof(fh), offset);
+                mip_header.width  = img.data[i][mip].width;
+                mip_header.height = img.data[i][mip].height;
+                mip_header.size   = compressed_size(options.compression, mip_header.width, mip_header.height);
 
-    uint16_t len = filename.size();
-    WRITE_AND_OFFSET(f, &len, sizeof(uint16_t), offset);
+                mip_headers.push_back(mip_header);
+                total_size += mip_header.size;
+            }
+        }
 
-    WRITE_AND_OFFSET(f, filename.c_str(), len, offset);
+        payload.resize(total_size);
 
-    WRITE_AND_OFFSET(f, &image_header, sizeof(BINImageHeader), offset);
+        uint8_t*           blocks = payload.data();
+        std::vector<float> level_floats;
 
-    if (options.output_mips == 0 && options.compression == COMPRESSION_NONE)
-    {
         for (uint32_t i = 0; i < img.array_slices; i++)
         {
-            for (uint32_t j = 0; j < img.mip_slices; j++)
+            for (int mip = 0; mip < mip_levels; mip++)
             {
-                BINMipSliceHeader mip_header;
+                const uint8_t* level_data   = (const uint8_t*)img.data[i][mip].data;
+                const int      level_width  = img.data[i][mip].width;
+                const int      level_height = img.data[i][mip].height;
 
-                mip_header.width  = img.data[i][j].width;
-                mip_header.height = img.data[i][j].height;
-                mip_header.size   = mip_header.width * mip_header.height * img.type * img.components;
+                const auto start = std::chrono::steady_clock::now();
 
-                WRITE_AND_OFFSET(f, &mip_header, sizeof(BINMipSliceHeader), offset);
+                if (options.compression == COMPRESSION_BC6)
+                {
+                    // The BC6H encoder works on 32-bit floats, so half float levels are widened first.
+                    if (img.type == PIXEL_TYPE_FLOAT16)
+                    {
+                        level_floats.resize(size_t(level_width) * level_height * img.components);
+                        convert_pixels(level_data, PIXEL_TYPE_FLOAT16, level_floats.data(), PIXEL_TYPE_FLOAT32, level_floats.size());
+                        level_data = (const uint8_t*)level_floats.data();
+                    }
+
+                    bc6h_encode(bc6h_preset(options.quality), (const float*)level_data, level_width, level_height, img.components, blocks);
+                }
+                else if (etc_encoder_supports(options.compression))
+                    etc_encode(options.compression, options.quality, level_data, level_width, level_height, img.components, blocks);
+                else
+                    bc_encode(options.compression, options.quality, level_data, level_width, level_height, img.components, blocks);
 
-                WRITE_AND_OFFSET(f, img.data[i][j].data, mip_header.size, offset);
+                if (options.stats)
+                {
+                    options.stats->encode_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    options.stats->encoded_pixels += uint64_t(level_width) * level_height;
+                }
+
+                blocks += compressed_size(options.compression, level_width, level_height);
             }
         }
     }
@@ -319,203 +515,477 @@ bool export_image(Image& img, const ImageExportOptions& options)
         nvtt::OutputOptions      output_options;
         nvtt::Compressor         compressor;
 
-        handler.stream = &f;
-        handler.offset = offset;
+        handler.mip_headers = &mip_headers;
+        handler.payload     = &payload;
 
         compression_options.setFormat(kCompression[options.compression]);
+        compression_options.setQuality(kQuality[options.quality]);
 
-        if (options.compression == COMPRESSION_NONE)
-        {
-            uint32_t pixel_size = 8 * options.pixel_type;
-
-            if (img.type == PIXEL_TYPE_UNORM8)
-                compression_options.setPixelType(nvtt::PixelType_UnsignedNorm);
-            else if (img.type == PIXEL_TYPE_FLOAT16 || img.type == PIXEL_TYPE_FLOAT32)
-                compression_options.setPixelType(nvtt::PixelType_Float);
-
-            if (img.components == 4)
-                compression_options.setPixelFormat(pixel_size, pixel_size, pixel_size, pixel_size);
-            else if (img.components == 3)
-                compression_options.setPixelFormat(pixel_size, pixel_size, pixel_size, 0);
-            else if (img.components == 2)
-                compression_options.setPixelFormat(pixel_size, pixel_size, 0, 0);
-            else if (img.components == 1)
-                compression_options.setPixelFormat(0, 0, pixel_size, 0);
-        }
-
-        if (options.pixel_type == PIXEL_TYPE_UNORM8)
+        if (img.type == PIXEL_TYPE_UNORM8)
             input_options.setFormat(nvtt::InputFormat_BGRA_8UB);
-        else if (options.pixel_type == PIXEL_TYPE_FLOAT16)
+        else if (img.type == PIXEL_TYPE_FLOAT16)
             input_options.setFormat(nvtt::InputFormat_RGBA_16F);
-        else if (options.pixel_type == PIXEL_TYPE_FLOAT32)
+        else if (img.type == PIXEL_TYPE_FLOAT32)
             input_options.setFormat(nvtt::InputFormat_RGBA_32F);
 
-        if (options.normal_map)
-        {
-            input_options.setNormalMap(true);
-            input_options.setConvertToNormalMap(false);
-            input_options.setGamma(1.0f, 1.0f);
-            input_options.setNormalizeMipmaps(true);
-        }
-        else
-        {
-            input_options.setNormalMap(false);
-            input_options.setConvertToNormalMap(false);
-            input_options.setGamma(2.2f, 2.2f);
-            input_options.setNormalizeMipmaps(false);
-        }
+        // The mips are already filtered and encoded, so NVTT only has to compress the levels it is given.
+        input_options.setNormalMap(options.normal_map);
+        input_options.setConvertToNormalMap(false);
+        input_options.setGamma(1.0f, 1.0f);
+        input_options.setNormalizeMipmaps(false);
 
         output_options.setOutputHeader(false);
         output_options.setOutputHandler(&handler);
 
+        const SwizzleChannel to_bgra[4] = { SWIZZLE_B, SWIZZLE_G, SWIZZLE_R, img.components == 4 ? SWIZZLE_A : SWIZZLE_ONE };
+        std::vector<uint8_t> bgra;
+
         for (int i = 0; i < img.array_slices; i++)
         {
-            Image  temp_img;
-            Image* current_img = &temp_img;
-
             input_options.setTextureLayout(nvtt::TextureType_2D, img.data[i][0].width, img.data[i][0].height);
+            input_options.setMipmapGeneration(mip_levels > 1, mip_levels);
 
-            // If generate_mipmaps is false or if the full mipchain has to be generated, set the data for the initial mip level.
-            if (!generate_mipmaps || (generate_mipmaps && options.output_mips == -1) || (generate_mipmaps && options.output_mips > 1))
-            {
-                if (img.components == 4)
-                {
-                    if (options.compression == COMPRESSION_NONE)
-                        img.argb_to_rgba(i, 0);
-                    else
-                        img.to_bgra(i, 0);
-
-                    current_img = &img;
-                }
-                else
-                {
-                    img.to_rgba(temp_img, i, 0);
-
-                    if (options.compression != COMPRESSION_NONE)
-                        temp_img.to_bgra(i, 0);
-                }
-
-                input_options.setMipmapGeneration(generate_mipmaps);
-                input_options.setMipmapData(current_img->data[i][0].data, img.data[i][0].width, img.data[i][0].height);
-            }
-            else if (generate_mipmaps && img.mip_slices > 1)
+            for (int mip = 0; mip < mip_levels; mip++)
             {
-                input_options.setMipmapGeneration(generate_mipmaps, img.mip_slices);
+                const Image::Data& data   = img.data[i][mip];
+                const size_t       pixels = size_t(data.width) * data.height;
 
-                for (int mip = 0; mip < img.mip_slices; mip++)
-                {
-                    if (img.components == 4)
-                    {
-                        if (options.compression == COMPRESSION_NONE)
-                            img.argb_to_rgba(i, 0);
-                        else
-                            img.to_bgra(i, 0);
-
-                        current_img = &img;
-                    }
-                    else
-                        img.to_rgba(temp_img, i, 0);
+                bgra.resize(pixels * 4 * img.type);
+                swizzle_pixels(data.data, img.components, bgra.data(), 4, to_bgra, img.type, pixels, options.flip_green && !flip_in_place);
 
-                    input_options.setMipmapData(current_img->data[i][mip].data, img.data[i][mip].width, img.data[i][mip].height, 1, 0, mip);
-                }
-            }
-            else
-            {
-                temp_img.deallocate();
-                std::cout << "ERROR::Image must contain at least one miplevel" << std::endl;
-                return false;
+                input_options.setMipmapData(bgra.data(), data.width, data.height, 1, 0, mip);
             }
 
             handler.mip_levels = 0;
             compressor.process(input_options, compression_options, output_options);
-
-            temp_img.deallocate();
         }
 
 #if defined(ENABLE_DEBUG_OUTPUT)
         if (options.debug_output)
         {
-            if (options.compression == COMPRESSION_NONE)
-                debug_read_and_export_image(path, img.name + "_post_export");
-            else
-            {
-                std::string name = filesystem::get_file_path(path) + "/" + img.name + "_post_export.dds";
-                output_options.setFileName(name.c_str());
-                output_options.setOutputHeader(true);
-                output_options.setContainer(nvtt::Container_DDS);
+            std::string name = filesystem::get_file_path(path) + "/" + img.name + "_post_export.dds";
+            output_options.setFileName(name.c_str());
+            output_options.setOutputHeader(true);
+            output_options.setContainer(nvtt::Container_DDS);
 
-                compressor.process(input_options, compression_options, output_options);
-            }
+            compressor.process(input_options, compression_options, output_options);
         }
 #endif
     }
 
+    if (mip_headers.size() != size_t(img.array_slices) * mip_levels)
+    {
+        std::cout << "ERROR::Expected " << img.array_slices * mip_levels << " mips but got " << mip_headers.size() << std::endl;
+        return false;
+    }
+
+    if (options.container == IMAGE_CONTAINER_KTX2)
+        return write_ktx2(path, img, options.compression, srgb && !options.normal_map, mip_headers, payload.empty() ? (const uint8_t*)img.storage : payload.data());
+
+    // Written next to the output and renamed over it, so engines hot reloading the output never read a partial file.
+    const std::string temp_path = filesystem::temp_file_path(path);
+
+    std::fstream f(temp_path, std::ios::out | std::ios::binary);
+
+    if (!f.is_open())
+    {
+        std::cout << "Failed to open file: " << temp_path << std::endl;
+        return false;
+    }
+
+    long offset = 0;
+    f.seekp(offset);
+
+    WRITE_AND_OFFSET(f, &fh, sizeof(fh), offset);
+
+    uint16_t len = filename.size();
+    WRITE_AND_OFFSET(f, &len, sizeof(uint16_t), offset);
+
+    WRITE_AND_OFFSET(f, filename.c_str(), len, offset);
+
+    WRITE_AND_OFFSET(f, &image_header, sizeof(BINImageHeader), offset);
+
+    WRITE_AND_OFFSET(f, mip_headers.data(), sizeof(BINMipSliceHeader) * mip_headers.size(), offset);
+
+    if (payload.empty())
+    {
+        WRITE_AND_OFFSET(f, img.storage, img.storage_size(), offset);
+    }
+    else
+    {
+        WRITE_AND_OFFSET(f, payload.data(), payload.size(), offset);
+    }
+
     f.close();
 
+    if (f.fail() || !filesystem::publish_file(temp_path, path))
+    {
+        remove(temp_path.c_str());
+        std::cout << "Failed to write file: " << path << std::endl;
+        return false;
+    }
+
+#if defined(ENABLE_DEBUG_OUTPUT)
+    if (options.debug_output && options.compression == COMPRESSION_NONE)
+        debug_read_and_export_image(path, img.name + "_post_export");
+#endif
+
     return true;
 }
 
-bool cubemap_from_latlong(cmft::Image& dst, Image& src)
+// Key of an exported image in the artifact store: every level of the image, its layout, its name, which is stored in
+// the file, and the export options.
+static uint64_t image_artifact_key(const Image& img, const ImageExportOptions& options)
 {
-    cmft::Image cmft_img;
-    cmft_img.m_width    = uint32_t(src.data[0][0].width);
-    cmft_img.m_height   = uint32_t(src.data[0][0].height);
-    cmft_img.m_dataSize = src.size(0, 0);
+    uint64_t key = hash_string(BUILD_CACHE_VERSION, img.name);
+
+    key = hash_combine(key, AST_VERSION);
+    key = hash_combine(key, img.type);
+    key = hash_combine(key, img.compression);
+    key = hash_combine(key, img.components);
+    key = hash_combine(key, img.array_slices);
+    key = hash_combine(key, img.mip_slices);
+    key = hash_combine(key, img.cubemap);
+    key = hash_combine(key, img.color_space);
+
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
+        {
+            key = hash_combine(key, img.data[i][j].width);
+            key = hash_combine(key, img.data[i][j].height);
+            key = hash_bytes(img.data[i][j].data, img.data[i][j].size, key);
+        }
+    }
 
-    if (src.components < 3)
+    return hash_combine(key, hash_export_options(options));
+}
+
+bool export_image(Image& img, const ImageExportOptions& options)
+{
+    std::string path;
+
+    if (options.path.size() > 0)
     {
-        std::cout << "ERROR::Image must at least have 3 color channels" << std::endl;
+        path = options.path;
+        path += "/";
+    }
+
+    path += img.name;
+    path += options.container == IMAGE_CONTAINER_KTX2 ? ".ktx2" : ".ast";
+
+    const std::string metadata_path = compression_metadata_path(path);
+
+    // Hashing the image costs a fraction of generating mips and compressing it, which a hit in the store skips.
+    uint64_t key = 0;
+
+    if (options.store)
+    {
+        key = image_artifact_key(img, options);
+
+        if (!filesystem::does_directory_exist(options.path))
+            filesystem::create_directory(options.path);
+
+        if ((!options.auto_compression || options.store->fetch(hash_string(key, "compression"), metadata_path)) && options.store->fetch(key, path))
+            return true;
+    }
+
+    if (options.auto_compression)
+    {
+        // The format is measured on the unflipped mip 0, flipping the green channel does not change any of the errors.
+        CompressionSelection selection;
+
+        if (!select_compression(img, options.normal_map, options.quality, options.compression_target, selection))
+            return false;
+
+        ImageExportOptions selected_options = options;
+        selected_options.compression        = selection.compression;
+
+        if (!write_image(img, selected_options, path) || !write_compression_metadata(metadata_path, options.compression_target, selection))
+            return false;
+
+        if (options.store)
+            options.store->publish(hash_string(key, "compression"), metadata_path);
+    }
+    else if (!write_image(img, options, path))
         return false;
+
+    if (options.store)
+        options.store->publish(key, path);
+
+    return true;
+}
+
+uint64_t hash_export_options(const ImageExportOptions& options)
+{
+    uint64_t hash = 0;
+
+    hash = hash_combine(hash, options.pixel_type);
+    hash = hash_combine(hash, options.compression);
+    hash = hash_combine(hash, options.normal_map);
+    hash = hash_combine(hash, options.flip_green);
+    hash = hash_combine(hash, uint64_t(int64_t(options.output_mips)));
+    hash = hash_combine(hash, options.mip_filter);
+    hash = hash_combine(hash, options.srgb);
+    hash = hash_bytes(&options.alpha_coverage, sizeof(float), hash);
+    hash = hash_combine(hash, options.quality);
+    hash = hash_combine(hash, options.use_builtin_encoder);
+    hash = hash_combine(hash, options.container);
+    hash = hash_combine(hash, options.auto_compression);
+
+    if (options.auto_compression)
+    {
+        hash = hash_bytes(&options.compression_target.min_psnr, sizeof(float), hash);
+        hash = hash_bytes(&options.compression_target.min_ssim, sizeof(float), hash);
+        hash = hash_bytes(&options.compression_target.max_normal_error, sizeof(float), hash);
+        hash = hash_combine(hash, options.compression_target.sample_tiles);
+        hash = hash_combine(hash, options.compression_target.allow_bc5_normals);
     }
 
-    if (src.components == 4)
+    return hash;
+}
+
+uint64_t hash_export_options(const CubemapImageExportOptions& options)
+{
+    uint64_t hash = 0;
+
+    hash = hash_combine(hash, options.compression);
+    hash = hash_combine(hash, options.pixel_type);
+    hash = hash_combine(hash, uint64_t(int64_t(options.output_mips)));
+    hash = hash_combine(hash, options.force_cmp);
+    hash = hash_combine(hash, options.irradiance);
+    hash = hash_combine(hash, options.irradiance_sh);
+    hash = hash_combine(hash, options.sampling_tables);
+    hash = hash_combine(hash, options.sampling_width);
+    hash = hash_combine(hash, options.radiance);
+    hash = hash_combine(hash, options.face_size);
+    hash = hash_combine(hash, options.filter);
+    hash = hash_combine(hash, options.supersampling);
+    hash = hash_combine(hash, options.radiance_size);
+    hash = hash_combine(hash, options.radiance_mips);
+    hash = hash_combine(hash, options.radiance_samples);
+    hash = hash_combine(hash, options.roughness_mapping);
+    hash = hash_combine(hash, options.layout);
+    hash = hash_combine(hash, options.octahedral_gutter);
+    hash = hash_combine(hash, options.container);
+
+    return hash;
+}
+
+std::vector<std::string> cubemap_output_files(const std::string& input, const CubemapImageExportOptions& options)
+{
+    std::string base = options.path;
+
+    if (base.size() > 0)
+        base += "/";
+
+    base += filesystem::get_filename(input);
+
+    const std::string extension = options.container == IMAGE_CONTAINER_KTX2 ? ".ktx2" : ".ast";
+
+    std::vector<std::string> files = { base + extension };
+
+    if (options.irradiance)
+        files.push_back(base + "_irradiance" + extension);
+    if (options.radiance)
+        files.push_back(base + "_radiance" + extension);
+    if (options.irradiance_sh)
+        files.push_back(base + "_sh9" + extension);
+    if (options.sampling_tables)
+        files.push_back(base + "_sampling" + extension);
+
+    return files;
+}
+
+// Wraps a cubemap for the cmft filters without copying it. With a single mip the faces are back to back in the
+// storage of the image, which is the layout cmft uses.
+static void cmft_cubemap_view(cmft::Image& dst, const Image& cubemap)
+{
+    dst.m_width    = uint32_t(cubemap.data[0][0].width);
+    dst.m_height   = uint32_t(cubemap.data[0][0].height);
+    dst.m_dataSize = uint32_t(cubemap.storage_size());
+
+    if (cubemap.components == 4)
     {
-        if (src.type == PIXEL_TYPE_UNORM8)
-            cmft_img.m_format = cmft::TextureFormat::RGBA8;
-        else if (src.type == PIXEL_TYPE_FLOAT16)
-            cmft_img.m_format = cmft::TextureFormat::RGBA16F;
-        else if (src.type == PIXEL_TYPE_FLOAT32)
-            cmft_img.m_format = cmft::TextureFormat::RGBA32F;
+        if (cubemap.type == PIXEL_TYPE_UNORM8)
+            dst.m_format = cmft::TextureFormat::RGBA8;
+        else if (cubemap.type == PIXEL_TYPE_FLOAT16)
+            dst.m_format = cmft::TextureFormat::RGBA16F;
+        else if (cubemap.type == PIXEL_TYPE_FLOAT32)
+            dst.m_format = cmft::TextureFormat::RGBA32F;
     }
-    else if (src.components == 3)
+    else if (cubemap.components == 3)
     {
-        if (src.type == PIXEL_TYPE_UNORM8)
-            cmft_img.m_format = cmft::TextureFormat::RGB8;
-        else if (src.type == PIXEL_TYPE_FLOAT16)
-            cmft_img.m_format = cmft::TextureFormat::RGB16F;
-        else if (src.type == PIXEL_TYPE_FLOAT32)
-            cmft_img.m_format = cmft::TextureFormat::RGB32F;
+        if (cubemap.type == PIXEL_TYPE_UNORM8)
+            dst.m_format = cmft::TextureFormat::RGB8;
+        else if (cubemap.type == PIXEL_TYPE_FLOAT16)
+            dst.m_format = cmft::TextureFormat::RGB16F;
+        else if (cubemap.type == PIXEL_TYPE_FLOAT32)
+            dst.m_format = cmft::TextureFormat::RGB32F;
     }
 
-    cmft_img.m_numMips  = 1;
-    cmft_img.m_numFaces = 1;
-    cmft_img.m_data     = (void*)src.data[0][0].data;
+    dst.m_numMips  = 1;
+    dst.m_numFaces = 6;
+    dst.m_data     = cubemap.storage;
+}
+
+// Copies the faces of a cmft cubemap into an image that owns its storage, so the image can be converted or get new
+// mips without touching memory owned by cmft.
+static void copy_cmft_cubemap(Image& dst, const cmft::Image& src, const PixelType& type, int components, int mip_levels)
+{
+    uint32_t img_offsets[CUBE_FACE_NUM][MAX_MIP_NUM];
+    cmft::imageGetMipOffsets(img_offsets, src);
+
+    dst.cubemap = true;
+    dst.allocate(type, src.m_width, src.m_height, components, 6, mip_levels);
 
-    if (!cmft::imageIsLatLong(cmft_img))
+    for (int i = 0; i < 6; i++)
     {
-        std::cout << "ERROR::Image is not in latlong format" << std::endl;
-        return false;
+        for (int j = 0; j < mip_levels; j++)
+            memcpy(dst.data[i][j].data, (const uint8_t*)src.m_data + img_offsets[i][j], dst.data[i][j].size);
     }
+}
+
+// Writes an environment map in the layout selected by the options. Octahedral maps are resampled from every mip of
+// the cubemap instead of being filtered as a 2D image, so gutters and prefiltered mips stay intact.
+static bool export_environment(Image& cubemap, ImageExportOptions& exp_options, const CubemapImageExportOptions& options)
+{
+    if (options.layout == ENVIRONMENT_LAYOUT_CUBEMAP)
+        return export_image(cubemap, exp_options);
 
-    if (!cmft::imageCubemapFromLatLong(dst, cmft_img))
+    if (exp_options.output_mips != 0)
     {
-        std::cout << "ERROR::Failed to convert Cubemap" << std::endl;
-        return false;
+        MipGenerationOptions mip_options;
+
+        mip_options.filter     = exp_options.mip_filter;
+        mip_options.mip_levels = exp_options.output_mips;
+        mip_options.srgb       = exp_options.srgb;
+
+        if (!generate_mips(cubemap, mip_options))
+            return false;
+
+        exp_options.output_mips = 0;
     }
 
-    return true;
+    OctahedralOptions octahedral_options;
+
+    octahedral_options.gutter = options.octahedral_gutter;
+
+    Image octahedral;
+
+    if (!cubemap_to_octahedral(cubemap, octahedral, octahedral_options))
+        return false;
+
+    cubemap.deallocate();
+
+    return export_image(octahedral, exp_options);
 }
 
 bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options)
 {
-    cmft::Image cmft_cube;
+    // Filtering always runs on the imported precision, only the stored float precision follows the options.
+    const PixelType output_type = src.type == PIXEL_TYPE_UNORM8 ? PIXEL_TYPE_UNORM8 : options.pixel_type;
+
+    if (src.components < 3)
+    {
+        std::cout << "ERROR::Image must at least have 3 color channels" << std::endl;
+        return false;
+    }
 
-    if (!cubemap_from_latlong(cmft_cube, src))
+    // SH is projected from the lat-long map itself, before it is released, so no cubemap intermediate is needed.
+    if (options.irradiance_sh)
+    {
+        SHCoefficients sh;
+        sh.order = 3;
+
+        if (!project_sh_latlong(src, sh))
+        {
+            std::cout << "ERROR::Failed to project irradiance SH!" << std::endl;
+            return false;
+        }
+
+        sh_convolve_cosine(sh);
+
+        Image sh_image;
+
+        sh_image.name = src.name;
+        sh_image.name += "_sh9";
+        sh_image.allocate(PIXEL_TYPE_FLOAT32, 9, 1, 3, 1, 1);
+
+        memcpy(sh_image.data[0][0].data, sh.c, sh_image.data[0][0].size);
+
+        ImageExportOptions sh_exp_options;
+
+        sh_exp_options.compression = COMPRESSION_NONE;
+        sh_exp_options.normal_map  = false;
+        sh_exp_options.output_mips = 0;
+        sh_exp_options.path        = options.path;
+        sh_exp_options.pixel_type  = PIXEL_TYPE_FLOAT32;
+        sh_exp_options.container   = options.container;
+        sh_exp_options.store       = options.store;
+        sh_exp_options.stats       = options.stats;
+#if defined(ENABLE_DEBUG_OUTPUT)
+        sh_exp_options.debug_output = options.debug_output;
+#endif
+
+        if (!export_image(sh_image, sh_exp_options))
+        {
+            std::cout << "ERROR::Failed to export irradiance SH" << std::endl;
+            return false;
+        }
+    }
+
+    if (options.sampling_tables)
+    {
+        Image sampling_tables;
+
+        if (!latlong_sampling_tables(src, sampling_tables, options.sampling_width))
+        {
+            std::cout << "ERROR::Failed to build sampling tables!" << std::endl;
+            return false;
+        }
+
+        ImageExportOptions sampling_exp_options;
+
+        sampling_exp_options.compression = COMPRESSION_NONE;
+        sampling_exp_options.normal_map  = false;
+        sampling_exp_options.output_mips = 0;
+        sampling_exp_options.path        = options.path;
+        sampling_exp_options.pixel_type  = PIXEL_TYPE_FLOAT32;
+        sampling_exp_options.container   = options.container;
+        sampling_exp_options.store       = options.store;
+        sampling_exp_options.stats       = options.stats;
+#if defined(ENABLE_DEBUG_OUTPUT)
+        sampling_exp_options.debug_output = options.debug_output;
+#endif
+
+        if (!export_image(sampling_tables, sampling_exp_options))
+        {
+            std::cout << "ERROR::Failed to export sampling tables" << std::endl;
+            return false;
+        }
+    }
+
+    CubemapConversionOptions conversion_options;
+
+    conversion_options.face_size     = options.face_size;
+    conversion_options.filter        = options.filter;
+    conversion_options.supersampling = options.supersampling;
+
+    Image cubemap;
+
+    if (!latlong_to_cubemap(src, cubemap, conversion_options))
     {
         std::cout << "ERROR::Failed to convert Cubemap" << std::endl;
         return false;
     }
 
+    // Large lat-long maps are released before filtering starts.
+    src.deallocate();
+
+    cmft::Image cmft_cube;
+    cmft_cubemap_view(cmft_cube, cubemap);
+
     if (options.irradiance)
     {
         cmft::Image cmft_irradiance_cube;
@@ -528,25 +998,11 @@ bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options)
 
         Image irradiance_cube;
 
-        uint32_t img_offsets[CUBE_FACE_NUM][MAX_MIP_NUM];
-        cmft::imageGetMipOffsets(img_offsets, cmft_irradiance_cube);
-
-        irradiance_cube.name = src.name;
+        irradiance_cube.name = cubemap.name;
         irradiance_cube.name += "_irradiance";
 
-        irradiance_cube.components   = src.components;
-        irradiance_cube.array_slices = 6;
-        irradiance_cube.mip_slices   = 1;
-        irradiance_cube.type         = src.type;
-
-        for (int i = 0; i < 6; i++)
-        {
-            uint8_t* mip_data = (uint8_t*)cmft_irradiance_cube.m_data + img_offsets[i][0];
-
-            irradiance_cube.data[i][0].data   = (float*)mip_data;
-            irradiance_cube.data[i][0].height = cmft_irradiance_cube.m_height;
-            irradiance_cube.data[i][0].width  = cmft_irradiance_cube.m_width;
-        }
+        copy_cmft_cubemap(irradiance_cube, cmft_irradiance_cube, cubemap.type, cubemap.components, 1);
+        cmft::imageUnload(cmft_irradiance_cube);
 
         ImageExportOptions irradiance_exp_options;
 
@@ -554,69 +1010,39 @@ bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options)
         irradiance_exp_options.normal_map  = false;
         irradiance_exp_options.output_mips = 0;
         irradiance_exp_options.path        = options.path;
-        irradiance_exp_options.pixel_type  = src.type;
+        irradiance_exp_options.pixel_type  = output_type;
+        irradiance_exp_options.container   = options.container;
+        irradiance_exp_options.store       = options.store;
+        irradiance_exp_options.stats       = options.stats;
 #if defined(ENABLE_DEBUG_OUTPUT)
         irradiance_exp_options.debug_output = options.debug_output;
 #endif
 
-        if (!export_image(irradiance_cube, irradiance_exp_options))
+        if (!export_environment(irradiance_cube, irradiance_exp_options, options))
         {
             std::cout << "ERROR::Failed to export Cubemap" << std::endl;
             return false;
         }
-
-        cmft::imageUnload(cmft_irradiance_cube);
-
-        for (int i = 0; i < 6; i++)
-            irradiance_cube.data[i][0].data = nullptr;
     }
 
     if (options.radiance)
     {
-        cmft::Image cmft_radiance_cube;
+        RadiancePrefilterOptions prefilter_options;
 
-        int threads = std::thread::hardware_concurrency();
+        prefilter_options.face_size    = options.radiance_size;
+        prefilter_options.mip_levels   = options.radiance_mips;
+        prefilter_options.sample_count = options.radiance_samples;
+        prefilter_options.mapping      = options.roughness_mapping;
 
-        std::cout << "Using " << threads << " threads to generate radiance map" << std::endl;
+        Image radiance_cube;
 
-        if (!cmft::imageRadianceFilter(cmft_radiance_cube,
-                                       RADIANCE_MAP_SIZE,
-                                       cmft::LightingModel::BlinnBrdf,
-                                       true,
-                                       RADIANCE_MAP_MIP_LEVELS,
-                                       CMFT_GLOSS_SCALE,
-                                       CMFT_GLOSS_BIAS,
-                                       cmft_cube,
-                                       cmft::EdgeFixup::None,
-                                       threads))
+        if (!prefilter_ggx(cubemap, radiance_cube, prefilter_options))
         {
             std::cout << "ERROR::Failed to generate radiance map!" << std::endl;
             return false;
         }
 
-        Image radiance_cube;
-
-        uint32_t img_offsets[CUBE_FACE_NUM][MAX_MIP_NUM];
-        cmft::imageGetMipOffsets(img_offsets, cmft_radiance_cube);
-
-        radiance_cube.name = src.name;
         radiance_cube.name += "_radiance";
-        radiance_cube.type         = src.type;
-        radiance_cube.components   = src.components;
-        radiance_cube.array_slices = 6;
-        radiance_cube.mip_slices   = 7;
-
-        for (int i = 0; i < 6; i++)
-        {
-            for (int j = 0; j < 7; j++)
-            {
-                uint8_t* mip_data = (uint8_t*)cmft_radiance_cube.m_data + img_offsets[i][j];
-
-                radiance_cube.data[i][j].data   = (void*)mip_data;
-                radiance_cube.data[i][j].height = cmft_radiance_cube.m_height >> j;
-                radiance_cube.data[i][j].width  = cmft_radiance_cube.m_width >> j;
-            }
-        }
 
         ImageExportOptions radiance_exp_options;
 
@@ -624,44 +1050,19 @@ bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options)
         radiance_exp_options.normal_map  = false;
         radiance_exp_options.output_mips = 0;
         radiance_exp_options.path        = options.path;
-        radiance_exp_options.pixel_type  = src.type;
+        radiance_exp_options.pixel_type  = output_type;
+        radiance_exp_options.container   = options.container;
+        radiance_exp_options.store       = options.store;
+        radiance_exp_options.stats       = options.stats;
 #if defined(ENABLE_DEBUG_OUTPUT)
         radiance_exp_options.debug_output = options.debug_output;
 #endif
 
-        if (!export_image(radiance_cube, radiance_exp_options))
+        if (!export_environment(radiance_cube, radiance_exp_options, options))
         {
             std::cout << "ERROR::Failed to export Cubemap" << std::endl;
             return false;
         }
-
-        cmft::imageUnload(cmft_radiance_cube);
-
-        for (int i = 0; i < 6; i++)
-        {
-            for (int j = 0; j < 7; j++)
-                radiance_cube.data[i][j].data = nullptr;
-        }
-    }
-
-    uint32_t img_offsets[CUBE_FACE_NUM][MAX_MIP_NUM];
-    cmft::imageGetMipOffsets(img_offsets, cmft_cube);
-
-    Image cubemap;
-
-    cubemap.type         = src.type;
-    cubemap.name         = src.name;
-    cubemap.components   = src.components;
-    cubemap.array_slices = 6;
-    cubemap.mip_slices   = 1;
-
-    for (int i = 0; i < 6; i++)
-    {
-        uint8_t* mip_data = (uint8_t*)cmft_cube.m_data + img_offsets[i][0];
-
-        cubemap.data[i][0].data   = (void*)mip_data;
-        cubemap.data[i][0].height = cmft_cube.m_height;
-        cubemap.data[i][0].width  = cmft_cube.m_width;
     }
 
     ImageExportOptions exp_options;
@@ -669,29 +1070,53 @@ bool cubemap_from_latlong(Image& src, const CubemapImageExportOptions& options)
     exp_options.compression = options.compression;
     exp_options.normal_map  = false;
     exp_options.output_mips = options.output_mips;
-    exp_options.pixel_type  = src.type;
+    exp_options.pixel_type  = output_type;
+    exp_options.container   = options.container;
+    exp_options.store       = options.store;
+    exp_options.stats       = options.stats;
     exp_options.path        = options.path;
 #if defined(ENABLE_DEBUG_OUTPUT)
     exp_options.debug_output = options.debug_output;
 #endif
 
-    if (!export_image(cubemap, exp_options))
+    if (!export_environment(cubemap, exp_options, options))
     {
         std::cout << "ERROR::Failed to export Cubemap" << std::endl;
         return false;
     }
 
-    cmft::imageUnload(cmft_cube);
-    src.deallocate();
-
-    for (int i = 0; i < 6; i++)
-        cubemap.data[i][0].data = nullptr;
-
     return true;
 }
 
 bool cubemap_from_latlong(const std::string& input, const CubemapImageExportOptions& options)
 {
+    // The maps are looked up by the bytes of the lat-long map, which skips decoding and filtering it, and are only
+    // taken from the store if all of them are there.
+    const std::vector<std::string> outputs = cubemap_output_files(input, options);
+    std::vector<uint64_t>          keys;
+    uint64_t                       source_key = 0;
+
+    if (options.store && hash_file(input, source_key))
+    {
+        source_key = hash_combine(source_key, hash_export_options(options));
+        source_key = hash_combine(source_key, BUILD_CACHE_VERSION);
+        source_key = hash_combine(source_key, AST_VERSION);
+
+        for (const auto& output : outputs)
+            keys.push_back(hash_string(source_key, filesystem::get_file_name_and_extention(output)));
+
+        if (!filesystem::does_directory_exist(options.path))
+            filesystem::create_directory(options.path);
+
+        bool fetched = true;
+
+        for (size_t i = 0; i < outputs.size() && fetched; i++)
+            fetched = options.store->fetch(keys[i], outputs[i]);
+
+        if (fetched)
+            return true;
+    }
+
     Image src;
 
     if (!import_image(src, input, PIXEL_TYPE_UNORM8, options.force_cmp))
@@ -700,6 +1125,18 @@ bool cubemap_from_latlong(const std::string& input, const CubemapImageExportOpti
         return false;
     }
 
-    return cubemap_from_latlong(src, options);
+    // Maps keyed by the source are not stored a second time under the key of their pixels.
+    CubemapImageExportOptions export_options = options;
+
+    if (!keys.empty())
+        export_options.store = nullptr;
+
+    if (!cubemap_from_latlong(src, export_options))
+        return false;
+
+    for (size_t i = 0; i < keys.size(); i++)
+        options.store->publish(keys[i], outputs[i]);
+
+    return true;
 }
 } // namespace ast
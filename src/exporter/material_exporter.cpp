@@ -1,10 +1,13 @@
 #include <exporter/material_exporter.h>
 #include <exporter/image_exporter.h>
 #include <common/filesystem.h>
+#include <common/header.h>
 #include <json.hpp>
+#include <stdio.h>
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <memory>
 
 namespace ast
 {
@@ -51,46 +54,241 @@ nlohmann::json to_json(TextureRef texture_ref)
     return json;
 }
 
-void export_texture(const std::string& src_path, const std::string& dst_path, bool normal_map, bool use_compression, bool normal_map_flip_green)
+// Build key of a texture: its source bytes and every setting that changes the exported file.
+static bool texture_build_key(const MaterialTexture& texture, const MaterialExportOptions& options, uint64_t& key)
 {
-    Image img;
+    if (!hash_file(texture.source, key))
+        return false;
+
+    key = hash_combine(key, texture.normal_map);
+    key = hash_combine(key, options.use_compression);
+    key = hash_combine(key, texture.flip_green);
+    key = hash_combine(key, texture.srgb);
 
-    if (import_image(img, src_path))
+    if (options.use_compression)
     {
-        ImageExportOptions options;
+        key = hash_bytes(&options.compression_target.min_psnr, sizeof(float), key);
+        key = hash_bytes(&options.compression_target.min_ssim, sizeof(float), key);
+        key = hash_bytes(&options.compression_target.max_normal_error, sizeof(float), key);
+        key = hash_combine(key, options.compression_target.sample_tiles);
+        key = hash_combine(key, options.compression_target.allow_bc5_normals);
+    }
+
+    return true;
+}
+
+// Generates the mips of a decoded texture, compresses it with the smallest format meeting the quality target and
+// writes it.
+static bool write_texture(Image& img, const MaterialTexture& texture, const MaterialExportOptions& material_options)
+{
+    ImageExportOptions options;
+
+    options.output_mips        = -1;
+    options.normal_map         = texture.normal_map;
+    options.path               = texture.output_folder;
+    options.compression        = COMPRESSION_NONE;
+    options.flip_green         = texture.flip_green;
+    options.srgb               = texture.srgb;
+    options.auto_compression   = material_options.use_compression;
+    options.compression_target = material_options.compression_target;
+
+    if (!export_image(img, options))
+    {
+        std::cout << "ERROR::Failed to export texture: " << img.name << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Key of a converted texture in the artifact store. The file name is part of it since it is stored in the file.
+static uint64_t texture_artifact_key(const MaterialTexture& texture, uint64_t build_key)
+{
+    uint64_t key = hash_combine(build_key, BUILD_CACHE_VERSION);
+
+    key = hash_combine(key, AST_VERSION);
+
+    return hash_string(key, filesystem::get_filename(texture.output_file));
+}
+
+// Copies a converted texture, and the metadata of its compression if it is compressed, from the artifact store, which
+// skips decoding it.
+static bool fetch_texture(ArtifactStore* store, const MaterialTexture& texture, bool use_compression, uint64_t build_key)
+{
+    if (!store)
+        return false;
+
+    if (!filesystem::does_directory_exist(texture.output_folder))
+        filesystem::create_directory(texture.output_folder);
+
+    const uint64_t key = texture_artifact_key(texture, build_key);
+
+    if (use_compression && !store->fetch(hash_string(key, "compression"), compression_metadata_path(texture.output_file)))
+        return false;
+
+    return store->fetch(key, texture.output_file);
+}
+
+// Records a converted texture in the build cache and the artifact store.
+static void record_texture(BuildCache* cache, ArtifactStore* store, const MaterialTexture& texture, bool use_compression, uint64_t build_key)
+{
+    if (cache)
+        cache->update(texture.output_file, build_key);
 
-        options.output_mips = -1;
-        options.normal_map  = normal_map;
-        options.path        = dst_path;
-        options.compression = COMPRESSION_NONE;
-        options.flip_green  = normal_map_flip_green;
+    if (store)
+    {
+        const uint64_t key = texture_artifact_key(texture, build_key);
 
         if (use_compression)
-        {
-            if (img.components == 1)
-                options.compression = COMPRESSION_BC4;
-            else if (img.components == 3)
-                options.compression = COMPRESSION_BC1;
-            else if (img.components == 4)
-                options.compression = COMPRESSION_BC3;
-        }
+            store->publish(hash_string(key, "compression"), compression_metadata_path(texture.output_file));
 
-        export_image(img, options);
+        store->publish(key, texture.output_file);
+    }
+}
+
+// Decodes a texture, then queues the rest of its conversion so other textures can be decoded in the meantime.
+static void export_texture(TaskPool& pool, const MaterialTexture& texture, const MaterialExportOptions& options, std::atomic<bool>& failed)
+{
+    uint64_t key = 0;
 
-        img.deallocate();
+    const bool hashed = (options.cache || options.store) && texture_build_key(texture, options, key);
+
+    if (hashed && options.cache && options.cache->up_to_date(texture.output_file, key))
+        return;
+
+    if (hashed && fetch_texture(options.store, texture, options.use_compression, key))
+    {
+        record_texture(options.cache, nullptr, texture, options.use_compression, key);
+        return;
+    }
+
+    std::shared_ptr<Image> img = std::make_shared<Image>();
+
+    if (!import_image(*img, texture.source))
+    {
+        std::cout << "ERROR::Failed to import texture: " << texture.source << std::endl;
+        failed = true;
+        return;
+    }
+
+    pool.submit([img, hashed, key, texture, options, &failed]() {
+        if (!write_texture(*img, texture, options))
+            failed = true;
+        else if (hashed)
+            record_texture(options.cache, options.store, texture, options.use_compression, key);
+
+        img->deallocate();
+    });
+}
+
+static std::string texture_output_path(const TextureInfo& texture_info, const MaterialExportOptions& options)
+{
+    std::string path = options.output_root_folder_path_absolute + "/texture/";
+
+    path += filesystem::get_filename(texture_info.path);
+    path += ".ast";
+
+    return path;
+}
+
+bool TextureRegistry::claim(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return claimed.insert(path).second;
+}
+
+void material_textures(const Material& desc, const MaterialExportOptions& options, std::vector<MaterialTexture>& textures)
+{
+    for (int i = 0; i < int(desc.textures.size()); i++)
+    {
+        const bool is_normal_map = desc.normal_texture.texture_idx == i || desc.clear_coat_normal_texture.texture_idx == i;
+        const bool is_color      = desc.base_color_texture.texture_idx == i || desc.emissive_texture.texture_idx == i || desc.sheen_color_texture.texture_idx == i;
+
+        MaterialTexture texture;
+
+        texture.source        = desc.textures[i].path;
+        texture.output_folder = options.output_root_folder_path_absolute + "/texture";
+        texture.output_file   = texture_output_path(desc.textures[i], options);
+        texture.normal_map    = is_normal_map;
+        texture.flip_green    = is_normal_map ? options.normal_map_flip_green : false;
+        texture.srgb          = is_color && !is_normal_map;
+
+        textures.push_back(texture);
+    }
+}
+
+bool export_material_texture(const MaterialTexture& texture, const MaterialExportOptions& options, bool* up_to_date)
+{
+    uint64_t key = 0;
+
+    const bool hashed = (options.cache || options.store) && texture_build_key(texture, options, key);
+    const bool cached = hashed && options.cache && options.cache->up_to_date(texture.output_file, key);
+
+    if (up_to_date)
+        *up_to_date = cached;
+
+    if (cached)
+        return true;
+
+    if (hashed && fetch_texture(options.store, texture, options.use_compression, key))
+    {
+        record_texture(options.cache, nullptr, texture, options.use_compression, key);
+        return true;
+    }
+
+    Image img;
+
+    if (!import_image(img, texture.source))
+    {
+        std::cout << "ERROR::Failed to import texture: " << texture.source << std::endl;
+        return false;
+    }
+
+    if (!write_texture(img, texture, options))
+        return false;
+
+    if (hashed)
+        record_texture(options.cache, options.store, texture, options.use_compression, key);
+
+    return true;
+}
+
+void export_material_textures(const Material& desc, const MaterialExportOptions& options, TaskPool& pool, TextureRegistry& registry)
+{
+    std::vector<MaterialTexture> textures;
+    material_textures(desc, options, textures);
+
+    for (const MaterialTexture& texture : textures)
+    {
+        if (!registry.claim(texture.output_file))
+            continue;
+
+        pool.submit([&pool, &registry, texture, options]() {
+            export_texture(pool, texture, options, registry.failed);
+        });
     }
 }
 
 bool export_material(const Material& desc, const MaterialExportOptions& options)
+{
+    TaskPool        pool;
+    TextureRegistry registry;
+
+    export_material_textures(desc, options, pool, registry);
+    pool.wait();
+
+    // The JSON is written even if a texture failed, so the material still loads with the textures that did convert.
+    const bool written = write_material(desc, options);
+
+    return written && !registry.failed;
+}
+
+bool write_material(const Material& desc, const MaterialExportOptions& options)
 {
     nlohmann::json doc;
 
-    std::string           path_to_textures_folder_absolute_string      = options.output_root_folder_path_absolute + "/texture";
-    std::string           path_to_materials_folder_absolute_string     = options.output_root_folder_path_absolute + "/material";
-    std::filesystem::path path_to_textures_folder_absolute             = path_to_textures_folder_absolute_string;
-    std::filesystem::path path_to_textures_folder_relative_to_material = std::filesystem::relative(path_to_textures_folder_absolute, path_to_materials_folder_absolute_string);
-    std::string           absolute_path_to_textures_folder             = path_to_textures_folder_absolute.string();
-    std::string           relative_path_to_textures_folder             = path_to_textures_folder_relative_to_material.string();
+    std::string path_to_materials_folder_absolute_string = options.output_root_folder_path_absolute + "/material";
 
     // Common
     {
@@ -104,29 +302,9 @@ bool export_material(const Material& desc, const MaterialExportOptions& options)
 
         for (int i = 0; i < desc.textures.size(); i++)
         {
-            auto src_texture_info = desc.textures[i];
-
-            std::string source_texture_path = src_texture_info.path;
-
-            std::string absolute_path_to_output_texture = path_to_textures_folder_absolute_string;
-            absolute_path_to_output_texture += "/";
-            absolute_path_to_output_texture += filesystem::get_filename(src_texture_info.path);
-            absolute_path_to_output_texture += ".ast";
-
-            std::filesystem::path output_texture_path_relative_to_material = std::filesystem::relative(absolute_path_to_output_texture, path_to_materials_folder_absolute_string);
+            const TextureInfo& src_texture_info = desc.textures[i];
 
-            // Check if asset exists
-            bool exists = filesystem::does_file_exist(absolute_path_to_output_texture);
-
-            if (!exists)
-            {
-                bool is_normal_map = false;
-
-                if (desc.normal_texture.texture_idx == i || desc.clear_coat_normal_texture.texture_idx == i)
-                    is_normal_map = true;
-
-                export_texture(source_texture_path, absolute_path_to_textures_folder, is_normal_map ? true : false, options.use_compression, is_normal_map ? options.normal_map_flip_green : false);
-            }
+            std::filesystem::path output_texture_path_relative_to_material = std::filesystem::relative(texture_output_path(src_texture_info, options), path_to_materials_folder_absolute_string);
 
             TextureInfo dst_texture_info;
 
@@ -203,14 +381,19 @@ bool export_material(const Material& desc, const MaterialExportOptions& options)
 
     std::string output_str = doc.dump(4);
 
-    std::fstream f(output_path, std::ios::out);
+    const std::string temp_path = filesystem::temp_file_path(output_path);
+
+    std::fstream f(temp_path, std::ios::out);
 
     if (f.is_open())
     {
         f.write(output_str.c_str(), output_str.size());
         f.close();
 
-        return true;
+        if (!f.fail() && filesystem::publish_file(temp_path, output_path))
+            return true;
+
+        remove(temp_path.c_str());
     }
     else
         std::cout << "Failed to write Material JSON!" << std::endl;
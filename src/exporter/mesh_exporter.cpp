@@ -3,6 +3,7 @@
 #include <common/filesystem.h>
 #include <common/header.h>
 #include <json.hpp>
+#include <stdio.h>
 #include <iostream>
 #include <fstream>
 #include <chrono>
@@ -61,7 +62,10 @@ bool export_mesh(const MeshImportResult& import_result, const MeshExportOption&
     output_path += import_result.name;
     output_path += ".ast";
 
-    std::fstream f(output_path, std::ios::out | std::ios::binary);
+    // Written next to the output and renamed over it, so engines hot reloading the mesh never read a partial file.
+    const std::string temp_path = filesystem::temp_file_path(output_path);
+
+    std::fstream f(temp_path, std::ios::out | std::ios::binary);
 
     if (f.is_open())
     {
@@ -124,17 +128,36 @@ bool export_mesh(const MeshImportResult& import_result, const MeshExportOption&
         // Export materials
         std::vector<BINMeshMaterialJson> mats;
 
-        for (int i = 0; i < import_result.materials.size(); i++)
+        MaterialExportOptions mat_exp_options;
+
+        mat_exp_options.output_root_folder_path_absolute = output_root_folder_path_absolute.string();
+        mat_exp_options.use_compression                  = options.use_compression;
+        mat_exp_options.compression_target               = options.compression_target;
+        mat_exp_options.normal_map_flip_green            = options.normal_map_flip_green;
+        mat_exp_options.cache                            = options.cache;
+        mat_exp_options.store                            = options.store;
+
+        // Textures of all materials are converted concurrently, the material JSONs are written once all of them are done.
+        bool textures_failed = false;
+
+        if (options.export_textures)
         {
-            auto material = import_result.materials[i].get();
+            TaskPool        pool;
+            TextureRegistry registry;
+
+            for (int i = 0; i < import_result.materials.size(); i++)
+                export_material_textures(*import_result.materials[i], mat_exp_options, pool, registry);
+
+            pool.wait();
 
-            MaterialExportOptions mat_exp_options;
+            textures_failed = registry.failed;
+        }
 
-            mat_exp_options.output_root_folder_path_absolute = output_root_folder_path_absolute.string();
-            mat_exp_options.use_compression                  = options.use_compression;
-            mat_exp_options.normal_map_flip_green            = options.normal_map_flip_green;
+        for (int i = 0; i < import_result.materials.size(); i++)
+        {
+            auto material = import_result.materials[i].get();
 
-            if (export_material(*material, mat_exp_options))
+            if (write_material(*material, mat_exp_options))
             {
                 std::string mat_out_path = "../material/" + material->name + ".json";
 
@@ -155,6 +178,14 @@ bool export_mesh(const MeshImportResult& import_result, const MeshExportOption&
 
         f.close();
 
+        if (f.fail() || !filesystem::publish_file(temp_path, output_path))
+        {
+            remove(temp_path.c_str());
+            std::cout << "Failed to write Mesh!" << std::endl;
+
+            return false;
+        }
+
         if (options.output_metadata)
         {
             nlohmann::json doc;
@@ -215,17 +246,32 @@ bool export_mesh(const MeshImportResult& import_result, const MeshExportOption&
 
             std::string output_str = doc.dump(4);
 
-            std::fstream f(output_path, std::ios::out);
+            const std::string temp_path = filesystem::temp_file_path(output_path);
+
+            std::fstream f(temp_path, std::ios::out);
 
             if (f.is_open())
             {
                 f.write(output_str.c_str(), output_str.size());
                 f.close();
+
+                if (f.fail() || !filesystem::publish_file(temp_path, output_path))
+                {
+                    remove(temp_path.c_str());
+                    std::cout << "Failed to write Metadata JSON!" << std::endl;
+                }
             }
             else
                 std::cout << "Failed to write Metadata JSON!" << std::endl;
         }
 
+        // The mesh is still written with a failed texture, but the caller must not treat it as built.
+        if (textures_failed)
+        {
+            std::cout << "ERROR::Failed to export the textures of mesh: " << import_result.name << std::endl;
+            return false;
+        }
+
         auto                          finish = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> time   = finish - start;
 
@@ -238,4 +284,34 @@ bool export_mesh(const MeshImportResult& import_result, const MeshExportOption&
 
     return false;
 }
+
+bool mesh_build_key(const std::string& input, const std::vector<std::string>& dependencies, const MeshImportOptions& import_options, const MeshExportOption& export_options, uint64_t& key)
+{
+    if (!hash_file(input, key))
+        return false;
+
+    for (const auto& dependency : dependencies)
+    {
+        uint64_t hash;
+
+        if (!hash_file(dependency, hash))
+            return false;
+
+        key = hash_string(key, dependency);
+        key = hash_combine(key, hash);
+    }
+
+    key = hash_combine(key, import_options.displacement_as_normal);
+    key = hash_combine(key, import_options.is_orca_mesh);
+    key = hash_combine(key, export_options.use_compression);
+    key = hash_bytes(&export_options.compression_target.min_psnr, sizeof(float), key);
+    key = hash_bytes(&export_options.compression_target.min_ssim, sizeof(float), key);
+    key = hash_bytes(&export_options.compression_target.max_normal_error, sizeof(float), key);
+    key = hash_combine(key, export_options.compression_target.sample_tiles);
+    key = hash_combine(key, export_options.compression_target.allow_bc5_normals);
+    key = hash_combine(key, export_options.normal_map_flip_green);
+    key = hash_combine(key, export_options.output_metadata);
+
+    return true;
+}
 } // namespace ast
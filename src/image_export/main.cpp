@@ -1,7 +1,11 @@
 #include <exporter/image_exporter.h>
 #include <common/filesystem.h>
+#include <common/build_cache.h>
 #include <loader/loader.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 
 void print_usage()
 {
@@ -9,16 +13,54 @@ void print_usage()
 
     printf("Input options:\n");
     printf("  -E			Cubemap.\n");
-    printf("  -C			Compressed.\n");
+    printf("  -C[psnr]		Compressed with the smallest BC format meeting a quality target (default 40 dB PSNR, SSIM 0.97,\n");
+    printf("			2 degrees mean normal error with -N), recorded in [name]_compression.json. Block compressed DDS files\n");
+    printf("			keep their format and mips.\n");
 #if defined(ENABLE_DEBUG_OUTPUT)
     printf("  -D			Debug Output.\n");
 #endif
     printf("  -R			Generate radiance.\n");
     printf("  -I			Generate irradiance.\n");
+    printf("  -O			Generate SH9 irradiance coefficients directly from the lat-long map.\n");
+    printf("  -P[width]		Generate importance sampling tables for the lat-long map (default full resolution).\n");
+    printf("  -Z[gutter]		Write environment maps as single octahedral 2D textures (default gutter 2).\n");
     printf("  -M			Generate mipmaps.\n");
-    printf("  -N			Normal map.\n");
+    printf("  -N[2]			Normal map, -N2 lets -C store X and Y only as BC5 for shaders that rebuild Z.\n");
     printf("  -F			Flip green channel.\n");
     printf("  -V			Force 4-components.\n");
+    printf("  -Q[0-2]		Compression quality (0 = fast, 1 = normal, 2 = high).\n");
+    printf("  -X			Use NVTT for all block compression formats.\n");
+    printf("  -T			Compress to ETC2/EAC instead of BC.\n");
+    printf("  -K			Use a Kaiser filter for mipmaps instead of a box filter.\n");
+    printf("  -L			Treat color as linear instead of sRGB when generating mipmaps.\n");
+    printf("  -A[ref]		Preserve alpha test coverage in mipmaps (default reference 0.5).\n");
+    printf("  -H			Store uncompressed float images as half floats.\n");
+    printf("  -S[size]		Cubemap face size (default half the lat-long height).\n");
+    printf("  -B			Use bicubic filtering for cubemap conversion.\n");
+    printf("  -U[n]			Cubemap conversion supersampling, n x n samples per texel (default 2).\n");
+    printf("  -G[n]			GGX samples per radiance texel (default 64).\n");
+    printf("  -Y			Quadratic roughness to mip mapping for radiance maps instead of linear.\n");
+    printf("  -W			Write KTX2 files instead of .ast files.\n");
+    printf("  -J			Rebuild even if the build cache says the outputs are up to date.\n");
+    printf("  --stats		Print the throughput of the in-tree block encoders.\n");
+    printf("\nSet " ARTIFACT_STORE_ENV " to a directory, which may be on a shared mount, to reuse files converted by other\n");
+    printf("builds. " ARTIFACT_STORE_SIZE_ENV " bounds its size (default 16 GB).\n");
+}
+
+// Output files written for an input, which are all checked against the build cache.
+std::vector<std::string> output_files(const std::string& input, bool cubemap, const ast::CubemapImageExportOptions& cubemap_options, const ast::ImageExportOptions& image_options)
+{
+    if (cubemap)
+        return ast::cubemap_output_files(input, cubemap_options);
+
+    std::string base = image_options.path;
+
+    if (base.size() > 0)
+        base += "/";
+
+    base += filesystem::get_filename(input);
+
+    return { base + (image_options.container == ast::IMAGE_CONTAINER_KTX2 ? ".ktx2" : ".ast") };
 }
 
 int main(int argc, char* argv[])
@@ -35,13 +77,19 @@ int main(int argc, char* argv[])
         ast::ImageExportOptions        image_export_options;
         bool                           cubemap     = false;
         bool                           compression = false;
+        bool                           etc         = false;
+        bool                           use_cache   = true;
+        bool                           print_stats = false;
         int                            force_cmp   = 0;
+        ast::EncodeStats               stats;
 
         int32_t input_idx = 99999;
 
         for (int32_t i = 0; i < argc; i++)
         {
-            if (argv[i][0] == '-')
+            if (strcmp(argv[i], "--stats") == 0)
+                print_stats = true;
+            else if (argv[i][0] == '-')
             {
                 char c = tolower(argv[i][1]);
 
@@ -56,18 +104,72 @@ int main(int argc, char* argv[])
                     cubemap_export_options.radiance = true;
                 else if (c == 'i')
                     cubemap_export_options.irradiance = true;
+                else if (c == 'o')
+                    cubemap_export_options.irradiance_sh = true;
+                else if (c == 'z')
+                {
+                    cubemap_export_options.layout            = ast::ENVIRONMENT_LAYOUT_OCTAHEDRAL;
+                    cubemap_export_options.octahedral_gutter = argv[i][2] ? std::max(atoi(&argv[i][2]), 0) : 2;
+                }
+                else if (c == 'p')
+                {
+                    cubemap_export_options.sampling_tables = true;
+                    cubemap_export_options.sampling_width  = std::max(atoi(&argv[i][2]), 0);
+                }
                 else if (c == 'c')
+                {
                     compression = true;
+
+                    if (argv[i][2])
+                        image_export_options.compression_target.min_psnr = std::max(float(atof(&argv[i][2])), 0.0f);
+                }
                 else if (c == 'e')
                     cubemap = true;
                 else if (c == 'n')
-                    image_export_options.normal_map = true;
+                {
+                    image_export_options.normal_map                           = true;
+                    image_export_options.compression_target.allow_bc5_normals = argv[i][2] == '2';
+                }
                 else if (c == 'm')
                     image_export_options.output_mips = -1;
                 else if (c == 'f')
                     image_export_options.flip_green = true;
                 else if (c == 'v')
                     force_cmp = 4;
+                else if (c == 'q')
+                    image_export_options.quality = (ast::CompressionQuality)std::min(std::max(atoi(&argv[i][2]), 0), 2);
+                else if (c == 'x')
+                    image_export_options.use_builtin_encoder = false;
+                else if (c == 't')
+                    etc = true;
+                else if (c == 'k')
+                    image_export_options.mip_filter = ast::MIP_FILTER_KAISER;
+                else if (c == 'l')
+                    image_export_options.srgb = false;
+                else if (c == 'a')
+                    image_export_options.alpha_coverage = argv[i][2] ? std::min(std::max(float(atof(&argv[i][2])), 0.0f), 1.0f) : 0.5f;
+                else if (c == 'h')
+                {
+                    cubemap_export_options.pixel_type = ast::PIXEL_TYPE_FLOAT16;
+                    image_export_options.pixel_type   = ast::PIXEL_TYPE_FLOAT16;
+                }
+                else if (c == 's')
+                    cubemap_export_options.face_size = std::max(atoi(&argv[i][2]), 0);
+                else if (c == 'b')
+                    cubemap_export_options.filter = ast::CUBEMAP_FILTER_BICUBIC;
+                else if (c == 'u')
+                    cubemap_export_options.supersampling = argv[i][2] ? std::max(atoi(&argv[i][2]), 1) : 2;
+                else if (c == 'g')
+                    cubemap_export_options.radiance_samples = std::max(atoi(&argv[i][2]), 1);
+                else if (c == 'y')
+                    cubemap_export_options.roughness_mapping = ast::ROUGHNESS_MAPPING_QUADRATIC;
+                else if (c == 'j')
+                    use_cache = false;
+                else if (c == 'w')
+                {
+                    cubemap_export_options.container = ast::IMAGE_CONTAINER_KTX2;
+                    image_export_options.container   = ast::IMAGE_CONTAINER_KTX2;
+                }
             }
             else if (i > 0)
             {
@@ -100,10 +202,63 @@ int main(int argc, char* argv[])
             }
         }
 
+        // Outputs are skipped if the source bytes and every option are the same as in the last build.
+        std::vector<std::string> outputs = output_files(input, cubemap, cubemap_export_options, image_export_options);
+
+        // Automatic compression also writes the selected format, DDS files whose blocks are kept as they are do not.
+        ast::CompressionType dds_compression;
+
+        if (!cubemap && compression && !etc && !ast::image_block_compression(input, dds_compression))
+            outputs.push_back(ast::compression_metadata_path(outputs[0]));
+
+        ast::BuildCache cache;
+        uint64_t        key    = 0;
+        bool            hashed = false;
+
+        if (use_cache)
+        {
+            cache.load((image_export_options.path.size() > 0 ? image_export_options.path + "/" : std::string()) + BUILD_CACHE_FILE_NAME);
+
+            hashed = ast::hash_file(input, key);
+
+            if (hashed)
+            {
+                key = ast::hash_combine(key, cubemap ? ast::hash_export_options(cubemap_export_options) : ast::hash_export_options(image_export_options));
+                key = ast::hash_combine(key, cubemap);
+                key = ast::hash_combine(key, compression);
+                key = ast::hash_bytes(&image_export_options.compression_target.min_psnr, sizeof(float), key);
+                key = ast::hash_combine(key, etc);
+                key = ast::hash_combine(key, force_cmp);
+
+                if (std::all_of(outputs.begin(), outputs.end(), [&](const std::string& output) { return cache.up_to_date(output, key); }))
+                {
+                    printf("Skipping %s, it is up to date.\n", input.c_str());
+                    return 0;
+                }
+            }
+        }
+
+        if (print_stats)
+        {
+            cubemap_export_options.stats = &stats;
+            image_export_options.stats   = &stats;
+        }
+
+        ast::ArtifactStore store;
+
+        if (store.open_from_environment())
+        {
+            cubemap_export_options.store = &store;
+            image_export_options.store   = &store;
+        }
+
         if (cubemap)
         {
             cubemap_export_options.force_cmp = force_cmp;
 
+            if (compression)
+                cubemap_export_options.compression = ast::COMPRESSION_BC6;
+
             if (!ast::cubemap_from_latlong(input, cubemap_export_options))
             {
                 printf("ERROR: Failed to export cubemap!\n\n");
@@ -114,17 +269,24 @@ int main(int argc, char* argv[])
         {
             ast::Image img;
 
-            if (ast::import_image(img, input, ast::PIXEL_TYPE_UNORM8, force_cmp))
+            // Block compressed DDS files are copied as they are unless they have to be decoded for ETC or no compression.
+            if (ast::import_image(img, input, ast::PIXEL_TYPE_UNORM8, force_cmp, compression && !etc))
             {
-                if (compression)
+                if (img.compression != ast::COMPRESSION_NONE)
+                    image_export_options.compression = img.compression;
+                else if (compression && etc)
                 {
                     if (img.components == 1)
-                        image_export_options.compression = ast::COMPRESSION_BC4;
+                        image_export_options.compression = ast::COMPRESSION_EAC_R11;
+                    else if (img.components == 2)
+                        image_export_options.compression = ast::COMPRESSION_EAC_RG11;
                     else if (img.components == 3)
-                        image_export_options.compression = ast::COMPRESSION_BC1;
+                        image_export_options.compression = ast::COMPRESSION_ETC2;
                     else if (img.components == 4)
-                        image_export_options.compression = ast::COMPRESSION_BC3;
+                        image_export_options.compression = ast::COMPRESSION_ETC2_RGBA;
                 }
+                else if (compression)
+                    image_export_options.auto_compression = true;
                 else
                     image_export_options.compression = ast::COMPRESSION_NONE;
 
@@ -136,6 +298,23 @@ int main(int argc, char* argv[])
 
                 img.deallocate();
             }
+            else
+            {
+                printf("ERROR: Failed to import image!\n\n");
+                return 1;
+            }
+        }
+
+        if (print_stats && stats.encode_seconds > 0.0)
+            printf("Encoded %.2f MP at %.2f MP/s.\n", stats.encoded_pixels / 1000000.0, (stats.encoded_pixels / 1000000.0) / stats.encode_seconds);
+
+        // Without the hash of the input the key does not identify this build.
+        if (use_cache && hashed)
+        {
+            for (const auto& output : outputs)
+                cache.update(output, key);
+
+            cache.save();
         }
 
         return 0;
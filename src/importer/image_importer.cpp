@@ -9,72 +9,260 @@
 
 namespace ast
 {
-bool import_image(Image& img, const std::string& file, const PixelType& type, int force_cmp)
+// Maps the format of a DDS file to the block compression it can be stored with unchanged. Signed formats have no
+// matching CompressionType and are decoded instead.
+static bool dds_compression(const nv::DDSHeader& header, CompressionType& compression, int& components)
 {
-    auto ext = filesystem::get_file_extention(file);
-    img.name = filesystem::get_filename(file);
-
-    if (ext == "dds")
+    if (header.hasDX10Header())
     {
-        if (type == PIXEL_TYPE_FLOAT16 || type == PIXEL_TYPE_FLOAT32)
+        switch (header.header10.dxgiFormat)
         {
-            std::cout << "ERROR::Float images not supported with DDS!" << std::endl;
+            // DX10 headers have no alpha flag and every DXGI BC1 block may use punch-through alpha.
+            case nv::DXGI_FORMAT_BC1_UNORM:
+            case nv::DXGI_FORMAT_BC1_UNORM_SRGB:
+                compression = COMPRESSION_BC1a;
+                components  = 4;
+                return true;
+            case nv::DXGI_FORMAT_BC2_UNORM:
+            case nv::DXGI_FORMAT_BC2_UNORM_SRGB:
+                compression = COMPRESSION_BC2;
+                components  = 4;
+                return true;
+            case nv::DXGI_FORMAT_BC3_UNORM:
+            case nv::DXGI_FORMAT_BC3_UNORM_SRGB:
+                compression = COMPRESSION_BC3;
+                components  = 4;
+                return true;
+            case nv::DXGI_FORMAT_BC4_UNORM:
+                compression = COMPRESSION_BC4;
+                components  = 1;
+                return true;
+            case nv::DXGI_FORMAT_BC5_UNORM:
+                compression = COMPRESSION_BC5;
+                components  = 2;
+                return true;
+            case nv::DXGI_FORMAT_BC6H_UF16:
+                compression = COMPRESSION_BC6;
+                components  = 3;
+                return true;
+            case nv::DXGI_FORMAT_BC7_UNORM:
+            case nv::DXGI_FORMAT_BC7_UNORM_SRGB:
+                compression = COMPRESSION_BC7;
+                components  = 4;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    if (!(header.pf.flags & nv::DDPF_FOURCC))
+        return false;
+
+    switch (header.pf.fourcc)
+    {
+        case nv::FOURCC_DXT1:
+            compression = header.hasAlpha() ? COMPRESSION_BC1a : COMPRESSION_BC1;
+            components  = header.hasAlpha() ? 4 : 3;
+            return true;
+        case nv::FOURCC_DXT2:
+        case nv::FOURCC_DXT3:
+            compression = COMPRESSION_BC2;
+            components  = 4;
+            return true;
+        case nv::FOURCC_DXT4:
+        case nv::FOURCC_DXT5:
+            compression = header.isNormalMap() ? COMPRESSION_BC3n : COMPRESSION_BC3;
+            components  = 4;
+            return true;
+        case nv::FOURCC_ATI1:
+            compression = COMPRESSION_BC4;
+            components  = 1;
+            return true;
+        case nv::FOURCC_ATI2:
+            compression = COMPRESSION_BC5;
+            components  = 2;
+            return true;
+        default:
             return false;
+    }
+}
+
+// Color space declared by the DXGI format of a DX10 DDS file. Legacy files do not declare one.
+static ColorSpace dds_color_space(const nv::DDSHeader& header)
+{
+    if (!header.hasDX10Header())
+        return COLOR_SPACE_UNKNOWN;
+
+    switch (header.header10.dxgiFormat)
+    {
+        case nv::DXGI_FORMAT_BC1_UNORM_SRGB:
+        case nv::DXGI_FORMAT_BC2_UNORM_SRGB:
+        case nv::DXGI_FORMAT_BC3_UNORM_SRGB:
+        case nv::DXGI_FORMAT_BC7_UNORM_SRGB:
+        case nv::DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case nv::DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case nv::DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return COLOR_SPACE_SRGB;
+        default:
+            return COLOR_SPACE_LINEAR;
+    }
+}
+
+// Array slices of a DDS file, with the faces of cubemaps stored as consecutive slices.
+static uint32_t dds_slice_count(const nv::DirectDrawSurface& dds)
+{
+    return dds.arraySize() * (dds.isTextureCube() ? 6 : 1);
+}
+
+// Copies the blocks of every slice and mip into a single allocation, in the order they are written to .ast files.
+static bool import_dds_blocks(Image& img, nv::DirectDrawSurface& dds, const CompressionType& compression, int components)
+{
+    img.type         = compression == COMPRESSION_BC6 ? PIXEL_TYPE_FLOAT16 : PIXEL_TYPE_UNORM8;
+    img.compression  = compression;
+    img.components   = components;
+    img.array_slices = dds_slice_count(dds);
+    img.mip_slices   = dds.mipmapCount();
+    img.cubemap      = dds.isTextureCube();
+    img.color_space  = dds_color_space(dds.header);
+
+    if (img.data.size() < size_t(img.array_slices))
+        img.data.resize(img.array_slices);
+
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
+        {
+            img.data[i][j].width  = dds.surfaceWidth(j);
+            img.data[i][j].height = dds.surfaceHeight(j);
+            img.data[i][j].size   = compressed_size(compression, img.data[i][j].width, img.data[i][j].height);
         }
+    }
 
-        // Use NVTT for DDS files
-        nv::DirectDrawSurface dds;
+    img.allocate_storage();
 
-        if (dds.load(file.c_str()))
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
         {
-            nv::Image nv_img;
-            dds.mipmap(&nv_img, 0, 0);
+            if (!dds.readSurface(i, j, img.data[i][j].data, img.data[i][j].size))
+            {
+                std::cout << "ERROR::Failed to read mip " << j << " of slice " << i << " from DDS!" << std::endl;
+                img.deallocate();
+                return false;
+            }
+        }
+    }
 
-            img.data[0][0].width  = nv_img.width();
-            img.data[0][0].height = nv_img.height();
+    return true;
+}
 
-            auto fmt = nv_img.format();
+// Decodes every slice and mip to UNORM8 so the image can be filtered or compressed to a different format.
+static bool import_dds_pixels(Image& img, nv::DirectDrawSurface& dds)
+{
+    const int components = dds.hasAlpha() ? 4 : 3;
 
-            if (fmt == nv::Image::Format_RGB)
-                img.components = 3;
-            else if (fmt == nv::Image::Format_ARGB)
-                img.components = 4;
-            else
-                return false;
+    img.compression = COMPRESSION_NONE;
+    img.cubemap     = dds.isTextureCube();
+    img.color_space = dds_color_space(dds.header);
+    img.allocate(PIXEL_TYPE_UNORM8, dds.width(), dds.height(), components, dds_slice_count(dds), dds.mipmapCount());
 
-            size_t size         = img.data[0][0].width * img.data[0][0].height * img.components * size_t(type);
-            img.data[0][0].data = malloc(size);
+    nv::Image nv_img;
 
-            uint8_t*       data = (uint8_t*)img.data[0][0].data;
-            const uint32_t n    = nv_img.width() * nv_img.height();
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
+        {
+            dds.mipmap(&nv_img, i, j);
 
-            if (nv_img.format() == nv::Image::Format_ARGB)
+            if (int(nv_img.width()) != img.data[i][j].width || int(nv_img.height()) != img.data[i][j].height)
             {
-                for (uint32_t i = 0; i < n; i++)
-                {
-                    nv::Color32 color = nv_img.pixel(i);
-                    data[4 * i + 0]   = color.r;
-                    data[4 * i + 1]   = color.g;
-                    data[4 * i + 2]   = color.b;
-                    data[4 * i + 3]   = color.a;
-                }
+                std::cout << "ERROR::Unexpected size of mip " << j << " in DDS!" << std::endl;
+                img.deallocate();
+                return false;
             }
-            else if (nv_img.format() == nv::Image::Format_RGB)
+
+            uint8_t*       data = (uint8_t*)img.data[i][j].data;
+            const uint32_t n    = nv_img.width() * nv_img.height();
+
+            for (uint32_t k = 0; k < n; k++)
             {
-                for (uint32_t i = 0; i < n; i++)
-                {
-                    nv::Color32 color = nv_img.pixel(i);
-                    data[3 * i + 0]   = color.r;
-                    data[3 * i + 1]   = color.g;
-                    data[3 * i + 2]   = color.b;
-                }
+                nv::Color32 color = nv_img.pixel(k);
+
+                data[components * k + 0] = color.r;
+                data[components * k + 1] = color.g;
+                data[components * k + 2] = color.b;
+
+                if (components == 4)
+                    data[components * k + 3] = color.a;
             }
+        }
+    }
 
-            img.array_slices = 1;
-            img.mip_slices   = 1;
+    return true;
+}
 
-            return true;
+bool import_image(Image& img, const std::string& file, const PixelType& type, int force_cmp, bool keep_compressed)
+{
+    // Release what the image held before, the same object may be imported into more than once.
+    img.deallocate();
+    img.compression = COMPRESSION_NONE;
+    img.cubemap     = false;
+    img.color_space = COLOR_SPACE_UNKNOWN;
+
+    auto ext = filesystem::get_file_extention(file);
+    img.name = filesystem::get_filename(file);
+
+    if (ext == "dds")
+    {
+        // Use NVTT for DDS files
+        nv::DirectDrawSurface dds;
+
+        if (!dds.load(file.c_str()) || !dds.isValid())
+        {
+            std::cout << "ERROR::Failed to load DDS: " << file << std::endl;
+            return false;
+        }
+
+        if (dds.isTexture3D() || dds.mipmapCount() > 16)
+        {
+            std::cout << "ERROR::Volume DDS files and more than 16 mips are not supported!" << std::endl;
+            return false;
+        }
+
+        // Signed BC6H has no CompressionType and decoding it would clamp HDR values to UNORM8.
+        if (dds.header.hasDX10Header() && (dds.header.header10.dxgiFormat == nv::DXGI_FORMAT_BC6H_SF16 || dds.header.header10.dxgiFormat == nv::DXGI_FORMAT_BC6H_TYPELESS))
+        {
+            std::cout << "ERROR::Signed or typeless BC6H DDS files are not supported: " << file << std::endl;
+            return false;
+        }
+
+        CompressionType compression;
+        int             components;
+
+        const bool known_compression = dds_compression(dds.header, compression, components);
+
+        if (keep_compressed && known_compression)
+            return import_dds_blocks(img, dds, compression, components);
+
+        if (known_compression && compression == COMPRESSION_BC6)
+        {
+            std::cout << "ERROR::BC6H DDS files can only be imported with their blocks kept: " << file << std::endl;
+            return false;
+        }
+
+        if (type == PIXEL_TYPE_FLOAT16 || type == PIXEL_TYPE_FLOAT32)
+        {
+            std::cout << "ERROR::Float images not supported with DDS!" << std::endl;
+            return false;
         }
+
+        if (!dds.isSupported())
+        {
+            std::cout << "ERROR::Unsupported DDS format: " << file << std::endl;
+            return false;
+        }
+
+        return import_dds_pixels(img, dds);
     }
     else if (ext == "hdr")
     {
@@ -86,8 +274,13 @@ bool import_image(Image& img, const std::string& file, const PixelType& type, in
 
         if (img.data[0][0].data != nullptr)
         {
-            img.array_slices = 1;
-            img.mip_slices   = 1;
+            img.array_slices    = 1;
+            img.mip_slices      = 1;
+            img.data[0][0].size = img.size(0, 0);
+
+            // HDR files are always imported as float, in half precision if it was asked for.
+            if (type == PIXEL_TYPE_FLOAT16)
+                return img.convert(PIXEL_TYPE_FLOAT16);
 
             return true;
         }
@@ -99,16 +292,23 @@ bool import_image(Image& img, const std::string& file, const PixelType& type, in
             img.type            = PIXEL_TYPE_UNORM8;
             img.data[0][0].data = stbi_load(file.c_str(), &img.data[0][0].width, &img.data[0][0].height, &img.components, force_cmp);
         }
-        else if (type == PIXEL_TYPE_FLOAT32)
+        else if (type == PIXEL_TYPE_FLOAT16 || type == PIXEL_TYPE_FLOAT32)
         {
             img.type            = PIXEL_TYPE_FLOAT32;
             img.data[0][0].data = stbi_loadf(file.c_str(), &img.data[0][0].width, &img.data[0][0].height, &img.components, force_cmp);
         }
 
+        if (force_cmp != 0)
+            img.components = force_cmp;
+
         if (img.data[0][0].data != nullptr)
         {
-            img.array_slices = 1;
-            img.mip_slices   = 1;
+            img.array_slices    = 1;
+            img.mip_slices      = 1;
+            img.data[0][0].size = img.size(0, 0);
+
+            if (type == PIXEL_TYPE_FLOAT16)
+                return img.convert(PIXEL_TYPE_FLOAT16);
 
             return true;
         }
@@ -116,4 +316,43 @@ bool import_image(Image& img, const std::string& file, const PixelType& type, in
 
     return false;
 }
+
+bool image_info(const std::string& file, int& width, int& height, int& components)
+{
+    if (filesystem::get_file_extention(file) == "dds")
+    {
+        nv::DirectDrawSurface dds;
+
+        if (!dds.load(file.c_str()) || !dds.isValid())
+            return false;
+
+        CompressionType compression;
+
+        width  = dds.width();
+        height = dds.height();
+
+        // Same component counts import_image reports for the blocks, decoded files follow their alpha flag.
+        if (!dds_compression(dds.header, compression, components))
+            components = dds.hasAlpha() ? 4 : 3;
+
+        return true;
+    }
+
+    return stbi_info(file.c_str(), &width, &height, &components) != 0;
+}
+
+bool image_block_compression(const std::string& file, CompressionType& compression)
+{
+    if (filesystem::get_file_extention(file) != "dds")
+        return false;
+
+    nv::DirectDrawSurface dds;
+
+    if (!dds.load(file.c_str()) || !dds.isValid())
+        return false;
+
+    int components;
+
+    return dds_compression(dds.header, compression, components);
+}
 } // namespace ast
@@ -1,8 +1,10 @@
 #include <loader/loader.h>
 #include <common/header.h>
+#include <common/ktx2.h>
 #include <fstream>
 #include <common/filesystem.h>
 #include <json.hpp>
+#include <string.h>
 
 #define READ_AND_OFFSET(stream, dest, size, offset) \
     stream.read((char*)dest, size);                 \
@@ -64,8 +66,101 @@ glm::vec3                  deserialize_vec3(const nlohmann::json& json);
 TextureInfo                deserialize_texture_info(const nlohmann::json& json);
 TextureRef                 deserialize_texture_ref(const nlohmann::json& json);
 
+// Reads a KTX2 file written by export_image. Every mip holds all array layers and cubemap faces back to back, and
+// is scattered into the array slice major storage of the image.
+static bool load_ktx2(const std::string& path, Image& image)
+{
+    std::fstream f(path, std::ios::in | std::ios::binary);
+
+    if (!f.is_open())
+        return false;
+
+    KTX2Header header;
+    f.read((char*)&header, sizeof(KTX2Header));
+
+    if (f.fail() || memcmp(header.identifier, kKTX2Identifier, KTX2_IDENTIFIER_SIZE) != 0)
+    {
+        std::cout << "ERROR::" << path << " is not a KTX2 file!" << std::endl;
+        return false;
+    }
+
+    if (header.supercompression_scheme != 0 || header.pixel_depth > 1 || header.level_count > 16 || header.pixel_width == 0 || header.pixel_height == 0)
+    {
+        std::cout << "ERROR::Only 2D KTX2 files without supercompression with up to 16 mips are supported: " << path << std::endl;
+        return false;
+    }
+
+    if (!ktx2_image_format(header.vk_format, image.compression, image.type, image.components))
+    {
+        std::cout << "ERROR::Unsupported KTX2 format " << header.vk_format << " in " << path << std::endl;
+        return false;
+    }
+
+    const uint32_t faces = header.face_count == 6 ? 6 : 1;
+
+    // Release what the image held before, its slice counts are about to change.
+    image.deallocate();
+
+    image.name         = filesystem::get_filename(path);
+    image.cubemap      = faces == 6;
+    image.array_slices = std::max(header.layer_count, 1u) * faces;
+    image.mip_slices   = std::max(header.level_count, 1u);
+
+    if (image.data.size() < size_t(image.array_slices))
+        image.data.resize(image.array_slices);
+
+    for (int i = 0; i < image.array_slices; i++)
+    {
+        uint32_t w = header.pixel_width;
+        uint32_t h = header.pixel_height;
+
+        for (int j = 0; j < image.mip_slices; j++)
+        {
+            image.data[i][j].width  = w;
+            image.data[i][j].height = h;
+
+            if (image.compression == COMPRESSION_NONE)
+                image.data[i][j].size = image.size(i, j);
+            else
+                image.data[i][j].size = compressed_size(image.compression, w, h);
+
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
+        }
+    }
+
+    std::vector<KTX2LevelIndex> level_index(image.mip_slices);
+    f.read((char*)level_index.data(), sizeof(KTX2LevelIndex) * level_index.size());
+
+    image.allocate_storage();
+
+    for (int j = 0; j < image.mip_slices; j++)
+    {
+        uint64_t level_size = 0;
+
+        for (int i = 0; i < image.array_slices; i++)
+            level_size += image.data[i][j].size;
+
+        if (level_index[j].byte_length != level_size)
+        {
+            std::cout << "ERROR::Mip " << j << " of " << path << " does not match the size of its format!" << std::endl;
+            image.deallocate();
+            return false;
+        }
+
+        f.seekg(level_index[j].byte_offset);
+
+        for (int i = 0; i < image.array_slices; i++)
+            f.read((char*)image.data[i][j].data, image.data[i][j].size);
+    }
+
+    return !f.fail();
+}
+
 bool load_image(const std::string& path, Image& image)
 {
+    if (filesystem::get_file_extention(path) == "ktx2")
+        return load_ktx2(path, image);
     std::fstream f(path, std::ios::in | std::ios::binary);
 
     if (!f.is_open())
@@ -86,6 +181,9 @@ bool load_image(const std::string& path, Image& image)
 
     READ_AND_OFFSET(f, &image_header, sizeof(BINImageHeader), offset);
 
+    // Release what the image held before, its slice counts are about to change.
+    image.deallocate();
+
     image.array_slices = image_header.num_array_slices;
     image.mip_slices   = image_header.num_mip_slices;
     image.components   = image_header.num_channels;
@@ -95,6 +193,66 @@ bool load_image(const std::string& path, Image& image)
     if (image_header.num_array_slices == 0)
         return false;
 
+    // Mips are indexed into a fixed array of 16, the same limit as KTX2 files.
+    if (image_header.num_mip_slices == 0 || image_header.num_mip_slices > 16)
+    {
+        std::cout << "ERROR::Only images with 1 to 16 mips are supported: " << path << std::endl;
+        return false;
+    }
+
+    if (file_header.version > AST_VERSION)
+    {
+        std::cout << "ERROR::Unsupported file version " << int(file_header.version) << " in " << path << std::endl;
+        return false;
+    }
+
+    if (image.data.size() < size_t(image.array_slices))
+        image.data.resize(image.array_slices);
+
+    // Stored sizes are checked against the dimensions and format before anything is allocated, so a corrupt size
+    // cannot turn into a huge allocation or a read past the end of a level.
+    auto validate = [&](const BINMipSliceHeader& mip_header, int mip) {
+        const size_t expected = image.compression == COMPRESSION_NONE ? size_t(mip_header.width) * mip_header.height * image.components * size_t(image.type) : compressed_size(image.compression, mip_header.width, mip_header.height);
+
+        if (mip_header.size < 0 || size_t(mip_header.size) != expected)
+        {
+            std::cout << "ERROR::Mip " << mip << " of " << path << " does not match the size of its format!" << std::endl;
+            return false;
+        }
+
+        return true;
+    };
+
+    if (file_header.version >= 2)
+    {
+        // All mip headers come first, followed by the level data in the same order, which is read straight into the
+        // contiguous storage of the image.
+        std::vector<BINMipSliceHeader> mip_headers(size_t(image.array_slices) * image.mip_slices);
+
+        READ_AND_OFFSET(f, mip_headers.data(), sizeof(BINMipSliceHeader) * mip_headers.size(), offset);
+
+        for (int i = 0; i < image.array_slices; i++)
+        {
+            for (int j = 0; j < image.mip_slices; j++)
+            {
+                const BINMipSliceHeader& mip_header = mip_headers[i * image.mip_slices + j];
+
+                if (!validate(mip_header, j))
+                    return false;
+
+                image.data[i][j].width  = mip_header.width;
+                image.data[i][j].height = mip_header.height;
+                image.data[i][j].size   = mip_header.size;
+            }
+        }
+
+        image.allocate_storage();
+
+        READ_AND_OFFSET(f, image.storage, image.storage_size(), offset);
+
+        return !f.fail();
+    }
+
     for (int i = 0; i < image.array_slices; i++)
     {
         for (int j = 0; j < image.mip_slices; j++)
@@ -102,6 +260,9 @@ bool load_image(const std::string& path, Image& image)
             BINMipSliceHeader mip_header;
             READ_AND_OFFSET(f, &mip_header, sizeof(BINMipSliceHeader), offset);
 
+            if (!validate(mip_header, j))
+                return false;
+
             image.data[i][j].width  = mip_header.width;
             image.data[i][j].height = mip_header.height;
             image.data[i][j].data   = malloc(mip_header.size);
@@ -0,0 +1,530 @@
+#include <exporter/image_exporter.h>
+#include <common/filesystem.h>
+#include <common/parallel.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <glm.hpp>
+#include <chrono>
+
+// Fits linearly transformed cosines to the GGX BRDF for area lights, following "Real-Time Polygonal-Light Shading
+// with Linearly Transformed Cosines" (Heitz et al. 2016) and its reference fitter.
+
+#define LTC_TABLE_SIZE 64
+#define LTC_ERROR_SAMPLES 32
+#define LTC_MIN_ALPHA 0.00001f
+#define LTC_FIT_EPSILON 0.05f
+#define LTC_FIT_TOLERANCE 1e-5f
+#define LTC_FIT_MAX_ITERATIONS 100
+
+const float PI = 3.14159265359f;
+
+// ----------------------------------------------------------------------------
+
+struct GGX
+{
+    static float lambda(float alpha, float cos_theta)
+    {
+        if (cos_theta >= 1.0f)
+            return 0.0f;
+
+        const float a = 1.0f / alpha / tanf(acosf(cos_theta));
+        return 0.5f * (-1.0f + sqrtf(1.0f + 1.0f / (a * a)));
+    }
+
+    // Returns the BRDF times the cosine of L, and the pdf of sampling L with sample().
+    static float eval(const glm::vec3& V, const glm::vec3& L, float alpha, float& pdf)
+    {
+        if (V.z <= 0.0f)
+        {
+            pdf = 0.0f;
+            return 0.0f;
+        }
+
+        const float lambda_v = lambda(alpha, V.z);
+        float       g2       = 0.0f;
+
+        if (L.z > 0.0f)
+            g2 = 1.0f / (1.0f + lambda_v + lambda(alpha, L.z));
+
+        const glm::vec3 H = glm::normalize(V + L);
+
+        const float slope_x = H.x / H.z;
+        const float slope_y = H.y / H.z;
+
+        float d = 1.0f / (1.0f + (slope_x * slope_x + slope_y * slope_y) / alpha / alpha);
+        d       = d * d;
+        d       = d / (PI * alpha * alpha * H.z * H.z * H.z * H.z);
+
+        pdf = fabsf(d * H.z / 4.0f / glm::dot(V, H));
+
+        return d * g2 / 4.0f / V.z;
+    }
+
+    static glm::vec3 sample(const glm::vec3& V, float alpha, float u1, float u2)
+    {
+        const float phi = 2.0f * PI * u1;
+        const float r   = alpha * sqrtf(u2 / (1.0f - u2));
+
+        const glm::vec3 N = glm::normalize(glm::vec3(r * cosf(phi), r * sinf(phi), 1.0f));
+
+        return -V + 2.0f * N * glm::dot(N, V);
+    }
+};
+
+// ----------------------------------------------------------------------------
+
+struct LTC
+{
+    float magnitude = 1.0f;
+    float fresnel   = 1.0f;
+
+    // Parametric representation, M = [X Y Z] * [m11 0 m13; 0 m22 0; 0 0 1].
+    float     m11 = 1.0f;
+    float     m22 = 1.0f;
+    float     m13 = 0.0f;
+    glm::vec3 X   = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 Y   = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 Z   = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    glm::mat3 M;
+    glm::mat3 inv_M;
+    float     det_M = 1.0f;
+
+    void update()
+    {
+        M     = glm::mat3(X, Y, Z) * glm::mat3(m11, 0.0f, 0.0f, 0.0f, m22, 0.0f, m13, 0.0f, 1.0f);
+        inv_M = glm::inverse(M);
+        det_M = fabsf(glm::determinant(M));
+    }
+
+    float eval(const glm::vec3& L) const
+    {
+        const glm::vec3 L_original = glm::normalize(inv_M * L);
+        const glm::vec3 L_         = M * L_original;
+
+        const float l        = glm::length(L_);
+        const float jacobian = det_M / (l * l * l);
+        const float d        = std::max(0.0f, L_original.z) / PI;
+
+        return magnitude * d / jacobian;
+    }
+
+    glm::vec3 sample(float u1, float u2) const
+    {
+        const float theta = acosf(sqrtf(u1));
+        const float phi   = 2.0f * PI * u2;
+
+        return glm::normalize(M * glm::vec3(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)));
+    }
+};
+
+// ----------------------------------------------------------------------------
+
+// Integrates the norm and Fresnel terms of the BRDF and its average direction, which becomes the Z axis of the LTC.
+void compute_average_terms(const glm::vec3& V, float alpha, float& norm, float& fresnel, glm::vec3& average_dir)
+{
+    norm        = 0.0f;
+    fresnel     = 0.0f;
+    average_dir = glm::vec3(0.0f);
+
+    for (int j = 0; j < LTC_ERROR_SAMPLES; j++)
+    {
+        for (int i = 0; i < LTC_ERROR_SAMPLES; i++)
+        {
+            const float u1 = (i + 0.5f) / LTC_ERROR_SAMPLES;
+            const float u2 = (j + 0.5f) / LTC_ERROR_SAMPLES;
+
+            const glm::vec3 L = GGX::sample(V, alpha, u1, u2);
+
+            float       pdf;
+            const float eval = GGX::eval(V, L, alpha, pdf);
+
+            if (pdf > 0.0f)
+            {
+                const float     weight = eval / pdf;
+                const glm::vec3 H      = glm::normalize(V + L);
+
+                norm += weight;
+                fresnel += weight * powf(1.0f - std::max(glm::dot(V, H), 0.0f), 5.0f);
+                average_dir += weight * L;
+            }
+        }
+    }
+
+    norm /= float(LTC_ERROR_SAMPLES * LTC_ERROR_SAMPLES);
+    fresnel /= float(LTC_ERROR_SAMPLES * LTC_ERROR_SAMPLES);
+
+    // The BRDF is symmetric around the plane of V.
+    average_dir.y = 0.0f;
+    average_dir   = glm::normalize(average_dir);
+}
+
+// ----------------------------------------------------------------------------
+
+// Cubed error between the BRDF and the LTC, multiple importance sampled from both.
+float compute_error(const LTC& ltc, const glm::vec3& V, float alpha)
+{
+    double error = 0.0;
+
+    for (int j = 0; j < LTC_ERROR_SAMPLES; j++)
+    {
+        for (int i = 0; i < LTC_ERROR_SAMPLES; i++)
+        {
+            const float u1 = (i + 0.5f) / LTC_ERROR_SAMPLES;
+            const float u2 = (j + 0.5f) / LTC_ERROR_SAMPLES;
+
+            for (int technique = 0; technique < 2; technique++)
+            {
+                const glm::vec3 L = technique == 0 ? ltc.sample(u1, u2) : GGX::sample(V, alpha, u1, u2);
+
+                float       pdf_brdf;
+                const float eval_brdf = GGX::eval(V, L, alpha, pdf_brdf);
+                const float eval_ltc  = ltc.eval(L);
+                const float pdf_ltc   = eval_ltc / ltc.magnitude;
+
+                double e = fabs(double(eval_brdf) - double(eval_ltc));
+                e        = e * e * e;
+
+                if (pdf_ltc + pdf_brdf > 0.0f)
+                    error += e / double(pdf_ltc + pdf_brdf);
+            }
+        }
+    }
+
+    return float(error / double(LTC_ERROR_SAMPLES * LTC_ERROR_SAMPLES));
+}
+
+// ----------------------------------------------------------------------------
+
+void apply_parameters(LTC& ltc, const float* params, bool isotropic)
+{
+    const float m11 = std::max(params[0], 1e-7f);
+    const float m22 = std::max(params[1], 1e-7f);
+
+    ltc.m11 = m11;
+    ltc.m22 = isotropic ? m11 : m22;
+    ltc.m13 = isotropic ? 0.0f : params[2];
+    ltc.update();
+}
+
+// ----------------------------------------------------------------------------
+
+float evaluate_parameters(LTC& ltc, const glm::vec3& V, float alpha, const float* params, bool isotropic)
+{
+    apply_parameters(ltc, params, isotropic);
+    return compute_error(ltc, V, alpha);
+}
+
+// ----------------------------------------------------------------------------
+
+// Nelder-Mead downhill simplex over (m11, m22, m13).
+void fit(LTC& ltc, const glm::vec3& V, float alpha, bool isotropic)
+{
+    const int DIM = 3;
+
+    float simplex[DIM + 1][DIM];
+    float values[DIM + 1];
+
+    simplex[0][0] = ltc.m11;
+    simplex[0][1] = ltc.m22;
+    simplex[0][2] = ltc.m13;
+
+    for (int i = 1; i <= DIM; i++)
+    {
+        for (int j = 0; j < DIM; j++)
+            simplex[i][j] = simplex[0][j];
+
+        simplex[i][i - 1] += LTC_FIT_EPSILON;
+    }
+
+    for (int i = 0; i <= DIM; i++)
+        values[i] = evaluate_parameters(ltc, V, alpha, simplex[i], isotropic);
+
+    for (int iteration = 0; iteration < LTC_FIT_MAX_ITERATIONS; iteration++)
+    {
+        int lowest = 0, highest = 0;
+
+        for (int i = 1; i <= DIM; i++)
+        {
+            if (values[i] < values[lowest])
+                lowest = i;
+
+            if (values[i] > values[highest])
+                highest = i;
+        }
+
+        int second_highest = lowest;
+
+        for (int i = 0; i <= DIM; i++)
+        {
+            if (i != highest && values[i] > values[second_highest])
+                second_highest = i;
+        }
+
+        if (fabsf(values[highest] - values[lowest]) < LTC_FIT_TOLERANCE)
+            break;
+
+        float centroid[DIM] = {};
+
+        for (int i = 0; i <= DIM; i++)
+        {
+            if (i != highest)
+            {
+                for (int j = 0; j < DIM; j++)
+                    centroid[j] += simplex[i][j] / DIM;
+            }
+        }
+
+        float reflected[DIM];
+
+        for (int j = 0; j < DIM; j++)
+            reflected[j] = centroid[j] + (centroid[j] - simplex[highest][j]);
+
+        const float reflected_value = evaluate_parameters(ltc, V, alpha, reflected, isotropic);
+
+        if (reflected_value < values[lowest])
+        {
+            float expanded[DIM];
+
+            for (int j = 0; j < DIM; j++)
+                expanded[j] = centroid[j] + 2.0f * (centroid[j] - simplex[highest][j]);
+
+            const float expanded_value = evaluate_parameters(ltc, V, alpha, expanded, isotropic);
+            const bool  expand         = expanded_value < reflected_value;
+
+            for (int j = 0; j < DIM; j++)
+                simplex[highest][j] = expand ? expanded[j] : reflected[j];
+
+            values[highest] = expand ? expanded_value : reflected_value;
+        }
+        else if (reflected_value < values[second_highest])
+        {
+            for (int j = 0; j < DIM; j++)
+                simplex[highest][j] = reflected[j];
+
+            values[highest] = reflected_value;
+        }
+        else
+        {
+            float contracted[DIM];
+
+            for (int j = 0; j < DIM; j++)
+                contracted[j] = centroid[j] + 0.5f * (simplex[highest][j] - centroid[j]);
+
+            const float contracted_value = evaluate_parameters(ltc, V, alpha, contracted, isotropic);
+
+            if (contracted_value < values[highest])
+            {
+                for (int j = 0; j < DIM; j++)
+                    simplex[highest][j] = contracted[j];
+
+                values[highest] = contracted_value;
+            }
+            else
+            {
+                // Shrink towards the best vertex.
+                for (int i = 0; i <= DIM; i++)
+                {
+                    if (i == lowest)
+                        continue;
+
+                    for (int j = 0; j < DIM; j++)
+                        simplex[i][j] = simplex[lowest][j] + 0.5f * (simplex[i][j] - simplex[lowest][j]);
+
+                    values[i] = evaluate_parameters(ltc, V, alpha, simplex[i], isotropic);
+                }
+            }
+        }
+    }
+
+    int lowest = 0;
+
+    for (int i = 1; i <= DIM; i++)
+    {
+        if (values[i] < values[lowest])
+            lowest = i;
+    }
+
+    apply_parameters(ltc, simplex[lowest], isotropic);
+}
+
+// ----------------------------------------------------------------------------
+
+// Fits a single cell, starting from the parameters already stored in the LTC.
+void fit_cell(LTC& ltc, int a, int t, int size)
+{
+    // The view angle is parameterized by sqrt(1 - cos theta), which spends more cells near grazing angles.
+    const float     x         = float(t) / float(size - 1);
+    const float     ct        = 1.0f - x * x;
+    const float     theta     = std::min(1.57f, acosf(ct));
+    const glm::vec3 V         = glm::vec3(sinf(theta), 0.0f, cosf(theta));
+    const float     roughness = float(a) / float(size - 1);
+    const float     alpha     = std::max(roughness * roughness, LTC_MIN_ALPHA);
+
+    glm::vec3 average_dir;
+    compute_average_terms(V, alpha, ltc.magnitude, ltc.fresnel, average_dir);
+
+    bool isotropic;
+
+    if (t == 0)
+    {
+        // Normal incidence, the LTC is a scaled cosine around the normal.
+        ltc.X     = glm::vec3(1.0f, 0.0f, 0.0f);
+        ltc.Y     = glm::vec3(0.0f, 1.0f, 0.0f);
+        ltc.Z     = glm::vec3(0.0f, 0.0f, 1.0f);
+        ltc.m13   = 0.0f;
+        isotropic = true;
+    }
+    else
+    {
+        ltc.X     = glm::vec3(average_dir.z, 0.0f, -average_dir.x);
+        ltc.Y     = glm::vec3(0.0f, 1.0f, 0.0f);
+        ltc.Z     = average_dir;
+        isotropic = false;
+    }
+
+    ltc.update();
+    fit(ltc, V, alpha, isotropic);
+}
+
+// ----------------------------------------------------------------------------
+
+void print_usage()
+{
+    printf("usage: ltc_fit [options] [outpath]\n\n");
+
+    printf("Writes [name]_1 with the inverse LTC matrices and [name]_2 with the BRDF magnitude and Fresnel terms.\n");
+    printf("Both are indexed by roughness (x) and sqrt(1 - cos theta) (y).\n\n");
+
+    printf("Options:\n");
+    printf("  -H			Store the tables as half floats.\n");
+    printf("  -S[size]		Table width and height (default 64).\n");
+}
+
+// ----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc == 1)
+    {
+        print_usage();
+        return 1;
+    }
+    else
+    {
+        std::string    output;
+        ast::PixelType pixel_type = ast::PIXEL_TYPE_FLOAT32;
+        int32_t        size       = LTC_TABLE_SIZE;
+
+        for (int32_t i = 1; i < argc; i++)
+        {
+            if (argv[i][0] == '-')
+            {
+                char c = tolower(argv[i][1]);
+
+                if (c == 'h')
+                    pixel_type = ast::PIXEL_TYPE_FLOAT16;
+                else if (c == 's')
+                    size = std::max(atoi(&argv[i][2]), 2);
+            }
+            else
+                output = argv[i];
+        }
+
+        if (output.size() == 0)
+        {
+            printf("ERROR: Invalid output path\n\n");
+            print_usage();
+
+            return 1;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<LTC> table(size_t(size) * size);
+
+        // Every cell starts from the fit of its neighbour. The normal incidence column is fitted first, from rough to
+        // smooth, then every roughness row walks towards grazing angles on its own, so rows are fitted in parallel
+        // with the same result as a sequential fit.
+        for (int32_t a = size - 1; a >= 0; a--)
+        {
+            LTC& ltc = table[a];
+
+            if (a < size - 1)
+            {
+                ltc.m11 = table[a + 1].m11;
+                ltc.m22 = table[a + 1].m22;
+            }
+
+            fit_cell(ltc, a, 0, size);
+        }
+
+        ast::parallel_for(0, size, [&](int32_t a) {
+            for (int32_t t = 1; t < size; t++)
+            {
+                LTC& ltc = table[size_t(t) * size + a];
+                ltc = table[size_t(t - 1) * size + a];
+
+                fit_cell(ltc, a, t, size);
+            }
+        });
+
+        ast::ImageExportOptions options;
+        options.compression = ast::COMPRESSION_NONE;
+        options.pixel_type  = pixel_type;
+        options.normal_map  = false;
+        options.flip_green  = false;
+        options.output_mips = 0;
+
+        std::string filename = filesystem::get_filename(output);
+        std::string path     = filesystem::get_file_path(output);
+
+        if (path.size() > 0)
+            options.path = path;
+        else
+            options.path = "";
+
+        ast::Image matrices;
+        matrices.name = filename + "_1";
+        matrices.allocate(ast::PIXEL_TYPE_FLOAT32, size, size, 4, 1, 1);
+
+        ast::Image amplitudes;
+        amplitudes.name = filename + "_2";
+        amplitudes.allocate(ast::PIXEL_TYPE_FLOAT32, size, size, 2, 1, 1);
+
+        float* matrix_pixels    = (float*)matrices.data[0][0].data;
+        float* amplitude_pixels = (float*)amplitudes.data[0][0].data;
+
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            // Only four entries of the inverse are non-zero after normalizing by the middle element.
+            glm::mat3 m = glm::inverse(table[i].M);
+            m /= m[1][1];
+
+            matrix_pixels[i * 4 + 0] = m[0][0];
+            matrix_pixels[i * 4 + 1] = m[0][2];
+            matrix_pixels[i * 4 + 2] = m[2][0];
+            matrix_pixels[i * 4 + 3] = m[2][2];
+
+            amplitude_pixels[i * 2 + 0] = table[i].magnitude;
+            amplitude_pixels[i * 2 + 1] = table[i].fresnel;
+        }
+
+        if (!export_image(matrices, options))
+            printf("Failed to output LTC matrices: %s\n", output.c_str());
+
+        if (!export_image(amplitudes, options))
+            printf("Failed to output LTC amplitudes: %s\n", output.c_str());
+
+        auto                          finish = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> time   = finish - start;
+
+        printf("\nSuccessfully generated LTC tables in %f seconds\n\n", time.count());
+
+        return 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
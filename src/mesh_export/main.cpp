@@ -2,6 +2,8 @@
 #include <importer/mesh_importer.h>
 #include <exporter/mesh_exporter.h>
 #include <common/filesystem.h>
+#include <common/build_cache.h>
+#include <filesystem>
 #include <stdio.h>
 
 void print_usage()
@@ -14,6 +16,9 @@ void print_usage()
     printf("  -J            Output metadata JSON.\n");
     printf("  -D            Displacement as normal.\n");
     printf("  -O            Input mesh is from the ORCA library.\n");
+    printf("  -F            Rebuild everything, ignoring the build cache.\n");
+    printf("\nSet " ARTIFACT_STORE_ENV " to a directory, which may be on a shared mount, to reuse files converted by other\n");
+    printf("builds. " ARTIFACT_STORE_SIZE_ENV " bounds its size (default 16 GB).\n");
 }
 
 int main(int argc, char* argv[])
@@ -29,6 +34,7 @@ int main(int argc, char* argv[])
         ast::MeshImportOptions import_options;
         ast::MeshExportOption  export_options;
         ast::MeshImportResult  import_result;
+        bool                   use_cache = true;
 
         int32_t input_idx = 99999;
 
@@ -48,6 +54,8 @@ int main(int argc, char* argv[])
                     import_options.displacement_as_normal = true;
                 else if (c == 'o')
                     import_options.is_orca_mesh = true;
+                else if (c == 'f')
+                    use_cache = false;
             }
             else if (i > 0)
             {
@@ -79,9 +87,58 @@ int main(int argc, char* argv[])
             }
         }
 
+        // The mesh is skipped if neither it nor the textures it used last time changed. Otherwise it is imported again
+        // and only the textures that changed are converted.
+        const std::string output_root = std::filesystem::absolute(export_options.output_root_folder_path).string();
+        const std::string output_path = output_root + "/mesh/" + filesystem::get_filename(input) + ".ast";
+
+        ast::BuildCache cache;
+        uint64_t        key = 0;
+
+        if (use_cache)
+        {
+            cache.load(output_root + "/" + BUILD_CACHE_FILE_NAME);
+
+            if (ast::mesh_build_key(input, cache.dependencies(output_path), import_options, export_options, key) && cache.up_to_date(output_path, key))
+            {
+                printf("Skipping %s, it is up to date.\n", input.c_str());
+                return 0;
+            }
+
+            export_options.cache = &cache;
+        }
+
+        ast::ArtifactStore store;
+
+        if (store.open_from_environment())
+            export_options.store = &store;
+
         if (ast::import_mesh(input, import_result, import_options))
         {
-            if (!ast::export_mesh(import_result, export_options))
+            // A mesh with a failed texture is not recorded, so the texture is tried again by the next run. The textures
+            // that did convert are recorded by export_mesh and kept either way.
+            const bool exported = ast::export_mesh(import_result, export_options);
+
+            if (use_cache)
+            {
+                if (exported)
+                {
+                    std::vector<std::string> dependencies;
+
+                    for (const auto& material : import_result.materials)
+                    {
+                        for (const auto& texture : material->textures)
+                            dependencies.push_back(texture.path);
+                    }
+
+                    if (ast::mesh_build_key(input, dependencies, import_options, export_options, key))
+                        cache.update(output_path, key, dependencies);
+                }
+
+                cache.save();
+            }
+
+            if (!exported)
             {
                 printf("ERROR: Failed to export mesh!\n\n");
                 return 1;
@@ -1,9 +1,15 @@
 #include <exporter/image_exporter.h>
 #include <common/filesystem.h>
+#include <common/sh.h>
+#include <common/parallel.h>
+#include <loader/loader.h>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <algorithm>
 #include <glm.hpp>
 #include <chrono>
@@ -32,13 +38,6 @@ inline float lerp(float a, float b, float t)
 
 // ----------------------------------------------------------------------------
 
-inline float area_integral(float x, float y)
-{
-    return std::atan2f(x * y, std::sqrtf(x * x + y * y + 1));
-}
-
-// ----------------------------------------------------------------------------
-
 inline float unlerp(int val, int max)
 {
     return (val + 0.5f) / max;
@@ -161,7 +160,7 @@ struct Cubemap
 
         ~Data()
         {
-            free(pixels);
+            delete[] pixels;
         }
     };
 
@@ -177,12 +176,6 @@ struct Cubemap
             faces[i].pixels = new glm::vec3[w * h];
     }
 
-    Cubemap(const std::string paths[])
-    {
-        for (uint32_t i = 0; i < NUM_FACES; i++)
-            faces[i].pixels = (glm::vec3*)stbi_loadf(paths[i].c_str(), &width, &height, &comp, 0);
-    }
-
     void set_texel(glm::vec3 color, Face face, int32_t x, int32_t y)
     {
         assert(face < NUM_FACES);
@@ -230,22 +223,6 @@ struct Cubemap
         return glm::mix(mix_0, mix_1, y_fract);
     }
 
-    float calculate_solid_angle(Face face, int32_t x, int32_t y) const
-    {
-        float s = unlerp(x, width) * 2.0f - 1.0f;
-        float t = unlerp(y, height) * 2.0f - 1.0f;
-
-        // assumes square face
-        float half_texel_size = 1.0f / width;
-
-        float x0 = s - half_texel_size;
-        float y0 = t - half_texel_size;
-        float x1 = s + half_texel_size;
-        float y1 = t + half_texel_size;
-
-        return area_integral(x0, y0) - area_integral(x0, y1) - area_integral(x1, y0) + area_integral(x1, y1);
-    }
-
     glm::vec3 calculate_direction(Face face, int32_t face_x, int32_t face_y) const
     {
         float s = unlerp(face_x, width) * 2.0f - 1.0f;
@@ -289,50 +266,139 @@ struct Cubemap
 
         // Normalize vector
         glm::vec3 d;
-        float     inv_len = 1.0f / std::sqrtf(x * x + y * y + z * z);
+        float     inv_len = 1.0f / sqrtf(x * x + y * y + z * z);
         d.x               = x * inv_len;
         d.y               = y * inv_len;
         d.z               = z * inv_len;
 
         return d;
     }
+};
+
+// ----------------------------------------------------------------------------
+
+struct Probe
+{
+    std::string path; // Path of an .ast cubemap, or the common name of six HDR faces.
+    bool        ast;
+};
+
+// ----------------------------------------------------------------------------
+
+// Loads the six HDR faces into a single cubemap image for ast::project_sh.
+bool load_cube_map(const std::string& common_name, ast::Image& cubemap)
+{
+    static const char* endings[] = { "_posx.hdr", "_negx.hdr", "_posy.hdr", "_negy.hdr", "_posz.hdr", "_negz.hdr" };
 
-    SH9Color project_sh9()
+    for (int32_t face = 0; face < Cubemap::NUM_FACES; face++)
     {
-        SH9Color coef;
+        std::string path = common_name + endings[face];
 
-        float weight_sum = 0.0f;
+        int32_t w, h, comp;
+        float*  pixels = stbi_loadf(path.c_str(), &w, &h, &comp, 3);
 
-        for (int32_t face = 0; face < NUM_FACES; face++)
+        if (!pixels)
         {
-            for (int32_t y = 0; y < height; y++)
-            {
-                for (int32_t x = 0; x < width; x++)
-                {
-                    const Cubemap::Face cube_face   = static_cast<Cubemap::Face>(face);
-                    const glm::vec3     texel       = read_texel(cube_face, x, y);
-                    const float         solid_angle = calculate_solid_angle(cube_face, x, y);
-                    const glm::vec3     direction   = calculate_direction(cube_face, x, y);
-                    const SH9           basis       = project_onto_sh9(direction);
+            printf("ERROR: Failed to load cubemap face: %s\n", path.c_str());
+            return false;
+        }
 
-                    for (uint32_t i = 0; i < 9; i++)
-                        coef.c[i] += texel * basis.c[i] * solid_angle;
+        if (face == 0)
+            cubemap.allocate(ast::PIXEL_TYPE_FLOAT32, w, h, 3, Cubemap::NUM_FACES, 1);
 
-                    weight_sum += solid_angle;
-                }
-            }
+        if (w != cubemap.data[0][0].width || h != cubemap.data[0][0].height)
+        {
+            printf("ERROR: Cubemap face size mismatch: %s\n", path.c_str());
+            stbi_image_free(pixels);
+            return false;
         }
 
-        printf("Weight Sum = %f\n", weight_sum);
+        memcpy(cubemap.data[face][0].data, pixels, cubemap.data[face][0].size);
+        stbi_image_free(pixels);
+    }
 
-        float scale = (4.0f * Pi) / weight_sum;
+    return true;
+}
 
-        for (uint32_t i = 0; i < 9; i++)
-            coef.c[i] *= scale;
+// ----------------------------------------------------------------------------
 
-        return coef;
+bool project_probe(const Probe& probe, ast::SHCoefficients& sh)
+{
+    ast::Image cubemap;
+
+    if (probe.ast)
+    {
+        if (!ast::load_image(probe.path, cubemap))
+        {
+            printf("ERROR: Failed to load cubemap: %s\n", probe.path.c_str());
+            return false;
+        }
     }
-};
+    else if (!load_cube_map(probe.path, cubemap))
+        return false;
+
+    return ast::project_sh(cubemap, sh);
+}
+
+// ----------------------------------------------------------------------------
+
+Probe make_probe(const std::string& entry)
+{
+    Probe probe;
+
+    probe.path = entry;
+    probe.ast  = filesystem::get_file_extention(entry) == "ast";
+
+    return probe;
+}
+
+// ----------------------------------------------------------------------------
+
+// A batch is either a directory, where every .ast file and every set of '_posx.hdr' faces is a probe, or a manifest
+// with one .ast path or face common name per line. Empty lines and lines starting with '#' are skipped.
+bool collect_probes(const std::string& input, std::vector<Probe>& probes)
+{
+    if (filesystem::directory_exists_internal(input))
+    {
+        const std::string suffix = "_posx.hdr";
+
+        for (const std::string& file : filesystem::list_files(input))
+        {
+            if (filesystem::get_file_extention(file) == "ast")
+                probes.push_back(make_probe(input + "/" + file));
+            else if (file.size() > suffix.size() && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0)
+                probes.push_back(make_probe(input + "/" + file.substr(0, file.size() - suffix.size())));
+        }
+    }
+    else
+    {
+        std::ifstream manifest(input);
+
+        if (!manifest.is_open())
+        {
+            printf("ERROR: Failed to open probe manifest: %s\n", input.c_str());
+            return false;
+        }
+
+        std::string line;
+
+        while (std::getline(manifest, line))
+        {
+            line.erase(std::find_if(line.rbegin(), line.rend(), [](unsigned char c) { return !isspace(c); }).base(), line.end());
+
+            if (!line.empty() && line[0] != '#')
+                probes.push_back(make_probe(line));
+        }
+    }
+
+    if (probes.empty())
+    {
+        printf("ERROR: No probes found in: %s\n", input.c_str());
+        return false;
+    }
+
+    return true;
+}
 
 // ----------------------------------------------------------------------------
 
@@ -412,10 +478,13 @@ void output_cube_map(const SH9Color& coef, const std::string& name, const int32_
 
 void print_usage()
 {
-    printf("usage: brdf_lut [input_common_name] [outpath]\n\n");
+    printf("usage: sh_project [options] [input] [outpath]\n\n");
 
     printf("Input options:\n");
-    printf("  [input_common_name]	All faces must be HDR images with the name followed by '_posx', '_negx' etc \n");
+    printf("  [input]				An .ast cubemap, or the common name of HDR faces followed by '_posx', '_negx' etc.\n");
+    printf("  -B					Batch mode. The input is a directory or a manifest with one probe per line, and the\n");
+    printf("  					coefficients of all probes are packed into one image with a row per probe.\n");
+    printf("  -L[1-5]				Number of SH bands (default 3, 9 coefficients).\n");
     printf("  -P					Print spherical harmonics coefficients.\n");
     printf("  -I					Output irradiance map.\n");
 }
@@ -435,6 +504,8 @@ int main(int argc, char* argv[])
         std::string output;
         bool        print_coefficients = false;
         bool        output_irradiance  = false;
+        bool        batch              = false;
+        int         order              = 3;
 
         int32_t input_idx = 99999;
 
@@ -448,6 +519,10 @@ int main(int argc, char* argv[])
                     print_coefficients = true;
                 else if (c == 'i')
                     output_irradiance = true;
+                else if (c == 'b')
+                    batch = true;
+                else if (c == 'l')
+                    order = std::min(std::max(atoi(&argv[i][2]), 1), SH_MAX_ORDER);
             }
             else if (i > 0)
             {
@@ -496,35 +571,66 @@ int main(int argc, char* argv[])
         else
             options.path = "";
 
-        ast::Image img;
-        img.name = filename;
-        img.allocate(ast::PIXEL_TYPE_FLOAT32, NUM_COEFFICIENTS, 1, 3, 1, 1);
+        std::vector<Probe> probes;
+
+        if (batch)
+        {
+            if (!collect_probes(input, probes))
+                return 1;
+        }
+        else
+            probes.push_back(make_probe(input));
+
+        // Probes are loaded and projected concurrently. The projection of each probe then runs on its own thread.
+        std::vector<ast::SHCoefficients> coefficients(probes.size());
+        std::vector<uint8_t>             succeeded(probes.size(), 0);
+
+        for (ast::SHCoefficients& sh : coefficients)
+            sh.order = order;
+
+        ast::parallel_for(0, int32_t(probes.size()), [&](int32_t i) {
+            succeeded[i] = project_probe(probes[i], coefficients[i]);
+        });
 
-        glm::vec3* pixels = (glm::vec3*)img.data[0][0].data;
+        for (size_t i = 0; i < probes.size(); i++)
+        {
+            if (!succeeded[i])
+            {
+                printf("ERROR: Failed to project probe: %s\n", probes[i].path.c_str());
+                return 1;
+            }
+        }
 
-        std::string faces[] = {
-            input + "_posx.hdr",
-            input + "_negx.hdr",
-            input + "_posy.hdr",
-            input + "_negy.hdr",
-            input + "_posz.hdr",
-            input + "_negz.hdr"
-        };
+        const int32_t num_coefficients = order * order;
 
-        Cubemap cubemap(faces);
+        ast::Image img;
+        img.name = filename;
+        img.allocate(ast::PIXEL_TYPE_FLOAT32, num_coefficients, int32_t(probes.size()), 3, 1, 1);
 
-        SH9Color coef = cubemap.project_sh9();
+        float* pixels = (float*)img.data[0][0].data;
 
-        if (print_coefficients)
+        for (size_t p = 0; p < probes.size(); p++)
         {
-            for (uint32_t i = 0; i < NUM_COEFFICIENTS; i++)
+            if (print_coefficients && batch)
+                printf("%s:\n", probes[p].path.c_str());
+
+            for (int32_t i = 0; i < num_coefficients; i++)
             {
-                printf("%i = [ %f, %f, %f ]\n", i, coef.c[i].x, coef.c[i].y, coef.c[i].z);
-                pixels[i] = coef.c[i];
+                const float* c = coefficients[p].c[i];
+
+                memcpy(&pixels[(p * num_coefficients + i) * 3], c, sizeof(float) * 3);
+
+                if (print_coefficients)
+                    printf("%i = [ %f, %f, %f ]\n", i, c[0], c[1], c[2]);
             }
         }
 
-        if (output_irradiance)
+        SH9Color coef;
+
+        for (int32_t i = 0; i < std::min(num_coefficients, NUM_COEFFICIENTS); i++)
+            coef.c[i] = glm::vec3(coefficients[0].c[i][0], coefficients[0].c[i][1], coefficients[0].c[i][2]);
+
+        if (output_irradiance && !batch)
             output_irradiance_cube_map(coef, "output_irradiance_", 512, 512);
 
         if (!export_image(img, options))
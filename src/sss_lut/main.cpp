@@ -0,0 +1,161 @@
+#include <exporter/image_exporter.h>
+#include <common/filesystem.h>
+#include <common/sss.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+
+// ----------------------------------------------------------------------------
+
+// Reads a diffusion profile with one Gaussian per line: variance (mm^2) followed by the red, green and blue weights.
+// Empty lines and lines starting with '#' are skipped.
+bool load_profile(const std::string& path, ast::DiffusionProfile& profile)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open())
+    {
+        printf("ERROR: Failed to open diffusion profile: %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream     stream(line);
+        ast::DiffusionGaussian gaussian;
+
+        if (!(stream >> gaussian.variance >> gaussian.weight[0] >> gaussian.weight[1] >> gaussian.weight[2]))
+        {
+            printf("ERROR: Invalid diffusion profile entry: %s\n", line.c_str());
+            return false;
+        }
+
+        profile.gaussians.push_back(gaussian);
+    }
+
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+
+void print_usage()
+{
+    printf("usage: sss_lut [options] [outpath]\n\n");
+
+    printf("Writes [name] with diffuse scattering by N.L (x) and curvature (y), and [name]_transmittance by thickness (x).\n\n");
+
+    printf("Options:\n");
+    printf("  -H			Store the LUTs as half floats.\n");
+    printf("  -S[size]		Scattering LUT width and height (default 256).\n");
+    printf("  -N[n]			Integration steps per texel (default 1024).\n");
+    printf("  -C[max]		Curvature of the top row in 1/mm (default 1.0).\n");
+    printf("  -T[max]		Thickness of the last transmittance texel in mm (default 5.0).\n");
+    printf("  -P[path]		Diffusion profile, one 'variance r g b' Gaussian per line (default skin).\n");
+}
+
+// ----------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc == 1)
+    {
+        print_usage();
+        return 1;
+    }
+    else
+    {
+        std::string           output;
+        std::string           profile_path;
+        ast::PixelType        pixel_type = ast::PIXEL_TYPE_FLOAT32;
+        ast::SSSLUTOptions    lut_options;
+        ast::DiffusionProfile profile;
+
+        for (int32_t i = 1; i < argc; i++)
+        {
+            if (argv[i][0] == '-')
+            {
+                char c = tolower(argv[i][1]);
+
+                if (c == 'h')
+                    pixel_type = ast::PIXEL_TYPE_FLOAT16;
+                else if (c == 's')
+                    lut_options.size = std::max(atoi(&argv[i][2]), 2);
+                else if (c == 'n')
+                    lut_options.sample_count = std::max(atoi(&argv[i][2]), 2);
+                else if (c == 'c')
+                    lut_options.max_curvature = std::max(float(atof(&argv[i][2])), 0.0f);
+                else if (c == 't')
+                    lut_options.max_thickness = std::max(float(atof(&argv[i][2])), 0.0f);
+                else if (c == 'p')
+                    profile_path = &argv[i][2];
+            }
+            else
+                output = argv[i];
+        }
+
+        if (output.size() == 0)
+        {
+            printf("ERROR: Invalid output path\n\n");
+            print_usage();
+
+            return 1;
+        }
+
+        if (profile_path.size() > 0)
+        {
+            if (!load_profile(profile_path, profile))
+                return 1;
+        }
+        else
+            profile = ast::skin_diffusion_profile();
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        ast::ImageExportOptions options;
+        options.compression = ast::COMPRESSION_NONE;
+        options.pixel_type  = pixel_type;
+        options.normal_map  = false;
+        options.flip_green  = false;
+        options.output_mips = 0;
+
+        std::string filename = filesystem::get_filename(output);
+        std::string path     = filesystem::get_file_path(output);
+
+        if (path.size() > 0)
+            options.path = path;
+        else
+            options.path = "";
+
+        ast::Image scattering;
+        ast::Image transmittance;
+
+        if (!ast::generate_sss_lut(profile, scattering, lut_options) || !ast::generate_transmittance_lut(profile, transmittance, lut_options))
+            return 1;
+
+        scattering.name    = filename;
+        transmittance.name = filename + "_transmittance";
+
+        if (!export_image(scattering, options))
+            printf("Failed to output scattering LUT: %s\n", output.c_str());
+
+        if (!export_image(transmittance, options))
+            printf("Failed to output transmittance LUT: %s\n", output.c_str());
+
+        auto                          finish = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> time   = finish - start;
+
+        printf("\nSuccessfully generated SSS LUTs in %f seconds\n\n", time.count());
+
+        return 0;
+    }
+}
+
+// ----------------------------------------------------------------------------
@@ -0,0 +1,116 @@
+#include "test.h"
+#include <common/artifact_store.h>
+#include <inttypes.h>
+#include <chrono>
+#include <fstream>
+
+using namespace ast;
+
+static void write_bytes(const std::string& path, char value, size_t size)
+{
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    f << std::string(size, value);
+}
+
+static std::string read_bytes(const std::string& path)
+{
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+// Layout documented by ArtifactStore: [root]/[first 2 hex digits]/[16 hex digits].
+static std::string artifact_path(const std::string& root, uint64_t key)
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016" PRIx64, key);
+
+    return root + "/" + std::string(name, 2) + "/" + name;
+}
+
+static void set_age(const std::string& path, int hours)
+{
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - std::chrono::hours(hours));
+}
+
+static void test_round_trip()
+{
+    const std::string directory = test_directory("artifact_store_round_trip");
+    const std::string root      = directory + "/store";
+    const std::string file      = directory + "/image.ast";
+    const std::string output    = directory + "/out/image.ast";
+
+    ArtifactStore store;
+
+    CHECK(!store.fetch(1, output));
+    CHECK(store.open(root));
+    CHECK(!store.fetch(1, output));
+
+    write_bytes(file, 'a', 100);
+
+    CHECK(store.publish(1, file));
+    CHECK(std::filesystem::exists(artifact_path(root, 1)));
+
+    std::filesystem::create_directories(directory + "/out");
+
+    CHECK(store.fetch(1, output));
+    CHECK(read_bytes(output) == std::string(100, 'a'));
+    CHECK(!store.fetch(2, output));
+
+    // Publishing a key again keeps the stored bytes, every writer of a key stores the same output.
+    write_bytes(file, 'b', 100);
+
+    CHECK(store.publish(1, file));
+    CHECK(store.fetch(1, output));
+    CHECK(read_bytes(output) == std::string(100, 'a'));
+}
+
+static void test_eviction()
+{
+    const std::string directory = test_directory("artifact_store_eviction");
+    const std::string root      = directory + "/store";
+    const std::string file      = directory + "/mesh.ast";
+    const std::string output    = directory + "/fetched.ast";
+
+    ArtifactStore store;
+
+    CHECK(store.open(root, 1000));
+
+    write_bytes(file, 'm', 400);
+
+    CHECK(store.publish(1, file));
+    set_age(artifact_path(root, 1), 3);
+
+    CHECK(store.publish(2, file));
+    set_age(artifact_path(root, 2), 2);
+
+    // Fetching refreshes the artifact, so 2 is now the least recently used.
+    CHECK(store.fetch(1, output));
+
+    // 1200 bytes exceed the limit, the oldest artifacts are removed until the store is below 90% of it.
+    CHECK(store.publish(3, file));
+
+    CHECK(std::filesystem::exists(artifact_path(root, 1)));
+    CHECK(!std::filesystem::exists(artifact_path(root, 2)));
+    CHECK(std::filesystem::exists(artifact_path(root, 3)));
+
+    // Temporary files of interrupted writers are removed once they are old, recent ones may still be written.
+    const std::string stale  = root + "/00/0000000000000004.tmp.1";
+    const std::string recent = root + "/00/0000000000000005.tmp.1";
+
+    write_bytes(stale, 't', 10);
+    write_bytes(recent, 't', 10);
+    set_age(stale, 2);
+
+    store.evict();
+
+    CHECK(!std::filesystem::exists(stale));
+    CHECK(std::filesystem::exists(recent));
+}
+
+int main()
+{
+    test_round_trip();
+    test_eviction();
+
+    return TEST_RESULT();
+}
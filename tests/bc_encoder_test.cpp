@@ -0,0 +1,230 @@
+#include "test.h"
+#include <exporter/bc_encoder.h>
+#include <nvimage/BlockDXT.h>
+#include <nvimage/ColorBlock.h>
+#include <nvmath/Vector.inl>
+#include <math.h>
+#include <vector>
+
+using namespace ast;
+
+#define TEST_IMAGE_SIZE 64
+
+// Smooth gradients with a little deterministic noise, which every format can store well but none exactly. The alpha
+// channel is either a gradient or a cutout of only 0 and 255.
+static std::vector<uint8_t> test_pixels(bool cutout)
+{
+    std::vector<uint8_t> pixels(TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4);
+
+    for (int y = 0; y < TEST_IMAGE_SIZE; y++)
+    {
+        for (int x = 0; x < TEST_IMAGE_SIZE; x++)
+        {
+            uint8_t*  pixel = &pixels[(y * TEST_IMAGE_SIZE + x) * 4];
+            const int noise = int((uint32_t(x * 7919 + y * 104729) * 2654435761u) >> 29);
+
+            pixel[0] = uint8_t(x * 4 + noise);
+            pixel[1] = uint8_t(y * 3 + noise);
+            pixel[2] = uint8_t(128 + (x - y));
+            pixel[3] = cutout ? ((x / 5 + y / 7) % 2 ? 255 : 0) : uint8_t(255 - x * 2);
+        }
+    }
+
+    return pixels;
+}
+
+static std::vector<uint8_t> decode(const CompressionType& compression, const std::vector<uint8_t>& blocks)
+{
+    const int            blocks_x = TEST_IMAGE_SIZE / 4;
+    std::vector<uint8_t> pixels(TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4);
+
+    for (int by = 0; by < blocks_x; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* block = &blocks[(by * blocks_x + bx) * compressed_block_size(compression)];
+
+            nv::ColorBlock colors;
+
+            if (compression == COMPRESSION_BC1 || compression == COMPRESSION_BC1a)
+                ((const nv::BlockDXT1*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC3)
+                ((const nv::BlockDXT5*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC4)
+                ((const nv::BlockATI1*)block)->decodeBlock(&colors);
+            else if (compression == COMPRESSION_BC5)
+                ((const nv::BlockATI2*)block)->decodeBlock(&colors);
+            else
+                ((const nv::BlockBC7*)block)->decodeBlock(&colors);
+
+            for (int y = 0; y < 4; y++)
+            {
+                for (int x = 0; x < 4; x++)
+                {
+                    const nv::Color32 color = colors.color(x, y);
+                    uint8_t*          pixel = &pixels[((by * 4 + y) * TEST_IMAGE_SIZE + bx * 4 + x) * 4];
+
+                    pixel[0] = color.r;
+                    pixel[1] = color.g;
+                    pixel[2] = color.b;
+                    pixel[3] = color.a;
+                }
+            }
+        }
+    }
+
+    return pixels;
+}
+
+static float psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int first_channel, int channels)
+{
+    double error = 0.0;
+
+    for (size_t i = 0; i < a.size() / 4; i++)
+    {
+        for (int c = first_channel; c < first_channel + channels; c++)
+        {
+            const double delta = double(a[i * 4 + c]) - double(b[i * 4 + c]);
+            error += delta * delta;
+        }
+    }
+
+    const double mse = error / (double(a.size() / 4) * channels);
+
+    return mse == 0.0 ? 100.0f : float(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+static std::vector<uint8_t> encode(const CompressionType& compression, const CompressionQuality& quality, const std::vector<uint8_t>& pixels)
+{
+    std::vector<uint8_t> blocks(compressed_size(compression, TEST_IMAGE_SIZE, TEST_IMAGE_SIZE));
+
+    bc_encode(compression, quality, pixels.data(), TEST_IMAGE_SIZE, TEST_IMAGE_SIZE, 4, blocks.data());
+
+    return blocks;
+}
+
+static void test_round_trips()
+{
+    const std::vector<uint8_t> pixels = test_pixels(false);
+
+    for (int q = COMPRESSION_QUALITY_FAST; q <= COMPRESSION_QUALITY_HIGH; q++)
+    {
+        const CompressionQuality quality = CompressionQuality(q);
+
+        CHECK(psnr(pixels, decode(COMPRESSION_BC1, encode(COMPRESSION_BC1, quality, pixels)), 0, 3) > 34.0f);
+        CHECK(psnr(pixels, decode(COMPRESSION_BC3, encode(COMPRESSION_BC3, quality, pixels)), 0, 4) > 36.0f);
+        CHECK(psnr(pixels, decode(COMPRESSION_BC4, encode(COMPRESSION_BC4, quality, pixels)), 0, 1) > 40.0f);
+        CHECK(psnr(pixels, decode(COMPRESSION_BC5, encode(COMPRESSION_BC5, quality, pixels)), 0, 2) > 40.0f);
+    }
+
+    // Higher tiers search more and never end up worse.
+    const float fast = psnr(pixels, decode(COMPRESSION_BC1, encode(COMPRESSION_BC1, COMPRESSION_QUALITY_FAST, pixels)), 0, 3);
+    const float high = psnr(pixels, decode(COMPRESSION_BC1, encode(COMPRESSION_BC1, COMPRESSION_QUALITY_HIGH, pixels)), 0, 3);
+
+    CHECK(high >= fast);
+}
+
+// BC7 stores all four channels at a higher quality than BC3 on every preset.
+static void test_bc7()
+{
+    const std::vector<uint8_t> pixels = test_pixels(false);
+
+    for (int q = COMPRESSION_QUALITY_FAST; q <= COMPRESSION_QUALITY_HIGH; q++)
+    {
+        const CompressionQuality quality = CompressionQuality(q);
+
+        const float bc3 = psnr(pixels, decode(COMPRESSION_BC3, encode(COMPRESSION_BC3, quality, pixels)), 0, 4);
+        const float bc7 = psnr(pixels, decode(COMPRESSION_BC7, encode(COMPRESSION_BC7, quality, pixels)), 0, 4);
+
+        CHECK(bc7 > 38.0f);
+        CHECK(bc7 > bc3);
+    }
+}
+
+// BC1a stores transparent texels in the three color mode of a block.
+static void test_bc1a()
+{
+    const std::vector<uint8_t> pixels  = test_pixels(true);
+    const std::vector<uint8_t> decoded = decode(COMPRESSION_BC1a, encode(COMPRESSION_BC1a, COMPRESSION_QUALITY_NORMAL, pixels));
+
+    // Cutout alpha survives exactly, and the color of visible pixels stays close.
+    double error   = 0.0;
+    size_t visible = 0;
+    bool   alpha   = true;
+
+    for (size_t i = 0; i < pixels.size() / 4; i++)
+    {
+        alpha &= pixels[i * 4 + 3] == decoded[i * 4 + 3];
+
+        if (pixels[i * 4 + 3] == 0)
+            continue;
+
+        for (int c = 0; c < 3; c++)
+            error += (double(pixels[i * 4 + c]) - double(decoded[i * 4 + c])) * (double(pixels[i * 4 + c]) - double(decoded[i * 4 + c]));
+
+        visible++;
+    }
+
+    CHECK(alpha);
+    CHECK(visible > 0 && 10.0 * log10(255.0 * 255.0 / (error / double(visible * 3) + 1e-9)) > 35.0);
+}
+
+static void test_bc6h()
+{
+    std::vector<float> pixels(TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 3);
+
+    for (int y = 0; y < TEST_IMAGE_SIZE; y++)
+    {
+        for (int x = 0; x < TEST_IMAGE_SIZE; x++)
+        {
+            float* pixel = &pixels[(y * TEST_IMAGE_SIZE + x) * 3];
+
+            pixel[0] = expf(float(x - 32) / 8.0f);
+            pixel[1] = float(y) / 16.0f;
+            pixel[2] = 0.25f;
+        }
+    }
+
+    std::vector<uint8_t> blocks(compressed_size(COMPRESSION_BC6, TEST_IMAGE_SIZE, TEST_IMAGE_SIZE));
+
+    bc6h_encode(bc6h_preset(COMPRESSION_QUALITY_NORMAL), pixels.data(), TEST_IMAGE_SIZE, TEST_IMAGE_SIZE, 3, blocks.data());
+
+    // Mean relative error, BC6H keeps about as many significant bits as a half float in smooth blocks.
+    const int blocks_x = TEST_IMAGE_SIZE / 4;
+    double    error    = 0.0;
+
+    for (int by = 0; by < blocks_x; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            nv::Vector4 colors[16];
+
+            ((const nv::BlockBC6*)&blocks[(by * blocks_x + bx) * 16])->decodeBlock(colors);
+
+            for (int i = 0; i < 16; i++)
+            {
+                const float* pixel = &pixels[((by * 4 + i / 4) * TEST_IMAGE_SIZE + bx * 4 + i % 4) * 3];
+
+                error += fabs(colors[i].x - pixel[0]) / (pixel[0] + 1e-3);
+                error += fabs(colors[i].y - pixel[1]) / (pixel[1] + 1e-3);
+                error += fabs(colors[i].z - pixel[2]) / (pixel[2] + 1e-3);
+            }
+        }
+    }
+
+    CHECK(error / double(pixels.size()) < 0.03);
+}
+
+int main()
+{
+    CHECK(bc_encoder_supports(COMPRESSION_BC5));
+    CHECK(bc_encoder_supports(COMPRESSION_BC1a));
+    CHECK(!bc_encoder_supports(COMPRESSION_BC2));
+
+    test_round_trips();
+    test_bc7();
+    test_bc1a();
+    test_bc6h();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+#include "test.h"
+#include <common/brdf.h>
+
+using namespace ast;
+
+static void test_lut()
+{
+    BRDFLUTOptions options;
+
+    options.size         = 32;
+    options.sample_count = 256;
+    options.multi_lut    = true;
+
+    Image lut;
+
+    CHECK(generate_brdf_lut(lut, options));
+    CHECK(lut.type == PIXEL_TYPE_FLOAT32 && lut.components == 4);
+    CHECK(lut.data[0][0].width == 32 && lut.data[0][0].height == 32);
+
+    const float* pixels = (const float*)lut.data[0][0].data;
+
+    bool in_range = true;
+
+    for (int i = 0; i < 32 * 32; i++)
+    {
+        const float* texel = &pixels[i * 4];
+
+        // Scale and bias split the directional albedo of GGX, which never exceeds 1, and the multi-scatter
+        // compensation only ever adds energy. The sheen DFG is not bounded by 1 at grazing angles.
+        in_range &= texel[0] >= 0.0f && texel[1] >= 0.0f && texel[0] + texel[1] <= 1.001f;
+        in_range &= texel[2] >= -1e-4f;
+        in_range &= texel[3] >= 0.0f;
+    }
+
+    CHECK(in_range);
+
+    // A smooth surface seen head on reflects everything: scale + bias = 1 and nothing to compensate.
+    const float* smooth = &pixels[(31 * 32 + 31) * 4];
+
+    CHECK(smooth[0] + smooth[1] > 0.97f);
+    CHECK(smooth[2] < 0.03f);
+
+    // Rough surfaces lose energy to single scattering, which the compensation gives back.
+    const float* rough = &pixels[(0 * 32 + 16) * 4];
+
+    CHECK(rough[0] + rough[1] < smooth[0] + smooth[1]);
+    CHECK(rough[2] > 0.1f);
+}
+
+// Without multi_lut only the scale and bias are written, and they match the first two channels of the multi LUT.
+static void test_scale_bias_only()
+{
+    BRDFLUTOptions options;
+
+    options.size         = 16;
+    options.sample_count = 64;
+
+    Image lut;
+    Image multi_lut;
+
+    CHECK(generate_brdf_lut(lut, options));
+
+    options.multi_lut = true;
+
+    CHECK(generate_brdf_lut(multi_lut, options));
+    CHECK(lut.components == 2 && multi_lut.components == 4);
+
+    const float* scale_bias = (const float*)lut.data[0][0].data;
+    const float* multi      = (const float*)multi_lut.data[0][0].data;
+
+    bool same = true;
+
+    for (int i = 0; i < 16 * 16; i++)
+        same &= scale_bias[i * 2] == multi[i * 4] && scale_bias[i * 2 + 1] == multi[i * 4 + 1];
+
+    CHECK(same);
+}
+
+static void test_invalid_options()
+{
+    BRDFLUTOptions options;
+    Image          lut;
+
+    options.size = 1;
+
+    CHECK(!generate_brdf_lut(lut, options));
+
+    options.size         = 16;
+    options.sample_count = 0;
+
+    CHECK(!generate_brdf_lut(lut, options));
+}
+
+int main()
+{
+    test_lut();
+    test_scale_bias_only();
+    test_invalid_options();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,106 @@
+#include "test.h"
+#include <common/build_cache.h>
+#include <fstream>
+
+using namespace ast;
+
+static void write_text(const std::string& path, const std::string& text)
+{
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    f << text;
+}
+
+static void test_hashes()
+{
+    const std::string directory = test_directory("build_cache_hashes");
+    const std::string a         = directory + "/a.txt";
+    const std::string b         = directory + "/b.txt";
+
+    write_text(a, "texture");
+    write_text(b, "texture");
+
+    uint64_t hash_a = 0;
+    uint64_t hash_b = 0;
+
+    CHECK(hash_file(a, hash_a));
+    CHECK(hash_file(b, hash_b));
+    CHECK(hash_a == hash_b);
+    CHECK(hash_a == hash_bytes("texture", 7));
+
+    write_text(b, "texturf");
+
+    CHECK(hash_file(b, hash_b));
+    CHECK(hash_a != hash_b);
+    CHECK(!hash_file(directory + "/missing.txt", hash_b));
+
+    CHECK(hash_combine(1, 2) != hash_combine(2, 1));
+    CHECK(hash_string(0, "a") != hash_string(0, "b"));
+}
+
+static void test_round_trip()
+{
+    const std::string directory = test_directory("build_cache_round_trip");
+    const std::string path      = directory + "/build_cache.txt";
+    const std::string output    = directory + "/mesh.ast";
+    const std::string texture   = directory + "/albedo.png";
+
+    write_text(output, "mesh");
+
+    {
+        BuildCache cache;
+
+        CHECK(!cache.load(path));
+        CHECK(!cache.up_to_date(output, 42));
+
+        cache.update(output, 42, { texture });
+
+        CHECK(cache.up_to_date(output, 42));
+        CHECK(cache.save());
+    }
+
+    // Nothing but the manifest is left in the directory.
+    int files = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+        files += entry.path().filename() != "mesh.ast";
+
+    CHECK(files == 1);
+
+    BuildCache cache;
+
+    CHECK(cache.load(path));
+    CHECK(cache.up_to_date(output, 42));
+    CHECK(!cache.up_to_date(output, 43));
+    CHECK(cache.dependencies(output).size() == 1 && cache.dependencies(output)[0] == texture);
+    CHECK(cache.dependencies(directory + "/other.ast").empty());
+
+    // A deleted output needs to be rebuilt even if its key matches.
+    std::filesystem::remove(output);
+
+    CHECK(!cache.up_to_date(output, 42));
+}
+
+static void test_version_mismatch()
+{
+    const std::string directory = test_directory("build_cache_version");
+    const std::string path      = directory + "/build_cache.txt";
+    const std::string output    = directory + "/image.ast";
+
+    write_text(output, "image");
+    write_text(path, "ast_build_cache 0 0\n000000000000002a " + output + "\n");
+
+    // Manifests of other versions are ignored, so every output is rebuilt.
+    BuildCache cache;
+    cache.load(path);
+
+    CHECK(!cache.up_to_date(output, 42));
+}
+
+int main()
+{
+    test_hashes();
+    test_round_trip();
+    test_version_mismatch();
+
+    return TEST_RESULT();
+}
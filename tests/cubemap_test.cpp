@@ -0,0 +1,91 @@
+#include "test.h"
+#include <common/cubemap.h>
+#include <math.h>
+
+using namespace ast;
+
+// Builds the tables of a 12x6 lat-long map at a width of 8, so table texels cover one and a half source texels in both
+// directions. Source texels in column bright_column have a luminance of 1, all others of 0, or all are 1 if it is -1.
+static bool sampling_tables(int bright_column, Image& tables)
+{
+    Image latlong(PIXEL_TYPE_FLOAT32);
+
+    latlong.allocate(PIXEL_TYPE_FLOAT32, 12, 6, 3, 1, 1);
+
+    float* pixels = (float*)latlong.data[0][0].data;
+
+    for (int y = 0; y < 6; y++)
+    {
+        for (int x = 0; x < 12; x++)
+        {
+            for (int c = 0; c < 3; c++)
+                pixels[(y * 12 + x) * 3 + c] = bright_column < 0 || x == bright_column ? 1.0f : 0.0f;
+        }
+    }
+
+    return latlong_sampling_tables(latlong, tables, 8);
+}
+
+// Constant radiance gives uniform conditional CDFs and a marginal CDF that follows sin(theta) of the table rows.
+static void test_uneven_constant()
+{
+    Image tables;
+
+    CHECK(sampling_tables(-1, tables));
+    CHECK(tables.data[0][0].width == 9 && tables.data[0][0].height == 5);
+
+    const float* cdf = (const float*)tables.data[0][0].data;
+
+    bool uniform = true;
+
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x <= 8; x++)
+            uniform &= fabsf(cdf[y * 9 + x] - x / 8.0f) < 1e-5f;
+    }
+
+    CHECK(uniform);
+
+    const float* marginal = cdf + 4 * 9;
+
+    double total = 0.0;
+
+    for (int y = 0; y < 4; y++)
+        total += sin((y + 0.5) * 3.14159265358979 / 4);
+
+    double sum    = 0.0;
+    bool   weighs = true;
+
+    for (int y = 0; y < 4; y++)
+    {
+        sum += sin((y + 0.5) * 3.14159265358979 / 4) / total;
+        weighs &= fabs(marginal[y + 1] - sum) < 1e-5;
+    }
+
+    CHECK(weighs);
+}
+
+// Source column 1 straddles the first two table columns and splits its energy evenly between them.
+static void test_uneven_coverage()
+{
+    Image tables;
+
+    CHECK(sampling_tables(1, tables));
+
+    const float* cdf = (const float*)tables.data[0][0].data;
+
+    bool split = true;
+
+    for (int y = 0; y < 4; y++)
+        split &= fabsf(cdf[y * 9 + 1] - 0.5f) < 1e-5f && fabsf(cdf[y * 9 + 2] - 1.0f) < 1e-5f;
+
+    CHECK(split);
+}
+
+int main()
+{
+    test_uneven_constant();
+    test_uneven_coverage();
+
+    return TEST_RESULT();
+}
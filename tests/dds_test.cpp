@@ -0,0 +1,169 @@
+#include "test.h"
+#include <importer/image_importer.h>
+#include <nvimage/DirectDrawSurface.h>
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+using namespace ast;
+
+// Writes a BC1 sized DDS file whose blocks hold a known byte pattern, faces of cubemaps being consecutive slices.
+static std::vector<uint8_t> write_dds(const std::string& path, nv::DDSHeader& header, uint32_t size, uint32_t mips, uint32_t slices)
+{
+    header.setWidth(size);
+    header.setHeight(size);
+    header.setMipmapCount(mips);
+
+    std::vector<uint8_t> blocks;
+
+    for (uint32_t i = 0; i < slices; i++)
+    {
+        for (uint32_t j = 0; j < mips; j++)
+        {
+            const uint32_t blocks_per_side = std::max(1u, ((size >> j) + 3) / 4);
+
+            for (uint32_t k = 0; k < blocks_per_side * blocks_per_side * 8; k++)
+                blocks.push_back(uint8_t(k * 13 + j * 5 + i * 71));
+        }
+    }
+
+    // Legacy files end the header before the DX10 extension.
+    const size_t header_size = header.hasDX10Header() ? sizeof(nv::DDSHeader) : sizeof(nv::DDSHeader) - sizeof(nv::DDSHeader10);
+
+    std::fstream f(path, std::ios::out | std::ios::binary);
+
+    f.write((const char*)&header, header_size);
+    f.write((const char*)blocks.data(), blocks.size());
+
+    return blocks;
+}
+
+static bool same_blocks(const Image& img, const std::vector<uint8_t>& blocks)
+{
+    size_t offset = 0;
+
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
+        {
+            if (offset + img.data[i][j].size > blocks.size() || memcmp(img.data[i][j].data, &blocks[offset], img.data[i][j].size) != 0)
+                return false;
+
+            offset += img.data[i][j].size;
+        }
+    }
+
+    return offset == blocks.size();
+}
+
+// DX10 BC1 may always hold punch-through alpha and declares its color space.
+static void test_dx10_bc1(const std::string& directory)
+{
+    const std::string path = directory + "/dx10_bc1.dds";
+
+    nv::DDSHeader header;
+
+    header.setTexture2D();
+    header.setDX10Format(nv::DXGI_FORMAT_BC1_UNORM_SRGB);
+
+    const std::vector<uint8_t> blocks = write_dds(path, header, 16, 3, 1);
+
+    Image img;
+
+    CHECK(import_image(img, path, PIXEL_TYPE_UNORM8, 0, true));
+    CHECK(img.compression == COMPRESSION_BC1a);
+    CHECK(img.components == 4);
+    CHECK(img.color_space == COLOR_SPACE_SRGB);
+    CHECK(img.array_slices == 1 && img.mip_slices == 3);
+    CHECK(same_blocks(img, blocks));
+
+    int width = 0, height = 0, components = 0;
+
+    CHECK(image_info(path, width, height, components));
+    CHECK(width == 16 && height == 16 && components == 4);
+
+    CompressionType compression = COMPRESSION_NONE;
+
+    CHECK(image_block_compression(path, compression));
+    CHECK(compression == COMPRESSION_BC1a);
+}
+
+// Legacy DXT1 follows the alpha flag and leaves the color space to the caller.
+static void test_legacy_dxt1(const std::string& directory)
+{
+    for (bool alpha : { false, true })
+    {
+        const std::string path = directory + (alpha ? "/dxt1a.dds" : "/dxt1.dds");
+
+        nv::DDSHeader header;
+
+        header.setTexture2D();
+        header.setFourCC('D', 'X', 'T', '1');
+        header.setHasAlphaFlag(alpha);
+
+        const std::vector<uint8_t> blocks = write_dds(path, header, 8, 1, 1);
+
+        Image img;
+
+        CHECK(import_image(img, path, PIXEL_TYPE_UNORM8, 0, true));
+        CHECK(img.compression == (alpha ? COMPRESSION_BC1a : COMPRESSION_BC1));
+        CHECK(img.components == (alpha ? 4 : 3));
+        CHECK(img.color_space == COLOR_SPACE_UNKNOWN);
+        CHECK(same_blocks(img, blocks));
+
+        int width = 0, height = 0, components = 0;
+
+        CHECK(image_info(path, width, height, components));
+        CHECK(components == img.components);
+    }
+}
+
+// Cubemap faces become six array slices of an image flagged as a cubemap.
+static void test_cubemap(const std::string& directory)
+{
+    const std::string path = directory + "/cube.dds";
+
+    nv::DDSHeader header;
+
+    header.setTextureCube();
+    header.setFourCC('D', 'X', 'T', '1');
+
+    const std::vector<uint8_t> blocks = write_dds(path, header, 8, 2, 6);
+
+    Image img;
+
+    CHECK(import_image(img, path, PIXEL_TYPE_UNORM8, 0, true));
+    CHECK(img.cubemap);
+    CHECK(img.array_slices == 6 && img.mip_slices == 2);
+    CHECK(same_blocks(img, blocks));
+}
+
+// Signed BC6H has no matching compression and cannot be decoded either.
+static void test_signed_bc6h(const std::string& directory)
+{
+    const std::string path = directory + "/bc6h_sf16.dds";
+
+    nv::DDSHeader header;
+
+    header.setTexture2D();
+    header.setDX10Format(nv::DXGI_FORMAT_BC6H_SF16);
+
+    // BC6H blocks are twice the size of BC1 blocks, the file is rejected before they are read.
+    write_dds(path, header, 8, 1, 2);
+
+    Image img;
+
+    CHECK(!import_image(img, path, PIXEL_TYPE_UNORM8, 0, true));
+}
+
+int main()
+{
+    const std::string directory = test_directory("dds");
+
+    test_dx10_bc1(directory);
+    test_legacy_dxt1(directory);
+    test_cubemap(directory);
+    test_signed_bc6h(directory);
+
+    return TEST_RESULT();
+}
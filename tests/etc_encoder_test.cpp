@@ -0,0 +1,125 @@
+#include "test.h"
+#include <exporter/etc_encoder.h>
+#include <nvtt/CompressorETC.h>
+#include <nvmath/Vector.inl>
+#include <math.h>
+#include <vector>
+
+using namespace ast;
+
+#define TEST_IMAGE_SIZE 64
+
+// Smooth gradients with a little deterministic noise and a gradient alpha.
+static std::vector<uint8_t> test_pixels()
+{
+    std::vector<uint8_t> pixels(TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4);
+
+    for (int y = 0; y < TEST_IMAGE_SIZE; y++)
+    {
+        for (int x = 0; x < TEST_IMAGE_SIZE; x++)
+        {
+            uint8_t*  pixel = &pixels[(y * TEST_IMAGE_SIZE + x) * 4];
+            const int noise = int((uint32_t(x * 7919 + y * 104729) * 2654435761u) >> 29);
+
+            pixel[0] = uint8_t(x * 4 + noise);
+            pixel[1] = uint8_t(y * 3 + noise);
+            pixel[2] = uint8_t(128 + (x - y));
+            pixel[3] = uint8_t(255 - x * 2);
+        }
+    }
+
+    return pixels;
+}
+
+// Decodes with the reference decoders of NVTT into RGBA floats in [0, 1].
+static std::vector<float> decode(const CompressionType& compression, const std::vector<uint8_t>& blocks)
+{
+    const int          blocks_x   = TEST_IMAGE_SIZE / 4;
+    const size_t       block_size = compressed_block_size(compression);
+    std::vector<float> pixels(TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4, 0.0f);
+
+    for (int by = 0; by < blocks_x; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* block = &blocks[(by * blocks_x + bx) * block_size];
+
+            nv::Vector4 colors[16];
+
+            for (int i = 0; i < 16; i++)
+                colors[i] = nv::Vector4(0.0f);
+
+            if (compression == COMPRESSION_ETC1 || compression == COMPRESSION_ETC2)
+                nv::decompress_etc(block, colors);
+            else if (compression == COMPRESSION_ETC2_RGBA)
+                nv::decompress_etc_eac(block, colors);
+            else if (compression == COMPRESSION_EAC_R11)
+                nv::decompress_eac(block, colors, 0);
+            else
+            {
+                nv::decompress_eac(block, colors, 0);
+                nv::decompress_eac(block + 8, colors, 1);
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                float* pixel = &pixels[((by * 4 + i / 4) * TEST_IMAGE_SIZE + bx * 4 + i % 4) * 4];
+
+                for (int c = 0; c < 4; c++)
+                    pixel[c] = colors[i].component[c];
+            }
+        }
+    }
+
+    return pixels;
+}
+
+static float psnr(const CompressionType& compression, const CompressionQuality& quality, int channels)
+{
+    const std::vector<uint8_t> pixels = test_pixels();
+    std::vector<uint8_t>       blocks(compressed_size(compression, TEST_IMAGE_SIZE, TEST_IMAGE_SIZE));
+
+    etc_encode(compression, quality, pixels.data(), TEST_IMAGE_SIZE, TEST_IMAGE_SIZE, 4, blocks.data());
+
+    const std::vector<float> decoded = decode(compression, blocks);
+
+    double error = 0.0;
+
+    for (size_t i = 0; i < pixels.size() / 4; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            const double delta = double(pixels[i * 4 + c]) - double(decoded[i * 4 + c]) * 255.0;
+            error += delta * delta;
+        }
+    }
+
+    const double mse = error / (double(pixels.size() / 4) * channels);
+
+    return mse == 0.0 ? 100.0f : float(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+int main()
+{
+    CHECK(etc_encoder_supports(COMPRESSION_ETC2_RGBA));
+    CHECK(!etc_encoder_supports(COMPRESSION_BC1));
+
+    for (int q = COMPRESSION_QUALITY_FAST; q <= COMPRESSION_QUALITY_HIGH; q++)
+    {
+        const CompressionQuality quality = CompressionQuality(q);
+
+        CHECK(psnr(COMPRESSION_ETC1, quality, 3) > 28.0f);
+        CHECK(psnr(COMPRESSION_ETC2, quality, 3) > 28.0f);
+        CHECK(psnr(COMPRESSION_ETC2_RGBA, quality, 4) > 29.5f);
+        CHECK(psnr(COMPRESSION_EAC_R11, quality, 1) > 45.0f);
+        CHECK(psnr(COMPRESSION_EAC_RG11, quality, 2) > 45.0f);
+    }
+
+    // PVRTC 4bpp levels are never smaller than 2x2 blocks of 8 bytes.
+    CHECK(compressed_size(COMPRESSION_PVR, 64, 64) == 64 * 64 / 2);
+    CHECK(compressed_size(COMPRESSION_PVR, 8, 8) == 32);
+    CHECK(compressed_size(COMPRESSION_PVR, 4, 4) == 32);
+    CHECK(compressed_size(COMPRESSION_PVR, 1, 1) == 32);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,304 @@
+#include "test.h"
+#include <exporter/image_exporter.h>
+#include <loader/loader.h>
+#include <importer/image_importer.h>
+#include <common/header.h>
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+using namespace ast;
+
+static void fill(Image& img)
+{
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        uint8_t* pixels = (uint8_t*)img.data[i][0].data;
+
+        for (size_t j = 0; j < img.data[i][0].size; j++)
+            pixels[j] = uint8_t(j * 7 + i * 31);
+    }
+}
+
+static size_t count_files(const std::string& directory)
+{
+    size_t          count = 0;
+    std::error_code error;
+
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+        count += it->is_regular_file();
+
+    return count;
+}
+
+// Uncompressed levels come back byte for byte from both containers.
+static void test_round_trip(const ImageContainer& container, const char* extension)
+{
+    const std::string directory = test_directory(std::string("image_file_round_trip_") + extension);
+
+    Image img;
+
+    img.name = "array";
+    img.allocate(PIXEL_TYPE_UNORM8, 16, 8, 4, 2, 1);
+    fill(img);
+
+    ImageExportOptions options;
+
+    options.path      = directory;
+    options.container = container;
+
+    CHECK(export_image(img, options));
+
+    Image loaded;
+
+    CHECK(load_image(directory + "/array." + extension, loaded));
+    CHECK(loaded.compression == COMPRESSION_NONE);
+    CHECK(loaded.type == PIXEL_TYPE_UNORM8);
+    CHECK(loaded.components == 4);
+    CHECK(loaded.array_slices == 2);
+    CHECK(loaded.mip_slices == 1);
+    CHECK(!loaded.cubemap);
+
+    for (int i = 0; i < 2 && loaded.array_slices == 2; i++)
+    {
+        CHECK(loaded.data[i][0].width == 16 && loaded.data[i][0].height == 8);
+        CHECK(loaded.data[i][0].size == img.data[i][0].size);
+        CHECK(memcmp(loaded.data[i][0].data, img.data[i][0].data, img.data[i][0].size) == 0);
+    }
+}
+
+// Block compressed cubemaps keep their faces, mips and cubemap flag in KTX2 files.
+static void test_ktx2_cubemap()
+{
+    const std::string directory = test_directory("image_file_cubemap");
+
+    Image img;
+
+    img.name    = "cube";
+    img.cubemap = true;
+    img.allocate(PIXEL_TYPE_UNORM8, 8, 8, 4, 6, 1);
+    fill(img);
+
+    ImageExportOptions options;
+
+    options.path        = directory;
+    options.container   = IMAGE_CONTAINER_KTX2;
+    options.compression = COMPRESSION_BC7;
+    options.output_mips = -1;
+
+    CHECK(export_image(img, options));
+
+    Image loaded;
+
+    CHECK(load_image(directory + "/cube.ktx2", loaded));
+    CHECK(loaded.cubemap);
+    CHECK(loaded.compression == COMPRESSION_BC7);
+    CHECK(loaded.array_slices == 6);
+    CHECK(loaded.mip_slices == 4);
+
+    for (int i = 0; i < loaded.array_slices && loaded.mip_slices == 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+            CHECK(loaded.data[i][j].width == (8 >> j) && loaded.data[i][j].size == compressed_size(COMPRESSION_BC7, 8 >> j, 8 >> j));
+    }
+
+    // A 2D array with the same faces is not written as a cubemap.
+    img.cubemap = false;
+    img.name    = "array";
+
+    CHECK(export_image(img, options));
+    CHECK(load_image(directory + "/array.ktx2", loaded));
+    CHECK(!loaded.cubemap);
+    CHECK(loaded.array_slices == 6);
+}
+
+// Images that are loaded or imported into again release and reset what they held before.
+static void test_reload()
+{
+    const std::string directory = test_directory("image_file_reload");
+
+    Image img;
+
+    img.name    = "cube";
+    img.cubemap = true;
+    img.allocate(PIXEL_TYPE_UNORM8, 4, 4, 4, 6, 1);
+    fill(img);
+
+    ImageExportOptions options;
+
+    options.path        = directory;
+    options.container   = IMAGE_CONTAINER_KTX2;
+    options.compression = COMPRESSION_BC1;
+
+    CHECK(export_image(img, options));
+
+    // 2x1 binary PPM, which stb reads into a level of its own.
+    std::ofstream ppm(directory + "/pixels.ppm", std::ios::out | std::ios::binary);
+
+    ppm << "P6\n2 1\n255\n";
+    ppm.write("\x10\x20\x30\x40\x50\x60", 6);
+    ppm.close();
+
+    Image loaded;
+
+    CHECK(load_image(directory + "/cube.ktx2", loaded));
+    CHECK(load_image(directory + "/cube.ktx2", loaded));
+    CHECK(import_image(loaded, directory + "/pixels.ppm"));
+    CHECK(loaded.compression == COMPRESSION_NONE && !loaded.cubemap);
+    CHECK(loaded.array_slices == 1 && loaded.components == 3);
+    CHECK(loaded.data[0][0].width == 2 && ((const uint8_t*)loaded.data[0][0].data)[3] == 0x40);
+    CHECK(import_image(loaded, directory + "/pixels.ppm"));
+    CHECK(load_image(directory + "/cube.ktx2", loaded));
+    CHECK(loaded.cubemap && loaded.array_slices == 6);
+}
+
+// Writes an uncompressed RGBA8 .ast image with the given mip headers followed by 1 KB of zeros.
+static void write_ast(const std::string& path, uint8_t mips, const std::vector<BINMipSliceHeader>& mip_headers)
+{
+    BINFileHeader  file_header;
+    BINImageHeader image_header;
+
+    memcpy(&file_header.magic, "ast", 4);
+    file_header.version = AST_VERSION;
+    file_header.type    = ASSET_IMAGE;
+
+    image_header.compression      = COMPRESSION_NONE;
+    image_header.channel_size     = PIXEL_TYPE_UNORM8;
+    image_header.num_channels     = 4;
+    image_header.num_array_slices = 1;
+    image_header.num_mip_slices   = mips;
+
+    const uint16_t len = 6;
+
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    f.write((const char*)&file_header, sizeof(file_header));
+    f.write((const char*)&len, sizeof(len));
+    f.write("broken", len);
+    f.write((const char*)&image_header, sizeof(image_header));
+    f.write((const char*)mip_headers.data(), sizeof(BINMipSliceHeader) * mip_headers.size());
+    f.write(std::string(1024, '\0').c_str(), 1024);
+}
+
+// Headers that claim more mips than an image holds are rejected before anything is read into it.
+static void test_ast_mip_limit()
+{
+    const std::string path = test_directory("image_file_mip_limit") + "/broken.ast";
+
+    for (uint8_t mips : { uint8_t(0), uint8_t(17) })
+    {
+        write_ast(path, mips, {});
+
+        Image loaded;
+
+        CHECK(!load_image(path, loaded));
+    }
+}
+
+// Stored level sizes have to match the dimensions and format of the level, negative or oversized ones are rejected.
+static void test_ast_mip_sizes()
+{
+    const std::string path = test_directory("image_file_mip_sizes") + "/broken.ast";
+
+    for (int size : { -1, 0, 63, 65, 0x7fffffff })
+    {
+        write_ast(path, 1, { BINMipSliceHeader { 4, 4, size } });
+
+        Image loaded;
+
+        CHECK(!load_image(path, loaded));
+    }
+
+    write_ast(path, 1, { BINMipSliceHeader { 4, 4, 64 } });
+
+    Image loaded;
+
+    CHECK(load_image(path, loaded));
+    CHECK(loaded.data[0][0].size == 64);
+}
+
+// Every level lives in one allocation, array slice major, which is the order .ast files store them in.
+static void test_contiguous_storage()
+{
+    Image img;
+
+    img.allocate(PIXEL_TYPE_UNORM8, 16, 8, 4, 3, 4);
+
+    const uint8_t* expected = (const uint8_t*)img.storage;
+    bool           in_order = true;
+
+    for (int i = 0; i < img.array_slices; i++)
+    {
+        for (int j = 0; j < img.mip_slices; j++)
+        {
+            in_order &= img.data[i][j].data == expected;
+            expected += img.data[i][j].size;
+        }
+    }
+
+    CHECK(in_order);
+    CHECK(expected == (const uint8_t*)img.storage + img.storage_size());
+
+    Image copy = img;
+
+    CHECK(copy.storage != img.storage && copy.storage_size() == img.storage_size());
+}
+
+// Exports with the same image and options share an artifact, anything that changes the output gets its own.
+static void test_artifact_keys()
+{
+    const std::string directory = test_directory("image_file_artifact_keys");
+
+    ArtifactStore store;
+
+    CHECK(store.open(directory + "/store"));
+
+    Image img;
+
+    img.name = "albedo";
+    img.allocate(PIXEL_TYPE_UNORM8, 8, 8, 4, 1, 1);
+    fill(img);
+
+    ImageExportOptions options;
+
+    options.path  = directory + "/a";
+    options.store = &store;
+
+    CHECK(export_image(img, options));
+    CHECK(count_files(directory + "/store") == 1);
+
+    options.path = directory + "/b";
+
+    CHECK(export_image(img, options));
+    CHECK(count_files(directory + "/store") == 1);
+    CHECK(count_files(directory + "/b") == 1);
+
+    options.compression = COMPRESSION_BC1;
+
+    CHECK(export_image(img, options));
+    CHECK(count_files(directory + "/store") == 2);
+
+    ((uint8_t*)img.data[0][0].data)[0]++;
+
+    CHECK(export_image(img, options));
+    CHECK(count_files(directory + "/store") == 3);
+
+    img.color_space = COLOR_SPACE_LINEAR;
+
+    CHECK(export_image(img, options));
+    CHECK(count_files(directory + "/store") == 4);
+}
+
+int main()
+{
+    test_contiguous_storage();
+    test_round_trip(IMAGE_CONTAINER_AST, "ast");
+    test_round_trip(IMAGE_CONTAINER_KTX2, "ktx2");
+    test_ktx2_cubemap();
+    test_reload();
+    test_ast_mip_limit();
+    test_ast_mip_sizes();
+    test_artifact_keys();
+
+    return TEST_RESULT();
+}
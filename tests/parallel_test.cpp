@@ -0,0 +1,110 @@
+#include "test.h"
+#include <common/parallel.h>
+#include <atomic>
+#include <vector>
+
+using namespace ast;
+
+static bool all_equal(const std::vector<std::atomic<int32_t>>& hits, int32_t value)
+{
+    for (const auto& hit : hits)
+    {
+        if (hit != value)
+            return false;
+    }
+
+    return true;
+}
+
+static void test_parallel_for()
+{
+    std::vector<std::atomic<int32_t>> hits(1000);
+
+    for (auto& hit : hits)
+        hit = 0;
+
+    parallel_for(0, int32_t(hits.size()), [&](int32_t i) { hits[i]++; });
+
+    CHECK(all_equal(hits, 1));
+
+    int32_t calls = 0;
+
+    parallel_for(5, 5, [&](int32_t) { calls++; });
+
+    CHECK(calls == 0);
+}
+
+static void test_task_pool()
+{
+    TaskPool             pool(4);
+    std::atomic<int32_t> count(0);
+
+    CHECK(pool.num_threads() == 4);
+
+    // Tasks that submit more tasks are waited for as well.
+    for (int i = 0; i < 16; i++)
+    {
+        pool.submit([&]() {
+            for (int j = 0; j < 16; j++)
+                pool.submit([&]() { count++; });
+
+            count++;
+        });
+    }
+
+    pool.wait();
+
+    CHECK(count == 16 * 16 + 16);
+}
+
+static void test_nested_parallel_for()
+{
+    const int32_t tasks = 4;
+    const int32_t size  = 512;
+
+    TaskPool                          pool(4);
+    std::vector<std::atomic<int32_t>> hits(tasks * size);
+
+    for (auto& hit : hits)
+        hit = 0;
+
+    // A parallel_for inside a task is split into tasks of the pool and still covers every index exactly once.
+    for (int32_t task = 0; task < tasks; task++)
+        pool.submit([&, task]() { parallel_for(0, size, [&](int32_t i) { hits[task * size + i]++; }); });
+
+    pool.wait();
+
+    CHECK(all_equal(hits, 1));
+}
+
+static void test_wait_counter()
+{
+    TaskPool             pool(2);
+    std::atomic<int32_t> remaining(32);
+    std::atomic<int32_t> finished(0);
+
+    for (int i = 0; i < 32; i++)
+    {
+        pool.submit([&]() {
+            finished++;
+            remaining--;
+        });
+    }
+
+    pool.wait(remaining);
+
+    CHECK(remaining == 0);
+    CHECK(finished == 32);
+
+    pool.wait();
+}
+
+int main()
+{
+    test_parallel_for();
+    test_task_pool();
+    test_nested_parallel_for();
+    test_wait_counter();
+
+    return TEST_RESULT();
+}
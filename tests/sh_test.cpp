@@ -0,0 +1,160 @@
+#include "test.h"
+#include <common/sh.h>
+#include <common/cubemap.h>
+#include <math.h>
+
+using namespace ast;
+
+// Radiance whose red, green and blue channels each hold one basis function. Projecting it must give back a single
+// coefficient of one per channel, which checks the basis, the solid angles and the texel directions together.
+struct BasisRadiance
+{
+    int order;
+    int basis[3];
+};
+
+static void radiance(const BasisRadiance& source, const float* dir, float* rgb)
+{
+    float basis[SH_MAX_COEFFICIENTS];
+
+    sh_basis(dir, source.order, basis);
+
+    for (int c = 0; c < 3; c++)
+        rgb[c] = basis[source.basis[c]];
+}
+
+static bool matches_basis(const BasisRadiance& source, const SHCoefficients& coefficients, float tolerance)
+{
+    for (int k = 0; k < coefficients.order * coefficients.order; k++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const float expected = k == source.basis[c] ? 1.0f : 0.0f;
+
+            if (fabsf(coefficients.c[k][c] - expected) > tolerance)
+            {
+                printf("Coefficient %d of channel %d is %f instead of %f\n", k, c, coefficients.c[k][c], expected);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static void test_cubemap_projection(const BasisRadiance& source)
+{
+    const int size = 32;
+
+    Image cube(PIXEL_TYPE_FLOAT32);
+
+    cube.allocate(PIXEL_TYPE_FLOAT32, size, size, 3, 6, 1);
+    cube.cubemap = true;
+
+    for (int face = 0; face < 6; face++)
+    {
+        float* pixels = (float*)cube.data[face][0].data;
+
+        for (int y = 0; y < size; y++)
+        {
+            for (int x = 0; x < size; x++)
+            {
+                float dir[3];
+
+                cubemap_direction(face, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f, dir);
+
+                const float length = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+
+                for (int c = 0; c < 3; c++)
+                    dir[c] /= length;
+
+                radiance(source, dir, &pixels[(y * size + x) * 3]);
+            }
+        }
+    }
+
+    SHCoefficients coefficients;
+
+    coefficients.order = source.order;
+
+    CHECK(project_sh(cube, coefficients));
+    CHECK(matches_basis(source, coefficients, 0.01f));
+
+    coefficients.order = SH_MAX_ORDER + 1;
+
+    CHECK(!project_sh(cube, coefficients));
+}
+
+// The lat-long projection has to agree with the cubemap one. Texels use the mapping of the projection:
+// u = (pi + atan2(x, z)) / (2 pi), v = theta / pi with +Y up.
+static void test_latlong_projection(const BasisRadiance& source)
+{
+    const int   width  = 128;
+    const int   height = 64;
+    const float pi     = 3.14159265f;
+
+    Image latlong(PIXEL_TYPE_FLOAT32);
+
+    latlong.allocate(PIXEL_TYPE_FLOAT32, width, height, 3, 1, 1);
+
+    float* pixels = (float*)latlong.data[0][0].data;
+
+    for (int y = 0; y < height; y++)
+    {
+        const float theta = (y + 0.5f) * pi / height;
+
+        for (int x = 0; x < width; x++)
+        {
+            const float phi    = (x + 0.5f) * 2.0f * pi / width - pi;
+            const float dir[3] = { sinf(theta) * sinf(phi), cosf(theta), sinf(theta) * cosf(phi) };
+
+            radiance(source, dir, &pixels[(y * width + x) * 3]);
+        }
+    }
+
+    SHCoefficients coefficients;
+
+    coefficients.order = source.order;
+
+    CHECK(project_sh_latlong(latlong, coefficients));
+    CHECK(matches_basis(source, coefficients, 0.01f));
+}
+
+// Constant radiance L gives an irradiance of pi * L for every normal.
+static void test_cosine_convolution()
+{
+    SHCoefficients coefficients;
+
+    coefficients.c[0][0] = coefficients.c[0][1] = coefficients.c[0][2] = 2.0f * sqrtf(3.14159265f);
+
+    sh_convolve_cosine(coefficients);
+
+    const float normals[3][3] = { { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, -0.6f, 0.8f } };
+
+    for (const auto& normal : normals)
+    {
+        float basis[SH_MAX_COEFFICIENTS];
+
+        sh_basis(normal, coefficients.order, basis);
+
+        float irradiance = 0.0f;
+
+        for (int k = 0; k < coefficients.order * coefficients.order; k++)
+            irradiance += coefficients.c[k][0] * basis[k];
+
+        CHECK(fabsf(irradiance - 3.14159265f) < 1e-3f);
+    }
+}
+
+int main()
+{
+    test_cubemap_projection({ 3, { 0, 2, 7 } });
+
+    // L3 and L4 bands.
+    test_cubemap_projection({ 5, { 9, 12, 20 } });
+
+    test_latlong_projection({ 3, { 0, 2, 7 } });
+    test_cosine_convolution();
+
+    return TEST_RESULT();
+}
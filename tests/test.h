@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdio.h>
+#include <filesystem>
+#include <string>
+
+// Every test is an executable that runs all of its checks, prints the ones that failed and returns 1 if any did.
+static int g_failed_checks = 0;
+
+#define CHECK(condition)                                                     \
+    do                                                                       \
+    {                                                                        \
+        if (!(condition))                                                    \
+        {                                                                    \
+            printf("FAILED: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+            g_failed_checks++;                                               \
+        }                                                                    \
+    } while (0)
+
+#define TEST_RESULT() (g_failed_checks > 0 ? 1 : 0)
+
+// Returns an empty directory in the temporary directory of the system, named after the test.
+static inline std::string test_directory(const std::string& name)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / ("ast_" + name);
+
+    std::error_code error;
+    std::filesystem::remove_all(path, error);
+    std::filesystem::create_directories(path, error);
+
+    return path.string();
+}